@@ -18,5 +18,7 @@
 #define HD_INVALID_ID (-1)
 // A sufficiently large number representing (positive) infinity.
 #define HD_INFINITY (1e20)
+// The ratio of a circle's circumference to its diameter.
+#define HD_PI (3.14159265358979323846)
 
 #endif // _CONST_H_
\ No newline at end of file
@@ -0,0 +1,118 @@
+#ifndef _COMPRESSED_MESH_STORAGE_H_
+#define _COMPRESSED_MESH_STORAGE_H_
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "math/vector3.h"
+#include "geometry/bounding_box3.h"
+#include "util/memory_usage.h"
+
+namespace hd {
+  /**
+   * Compact, read-only storage of mesh geometry, decoded on the fly upon access:
+   *
+   * - Positions are quantized on a uniform grid spanning the bounding box of the mesh, with
+   * either 16 bits (three uint16) or 21 bits (packed into one uint64) per axis.
+   * - Unit normals are octahedral-encoded into two 16-bit signed integers.
+   * - Faces are grouped into clusters of consecutive faces. Vertex indices of each cluster are
+   * stored as 16-bit deltas from the smallest index in the cluster, falling back to full 32-bit
+   * indices only for clusters spanning too large a range of vertices. Spatially coherent vertex
+   * and face orders therefore compress best.
+   *
+   * For more details on octahedral normal encoding please read:
+   *     A Survey of Efficient Representations for Independent Unit Vectors. Z. H. Cigolle et al.
+   *     Journal of Computer Graphics Techniques, Vol. 3, No. 2, 2014.
+   */
+  class CompressedMeshStorage {
+    public:
+    /**
+     * Number of bits used to quantize each coordinate of vertex positions.
+     */
+    enum class PositionPrecision {
+      BITS_16,
+      BITS_21
+    };
+
+    /**
+     * Size and accuracy figures measured when compressing a mesh.
+     */
+    class Stats {
+      public:
+        // Memory footprint of the mesh data before and after compression, in bytes.
+        std::size_t originalBytes;
+        std::size_t compressedBytes;
+        // Largest distance between an original vertex position and its decoded value.
+        double maxPositionError;
+        // Largest angle, in radians, between an original normal and its decoded value.
+        double maxNormalError;
+      public:
+        Stats() : originalBytes(0), compressedBytes(0), maxPositionError(0.0),
+            maxNormalError(0.0) {}
+        double ratio() const;
+    };
+
+    private:
+      // Number of faces per index cluster.
+      static const unsigned int FACE_CLUSTER_SIZE = 64;
+
+      class FaceCluster {
+        public:
+          // Smallest vertex index referred to by faces of this cluster.
+          uint32_t baseVertex;
+          // Offset of the first index of this cluster in either _narrowIndices or _wideIndices.
+          uint32_t offset;
+          // Whether indices are stored in full in _wideIndices.
+          bool isWide;
+      };
+
+      PositionPrecision _precision;
+      Vector3 _origin;
+      // Size of one quantization step along each axis.
+      Vector3 _step;
+      unsigned int _vertexNum;
+      unsigned int _faceNum;
+      std::vector<uint16_t> _positions16;
+      std::vector<uint64_t> _positions21;
+      std::vector<uint32_t> _vertexNormals;
+      std::vector<uint32_t> _faceNormals;
+      std::vector<FaceCluster> _clusters;
+      std::vector<uint16_t> _narrowIndices;
+      std::vector<uint32_t> _wideIndices;
+
+    public:
+      // Compress the given geometry. Either normal list may be empty if it is not needed, in
+      // which case the corresponding normal() getter must not be called.
+      CompressedMeshStorage(const std::vector<Vector3>& positions,
+          const std::vector<Vector3>& vertexNormals,
+          const std::vector<std::array<unsigned int, 3>>& faces,
+          const std::vector<Vector3>& faceNormals,
+          const BoundingBox3& boundingBox,
+          PositionPrecision precision);
+      ~CompressedMeshStorage() {}
+
+      unsigned int vertexNum() const { return _vertexNum; }
+      unsigned int faceNum() const { return _faceNum; }
+      PositionPrecision precision() const { return _precision; }
+      bool hasVertexNormals() const { return !_vertexNormals.empty(); }
+      bool hasFaceNormals() const { return !_faceNormals.empty(); }
+
+      Vector3 pos(unsigned int vid) const;
+      Vector3 vertexNormal(unsigned int vid) const;
+      Vector3 faceNormal(unsigned int fid) const;
+      std::array<unsigned int, 3> face(unsigned int fid) const;
+      // Memory footprint of the compressed data, in bytes.
+      std::size_t memoryBytes() const;
+      // Breakdown of the heap memory held by the compressed data.
+      MemoryUsage memoryUsage() const;
+
+      // Octahedral encoding of unit vectors, exposed for testing.
+      static uint32_t encodeNormal(const Vector3& n);
+      static Vector3 decodeNormal(uint32_t code);
+  };
+}
+
+#endif // _COMPRESSED_MESH_STORAGE_H_
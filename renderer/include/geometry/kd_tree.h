@@ -1,13 +1,24 @@
 #ifndef _KD_TREE_H_
 #define _KD_TREE_H_
 
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <memory>
 #include "geometry/has_bounding_box3.h"
 #include "geometry/triangle3.h"
 #include "geometry/bounding_box3.h"
+#include "geometry/ray3.h"
+#include "geometry/triangular_mesh.h"
+#include "util/arena.h"
+#include "util/memory_usage.h"
 
 namespace hd {
+  class ClusterStore;
+
   /**
    * Data structure for K-d tree, which can provide fast lookup of geometry entities with given
    * range in 3d space.
@@ -30,62 +41,203 @@ namespace hd {
    * a few of which will be supported: partitioning by median, or by SAH (Surface Area Heuristic).
    * For more details, please refer to:
    *     Physically Based Rendering, Third Edition. Matt Pharr, Wenzel Jakob, Greg Humphreys. 
+   *
+   * Entities are partitioned by their gravity centers, so every entity belongs to exactly one
+   * leaf, and the bounding box of each node is that of the entities below it.
+   *
+   * Nodes, entities and the lists of entities of leaves are all allocated from an Arena, either
+   * owned by the tree or shared with the rest of the scene, so that a build makes a handful of
+   * chunk allocations rather than one per node, and teardown is a single bulk release. Subtrees
+   * are built concurrently, each thread allocating from its own arena chunks.
+   *
+   * A tree over an out-of-core mesh (see TriangularMesh::outOfCore()) is built over the bounds
+   * of its clusters instead, and holds no triangles. Leaves refer to clusters, whose pages are
+   * fetched through the ClusterStore of the mesh when a ray reaches their bounds, so that only
+   * the clusters rays actually reach are ever read, and memory stays within the budget of the
+   * store. Entities are still faces, numbered as in the mesh.
    */
-  class KdTree {
-    class PartitionPlane {
-      public:
-        // Represents the type of plane we're using to split the bounding box.
-        // 0 -- x, 1 -- y, 2 -- z.
-        unsigned int planeType;
-        // E.g. if planeType = 0 and value = 1.0, it means the plane is x = 1.0.
-        double value;
-      public:
-        PartitionPlane(): planeType(0), value(0.0) {}
-        PartitionPlane(unsigned int planeTypeArg, double valueArg)
-            : planeType(planeTypeArg), value(valueArg) {}
-    };
-
-    /**
-     * Data structure for a single tree node. Stores pointers to left and right children if not
-     * leaf, or a list of entities stored at leaf node.
-     * If not a leaf node, partition plane is also defined to describe the subdivision between
-     * left and right children.
-     */
-    class Node : public HasBoundingBox3 {
-      public:
-        BoundingBox3 boundingBox;
-        bool isLeaf;
-        std::vector<Triangle3> entities;
-        PartitionPlane partitionPlane;
-        std::shared_ptr<Node> left;
-        std::shared_ptr<Node> right;
-      public:
-        Node() {}
-        ~Node() {}
-    };
-
-    /**
-     * Modes for how a list of geometry entities are partitioned into two lists.
-     */
-    enum PartitionMode {
-      // Sorting all entities by their gravity centers along the longest axis, then
-      // divide them into two equal halves (or differ at most 1) along that axis.
-      CENTER_MEDIAN,
-      // Surface Area Heuristics, a smart way of partitioning list of entities to 
-      // minimize the probablity of rays intersecting with both halves.
-      SAH
-    };
-
-    /**
-     * Modes to limit tree depths.
-     */
-    enum DepthLimitMode {
-      // Set a max level constraint to the tree respect to total number of nodes n.
-      // An experience value of d = 8 + 1.3 * log(N) is proven to be effective.
-      MAX_LEVEL,
-      // Stop partitioning when number of entities enclosed is less than a fixed value.
-      MIN_ENTITIES
-    };
+  class KdTree : public HasBoundingBox3 {
+    public:
+      /**
+       * Modes for how a list of geometry entities are partitioned into two lists.
+       */
+      enum PartitionMode {
+        // Sorting all entities by their gravity centers along the longest axis, then
+        // divide them into two equal halves (or differ at most 1) along that axis.
+        CENTER_MEDIAN,
+        // Surface Area Heuristics, a smart way of partitioning list of entities to 
+        // minimize the probablity of rays intersecting with both halves.
+        SAH
+      };
+
+      /**
+       * Modes to limit tree depths.
+       */
+      enum DepthLimitMode {
+        // Set a max level constraint to the tree respect to total number of nodes n.
+        // An experience value of d = 8 + 1.3 * log(N) is proven to be effective.
+        MAX_LEVEL,
+        // Stop partitioning when number of entities enclosed is less than a fixed value.
+        MIN_ENTITIES
+      };
+
+      /**
+       * Parameters of a build.
+       */
+      class Options {
+        public:
+          PartitionMode partitionMode;
+          DepthLimitMode depthLimitMode;
+          // Max level for MAX_LEVEL mode. 0 picks 8 + 1.3 * log2(N) for N entities.
+          unsigned int maxLevel;
+          // Nodes with at most this many entities are not partitioned any further in
+          // MIN_ENTITIES mode.
+          unsigned int minEntities;
+        public:
+          Options() : partitionMode(SAH), depthLimitMode(MIN_ENTITIES), maxLevel(0),
+              minEntities(4) {}
+      };
+
+      /**
+       * Counts of what traversals touch, e.g. to compare orders of tracing rays where hardware
+       * cache counters are not available.
+       *
+       * Besides nodes visited and entities tested, every access to a node, to the entity
+       * indices of a leaf or to an entity is looked up in a simulated direct-mapped cache of
+       * CACHE_LINE_NUM lines of 64 bytes, i.e. 256 KiB like a typical L2 cache, which persists
+       * across the traversals counted. Cache misses thus depend on the order of traversals as
+       * hardware ones do: they drop when consecutive rays touch the same parts of the tree.
+       *
+       * Not thread-safe: each thread counts with stats of its own, which add up.
+       */
+      class TraversalStats {
+        public:
+          static const unsigned int CACHE_LINE_NUM = 1 << 12;
+
+        public:
+          uint64_t traversalNum;
+          uint64_t nodeNum;
+          uint64_t entityNum;
+          uint64_t cacheMissNum;
+
+        private:
+          // Line held by each slot of the simulated cache, or ~0 if none.
+          std::vector<uintptr_t> _cacheLines;
+
+        public:
+          TraversalStats() : traversalNum(0), nodeNum(0), entityNum(0), cacheMissNum(0) {}
+
+          // Count an access to the given memory in the simulated cache.
+          void access(const void* data, std::size_t size);
+          // Add up the counts of other stats. Their caches are left apart.
+          TraversalStats& operator+=(const TraversalStats& stats);
+      };
+
+    private:
+      class PartitionPlane {
+        public:
+          // Represents the type of plane we're using to split the bounding box.
+          // 0 -- x, 1 -- y, 2 -- z.
+          unsigned int planeType;
+          // E.g. if planeType = 0 and value = 1.0, it means the plane is x = 1.0.
+          double value;
+        public:
+          PartitionPlane(): planeType(0), value(0.0) {}
+          PartitionPlane(unsigned int planeTypeArg, double valueArg)
+              : planeType(planeTypeArg), value(valueArg) {}
+      };
+
+      /**
+       * Data structure for a single tree node. Stores pointers to left and right children if not
+       * leaf, or a list of entities stored at leaf node.
+       * If not a leaf node, partition plane is also defined to describe the subdivision between
+       * left and right children. Nodes live in the arena of the tree and are never destructed.
+       */
+      class Node {
+        public:
+          BoundingBox3 boundingBox;
+          bool isLeaf;
+          // Indices of entities of a leaf, pointing into the entity index list of the tree.
+          const unsigned int* entities;
+          unsigned int entityNum;
+          PartitionPlane partitionPlane;
+          Node* left;
+          Node* right;
+        public:
+          Node() : isLeaf(true), entities(nullptr), entityNum(0), left(nullptr),
+              right(nullptr) {}
+      };
+
+      class BuildContext;
+
+      std::shared_ptr<Arena> _arena;
+      // Triangles of entities, or null for trees over clusters of an out-of-core mesh.
+      const Triangle3* _entities;
+      unsigned int _entityNum;
+      // Store that leaves fetch cluster pages from, for trees over an out-of-core mesh.
+      std::shared_ptr<ClusterStore> _clusterStore;
+      Node* _root;
+      unsigned int _nodeNum;
+      unsigned int _leafNum;
+      unsigned int _depth;
+
+    public:
+      KdTree(const KdTree& tree) = delete;
+      KdTree& operator=(const KdTree& tree) = delete;
+      ~KdTree();
+
+      // Build a tree over the given entities. Tree data is allocated from the given arena, e.g.
+      // a scene-lifetime arena, or from an arena of the tree's own if none is given. Temporary
+      // build buffers are allocated from a scratch arena released at the end of the build.
+      static std::unique_ptr<KdTree> build(const std::vector<Triangle3>& entities,
+          const Options& options = Options(),
+          const std::shared_ptr<Arena>& arena = std::shared_ptr<Arena>());
+      // Build a tree over the faces of a populated mesh. Entity i is face i. Trees over
+      // out-of-core meshes are built over their clusters (see above).
+      static std::unique_ptr<KdTree> build(const TriangularMesh& mesh,
+          const Options& options = Options(),
+          const std::shared_ptr<Arena>& arena = std::shared_ptr<Arena>());
+
+      unsigned int entityNum() const { return _entityNum; }
+      // Triangle of an entity, paged in first for trees over an out-of-core mesh.
+      Triangle3 entity(unsigned int index) const;
+      unsigned int nodeNum() const { return _nodeNum; }
+      unsigned int leafNum() const { return _leafNum; }
+      // Number of levels of the tree, 1 for a single leaf.
+      unsigned int depth() const { return _depth; }
+      BoundingBox3 boundingBox3() const override;
+      std::shared_ptr<Arena> arena() const { return _arena; }
+      // Breakdown of the memory held by this tree, counted the same way as
+      // TriangularMesh::memoryUsage().
+      MemoryUsage memoryUsage(MemoryCounter* counter = nullptr) const;
+
+      // Append to entityIds the indices of all entities whose bounding boxes overlap the given
+      // range, in no particular order.
+      void query(const BoundingBox3& range, std::vector<unsigned int>& entityIds) const;
+      // Find the closest entity hit by the ray at a distance in (tMin, tMax). Returns false and
+      // leaves hit unchanged if there is none. Counts the traversal in stats if given.
+      bool intersect(const Ray3& ray, double tMin, double tMax, RayHit& hit,
+          TraversalStats* stats = nullptr) const;
+      // Whether any entity is hit by the ray at a distance in (tMin, tMax), e.g. whether a
+      // shadow ray is blocked. Cheaper than intersect(), as it stops at the first hit found.
+      bool occluded(const Ray3& ray, double tMin, double tMax,
+          TraversalStats* stats = nullptr) const;
+
+    private:
+      KdTree();
+      // Allocate an empty tree with room for entityNum entities in the given arena, or in an
+      // arena of its own.
+      static std::unique_ptr<KdTree> _allocate(const std::shared_ptr<Arena>& arena,
+          unsigned int entityNum);
+      // Build nodes over all entities once they are in place, or over all clusters of the store
+      // if any.
+      void _buildNodes(const Options& options);
+      Node* _buildNode(BuildContext& context, unsigned int* entityIds, unsigned int count,
+          unsigned int level);
+      // Shared traversal of intersect() and occluded(). Visits nodes front to back, shrinking
+      // tMax to the closest hit found so far, unless anyHit asks to stop at the first one.
+      bool _traverse(const Ray3& ray, double tMin, double tMax, bool anyHit,
+          RayHit* hit, TraversalStats* stats) const;
   };
 }
 
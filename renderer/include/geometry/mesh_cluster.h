@@ -0,0 +1,62 @@
+#ifndef _MESH_CLUSTER_H_
+#define _MESH_CLUSTER_H_
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "math/vector3.h"
+#include "geometry/bounding_box3.h"
+#include "geometry/triangular_mesh.h"
+
+namespace hd {
+  /**
+   * A small, spatially coherent group of connected faces of a triangular mesh (also known as a
+   * meshlet), with its own compact vertex list and conservative bounds for culling.
+   *
+   * Clusters are the unit of work for acceleration structure leaves, compression, streaming and
+   * parallel processing. A mesh is split into clusters by MeshCluster::partition(), which grows
+   * each cluster greedily across shared edges from a seed face, taking seeds in Morton order.
+   * Each step adds the adjacent face introducing the fewest new vertices, closest to the
+   * cluster centroid, until either the face or the vertex limit is reached.
+   *
+   * For more details on normal cone culling please read:
+   *     The Cone of Normals Technique for Fast Processing of Curved Patches. L. A. Shirman,
+   *     S. S. Abi-Ezzi. Computer Graphics Forum 12(3), 1993.
+   */
+  class MeshCluster {
+    public:
+      // Indices of mesh faces belonging to this cluster.
+      std::vector<unsigned int> faces;
+      // Indices of mesh vertices referred to by faces of this cluster, in order of first use.
+      std::vector<unsigned int> vertices;
+      // Three indices into the vertices list above per face, in the same order as faces.
+      std::vector<uint8_t> localTriangles;
+      BoundingBox3 boundingBox;
+      // Bounding sphere of all vertices of this cluster.
+      Vector3 center;
+      double radius;
+      // Normal cone containing the flat normals of all faces: every normal n satisfies
+      // n * coneAxis >= coneCosAngle. A cone angle of 180 degrees (coneCosAngle = -1) means the
+      // cluster cannot be culled by orientation.
+      Vector3 coneAxis;
+      double coneCosAngle;
+
+    public:
+      MeshCluster() : radius(0.0), coneCosAngle(-1.0) {}
+      ~MeshCluster() {}
+
+      // Whether every face of this cluster is guaranteed to face away from the given view
+      // position, i.e. the view position lies behind all of their planes. Conservative: might
+      // return false for clusters that are in fact back-facing, but never the opposite.
+      bool isBackFacing(const Vector3& viewPos) const;
+
+      // Split a populated, uncompressed mesh into clusters of at most maxFaceNum faces and
+      // maxVertexNum vertices each. Every face belongs to exactly one cluster. maxVertexNum must
+      // be at least 3 and at most 256.
+      static std::vector<MeshCluster> partition(const TriangularMesh& mesh,
+          unsigned int maxFaceNum = 128, unsigned int maxVertexNum = 128);
+  };
+}
+
+#endif // _MESH_CLUSTER_H_
@@ -0,0 +1,103 @@
+#ifndef _MESH_SIMPLIFIER_H_
+#define _MESH_SIMPLIFIER_H_
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+#include "math/matrix3.h"
+#include "math/vector3.h"
+#include "geometry/triangular_mesh.h"
+#include "util/indexed_min_heap.h"
+
+namespace hd {
+  /**
+   * Simplification of triangular meshes by iterative edge collapse, guided by quadric error
+   * metrics, used to generate levels of detail (LOD).
+   *
+   * Every vertex carries a quadric measuring the squared distance to the planes of its adjacent
+   * faces. Collapsing an edge merges its two vertices into one placed at the position minimizing
+   * the sum of both quadrics, and the resulting error is the cost of the collapse. Edges are kept
+   * in an indexed priority queue by cost, and the cheapest one is collapsed each time.
+   *
+   * Collapses are performed in place on a working copy of the DCEL: half-edges of the two removed
+   * faces are dropped and their neighbours re-linked as twins, so topology is never rebuilt
+   * between collapses. Collapses that would make the surface non-manifold or flip a face are
+   * rejected. Boundary edges are preserved by additional constraint planes.
+   *
+   * For more details please read:
+   *     Surface Simplification Using Quadric Error Metrics. M. Garland, P. Heckbert. SIGGRAPH 97.
+   */
+  class MeshSimplifier {
+    /**
+     * Quadric error of a point x, represented as Q(x) = x^T * a * x + 2 * b^T * x + c.
+     */
+    class Quadric {
+      public:
+        Matrix3 a;
+        Vector3 b;
+        double c;
+      public:
+        Quadric() : a(Matrix3::zero()), b(Vector3::zero()), c(0.0) {}
+        // Quadric of squared distance to plane n * x + d = 0, with n being unit length.
+        Quadric(const Vector3& n, double d, double weight = 1.0);
+        Quadric& operator+=(const Quadric& rhs);
+        double error(const Vector3& x) const;
+    };
+
+    private:
+      TriangularMesh::VertexNormalMode _vertexNormalMode;
+      TriangularMesh::FaceNormalMode _faceNormalMode;
+      // Working copy of the mesh. Indices of vertices, half-edges and faces are the same as in
+      // the original mesh. Removed elements are marked dead rather than erased.
+      std::vector<Vector3> _positions;
+      std::vector<Vector3> _vertexNormals;
+      std::vector<std::vector<unsigned int>> _outgoingEdges;
+      std::vector<bool> _vertexAlive;
+      std::vector<TriangularMesh::Edge> _edges;
+      std::vector<bool> _edgeAlive;
+      std::vector<std::array<unsigned int, 3>> _faceVertices;
+      std::vector<Vector3> _faceNormals;
+      std::vector<bool> _faceAlive;
+      unsigned int _faceNum;
+
+      std::vector<Quadric> _quadrics;
+      // Optimal position of the merged vertex for collapsing each half-edge.
+      std::vector<Vector3> _targets;
+      // Collapse costs keyed by half-edge. Only one half-edge of each twin pair is queued.
+      IndexedMinHeap _queue;
+
+    public:
+      // Initialize the working copy from a populated mesh.
+      MeshSimplifier(const TriangularMesh& mesh);
+      ~MeshSimplifier() {}
+
+      // Number of faces remaining after collapses so far.
+      unsigned int faceNum() const { return _faceNum; }
+      // Collapse edges until no more than targetFaceNum faces remain, or until no further edge
+      // can be collapsed, and return the simplified mesh. Calls with decreasing targets continue
+      // from the previous state.
+      std::unique_ptr<TriangularMesh> simplify(unsigned int targetFaceNum);
+      // Build a chain of LODs of the given mesh, one for each target face count. Targets must be
+      // in decreasing order, with each LOD simplified further from the previous one.
+      static std::vector<std::unique_ptr<TriangularMesh>> buildLods(
+          const TriangularMesh& mesh, const std::vector<unsigned int>& targetFaceNums);
+
+    private:
+      bool _isCanonical(unsigned int eid) const;
+      bool _isBoundaryVertex(unsigned int vid) const;
+      // Vertices sharing an edge with the given vertex.
+      std::vector<unsigned int> _neighbors(unsigned int vid) const;
+      // Evaluate the cost of collapsing a half-edge and (re)queue it, or drop it from the queue
+      // if it is dead or not the canonical one of its twin pair.
+      void _updateEdge(unsigned int eid);
+      // Whether collapsing the half-edge keeps the mesh manifold and no face flipped.
+      bool _canCollapse(unsigned int eid) const;
+      void _collapse(unsigned int eid);
+      // Build a mesh from all remaining vertices and faces.
+      std::unique_ptr<TriangularMesh> _snapshot() const;
+  };
+}
+
+#endif // _MESH_SIMPLIFIER_H_
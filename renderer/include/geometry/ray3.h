@@ -0,0 +1,48 @@
+#ifndef _RAY3_H_
+#define _RAY3_H_
+
+#pragma once
+
+#include "math/vector3.h"
+#include "const.h"
+
+namespace hd {
+  /**
+   * A ray in 3-d space, i.e. the half line origin + t * direction for t >= 0. The direction
+   * need not be normalized, in which case distances t along the ray are in units of its length.
+   */
+  class Ray3 {
+    public:
+      Vector3 origin;
+      Vector3 direction;
+
+    public:
+      Ray3() : origin(Vector3::zero()), direction(Vector3::zUnit()) {}
+      Ray3(const Vector3& o, const Vector3& d) : origin(o), direction(d) {}
+
+      // Returns the point at distance t along the ray.
+      Vector3 pointAt(double t) const { return origin + direction * t; }
+  };
+
+  /**
+   * Closest intersection of a ray with a set of triangle entities.
+   */
+  class RayHit {
+    public:
+      // Index of the entity hit, or HD_INVALID_ID if none.
+      unsigned int entityId;
+      // Distance along the ray.
+      double t;
+      // Barycentric coordinates of the hit point with respect to v(1) and v(2) of the triangle
+      // hit, i.e. the point is (1 - u - v) * v(0) + u * v(1) + v * v(2).
+      double u;
+      double v;
+
+    public:
+      RayHit() : entityId(HD_INVALID_ID), t(HD_INFINITY), u(0.0), v(0.0) {}
+
+      bool isHit() const { return entityId != static_cast<unsigned int>(HD_INVALID_ID); }
+  };
+}
+
+#endif // _RAY3_H_
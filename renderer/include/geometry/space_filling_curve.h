@@ -0,0 +1,45 @@
+#ifndef _SPACE_FILLING_CURVE_H_
+#define _SPACE_FILLING_CURVE_H_
+
+#pragma once
+
+#include <cstdint>
+#include "math/vector3.h"
+#include "geometry/bounding_box3.h"
+
+namespace hd {
+  /**
+   * Space-filling curves mapping 3-dimensional integer grid coordinates to a 1-dimensional
+   * index, such that points close on the curve are also close in space. Sorting elements by
+   * their curve index therefore places spatially nearby elements near each other in memory.
+   *
+   * - Morton (Z-order) curve interleaves bits of the three coordinates. It is cheap to compute
+   * but has long jumps between octants.
+   * - Hilbert curve only ever steps between adjacent cells, and yields better locality at a
+   * slightly higher computation cost.
+   *
+   * For more details on the Hilbert curve please read:
+   *     Programming the Hilbert Curve. J. Skilling. AIP Conference Proceedings 707, 2004.
+   */
+  enum class SpaceFillingCurve {
+    MORTON,
+    HILBERT
+  };
+
+  // Maximum number of bits per coordinate, so that the index of three coordinates fits in 64
+  // bits.
+  const unsigned int SFC_MAX_BITS = 21;
+
+  // Index of cell (x, y, z) on the Morton curve. Only the lowest 21 bits of each coordinate are
+  // used.
+  uint64_t mortonIndex3(uint32_t x, uint32_t y, uint32_t z);
+  // Index of cell (x, y, z) on the Hilbert curve filling a grid of 2^bits cells along each
+  // axis. All coordinates must be less than 2^bits, and bits must be in [1, 21].
+  uint64_t hilbertIndex3(uint32_t x, uint32_t y, uint32_t z, unsigned int bits = SFC_MAX_BITS);
+  // Index of a point on the given curve, after quantizing the point onto a grid of 2^21 cells
+  // along each axis spanning the given bounding box. Points outside the box are clamped.
+  uint64_t spaceFillingCurveIndex(SpaceFillingCurve curve, const Vector3& p,
+      const BoundingBox3& box);
+}
+
+#endif // _SPACE_FILLING_CURVE_H_
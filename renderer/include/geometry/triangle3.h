@@ -7,6 +7,7 @@
 #include "geometry/bounding_box3.h"
 #include "geometry/has_bounding_box3.h"
 #include "geometry/has_surface_area.h"
+#include "geometry/ray3.h"
 #include "math/vector3.h"
 
 namespace hd {
@@ -45,6 +46,13 @@ namespace hd {
       Vector3 normal() const;
       BoundingBox3 boundingBox3() const;
       double surfaceArea() const;
+
+      // Intersects the ray with this triangle, from either side, using the Moller-Trumbore
+      // algorithm. Returns true if the ray hits the triangle at a distance in (tMin, tMax), in
+      // which case t is set to that distance and u, v to the barycentric coordinates of the
+      // hit point with respect to v(1) and v(2).
+      bool intersect(const Ray3& ray, double tMin, double tMax,
+          double& t, double& u, double& v) const;
   };
 }
 
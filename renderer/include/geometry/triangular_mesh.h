@@ -3,15 +3,27 @@
 
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <memory>
 #include <vector>
+#include "const.h"
 #include "math/vector3.h"
 #include "geometry/bounding_box3.h"
+#include "geometry/compressed_mesh_storage.h"
 #include "geometry/has_surface_area.h"
 #include "geometry/has_bounding_box3.h"
+#include "geometry/space_filling_curve.h"
 #include "geometry/triangle3.h"
+#include "util/alias_table.h"
+#include "util/arena.h"
+#include "util/cow_vector.h"
+#include "util/memory_usage.h"
 
 namespace hd {
+  class ClusterStore;
+  class MeshSerializer;
+
   /**
    * Definitions and operations for a triangular mesh. The mesh is maintained as
    * a Doubly-Connected Edge List (DCEL):
@@ -32,10 +44,23 @@ namespace hd {
    * DCELs require population and calculation of derived data upon creation. The constructors
    * are private and therefore, you must and you can only build a triangular mesh via
    * TriangularMesh::Builder (except for copy constructor).
+   *
+   * Vertex, edge and face lists are copy-on-write buffers (see CowVector), so copying a mesh
+   * takes constant time and memory, and copies share geometry until one of them is modified.
+   *
+   * Populated meshes can be edited in place via TriangularMesh::Editor, which only recomputes
+   * derived data around the edited elements, and saved and loaded without re-population via
+   * MeshSerializer.
+   *
+   * A populated mesh can further be compressed into a read-only, render-only form (see
+   * TriangularMesh::compress()), which trades a small decoding cost in pos(), normal() and
+   * triangle() for several times smaller memory footprint.
+   *
+   * A mesh too large for memory can instead be backed by a ClusterStore file (see
+   * TriangularMesh::outOfCore()), from which pos(), normal() and triangle() page in the cluster
+   * of the face asked for. Such a mesh holds no geometry of its own beyond the cache of the store.
    */
-
-  // TODO: add ser/des solutions.
-  class TriangularMesh : public HasBoundingBox3 {
+  class TriangularMesh : public HasBoundingBox3, public HasSurfaceArea {
     public:
     /**
      * Definitions of vertices of DCEL.
@@ -47,8 +72,10 @@ namespace hd {
         // Normal vector of the vertex. Might be zero if the parent mesh does not support
         // normal interpolation.
         Vector3 normal;
-        // A list of indices of half-edges started from this vertex (outgoing).
-        std::vector<unsigned int> edges;
+        // A list of indices of half-edges started from this vertex (outgoing). Allocated from
+        // the arena of the parent mesh, if any, upon population, and moved to the heap once
+        // edits outgrow that allocation.
+        std::vector<unsigned int, ArenaAllocator<unsigned int>> edges;
       public:
         Vertex(const Vector3& p): pos(p) {}
         Vertex(const Vector3& p, const Vector3& n): pos(p), normal(n) {}
@@ -82,15 +109,19 @@ namespace hd {
       public:
         // List of all vertices' indices of this triangle.
         std::array<unsigned int, 3> vertices;
-        // List of all half-edges belonging to this triangle.
+        // List of all half-edges belonging to this triangle, HD_INVALID_ID until populated.
         // Note: edges in this array might not be sorted in counterclock-wise order. Please
         // rely on edge.nextEdge to traverse the face.
         std::array<unsigned int, 3> edges;
         Vector3 normal;
       public:
-        Face(const std::array<unsigned int, 3>& vid): vertices(vid) {}
+        Face(const std::array<unsigned int, 3>& vid): vertices(vid) {
+          edges.fill(HD_INVALID_ID);
+        }
         Face(const std::array<unsigned int, 3>& vid, const Vector3& fn)
-            : vertices(vid), normal(fn) {}
+            : vertices(vid), normal(fn) {
+          edges.fill(HD_INVALID_ID);
+        }
     };
 
     /**
@@ -154,15 +185,29 @@ namespace hd {
     };
 
     private:
-      std::vector<Vertex> _vertices;
-      std::vector<Edge> _edges;
-      std::vector<Face> _faces;
+      // Arena holding vertex adjacency lists, possibly shared with other meshes and structures
+      // of a scene. Null if they are allocated on the heap.
+      std::shared_ptr<Arena> _arena;
+      CowVector<Vertex> _vertices;
+      CowVector<Edge> _edges;
+      CowVector<Face> _faces;
       BoundingBox3 _boundingBox;
       bool _isPopulated;
       VertexNormalMode _vertexNormalMode;
       FaceNormalMode _faceNormalMode;
+      // Compressed geometry, replacing all of the above vertex, edge and face lists if the mesh
+      // is compressed. Shared between copies as it is immutable.
+      std::shared_ptr<const CompressedMeshStorage> _compressed;
+      // Store paging clusters of faces in on demand, replacing all lists if the mesh is
+      // out-of-core. Faces are numbered as in the store.
+      std::shared_ptr<ClusterStore> _clusterStore;
+      // Alias table over face areas for surface sampling, built upon first use and dropped
+      // whenever geometry changes. Always accessed atomically, as concurrent samplers may race
+      // to build it.
+      mutable std::shared_ptr<const AliasTable> _areaTable;
     
     public:
+      // Copies share vertex, edge and face lists with the original mesh.
       TriangularMesh(const TriangularMesh& mesh);
       ~TriangularMesh();
       class Builder;
@@ -171,11 +216,17 @@ namespace hd {
           FaceNormalMode faceNormalMode);
     private:
       friend class Builder;
+      friend class MeshSerializer;
       TriangularMesh();
 
     public:
       // Get vertex/face/edge at given index. We intentioanlly made these method names
       // super short because they're heavily used in long chaining calls.
+      // Note: compressed meshes have no half-edges, so e() aborts on them. v() and f() decode
+      // positions, indices and the normals kept by compress() instead, with empty vertex
+      // adjacency, HD_INVALID_ID face edges, zero vertex normals unless faces are Phong
+      // interpolated, and flat face normals if they are. Out-of-core meshes have no global
+      // vertex or edge indices, so all three abort on them.
       Vertex v(unsigned int index) const;
       Face f(unsigned int index) const;
       Edge e(unsigned int index) const;
@@ -192,17 +243,40 @@ namespace hd {
       // pos(Meshpoint(f, {a, b, c})) with 0 <= a, b, c <= 1 and a + b + c = 1 will return:
       //    a * v1 + b * b2 + c * v3.
       Vector3 pos(const MeshPoint& p) const;
+      // Batched versions of pos() and normal() for count points given in structure-of-arrays
+      // form: point i lies on face faceIds[i] with parameters (a[i], b[i], c[i]), and its
+      // position or normal is written to (x[i], y[i], z[i]). Vertex data is gathered block by
+      // block into contiguous arrays, so that the arithmetic runs in vectorizable loops rather
+      // than one point at a time. Results equal those of the scalar methods up to rounding.
+      void pos(std::size_t count, const unsigned int* faceIds,
+          const double* a, const double* b, const double* c,
+          double* x, double* y, double* z) const;
+      void normal(std::size_t count, const unsigned int* faceIds,
+          const double* a, const double* b, const double* c,
+          double* x, double* y, double* z) const;
 
-      // Get number of vertices/edges/faces.
+      // Get number of vertices/edges/faces. Compressed meshes have no half-edges, and
+      // out-of-core meshes neither half-edges nor a global vertex list.
       unsigned int vertexNum() const;
       unsigned int edgeNum() const;
       unsigned int faceNum() const;
 
       // More properties and operations.
-      BoundingBox3 boundingBox3() const;
+      BoundingBox3 boundingBox3() const override;
+      double surfaceArea() const override;
 
       VertexNormalMode vertexNormalMode() const;
       FaceNormalMode faceNormalMode() const;
+      // Whether this mesh still shares all of its vertex, edge and face lists with the other one,
+      // e.g. because one is an unmodified copy of the other.
+      bool sharesGeometryWith(const TriangularMesh& other) const;
+      // Arena this mesh allocates from, or null.
+      std::shared_ptr<Arena> arena() const;
+      // Breakdown of the memory held by this mesh. Buffers already in counter are skipped, and
+      // the others are added to it, so that summing over meshes sharing geometry counts it
+      // once. Without a counter, unused space of the arena is included as slack if no other
+      // structure uses the arena.
+      MemoryUsage memoryUsage(MemoryCounter* counter = nullptr) const;
   
     public:
       // Construct all data from row input (usually only vertex coordinates and faces).
@@ -210,20 +284,87 @@ namespace hd {
       // pre-calculation and interpolation of normals.
       void populate();
       bool isPopulated() const;
+
+      // Start editing a populated, uncompressed mesh in place. See TriangularMesh::Editor.
+      class Editor;
+      Editor edit();
+
+      // Sort faces by their centroids and vertices by their positions along a space-filling
+      // curve over the bounding box, and remap all vertex, half-edge and face indices of a
+      // populated mesh accordingly. Spatially nearby elements then sit near each other in
+      // memory, which benefits cache behaviour of spatial index builds and traversals.
+      // Note: geometry is unchanged, but indices and MeshPoints obtained before reordering are
+      // no longer valid.
+      void reorder(SpaceFillingCurve curve = SpaceFillingCurve::HILBERT);
+
+      // Replace vertex, edge and face lists of a populated mesh with a compressed copy of its
+      // geometry (see CompressedMeshStorage), and return measured size and error figures.
+      // Positions, normals and faces are decoded upon every call to pos(), normal() and
+      // triangle(). Half-edges and vertex adjacency are discarded, so e() can no longer be used
+      // (see v() for what v() and f() return). Compression is one-way.
+      CompressedMeshStorage::Stats compress(CompressedMeshStorage::PositionPrecision precision
+          = CompressedMeshStorage::PositionPrecision::BITS_16);
+      bool isCompressed() const;
+
+      // Open a mesh backed by a cluster store, e.g. one larger than memory. The mesh is
+      // populated and read-only: it supports pos(), normal(), triangle(), sampling and KdTree
+      // builds, which then only hold cluster bounds (see KdTree::build()), and its memory use is
+      // bounded by the budget of the store.
+      static std::unique_ptr<TriangularMesh> outOfCore(const std::shared_ptr<ClusterStore>& store);
+      bool isOutOfCore() const;
+      // Store backing an out-of-core mesh, or null.
+      std::shared_ptr<ClusterStore> clusterStore() const { return _clusterStore; }
+
+      // Abort with a message naming the caller if this mesh is compressed or out-of-core, in
+      // release builds too. For operations that need half-edges or modify the vertex, edge and
+      // face lists, which such meshes leave empty.
+      void requireLists(const char* caller) const;
+
+      // Sample a point uniformly by area on the surface of a populated mesh, from three uniform
+      // random numbers in [0, 1). The face is chosen in O(1) time with an alias table over face
+      // areas, which is built in parallel upon the first call and cached. The probability
+      // density of every point with respect to area is 1 / surfaceArea().
+      MeshPoint samplePoint(double uFace, double u1, double u2) const;
+      // Batched version of samplePoint(), taking three random numbers per sample from u, in the
+      // same order as the arguments of samplePoint(), and appending count points to points.
+      void samplePoints(const double* u, std::size_t count, std::vector<MeshPoint>& points) const;
     
     private:
       void _populateEdges();
       void _populateNormals();
       void _populateBoundingBox();
+      // An empty outgoing edge list allocating from the arena of the mesh.
+      std::vector<unsigned int, ArenaAllocator<unsigned int>> _newEdgeList() const;
+      // Index of the twin of a half-edge, or HD_INVALID_ID if it has none.
+      unsigned int _findTwinEdge(unsigned int eid) const;
+      void _populateFaceNormal(unsigned int fid);
+      void _populateVertexNormal(unsigned int vid);
+      // Append a face and its half-edges to a populated mesh, and link them to their twins.
+      void _appendFace(const Face& face);
+      // Remove a face and its half-edges from a populated mesh, unlinking them from their twins.
+      // The last face and its half-edges are moved into the freed slots.
+      void _removeFace(unsigned int fid);
+      // Merge coincident vertices before population. See Builder::weldVertices().
+      void _weldVertices(double tolerance);
+      std::shared_ptr<const AliasTable> _getAreaTable() const;
+      // Drop cached data derived from geometry. Must be called upon every geometry change.
+      void _invalidateCaches();
 
     public:
     class Builder {
       private:
         std::unique_ptr<TriangularMesh> _instance;
+        // Tolerance of vertex welding upon build. Negative if welding is disabled.
+        double _weldTolerance;
 
       public:
         Builder(VertexNormalMode vertexNormalMode, FaceNormalMode faceNormalMode);
 
+        // Pre-allocate storage for the given number of vertices and faces. Importers that know
+        // element counts upfront should call this before adding any element, to avoid repeated
+        // reallocation and copying of the internal arrays.
+        Builder& reserve(unsigned int vertexNum, unsigned int faceNum);
+
         // Add a vertex. For this method and the method below, the order of vertex insertion
         // determined vertex index (or ID). Please make sure you're inserting vertices as the
         // same order they appear in face list.
@@ -240,9 +381,90 @@ namespace hd {
         // Add a face with normal. This method is only allowed when
         // faceNormalMode is USER_SPECIFIED.
         Builder& addFace(const std::array<unsigned int, 3>& face, const Vector3& fn);
+
+        // Bulk versions of the methods above, appending count consecutive elements from
+        // contiguous arrays, with the same restrictions on normal modes. Storage is reserved
+        // once and normal modes are checked once per call rather than per element.
+        Builder& addVertices(const Vector3* positions, std::size_t count);
+        Builder& addVertices(const Vector3* positions, const Vector3* normals, std::size_t count);
+        Builder& addFaces(const std::array<unsigned int, 3>* faces, std::size_t count);
+        Builder& addFaces(const std::array<unsigned int, 3>* faces, const Vector3* normals,
+            std::size_t count);
+        // Take over the given vertex or face list without copying, replacing all vertices or
+        // faces added so far. Vertex normals must be set if vertexNormalMode is USER_SPECIFIED,
+        // and face normals if faceNormalMode is USER_SPECIFIED. Half-edge indices are ignored
+        // and regenerated upon population.
+        Builder& setVertices(std::vector<Vertex>&& vertices);
+        Builder& setFaces(std::vector<Face>&& faces);
+        // Merge duplicated vertices upon build, e.g. from per-face vertex soups. Two vertices are
+        // merged if their positions differ by less than tolerance along every axis and, when
+        // vertex normals are user specified, their normals are equal. Merging is transitive,
+        // and the merged vertex takes the position of the lowest indexed one. Face indices are
+        // remapped, and faces that become degenerate (referring to a vertex twice) are removed.
+        // Note: the order of remaining vertices and faces is preserved, but their indices may
+        // change.
+        Builder& weldVertices(double tolerance = HD_EPSILON);
+        // Allocate the many small per-vertex adjacency lists made upon population from the given
+        // arena rather than from the heap, e.g. a scene-lifetime arena shared by all meshes and
+        // acceleration structures of a scene, so that they are packed together and released in
+        // bulk with the scene. The mesh and its copies keep the arena alive.
+        Builder& setArena(const std::shared_ptr<Arena>& arena);
       public:
         std::unique_ptr<TriangularMesh> build(bool populate = true);
     };
+
+    /**
+     * Local, in-place editing of a populated mesh, e.g. for interactive look-dev. Edits are
+     * recorded by the editor and applied upon commit(), which then only recomputes the derived
+     * data they invalidate: half-edges of added and removed faces and their twins, normals of
+     * faces and vertices around edited elements, and the bounding box. The cost of a commit is
+     * therefore proportional to the size of the edited region rather than that of the mesh.
+     *
+     * The bounding box grows with moved and added vertices. It is only recomputed from scratch
+     * when a vertex lying on it is moved, as the box may then shrink.
+     *
+     * Note: vertex indices are stable, and added vertices are appended. Faces removed upon a
+     * commit are filled in by the last remaining faces, and added faces are appended after
+     * those, so face indices, half-edge indices and MeshPoints obtained before a commit that
+     * removes faces are no longer valid.
+     */
+    class Editor {
+      private:
+        class VertexMove {
+          public:
+            unsigned int vid;
+            Vector3 pos;
+            // Only set if vertex normals are user specified.
+            Vector3 normal;
+            bool hasNormal;
+        };
+
+        TriangularMesh& _mesh;
+        std::vector<Vertex> _addedVertices;
+        std::vector<VertexMove> _movedVertices;
+        std::vector<Face> _addedFaces;
+        std::vector<unsigned int> _removedFaces;
+
+      public:
+        Editor(TriangularMesh& mesh);
+
+        // Add a vertex, returning its index, which can be referred to by faces added with the
+        // same editor. Normal modes are restricted the same way as in Builder.
+        unsigned int addVertex(const Vector3& v);
+        unsigned int addVertex(const Vector3& v, const Vector3& vn);
+        // Move a vertex. Its normal is kept if vertex normals are user specified and no new
+        // normal is given, and recomputed otherwise.
+        Editor& moveVertex(unsigned int vid, const Vector3& v);
+        Editor& moveVertex(unsigned int vid, const Vector3& v, const Vector3& vn);
+        Editor& addFace(const std::array<unsigned int, 3>& face);
+        Editor& addFace(const std::array<unsigned int, 3>& face, const Vector3& fn);
+        // Remove the face at the given index, as of before the commit.
+        Editor& removeFace(unsigned int fid);
+
+        // Apply all recorded edits to the mesh and update its derived data. The editor can be
+        // reused afterwards.
+        void commit();
+    };
   };
 }
 
@@ -0,0 +1,173 @@
+#ifndef _CLUSTER_STORE_H_
+#define _CLUSTER_STORE_H_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "math/vector3.h"
+#include "geometry/bounding_box3.h"
+#include "geometry/has_bounding_box3.h"
+#include "geometry/mesh_cluster.h"
+#include "geometry/triangle3.h"
+#include "geometry/triangular_mesh.h"
+
+namespace hd {
+  /**
+   * Out-of-core storage of a triangular mesh split into clusters (see MeshCluster), for meshes
+   * that do not fit in memory.
+   *
+   * The store file holds a directory with the bounds of every cluster, followed by one page of
+   * geometry per cluster. Opening a store only loads the directory. Pages are read on demand
+   * when a cluster is first accessed, and kept in an LRU cache bounded by a memory budget, so
+   * that traversals only ever fault in the clusters they actually reach.
+   *
+   * Faces of a store are numbered cluster by cluster: the faces of cluster c are numbered from
+   * firstFace(c) on, in page order, and Page::faceIds maps them back to the original mesh. A
+   * TriangularMesh can be backed by a store (see TriangularMesh::outOfCore()), in which case a
+   * KdTree over it only holds cluster bounds and pages clusters in as rays reach them.
+   *
+   * Pages handed out are reference counted: evicting a page from the cache never invalidates it
+   * for callers still holding it, it only stops counting against the budget. All methods of an
+   * opened store are thread-safe.
+   *
+   * Layout (8-byte aligned, native byte order, rejected on load if written with another one):
+   *   - Header: magic, format version, endianness tag, normal modes, counts and bounding box.
+   *   - Directory: bounds, normal cone, sizes and file offset of each cluster page.
+   *   - Pages: vertex positions and normals, face normals, original face indices and local
+   *     vertex indices of faces of each cluster.
+   */
+  class ClusterStore : public HasBoundingBox3 {
+    public:
+      // Current version of the format. Bump this whenever the layout changes.
+      static const unsigned int VERSION = 1;
+
+      /**
+       * Geometry of one cluster, as loaded from its page.
+       */
+      class Page {
+        public:
+          std::vector<Vector3> positions;
+          // Vertex normals. Only used when face normals are Phong interpolated.
+          std::vector<Vector3> vertexNormals;
+          std::vector<Vector3> faceNormals;
+          // Index of each face in the original mesh.
+          std::vector<unsigned int> faceIds;
+          // Three indices into positions per face.
+          std::vector<uint8_t> localTriangles;
+          bool isPhong;
+        public:
+          Page() : isPhong(false) {}
+          unsigned int faceNum() const { return faceIds.size(); }
+          Triangle3 triangle(unsigned int localFace) const;
+          // Normal at the point with given barycentric parameters on a face, interpolated the
+          // same way as TriangularMesh::normal().
+          Vector3 normal(unsigned int localFace, const Vector3& params) const;
+          std::size_t memoryBytes() const;
+      };
+
+      /**
+       * Paging activity since the store was opened, and current cache occupancy.
+       */
+      class Stats {
+        public:
+          // Number of pages read from the file into the cache, and their total size in memory.
+          // Copies read concurrently with another thread and then discarded are not counted.
+          std::size_t pageIns;
+          std::size_t bytesPagedIn;
+          // Accesses served from the cache, including those that lost a concurrent page-in.
+          std::size_t hits;
+          std::size_t evictions;
+          std::size_t residentPages;
+          std::size_t bytesResident;
+        public:
+          Stats() : pageIns(0), bytesPagedIn(0), hits(0), evictions(0), residentPages(0),
+              bytesResident(0) {}
+      };
+
+    private:
+      class Entry {
+        public:
+          // Bounds and normal cone only. Face and vertex lists are left empty.
+          MeshCluster bounds;
+          uint64_t offset;
+          uint64_t size;
+          unsigned int faceNum;
+          unsigned int vertexNum;
+          std::shared_ptr<const Page> page;
+          // Position in _lru if the page is resident.
+          std::list<unsigned int>::iterator lruPosition;
+      };
+
+      std::string _path;
+      int _fd;
+      TriangularMesh::VertexNormalMode _vertexNormalMode;
+      TriangularMesh::FaceNormalMode _faceNormalMode;
+      bool _isPhong;
+      unsigned int _faceNum;
+      BoundingBox3 _boundingBox;
+      std::vector<Entry> _entries;
+      // Number of faces of all clusters before each one, and the total at the end.
+      std::vector<unsigned int> _firstFaces;
+      std::size_t _memoryBudget;
+      // Resident clusters, most recently used first.
+      std::list<unsigned int> _lru;
+      Stats _stats;
+      mutable std::mutex _mutex;
+
+    public:
+      ClusterStore(const ClusterStore& store) = delete;
+      ClusterStore& operator=(const ClusterStore& store) = delete;
+      ~ClusterStore();
+
+      // Write a populated, uncompressed mesh partitioned into the given clusters to the given
+      // path. Clusters must cover every face exactly once. Returns false if the file cannot be
+      // written.
+      static bool write(const TriangularMesh& mesh, const std::vector<MeshCluster>& clusters,
+          const std::string& path);
+      // Open a store written by write(), loading its directory only. Resident pages are evicted
+      // whenever their total size exceeds memoryBudget bytes, except for the most recently used
+      // one. Returns nullptr if the file cannot be read or is invalid.
+      static std::unique_ptr<ClusterStore> open(const std::string& path,
+          std::size_t memoryBudget);
+
+      unsigned int clusterNum() const { return _entries.size(); }
+      unsigned int faceNum() const { return _faceNum; }
+      TriangularMesh::VertexNormalMode vertexNormalMode() const { return _vertexNormalMode; }
+      TriangularMesh::FaceNormalMode faceNormalMode() const { return _faceNormalMode; }
+      BoundingBox3 boundingBox3() const override { return _boundingBox; }
+      // Bounds of a cluster, available without paging it in.
+      const MeshCluster& bounds(unsigned int clusterId) const;
+      // Number of the first face of a cluster in the numbering of the store.
+      unsigned int firstFace(unsigned int clusterId) const;
+      // Cluster and index within its page of a face of the store.
+      void locate(unsigned int faceId, unsigned int& clusterId, unsigned int& localFace) const;
+
+      // Geometry of a cluster, read from the file first unless it is resident. Returns nullptr
+      // if the page cannot be read.
+      std::shared_ptr<const Page> page(unsigned int clusterId);
+      // Same as page(), but aborts with a message if the page cannot be read, for callers with
+      // no way to report the failure, e.g. ray traversal of an out-of-core mesh.
+      std::shared_ptr<const Page> requirePage(unsigned int clusterId);
+      bool isResident(unsigned int clusterId) const;
+
+      std::size_t memoryBudget() const;
+      // Change the budget, evicting pages right away if needed.
+      void setMemoryBudget(std::size_t memoryBudget);
+      Stats stats() const;
+
+    private:
+      ClusterStore();
+      std::shared_ptr<const Page> _load(unsigned int clusterId) const;
+      bool _read(uint64_t offset, char* buffer, std::size_t size) const;
+      // Evict least recently used pages until the budget is met. Requires _mutex to be held.
+      void _evict();
+  };
+}
+
+#endif // _CLUSTER_STORE_H_
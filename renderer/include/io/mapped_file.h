@@ -0,0 +1,42 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace hd {
+  /**
+   * Read-only view of a whole file mapped into memory. The mapping is released upon destruction.
+   *
+   * On POSIX systems the file is mapped with mmap, so pages are loaded lazily by the OS and shared
+   * between processes mapping the same file. On other platforms the file content is read into a
+   * private buffer instead.
+   */
+  class MappedFile {
+    private:
+      const char* _data;
+      std::size_t _size;
+      // Fallback storage when memory mapping is unavailable.
+      std::vector<char> _buffer;
+
+    public:
+      MappedFile() : _data(nullptr), _size(0) {}
+      MappedFile(const MappedFile& file) = delete;
+      MappedFile& operator=(const MappedFile& file) = delete;
+      ~MappedFile();
+
+      // Map the file at the given path, releasing any previous mapping. Returns false if the
+      // file cannot be opened or mapped.
+      bool open(const std::string& path);
+      void close();
+
+      bool isOpen() const { return _data != nullptr; }
+      const char* data() const { return _data; }
+      std::size_t size() const { return _size; }
+  };
+}
+
+#endif // _MAPPED_FILE_H_
@@ -0,0 +1,48 @@
+#ifndef _MESH_SERIALIZER_H_
+#define _MESH_SERIALIZER_H_
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include "geometry/triangular_mesh.h"
+
+namespace hd {
+  /**
+   * Serialization of fully populated triangular meshes into HyperDoom's native binary format.
+   *
+   * The file stores everything derived during population, namely positions, normals, faces,
+   * half-edges with their twins, vertex adjacency, the bounding box and the normal modes, so that
+   * loading a mesh never re-runs TriangularMesh::populate().
+   *
+   * Layout (all sections are 8-byte aligned and stored in the writer's native byte order):
+   *   - Header: magic, format version, endianness tag, flags, normal modes, element counts,
+   *     bounding box and an optional checksum of everything after the header.
+   *   - Vertices: position and normal of each vertex, 6 doubles per vertex.
+   *   - Adjacency: vertexNum + 1 offsets into a flat list of outgoing half-edge indices,
+   *     followed by that list.
+   *   - Half-edges: start, end, face, twin, next and prev indices of each half-edge.
+   *   - Faces: vertex indices, half-edge indices and normal of each face.
+   *
+   * Files are mapped into memory on load. A file written on a machine of different byte order
+   * is detected through the endianness tag and rejected rather than misread.
+   */
+  class MeshSerializer {
+    public:
+      // Current version of the format. Bump this whenever the layout changes.
+      static const unsigned int VERSION = 1;
+
+      // Write a populated mesh to the given path. Returns false if the mesh is compressed or
+      // out-of-core, or the file cannot be written.
+      static bool write(const TriangularMesh& mesh, const std::string& path,
+          bool withChecksum = true);
+      // Load a mesh previously written by write(). The returned mesh is already populated.
+      // Returns nullptr if the file cannot be read, was written by an incompatible version or on
+      // a machine of different byte order, is truncated, fails checksum verification, or refers
+      // to vertices, edges or faces out of range.
+      static std::unique_ptr<TriangularMesh> read(const std::string& path,
+          bool verifyChecksum = true);
+  };
+}
+
+#endif // _MESH_SERIALIZER_H_
@@ -0,0 +1,37 @@
+#ifndef _PLY_READER_H_
+#define _PLY_READER_H_
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include "geometry/triangular_mesh.h"
+
+namespace hd {
+  /**
+   * Importer of triangular meshes stored in binary Stanford PLY files.
+   *
+   * Only binary encodings (little-endian and big-endian) are supported. The vertex element must
+   * provide x, y, z coordinates, and may optionally provide nx, ny, nz normals, in which case the
+   * mesh is built with VertexNormalMode::USER_SPECIFIED. Otherwise vertex normals are averaged.
+   * The face element must provide a vertex_indices (or vertex_index) list property. Polygons with
+   * more than three vertices are triangulated as fans. Any other element or property is skipped.
+   *
+   * Element blocks are read in large chunks straight into pre-sized mesh buffers rather than
+   * being parsed element by element from the stream, so the load time of large scans is bound
+   * by I/O instead of parsing.
+   *
+   * For the format specification, please refer to:
+   *     http://paulbourke.net/dataformats/ply/
+   */
+  class PlyReader {
+    public:
+      // Read the mesh stored at the given path. Returns nullptr if the file cannot be opened,
+      // is malformed or uses an unsupported encoding.
+      // Note: faceNormalMode must not be USER_SPECIFIED, as PLY faces carry no normals.
+      static std::unique_ptr<TriangularMesh> read(const std::string& path,
+          TriangularMesh::FaceNormalMode faceNormalMode = TriangularMesh::FaceNormalMode::PHONG);
+  };
+}
+
+#endif // _PLY_READER_H_
@@ -0,0 +1,135 @@
+#ifndef _SOCKET_H_
+#define _SOCKET_H_
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace hd {
+  /**
+   * A typed message exchanged over a Socket: a type tag and a payload of values appended by
+   * put() and read back in the same order by get(). Values are stored in native byte order, so
+   * both ends must share it.
+   */
+  class Message {
+    public:
+      uint32_t type;
+      std::vector<char> payload;
+
+    private:
+      // Offset of the next value get() reads.
+      std::size_t _readOffset;
+
+    public:
+      explicit Message(uint32_t t = 0) : type(t), _readOffset(0) {}
+
+      template <typename T>
+      void put(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be put.");
+        putBytes(&value, sizeof(T));
+      }
+      void putBytes(const void* data, std::size_t size);
+      void putString(const std::string& value);
+
+      // Read the next value. Returns false, reading nothing, if the payload is too short.
+      template <typename T>
+      bool get(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be got.");
+        return getBytes(&value, sizeof(T));
+      }
+      bool getBytes(void* data, std::size_t size);
+      bool getString(std::string& value);
+      // Whether all values were read.
+      bool isFullyRead() const { return _readOffset == payload.size(); }
+  };
+
+  /**
+   * A connected stream socket, over TCP or a Unix domain socket, carrying Messages. The
+   * connection is closed upon destruction. POSIX only.
+   *
+   * Addresses are written "unix:<path>" or "tcp:<host>:<port>".
+   *
+   * Payload sizes come from the peer, so receive() bounds them before allocating anything: by
+   * default to 64 KiB, enough for messages of a few values and strings, or to a limit per
+   * message type given by the receiver, which knows how large the messages it expects are.
+   */
+  class Socket {
+    public:
+      // Largest payload of a message of the given type that receive() accepts.
+      typedef std::function<uint64_t(uint32_t type)> PayloadLimit;
+
+    private:
+      int _fd;
+      double _receiveTimeout;
+
+    public:
+      Socket() : _fd(-1), _receiveTimeout(0.0) {}
+      // Take ownership of a connected socket descriptor.
+      explicit Socket(int fd) : _fd(fd), _receiveTimeout(0.0) {}
+      Socket(Socket&& socket);
+      Socket& operator=(Socket&& socket);
+      Socket(const Socket& socket) = delete;
+      Socket& operator=(const Socket& socket) = delete;
+      ~Socket();
+
+      // Connect to a listening socket. Returns a closed socket on failure.
+      static Socket connect(const std::string& address);
+
+      bool isOpen() const { return _fd >= 0; }
+      int fd() const { return _fd; }
+      void close();
+      // Make receive() fail unless the whole message arrives within the given time, or never
+      // time out if 0. The deadline holds per message, however slowly its bytes trickle in.
+      bool setReceiveTimeout(double seconds);
+
+      // Send or receive a whole message. Return false if the connection is closed, broken or
+      // timed out, or the message is malformed or larger than the payload limit.
+      bool send(const Message& message);
+      bool receive(Message& message);
+      bool receive(Message& message, const PayloadLimit& maxPayloadSize);
+
+    private:
+      bool _sendAll(const void* data, std::size_t size);
+      // Receive exactly size bytes, failing once the deadline passes if it is set.
+      bool _receiveAll(void* data, std::size_t size, bool hasDeadline,
+          std::chrono::steady_clock::time_point deadline);
+  };
+
+  /**
+   * A socket listening for connections, see Socket for addresses. Unix domain socket files are
+   * created on listen() and removed upon destruction.
+   */
+  class ServerSocket {
+    private:
+      int _fd;
+      std::string _address;
+      std::string _unixPath;
+
+    public:
+      ServerSocket() : _fd(-1) {}
+      ServerSocket(const ServerSocket& socket) = delete;
+      ServerSocket& operator=(const ServerSocket& socket) = delete;
+      ~ServerSocket();
+
+      // Listen at the given address. A TCP port of 0 picks a free port. A unix socket path
+      // must be free or hold a stale socket, never another file nor a socket in use. Returns
+      // false on failure.
+      bool listen(const std::string& address);
+      void close();
+
+      bool isOpen() const { return _fd >= 0; }
+      int fd() const { return _fd; }
+      // Address listened at, with the actual port for TCP.
+      const std::string& address() const { return _address; }
+      // Accept a pending connection. Returns a closed socket on failure.
+      Socket accept();
+  };
+}
+
+#endif // _SOCKET_H_
@@ -0,0 +1,142 @@
+#ifndef _ADAPTIVE_RENDERER_H_
+#define _ADAPTIVE_RENDERER_H_
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "render/checkpoint.h"
+#include "render/film.h"
+#include "render/image.h"
+#include "render/integrator.h"
+#include "render/tile_scheduler.h"
+
+namespace hd {
+  /**
+   * Progressive renderer that spends samples where the image is still noisy.
+   *
+   * Rendering proceeds in passes over all tiles (see TileScheduler). The first pass takes
+   * minSamplesPerPixel samples of every pixel, and each later pass adds samplesPerPass samples
+   * to the pixels that have not converged yet. A pixel has converged once the standard error of
+   * the mean of its luminance, relative to that mean, is below targetError, or once it has
+   * maxSamplesPerPixel samples. Rendering stops when all pixels have converged, or when the next
+   * pass would exceed the time budget.
+   *
+   * Whether a pixel takes more samples depends on its own samples only, and those depend on the
+   * pixel, sample index and seed only (see Integrator). The image after a given number of passes
+   * is thus the same whatever the number of threads or the scheduling of tiles; a time budget
+   * only decides how many passes are run, and is checked between passes only.
+   *
+   * For the same reason, a render can be checkpointed between passes and resumed by another
+   * process, which then finishes with the same image as a render that never stopped. render()
+   * checkpoints periodically if given a checkpoint path, writing from a background thread. A
+   * checkpoint is only resumed by a render of the same scene, camera and settings, and the time
+   * budget covers the passes run before it was taken too.
+   */
+  class AdaptiveRenderer {
+    public:
+      class Options {
+        public:
+          unsigned int minSamplesPerPixel;
+          unsigned int maxSamplesPerPixel;
+          unsigned int samplesPerPass;
+          // Relative standard error of pixel luminance at which pixels have converged.
+          double targetError;
+          // Wall-clock budget of the whole render, including passes run before render() was
+          // called or before the checkpoint it was resumed from was taken, or 0 for none.
+          double timeBudgetSeconds;
+          unsigned int tileSize;
+          // 0 uses one thread per core.
+          unsigned int threadNum;
+          // File render() checkpoints to, if not empty.
+          std::string checkpointPath;
+          // Minimum wall-clock time between two checkpoints, or 0 to checkpoint every pass.
+          // A checkpoint is also taken when render() returns.
+          double checkpointIntervalSeconds;
+          // Names of the integrator and sampler, and the filter images are reconstructed with,
+          // which are not otherwise known to the renderer. They are only recorded in
+          // checkpoints, so that a render never resumes one taken with others.
+          std::string integratorName;
+          std::string samplerName;
+          Film::Filter filter;
+        public:
+          Options() : minSamplesPerPixel(8), maxSamplesPerPixel(1024), samplesPerPass(8),
+              targetError(0.02), timeBudgetSeconds(0.0), tileSize(16), threadNum(0),
+              checkpointIntervalSeconds(60.0) {}
+      };
+
+      /**
+       * Progress of a render so far.
+       */
+      class Stats {
+        public:
+          unsigned int passNum;
+          uint64_t sampleNum;
+          // Pixels that reached the target error or the sample limit.
+          unsigned int convergedPixelNum;
+          double wallSeconds;
+          // Whether render() stopped because of the time budget.
+          bool outOfTime;
+          // Checkpoints written by render(), and those that could not be written.
+          unsigned int checkpointNum;
+          unsigned int checkpointFailureNum;
+          // Scheduling of all passes, summed up per thread.
+          TileScheduler::Stats scheduling;
+        public:
+          Stats() : passNum(0), sampleNum(0), convergedPixelNum(0), wallSeconds(0.0),
+              outOfTime(false), checkpointNum(0), checkpointFailureNum(0) {}
+      };
+
+    private:
+      const Integrator& _integrator;
+      Options _options;
+      TileScheduler _scheduler;
+      // Per-pixel running sums of sample radiance and squared luminance, and sample counts, in
+      // row-major order.
+      std::vector<Vector3> _sums;
+      std::vector<double> _luminanceSquareSums;
+      std::vector<unsigned int> _sampleCounts;
+      std::vector<uint8_t> _converged;
+      // Checksum of the mesh rendered (see Checkpoint::checksum()).
+      uint64_t _meshChecksum;
+      Stats _stats;
+
+    public:
+      AdaptiveRenderer(const Integrator& integrator, const Options& options = Options());
+
+      // Run passes until all pixels converged or the time budget ran out, and return the image.
+      std::unique_ptr<Image> render();
+      // Run a single pass. Returns false, running nothing, if all pixels have converged.
+      bool renderPass();
+      // Whether all pixels have converged.
+      bool isDone() const { return _stats.convergedPixelNum == _sampleCounts.size(); }
+      // State of the render after the passes run so far.
+      std::unique_ptr<Checkpoint> checkpoint() const;
+      // Carry on from a checkpoint, as if the passes it holds had been run by this renderer.
+      // Returns false, changing nothing, if it was taken by a render of another mesh, camera,
+      // resolution, integrator, sampler, sampler seed, filter or sampling options.
+      bool resume(const Checkpoint& checkpoint);
+
+      // Mean radiance of each pixel so far.
+      std::unique_ptr<Image> image() const;
+      unsigned int sampleCount(unsigned int x, unsigned int y) const;
+      // Relative standard error of the luminance of a pixel so far, infinity with less than two
+      // samples.
+      double relativeError(unsigned int x, unsigned int y) const;
+      const Stats& stats() const { return _stats; }
+      const Options& options() const { return _options; }
+
+    private:
+      void _renderTile(const TileScheduler::Tile& tile);
+      // Number of samples the pixel takes in the next pass.
+      unsigned int _passSampleCount(unsigned int pixel) const;
+      double _relativeError(unsigned int pixel) const;
+      bool _isConverged(unsigned int pixel) const;
+      // Update converged pixel and sample counts of the stats from the pixels.
+      void _countPixels();
+  };
+}
+
+#endif // _ADAPTIVE_RENDERER_H_
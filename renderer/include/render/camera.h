@@ -0,0 +1,51 @@
+#ifndef _CAMERA_H_
+#define _CAMERA_H_
+
+#pragma once
+
+#include "geometry/bounding_box3.h"
+#include "geometry/ray3.h"
+#include "math/vector3.h"
+
+namespace hd {
+  /**
+   * A pinhole camera, mapping positions on the image plane, in pixels from the top-left corner
+   * of the image, to primary rays.
+   */
+  class Camera {
+    private:
+      Vector3 _position;
+      // Orthonormal camera frame: forward is the viewing direction, right and up span the image
+      // plane, scaled so that right spans half the image width and up half its height at unit
+      // distance along forward.
+      Vector3 _forward;
+      Vector3 _right;
+      Vector3 _up;
+      unsigned int _width;
+      unsigned int _height;
+
+    public:
+      // A camera at position looking at lookAt, with the given up direction, vertical field of
+      // view in degrees and image resolution. up must not be parallel to the viewing direction.
+      Camera(const Vector3& position, const Vector3& lookAt, const Vector3& up, double fovY,
+          unsigned int width, unsigned int height);
+
+      // A camera looking at the center of the box along the given direction, from a distance
+      // where the whole box is in view.
+      static Camera frame(const BoundingBox3& box, const Vector3& viewDirection,
+          const Vector3& up, double fovY, unsigned int width, unsigned int height);
+
+      Vector3 position() const { return _position; }
+      Vector3 forward() const { return _forward; }
+      Vector3 right() const { return _right; }
+      Vector3 up() const { return _up; }
+      unsigned int width() const { return _width; }
+      unsigned int height() const { return _height; }
+
+      // Primary ray through the image plane position (x, y), in pixels from the top-left corner,
+      // e.g. (x + 0.5, y + 0.5) for the center of pixel (x, y). The direction is normalized.
+      Ray3 generateRay(double x, double y) const;
+  };
+}
+
+#endif // _CAMERA_H_
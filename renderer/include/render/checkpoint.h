@@ -0,0 +1,89 @@
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "geometry/triangular_mesh.h"
+#include "math/vector3.h"
+#include "render/film.h"
+
+namespace hd {
+  /**
+   * State of a progressive render between two passes, from which another process can carry on
+   * as if the render had never stopped (see AdaptiveRenderer::resume()).
+   *
+   * Besides progress counters, it holds per pixel the running sums of sample radiance and of
+   * squared luminance, and the number of samples taken, which is also the index of the next
+   * sample the sampler is asked for. Whether a pixel has converged is a function of these, so it
+   * is not stored. The settings the state depends on are stored too, along with what is
+   * rendered: integrator, sampler, filter, camera and a fingerprint of the mesh, so that a
+   * checkpoint is never resumed by a render that would continue it differently.
+   *
+   * Layout (stored in the writer's native byte order, like mesh files):
+   *   - Header: magic, format version, endianness tag, settings, progress counters and a
+   *     checksum of the payload.
+   *   - Payload: radiance sums, 3 doubles per pixel, then luminance square sums, 1 double per
+   *     pixel, then sample counts, 1 uint32 per pixel, padded to 8 bytes.
+   */
+  class Checkpoint {
+    public:
+      // Current version of the format. Bump this whenever the layout changes.
+      static const unsigned int VERSION = 2;
+      // Longest integrator and sampler names that fit in a checkpoint.
+      static const unsigned int MAX_NAME_LENGTH = 31;
+
+    public:
+      // Settings.
+      unsigned int width;
+      unsigned int height;
+      uint32_t samplerSeed;
+      unsigned int minSamplesPerPixel;
+      unsigned int maxSamplesPerPixel;
+      unsigned int samplesPerPass;
+      double targetError;
+      // Scene: names of the integrator and sampler, the reconstruction filter, the camera frame
+      // (see Camera) and the fingerprint of the mesh (see checksum()).
+      std::string integrator;
+      std::string sampler;
+      Film::Filter filter;
+      Vector3 cameraPosition;
+      Vector3 cameraForward;
+      Vector3 cameraRight;
+      Vector3 cameraUp;
+      unsigned int meshVertexNum;
+      unsigned int meshFaceNum;
+      uint64_t meshChecksum;
+      // Progress.
+      unsigned int passNum;
+      double wallSeconds;
+      // Per-pixel state, in row-major order.
+      std::vector<Vector3> sums;
+      std::vector<double> luminanceSquareSums;
+      std::vector<unsigned int> sampleCounts;
+
+    public:
+      Checkpoint() : width(0), height(0), samplerSeed(0), minSamplesPerPixel(0),
+          maxSamplesPerPixel(0), samplesPerPass(0), targetError(0.0), meshVertexNum(0),
+          meshFaceNum(0), meshChecksum(0), passNum(0), wallSeconds(0.0) {}
+
+      // Write the checkpoint to a temporary file next to the given path, then rename it to the
+      // path, so that the path always holds a complete checkpoint, even if the process is killed
+      // while writing. Both the file and the rename are synced to disk before returning, so that
+      // the checkpoint also survives the machine going down. Returns false if the file cannot
+      // be written, or if a name is longer than MAX_NAME_LENGTH.
+      bool write(const std::string& path) const;
+      // Load a checkpoint written by write(). Returns nullptr if the file cannot be read, was
+      // written by an incompatible version or on a machine of different byte order, is
+      // truncated, or fails checksum verification.
+      static std::unique_ptr<Checkpoint> read(const std::string& path);
+      // Checksum of the vertex positions of every face of a mesh, in face order. Like the face
+      // and vertex counts, it does not depend on how the mesh is stored, e.g. compressed.
+      static uint64_t checksum(const TriangularMesh& mesh);
+  };
+}
+
+#endif // _CHECKPOINT_H_
@@ -0,0 +1,56 @@
+#ifndef _CHECKPOINT_WRITER_H_
+#define _CHECKPOINT_WRITER_H_
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "render/checkpoint.h"
+
+namespace hd {
+  /**
+   * Writes checkpoints to a file from a background thread, so that rendering does not wait for
+   * the disk. Each write replaces the file atomically (see Checkpoint::write()).
+   *
+   * Only the latest checkpoint matters, so at most one waits to be written: a checkpoint
+   * submitted while another is being written replaces any checkpoint still waiting.
+   */
+  class CheckpointWriter {
+    private:
+      std::string _path;
+      std::thread _writer;
+      std::mutex _mutex;
+      std::condition_variable _condition;
+      std::unique_ptr<Checkpoint> _pending;
+      bool _writing;
+      bool _closing;
+      std::size_t _writeNum;
+      std::size_t _failureNum;
+
+    public:
+      explicit CheckpointWriter(const std::string& path);
+      CheckpointWriter(const CheckpointWriter& writer) = delete;
+      CheckpointWriter& operator=(const CheckpointWriter& writer) = delete;
+      // Writes the checkpoint still waiting, if any, before returning.
+      ~CheckpointWriter();
+
+      const std::string& path() const { return _path; }
+      void submit(std::unique_ptr<Checkpoint> checkpoint);
+      // Wait until all submitted checkpoints are written or replaced. Returns false if any write
+      // failed so far.
+      bool flush();
+      // Checkpoints written so far, and writes that failed.
+      std::size_t writeNum();
+      std::size_t failureNum();
+
+    private:
+      // Body of the background thread: write checkpoints as they come until closed.
+      void _run();
+  };
+}
+
+#endif // _CHECKPOINT_WRITER_H_
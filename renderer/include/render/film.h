@@ -0,0 +1,146 @@
+#ifndef _FILM_H_
+#define _FILM_H_
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "math/vector3.h"
+#include "render/image.h"
+
+namespace hd {
+  /**
+   * Accumulates the contributions of samples to the pixels of an image. Two kinds of
+   * contributions are kept apart:
+   *   - samples, weighted by a reconstruction filter centered on the image position they were
+   *     taken at, whose pixel value is their weighted average,
+   *   - splats, e.g. of light paths hitting the camera, which are summed unweighted and scaled
+   *     when the image is made, e.g. by the inverse of the number of light paths traced.
+   *
+   * All accumulation is lock-free: pixels are atomics updated by compare-and-swap, so that any
+   * thread can add to any pixel. Threads rendering tiles add their samples to private tile
+   * buffers instead, which cost no atomic operations, and merge them into the film once done.
+   * Tiles only contend on the few pixels where filter footprints of neighbouring tiles overlap.
+   *
+   * With a footprint no wider than a pixel, each pixel takes samples from a single tile, so
+   * results do not depend on the order tiles are merged in. Otherwise concurrent additions to
+   * a pixel may be rounded differently from one run to the next.
+   */
+  class Film {
+    public:
+      /**
+       * Separable reconstruction filter: a sample at image position (px, py) adds to the pixels
+       * whose centers are within radius of it on both axes, with weight w(dx) * w(dy).
+       */
+      class Filter {
+        public:
+          enum class Type {
+            // Constant weight.
+            BOX,
+            // Weight falling linearly to 0 at the radius.
+            TENT
+          };
+
+        public:
+          Type type;
+          double radius;
+
+        public:
+          // A box of one pixel, i.e. each sample counts fully and only in its own pixel.
+          Filter() : type(Type::BOX), radius(0.5) {}
+          Filter(Type t, double r) : type(t), radius(r) {}
+
+          // Weight on one axis at distance d from the sample.
+          double weight(double d) const;
+          // Pixels beyond those a sample is taken in that it may add to, on each side.
+          unsigned int margin() const;
+      };
+
+      /**
+       * Private accumulation buffer of the samples taken in a tile of pixels, which covers the
+       * tile and the margin around it that their filter footprints reach, within the image.
+       * Not thread-safe: meant to be filled by the thread rendering the tile.
+       */
+      class TileBuffer {
+        private:
+          Filter _filter;
+          // Covered pixels, [x0, x1) x [y0, y1).
+          unsigned int _x0, _y0, _x1, _y1;
+          std::vector<Vector3> _sums;
+          std::vector<double> _weights;
+
+        public:
+          // Buffer for tile [x0, x1) x [y0, y1) of an image of the given resolution, to be merged
+          // into a film of that resolution and filter.
+          TileBuffer(const Filter& filter, unsigned int width, unsigned int height,
+              unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1);
+
+          // Add a sample taken at image position (px, py), which must lie in the tile.
+          void addSample(double px, double py, const Vector3& value);
+
+          // Covered pixels, [x0(), x1()) x [y0(), y1()), and what they accumulated so far,
+          // e.g. to send a buffer filled by another process.
+          unsigned int x0() const { return _x0; }
+          unsigned int y0() const { return _y0; }
+          unsigned int x1() const { return _x1; }
+          unsigned int y1() const { return _y1; }
+          const Vector3& sum(unsigned int x, unsigned int y) const;
+          double weight(unsigned int x, unsigned int y) const;
+          // Add weighted sample sums accumulated elsewhere to a covered pixel.
+          void add(unsigned int x, unsigned int y, const Vector3& sum, double weight);
+
+          friend class Film;
+      };
+
+    private:
+      class Pixel {
+        public:
+          std::atomic<double> sum[3];
+          std::atomic<double> weight;
+          std::atomic<double> splat[3];
+      };
+
+      unsigned int _width;
+      unsigned int _height;
+      Filter _filter;
+      std::unique_ptr<Pixel[]> _pixels;
+
+    public:
+      // A film with no contribution yet.
+      Film(unsigned int width, unsigned int height, const Filter& filter = Filter());
+      Film(const Film& film) = delete;
+      Film& operator=(const Film& film) = delete;
+
+      unsigned int width() const { return _width; }
+      unsigned int height() const { return _height; }
+      const Filter& filter() const { return _filter; }
+
+      // Buffer for the samples of tile [x0, x1) x [y0, y1) of this film.
+      TileBuffer tileBuffer(unsigned int x0, unsigned int y0, unsigned int x1,
+          unsigned int y1) const;
+      // Add all samples of a tile buffer. Lock-free, and safe to call concurrently with any
+      // other accumulation.
+      void merge(const TileBuffer& buffer);
+      // Add a sample taken at image position (px, py). Lock-free.
+      void addSample(double px, double py, const Vector3& value);
+      // Add a splat at image position (px, py) to the pixel containing it. Lock-free.
+      void splat(double px, double py, const Vector3& value);
+      // Remove all contributions. Must not run concurrently with accumulation.
+      void clear();
+
+      // Value of a pixel: weighted average of its samples, black if they have no weight, plus
+      // its splats times splatScale. May be read while other pixels are being accumulated.
+      Vector3 pixel(unsigned int x, unsigned int y, double splatScale = 1.0) const;
+      std::unique_ptr<Image> image(double splatScale = 1.0) const;
+
+    private:
+      // Call fn(x, y, weight) for all pixels a sample at image position (px, py) adds to with
+      // the given filter, within [x0, x1) x [y0, y1).
+      template <typename Function>
+      static void _forEachFootprintPixel(const Filter& filter, double px, double py,
+          unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, Function fn);
+  };
+}
+
+#endif // _FILM_H_
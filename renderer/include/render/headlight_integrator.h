@@ -0,0 +1,23 @@
+#ifndef _HEADLIGHT_INTEGRATOR_H_
+#define _HEADLIGHT_INTEGRATOR_H_
+
+#pragma once
+
+#include "render/integrator.h"
+
+namespace hd {
+  /**
+   * Lights surfaces by a light at the camera, i.e. shades them by the cosine between the shading
+   * normal and the view ray. Needs nothing but geometry and shows it plainly, e.g. for previews.
+   */
+  class HeadlightIntegrator : public Integrator {
+    public:
+      HeadlightIntegrator(const TriangularMesh& mesh, const KdTree& tree, const Camera& camera,
+          unsigned int seed = 0) : Integrator(mesh, tree, camera, seed) {}
+
+      void render(const SampleRequest* requests, std::size_t count,
+          Vector3* radiance) const override;
+  };
+}
+
+#endif // _HEADLIGHT_INTEGRATOR_H_
@@ -0,0 +1,39 @@
+#ifndef _IMAGE_H_
+#define _IMAGE_H_
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "math/vector3.h"
+
+namespace hd {
+  /**
+   * A high dynamic range RGB image, with pixels stored row by row from the top-left corner.
+   * Images are written to and read from Portable Float Map (PFM) files, which store 32-bit
+   * floats per channel with no loss of range.
+   */
+  class Image {
+    private:
+      unsigned int _width;
+      unsigned int _height;
+      std::vector<Vector3> _pixels;
+
+    public:
+      // A black image of the given resolution.
+      Image(unsigned int width, unsigned int height);
+
+      unsigned int width() const { return _width; }
+      unsigned int height() const { return _height; }
+      Vector3& at(unsigned int x, unsigned int y);
+      const Vector3& at(unsigned int x, unsigned int y) const;
+
+      // Write the image as a little-endian PFM file. Returns false on failure.
+      bool writePfm(const std::string& path) const;
+      // Read a color PFM file of either endianness. Returns nullptr on failure.
+      static std::unique_ptr<Image> readPfm(const std::string& path);
+  };
+}
+
+#endif // _IMAGE_H_
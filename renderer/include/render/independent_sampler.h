@@ -0,0 +1,30 @@
+#ifndef _INDEPENDENT_SAMPLER_H_
+#define _INDEPENDENT_SAMPLER_H_
+
+#pragma once
+
+#include "render/sampler.h"
+
+namespace hd {
+  /**
+   * Independent uniform random numbers for every pixel, sample and dimension, i.e. plain Monte
+   * Carlo, whose error falls as N^-1/2 with N samples. The baseline other samplers are
+   * measured against, and the fallback for integrands too irregular to benefit from them.
+   *
+   * Numbers are drawn from Philox4x32 keyed by the seed, with counter (x, y, sampleIndex,
+   * dimension / 2): each evaluation gives the two 53-bit numbers of a pair of dimensions, i.e.
+   * of a pixel position or of a bounce of a path. fill() evaluates counters in SIMD batches.
+   */
+  class IndependentSampler : public Sampler {
+    public:
+      explicit IndependentSampler(uint32_t seed = 0) : Sampler(seed) {}
+
+      double get(unsigned int x, unsigned int y, unsigned int sampleIndex,
+          unsigned int dimension) const override;
+      void fill(std::size_t count, const unsigned int* xs, const unsigned int* ys,
+          const unsigned int* sampleIndices, unsigned int dimension, unsigned int dimensionNum,
+          double* values) const override;
+  };
+}
+
+#endif // _INDEPENDENT_SAMPLER_H_
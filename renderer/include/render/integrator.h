@@ -0,0 +1,76 @@
+#ifndef _INTEGRATOR_H_
+#define _INTEGRATOR_H_
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include "geometry/kd_tree.h"
+#include "geometry/ray3.h"
+#include "geometry/triangular_mesh.h"
+#include "math/vector3.h"
+#include "render/camera.h"
+#include "render/sampler.h"
+
+namespace hd {
+  /**
+   * Estimates the radiance reaching the camera through image samples, i.e. the light transport
+   * part of rendering, as opposed to scheduling samples over threads (see Renderer).
+   *
+   * Samples are requested in batches rather than one at a time, so that integrators can process
+   * them in whatever order suits them best, e.g. stage by stage over the whole batch.
+   *
+   * Every random number a sample uses is taken from a Sampler, as a function of its pixel, its
+   * sample index and the dimension it is used for, never of the order samples are processed in.
+   * The result of a sample thus does not depend on batching nor on scheduling.
+   */
+  class Integrator {
+    public:
+      /**
+       * Sample sampleIndex of pixel (x, y).
+       */
+      class SampleRequest {
+        public:
+          unsigned int x;
+          unsigned int y;
+          unsigned int sampleIndex;
+        public:
+          SampleRequest() : x(0), y(0), sampleIndex(0) {}
+          SampleRequest(unsigned int px, unsigned int py, unsigned int s)
+              : x(px), y(py), sampleIndex(s) {}
+      };
+
+    protected:
+      const TriangularMesh& _mesh;
+      // Tree over the faces of the mesh, entity i being face i.
+      const KdTree& _tree;
+      Camera _camera;
+      std::shared_ptr<const Sampler> _sampler;
+
+    public:
+      // Samples are drawn from an IndependentSampler with the given seed, unless another
+      // sampler is set.
+      Integrator(const TriangularMesh& mesh, const KdTree& tree, const Camera& camera,
+          unsigned int seed = 0);
+      virtual ~Integrator() {}
+
+      const TriangularMesh& mesh() const { return _mesh; }
+      const Camera& camera() const { return _camera; }
+      const Sampler& sampler() const { return *_sampler; }
+      void setSampler(const std::shared_ptr<const Sampler>& sampler);
+
+      // Write to radiance[i] the radiance estimate of requests[i], for count requests.
+      virtual void render(const SampleRequest* requests, std::size_t count,
+          Vector3* radiance) const = 0;
+
+    protected:
+      // Number in [0, 1) for the given dimension of a sample, from the sampler.
+      double _random(const SampleRequest& request, unsigned int dimension) const;
+      // Primary ray of a sample, jittered within its pixel by dimensions 0 and 1.
+      Ray3 _generateRay(const SampleRequest& request) const;
+      // Shading point of a hit, i.e. its parameters on the face hit.
+      TriangularMesh::MeshPoint _meshPoint(const RayHit& hit) const;
+  };
+}
+
+#endif // _INTEGRATOR_H_
@@ -0,0 +1,45 @@
+#ifndef _LATTICE_SAMPLER_H_
+#define _LATTICE_SAMPLER_H_
+
+#pragma once
+
+#include "render/sampler.h"
+
+namespace hd {
+  /**
+   * Points of a rank-1 lattice sequence, shifted per pixel by blue noise.
+   *
+   * All pixels share the same lattice, an extensible one whose first 2^m points form a lattice
+   * for every m (Cools, Kuo and Nuyens, 2006), rotated modulo 1 by an offset of each pixel and
+   * dimension (Cranley-Patterson rotation). Offsets are read from a blue noise mask, i.e. one
+   * without low frequencies, so that neighboring pixels have offsets far apart, and the error
+   * left in the image is spread as high frequency noise that looks smoother than white noise
+   * at the same sample count. Each dimension reads the mask at a different toroidal shift.
+   *
+   * The lattice has LATTICE_DIMENSION_NUM dimensions. Further dimensions use independent
+   * random numbers shifted by blue noise.
+   */
+  class LatticeSampler : public Sampler {
+    public:
+      static const unsigned int LATTICE_DIMENSION_NUM = 16;
+      // Side of the square, tiled blue noise mask.
+      static const unsigned int BLUE_NOISE_SIZE = 64;
+
+    private:
+      // Blue noise mask, generated once per process: ranks of pixels in [0, BLUE_NOISE_SIZE^2)
+      // in row-major order.
+      const uint16_t* _blueNoise;
+
+    public:
+      explicit LatticeSampler(uint32_t seed = 0);
+
+      double get(unsigned int x, unsigned int y, unsigned int sampleIndex,
+          unsigned int dimension) const override;
+
+      // Value of the blue noise mask at a pixel, in [0, 1), tiled over the plane. Values of
+      // the mask are equidistributed.
+      double blueNoise(unsigned int x, unsigned int y) const;
+  };
+}
+
+#endif // _LATTICE_SAMPLER_H_
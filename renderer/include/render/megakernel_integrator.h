@@ -0,0 +1,28 @@
+#ifndef _MEGAKERNEL_INTEGRATOR_H_
+#define _MEGAKERNEL_INTEGRATOR_H_
+
+#pragma once
+
+#include "render/path_integrator.h"
+
+namespace hd {
+  /**
+   * Path tracer that traces each path from start to end before moving on to the next one, i.e.
+   * a single loop body that intersects, shades and casts shadow rays in turn. Simple, and the
+   * baseline WavefrontIntegrator is measured against.
+   */
+  class MegakernelIntegrator : public PathIntegrator {
+    public:
+      MegakernelIntegrator(const TriangularMesh& mesh, const KdTree& tree, const Camera& camera,
+          const Options& options = Options(), unsigned int seed = 0)
+          : PathIntegrator(mesh, tree, camera, options, seed) {}
+
+      void render(const SampleRequest* requests, std::size_t count,
+          Vector3* radiance) const override;
+
+    private:
+      Vector3 _trace(const SampleRequest& request) const;
+  };
+}
+
+#endif // _MEGAKERNEL_INTEGRATOR_H_
@@ -0,0 +1,67 @@
+#ifndef _PATH_INTEGRATOR_H_
+#define _PATH_INTEGRATOR_H_
+
+#pragma once
+
+#include "render/integrator.h"
+
+namespace hd {
+  /**
+   * Base of path tracers: the light transport model they share, and the steps of a path that
+   * do not depend on how paths are scheduled.
+   *
+   * Surfaces are diffuse with a uniform albedo, lit by a sun, i.e. a directional light, and by a
+   * uniform sky. Paths bounce by cosine-weighted sampling of the hemisphere, and light from the
+   * sun is gathered at every bounce by a shadow ray, as the sun cannot be hit by chance.
+   *
+   * Bounce b of a sample uses random dimensions 2 + 2b and 3 + 2b, so that all path tracers
+   * trace the very same paths for the same samples, whatever order they trace them in.
+   */
+  class PathIntegrator : public Integrator {
+    public:
+      class Options {
+        public:
+          // Maximum number of surface interactions along a path.
+          unsigned int maxDepth;
+          double albedo;
+          // Direction towards the sun, normalized upon construction of integrators.
+          Vector3 sunDirection;
+          // Irradiance of the sun on a surface facing it.
+          Vector3 sunIrradiance;
+          Vector3 skyRadiance;
+        public:
+          Options() : maxDepth(5), albedo(0.7), sunDirection(0.3, 1.0, 0.5),
+              sunIrradiance(3.0, 2.8, 2.5), skyRadiance(0.3, 0.4, 0.6) {}
+      };
+
+    protected:
+      Options _options;
+      // Distance that rays leaving a surface are moved off it, to avoid hitting it again due to
+      // rounding. Relative to the size of the scene.
+      double _rayOffset;
+
+    public:
+      PathIntegrator(const TriangularMesh& mesh, const KdTree& tree, const Camera& camera,
+          const Options& options = Options(), unsigned int seed = 0);
+      virtual ~PathIntegrator() {}
+
+      const Options& options() const { return _options; }
+
+    protected:
+      // Turn the geometric normal of the entity hit and the shading normal to the side of the
+      // surface the ray comes from.
+      void _orientNormals(const Vector3& rayDirection, Vector3& geometricNormal,
+          Vector3& shadingNormal) const;
+      // Origin of rays leaving the surface at p, on the side the geometric normal points to.
+      Vector3 _offsetOrigin(const Vector3& p, const Vector3& geometricNormal) const;
+      // Weight of sun light reflected at a surface towards the previous path vertex, to be
+      // multiplied by the sun irradiance, if the sun is not occluded. 0 if the surface faces
+      // away from the sun, in which case no shadow ray is needed.
+      double _sunWeight(const Vector3& geometricNormal, const Vector3& shadingNormal) const;
+      // Direction of the bounce at a surface with the given shading normal, for random numbers
+      // u1 and u2. Cosine-weighted, so that the path throughput is just multiplied by albedo.
+      Vector3 _sampleBounce(const Vector3& shadingNormal, double u1, double u2) const;
+  };
+}
+
+#endif // _PATH_INTEGRATOR_H_
@@ -0,0 +1,75 @@
+#ifndef _PFM_STREAM_H_
+#define _PFM_STREAM_H_
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "render/film.h"
+
+namespace hd {
+  /**
+   * PFM file of the image of a film, written region by region by a background thread, e.g. tile
+   * by tile as rendering finishes them, so that output overlaps rendering instead of following
+   * it. Queuing a region only takes a short lock; the film is read and the file written by the
+   * background thread.
+   *
+   * The file is sized for the whole image when opened, and each region is written in place one
+   * row at a time, so regions may come in any order, and pixels never queued stay black. The
+   * pixels of a region must be final when it is queued. The file is the same as the one
+   * Image::writePfm() writes once all pixels have been queued.
+   */
+  class PfmStream {
+    private:
+      class Region {
+        public:
+          unsigned int x0, y0, x1, y1;
+      };
+
+      const Film* _film;
+      std::fstream _file;
+      // Offset of the pixel data, past the header.
+      std::streamoff _dataOffset;
+      std::thread _writer;
+      std::mutex _mutex;
+      std::condition_variable _condition;
+      std::deque<Region> _queue;
+      bool _closing;
+      bool _failed;
+      std::atomic<std::size_t> _regionNum;
+
+    public:
+      PfmStream();
+      PfmStream(const PfmStream& stream) = delete;
+      PfmStream& operator=(const PfmStream& stream) = delete;
+      // Closes the stream if still open.
+      ~PfmStream();
+
+      // Create or truncate the file at the given path for the image of the given film, which
+      // must outlive the stream, and start the background thread. Returns false on failure.
+      bool open(const std::string& path, const Film& film);
+      // Queue pixels [x0, x1) x [y0, y1) for writing.
+      void write(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1);
+      // Wait for all queued regions to be written, then close the file. Returns false if the
+      // stream was not open or any write failed.
+      bool close();
+
+      bool isOpen() const { return _film != nullptr; }
+      // Regions written so far.
+      std::size_t regionNum() const { return _regionNum.load(); }
+
+    private:
+      // Body of the background thread: write queued regions until closed.
+      void _run();
+      bool _writeRegion(const Region& region, std::vector<float>& row);
+  };
+}
+
+#endif // _PFM_STREAM_H_
@@ -0,0 +1,112 @@
+#ifndef _RENDER_COORDINATOR_H_
+#define _RENDER_COORDINATOR_H_
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <set>
+#include <memory>
+#include <string>
+#include <vector>
+#include "io/socket.h"
+#include "render/film.h"
+#include "render/image.h"
+#include "render/render_job.h"
+#include "render/tile_scheduler.h"
+
+namespace hd {
+  /**
+   * Renders a job across processes: hands out the tiles of the image to RenderWorkers connected
+   * over sockets, and merges the tile buffers they send back into a Film.
+   *
+   * Workers may connect at any time during run(). Each is kept busy with up to twice as many
+   * tiles as it has threads. A worker that disconnects, or holds tiles for longer than the tile
+   * timeout without returning any, is dropped, and the tiles it had not returned go back to the
+   * front of the queue for other workers. Every tile is merged exactly once; results of a tile
+   * merged already are ignored. Since samples depend on the pixel, sample index and seed only
+   * (see Integrator), the image is the same whichever workers render which tiles, and the same
+   * as a Renderer would render in a single process.
+   *
+   * Runs on the calling thread, polling all sockets, as merging is cheap next to rendering.
+   */
+  class RenderCoordinator {
+    public:
+      class Options {
+        public:
+          unsigned int tileSize;
+          // Time a worker holding tiles may go without returning one before it is considered
+          // hung, or 0 for no limit. Tiles queue up at workers, so this is counted from the last
+          // result, or from the assignment of tiles to a worker that held none, rather than from
+          // the assignment of each tile.
+          double tileTimeoutSeconds;
+          // Time run() waits without any tile being merged before giving up, or 0 for no limit.
+          double idleTimeoutSeconds;
+          // Called between polls while no worker is connected, if set. run() gives up once it
+          // returns false, e.g. when all workers it started itself have exited.
+          std::function<bool()> isWorkerExpected;
+        public:
+          Options() : tileSize(16), tileTimeoutSeconds(300.0), idleTimeoutSeconds(0.0) {}
+      };
+
+      class Stats {
+        public:
+          // Workers that connected, and those dropped before the job was done.
+          unsigned int workerNum;
+          unsigned int lostWorkerNum;
+          // Tiles handed out again after their worker was dropped.
+          unsigned int reassignedTileNum;
+          double wallSeconds;
+        public:
+          Stats() : workerNum(0), lostWorkerNum(0), reassignedTileNum(0), wallSeconds(0.0) {}
+      };
+
+    private:
+      typedef std::chrono::steady_clock Clock;
+
+      class Connection {
+        public:
+          Socket socket;
+          // Threads of the worker, 0 until it said hello.
+          unsigned int threadNum;
+          // Tiles handed out and not returned yet.
+          std::set<unsigned int> tiles;
+          // Since when the worker holds tiles without returning any.
+          Clock::time_point waitingSince;
+        public:
+          explicit Connection(Socket s) : socket(std::move(s)), threadNum(0) {}
+      };
+
+      RenderJob _job;
+      Options _options;
+      ServerSocket _server;
+      Stats _stats;
+
+    public:
+      RenderCoordinator(const RenderJob& job, const Options& options = Options());
+
+      // Listen for workers at the given address (see Socket). Returns false on failure.
+      bool listen(const std::string& address);
+      // Address listened at, with the actual port for TCP.
+      const std::string& address() const { return _server.address(); }
+      // Render the whole image with the workers that connect, and tell them when it is done.
+      // Returns nullptr if not listening, if the idle timeout elapsed, or if no worker is
+      // connected nor expected any more.
+      std::unique_ptr<Image> run();
+      const Stats& stats() const { return _stats; }
+
+    private:
+      // Handle a message of a worker. Returns false if the worker must be dropped.
+      bool _receive(Connection& connection, const TileScheduler& scheduler, Film& film,
+          std::vector<bool>& merged, unsigned int& mergedNum);
+      // Hand out queued tiles to a worker up to its share. Returns false if it must be dropped.
+      bool _assign(Connection& connection, const TileScheduler& scheduler,
+          const std::vector<bool>& merged, std::deque<unsigned int>& queue);
+      // Close a worker's connection and queue the tiles it had not returned.
+      void _drop(Connection& connection, const std::vector<bool>& merged,
+          std::deque<unsigned int>& queue);
+  };
+}
+
+#endif // _RENDER_COORDINATOR_H_
@@ -0,0 +1,101 @@
+#ifndef _RENDER_DAEMON_H_
+#define _RENDER_DAEMON_H_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "io/socket.h"
+#include "render/image.h"
+#include "render/render_job.h"
+#include "scene/scene_cache.h"
+
+namespace hd {
+  /**
+   * A long-running render server: renders the jobs clients send over a socket and sends back
+   * the images. Scenes are kept in a SceneCache between jobs, so that a job on a scene rendered
+   * recently, e.g. from another viewpoint, starts rendering without loading it again.
+   *
+   * Jobs are served one at a time, each on all threads, one job per connection (see
+   * RenderProtocol). Scenes may be native mesh files or PLY files, and their paths are
+   * resolved by the daemon, so clients should send absolute paths.
+   */
+  class RenderDaemon {
+    public:
+      class Options {
+        public:
+          // Memory budget of the scene cache, in bytes.
+          std::size_t cacheBytes;
+          unsigned int tileSize;
+          // 0 uses one thread per core.
+          unsigned int threadNum;
+          // Time a client may take to send its request.
+          double requestTimeoutSeconds;
+          // Largest image a job may ask for, bounding the memory a client can make the daemon
+          // allocate for the film and the response.
+          uint64_t maxPixelNum;
+        public:
+          Options() : cacheBytes(static_cast<std::size_t>(4) << 30), tileSize(16),
+              threadNum(0), requestTimeoutSeconds(10.0), maxPixelNum(1 << 24) {}
+      };
+
+      class Stats {
+        public:
+          unsigned int jobNum;
+          // Jobs answered with FAILED, and requests dropped as malformed.
+          unsigned int failedJobNum;
+          unsigned int badRequestNum;
+        public:
+          Stats() : jobNum(0), failedJobNum(0), badRequestNum(0) {}
+      };
+
+      /**
+       * How the daemon served a job, as reported to the client.
+       */
+      class JobStats {
+        public:
+          // Whether the scene was in the cache.
+          bool isSceneCached;
+          double loadSeconds;
+          double renderSeconds;
+        public:
+          JobStats() : isSceneCached(false), loadSeconds(0.0), renderSeconds(0.0) {}
+      };
+
+    private:
+      Options _options;
+      ServerSocket _server;
+      SceneCache _cache;
+      Stats _stats;
+
+    public:
+      explicit RenderDaemon(const Options& options = Options());
+
+      // Listen for clients at the given address (see Socket). Returns false on failure.
+      bool listen(const std::string& address);
+      // Address listened at, with the actual port for TCP.
+      const std::string& address() const { return _server.address(); }
+      // Serve clients until one asks to shut down, then stop listening. Returns false if not
+      // listening.
+      bool run();
+      const Stats& stats() const { return _stats; }
+      const SceneCache& cache() const { return _cache; }
+
+      // Have the daemon at the given address render a job. Returns nullptr, with the reason in
+      // error if given, if it cannot be reached or fails to render the job.
+      static std::unique_ptr<Image> render(const std::string& address, const RenderJob& job,
+          JobStats* stats = nullptr, std::string* error = nullptr);
+      // Ask the daemon at the given address to stop. Returns false if it cannot be reached.
+      static bool shutdown(const std::string& address);
+
+    private:
+      // Serve the request of a client. Returns false if it asked to shut down.
+      bool _serve(Socket& socket);
+      // Render a job, storing the reason in error on failure.
+      std::unique_ptr<Image> _render(const RenderJob& job, JobStats& stats, std::string& error);
+  };
+}
+
+#endif // _RENDER_DAEMON_H_
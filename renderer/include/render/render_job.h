@@ -0,0 +1,70 @@
+#ifndef _RENDER_JOB_H_
+#define _RENDER_JOB_H_
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "geometry/bounding_box3.h"
+#include "geometry/kd_tree.h"
+#include "geometry/triangular_mesh.h"
+#include "io/socket.h"
+#include "math/vector3.h"
+#include "render/camera.h"
+#include "render/film.h"
+#include "render/integrator.h"
+
+namespace hd {
+  /**
+   * Everything needed to render an image of a scene, so that processes other than the one that
+   * set it up can render parts of it identically (see RenderCoordinator and RenderWorker).
+   *
+   * The scene is referred to by the path of a mesh file of the native format (see
+   * MeshSerializer), which every process loads rather than receiving the mesh itself.
+   */
+  class RenderJob {
+    public:
+      // Largest image read() accepts, so that a job from a socket cannot make a process
+      // allocate more than a few tens of GiB for its film. Renderers may impose lower budgets.
+      static const uint64_t MAX_PIXEL_NUM = static_cast<uint64_t>(1) << 28;
+
+      std::string meshPath;
+      unsigned int width;
+      unsigned int height;
+      // Camera framing the whole scene (see Camera::frame()), fovY in degrees.
+      Vector3 viewDirection;
+      Vector3 up;
+      double fovY;
+      // Whether the camera is rather at the center of the scene, looking along viewDirection,
+      // e.g. for interior scenes.
+      bool isInside;
+      // headlight, megakernel or wavefront.
+      std::string integrator;
+      // independent, sobol or lattice.
+      std::string sampler;
+      uint32_t samplerSeed;
+      unsigned int samplesPerPixel;
+      Film::Filter filter;
+      // Whether the wavefront integrator sorts secondary rays (see WavefrontIntegrator).
+      bool isSortingRays;
+
+    public:
+      RenderJob() : width(640), height(480), viewDirection(-1.0, -1.0, -1.0),
+          up(Vector3::yUnit()), fovY(45.0), isInside(false), integrator("wavefront"),
+          sampler("sobol"), samplerSeed(0), samplesPerPixel(1), isSortingRays(true) {}
+
+      Camera camera(const BoundingBox3& sceneBox) const;
+      // Integrator and sampler of the job over a scene. Returns nullptr if either name is
+      // unknown.
+      std::unique_ptr<Integrator> createIntegrator(const TriangularMesh& mesh,
+          const KdTree& tree) const;
+
+      // Append the job to a message, or read it back. read() returns false if the message is
+      // malformed, or the image larger than MAX_PIXEL_NUM pixels.
+      void write(Message& message) const;
+      bool read(Message& message);
+  };
+}
+
+#endif // _RENDER_JOB_H_
@@ -0,0 +1,68 @@
+#ifndef _RENDER_PROTOCOL_H_
+#define _RENDER_PROTOCOL_H_
+
+#pragma once
+
+#include <cstdint>
+
+namespace hd {
+  /**
+   * Messages between a RenderCoordinator and its RenderWorkers, in the order they are sent:
+   *   - HELLO, worker to coordinator: protocol version, endianness tag and number of threads.
+   *   - JOB, coordinator to worker: the RenderJob.
+   *   - TILE, coordinator to worker: tile index and pixel bounds x0, y0, x1, y1.
+   *   - RESULT, worker to coordinator: tile index, bounds of the tile buffer, then per pixel of
+   *     the buffer in row-major order, its 3 sums and weight (see Film::TileBuffer).
+   *   - DONE, coordinator to worker: no tiles are left, the worker may disconnect.
+   * and between a RenderDaemon and its clients, one request per connection:
+   *   - RENDER, client to daemon: protocol version, endianness tag and the RenderJob.
+   *   - IMAGE, daemon to client: whether the scene was cached, seconds spent loading it and
+   *     rendering, width, height, then the 3 channels of every pixel in row-major order.
+   *   - FAILED, daemon to client: what went wrong, instead of an image.
+   *   - SHUTDOWN, client to daemon: stop serving once the request is acknowledged with DONE.
+   * Values are sent in native byte order, which the endianness tag checks both ends share.
+   *
+   * Receivers bound payloads by maxPayloadSize(), so that a peer cannot make them allocate more
+   * than the image or tile they expect.
+   */
+  class RenderProtocol {
+    public:
+      // Enumerators rather than static members, so that they can be bound to references.
+      enum : uint32_t {
+        // Current version of the protocol. Bump this whenever a message changes.
+        VERSION = 2,
+        ENDIANNESS_TAG = 0x01020304,
+        // Largest payload of messages without pixels, which hold a few values and strings,
+        // e.g. the mesh path of a RenderJob.
+        MAX_SMALL_PAYLOAD_SIZE = 1 << 16
+      };
+
+      enum MessageType : uint32_t {
+        HELLO = 1,
+        JOB,
+        TILE,
+        RESULT,
+        DONE,
+        RENDER,
+        IMAGE,
+        FAILED,
+        SHUTDOWN
+      };
+
+    public:
+      // Largest valid payload of a message of the given type, for RESULT and IMAGE messages of
+      // at most pixelNum pixels.
+      static uint64_t maxPayloadSize(uint32_t type, uint64_t pixelNum) {
+        switch (type) {
+          case RESULT:
+            return 5 * sizeof(uint32_t) + pixelNum * 4 * sizeof(double);
+          case IMAGE:
+            return 3 * sizeof(uint32_t) + 2 * sizeof(double) + pixelNum * 3 * sizeof(double);
+          default:
+            return MAX_SMALL_PAYLOAD_SIZE;
+        }
+      }
+  };
+}
+
+#endif // _RENDER_PROTOCOL_H_
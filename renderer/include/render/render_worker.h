@@ -0,0 +1,52 @@
+#ifndef _RENDER_WORKER_H_
+#define _RENDER_WORKER_H_
+
+#pragma once
+
+#include <string>
+
+namespace hd {
+  /**
+   * Renders tiles for a RenderCoordinator: connects to it, loads the scene of its job, and
+   * renders the tiles it hands out on a pool of threads, sending each tile buffer back as soon
+   * as it is done, until the coordinator says the job is done.
+   *
+   * Each worker loads its own copy of the mesh from the mesh file and builds its own KdTree,
+   * so workers on one machine do not share scene memory.
+   */
+  class RenderWorker {
+    public:
+      class Options {
+        public:
+          // 0 uses one thread per core.
+          unsigned int threadNum;
+          // Time to keep trying to connect, e.g. while the coordinator starts up.
+          double connectTimeoutSeconds;
+        public:
+          Options() : threadNum(0), connectTimeoutSeconds(10.0) {}
+      };
+
+      class Stats {
+        public:
+          unsigned int tileNum;
+          double wallSeconds;
+        public:
+          Stats() : tileNum(0), wallSeconds(0.0) {}
+      };
+
+    private:
+      Options _options;
+      Stats _stats;
+
+    public:
+      explicit RenderWorker(const Options& options = Options()) : _options(options) {}
+
+      // Work for the coordinator at the given address (see Socket) until the job is done.
+      // Returns false if it cannot be reached, the scene of the job cannot be loaded, or the
+      // connection breaks first.
+      bool run(const std::string& address);
+      const Stats& stats() const { return _stats; }
+  };
+}
+
+#endif // _RENDER_WORKER_H_
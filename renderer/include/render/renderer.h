@@ -0,0 +1,54 @@
+#ifndef _RENDERER_H_
+#define _RENDERER_H_
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include "render/film.h"
+#include "render/image.h"
+#include "render/integrator.h"
+#include "render/tile_scheduler.h"
+
+namespace hd {
+  /**
+   * Renders an image with an integrator, tile by tile on all cores (see TileScheduler). All
+   * samples of a tile are handed to the integrator as one batch, and accumulated in a private
+   * buffer of the tile, which is merged into a shared Film once the tile is done.
+   *
+   * The image can also be streamed to a PFM file while rendering: a tile is queued for writing
+   * as soon as its pixels are final, i.e. once it and all tiles whose filter footprints reach
+   * it are merged, and is written by a background thread (see PfmStream).
+   */
+  class Renderer {
+    public:
+      class Options {
+        public:
+          unsigned int samplesPerPixel;
+          unsigned int tileSize;
+          // 0 uses one thread per core.
+          unsigned int threadNum;
+          Film::Filter filter;
+          // PFM file to stream the image to, if not empty.
+          std::string outputPath;
+        public:
+          Options() : samplesPerPixel(1), tileSize(16), threadNum(0) {}
+      };
+
+    private:
+      const Integrator& _integrator;
+
+    public:
+      explicit Renderer(const Integrator& integrator) : _integrator(integrator) {}
+
+      // Render an image of the camera resolution. Scheduling stats are stored in stats if given.
+      // Returns nullptr if the output file cannot be written.
+      std::unique_ptr<Image> render(const Options& options,
+          TileScheduler::Stats* stats = nullptr) const;
+      // Take samplesPerPixel samples of every pixel of a tile, into a buffer of the tile.
+      void renderTile(const TileScheduler::Tile& tile, unsigned int samplesPerPixel,
+          Film::TileBuffer& buffer) const;
+  };
+}
+
+#endif // _RENDERER_H_
@@ -0,0 +1,51 @@
+#ifndef _SAMPLER_H_
+#define _SAMPLER_H_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace hd {
+  /**
+   * Source of the random numbers of samples: sample sampleIndex of pixel (x, y) uses one number
+   * per dimension, e.g. two for its position within the pixel and two per bounce of its path.
+   *
+   * Samplers are stateless: a number is a pure function of pixel, sample index, dimension and
+   * seed, so that any thread can evaluate any sample in any order, and no memory is allocated
+   * per sample. Samplers differ in how numbers of different samples of a pixel are spread over
+   * [0, 1)^n, which decides how fast estimates converge.
+   */
+  class Sampler {
+    protected:
+      uint32_t _seed;
+
+    public:
+      explicit Sampler(uint32_t seed) : _seed(seed) {}
+      virtual ~Sampler() {}
+
+      uint32_t seed() const { return _seed; }
+      // Number in [0, 1) for the given dimension of sample sampleIndex of pixel (x, y).
+      virtual double get(unsigned int x, unsigned int y, unsigned int sampleIndex,
+          unsigned int dimension) const = 0;
+      // Numbers for dimensions dimension to dimension + dimensionNum - 1 of count samples at
+      // once, sample i being sample sampleIndices[i] of pixel (xs[i], ys[i]): the number of
+      // dimension dimension + d of sample i is written to values[d * count + i]. Same numbers
+      // as get(), which it calls for each of them unless a sampler has a faster way.
+      virtual void fill(std::size_t count, const unsigned int* xs, const unsigned int* ys,
+          const unsigned int* sampleIndices, unsigned int dimension, unsigned int dimensionNum,
+          double* values) const;
+
+    protected:
+      // Hash of a pixel, mixed with the seed.
+      uint32_t _pixelHash(unsigned int x, unsigned int y) const;
+      // Hash of the given values, with all bits of the result depending on all of theirs.
+      static uint32_t _hash(uint32_t a, uint32_t b);
+      // Finalizer of SplitMix64, a bijective mix of all bits of its input.
+      static uint64_t _mix(uint64_t h);
+      // Number in [0, 1) with the bits of a 32-bit fraction.
+      static double _toUnit(uint32_t bits) { return bits * (1.0 / 4294967296.0); }
+  };
+}
+
+#endif // _SAMPLER_H_
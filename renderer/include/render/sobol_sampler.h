@@ -0,0 +1,44 @@
+#ifndef _SOBOL_SAMPLER_H_
+#define _SOBOL_SAMPLER_H_
+
+#pragma once
+
+#include "render/sampler.h"
+
+namespace hd {
+  /**
+   * Owen-scrambled Sobol points, following Burley, "Practical Hash-based Owen Scrambling", JCGT
+   * 2020.
+   *
+   * Dimensions are taken in groups of four, each group being the first four dimensions of the
+   * Sobol sequence, so that the numbers of a sample within a group, e.g. the pixel position and
+   * first bounce, are well stratified jointly. Each group shuffles the sequence by Owen
+   * scrambling the sample index with a seed of its own, which decorrelates groups, and every
+   * dimension is Owen scrambled with a seed of its own per pixel, which decorrelates pixels and
+   * keeps the estimates unbiased. Power-of-two sample counts of a pixel are stratified in every
+   * dimension and in every pair of dimensions 0 and 1 of a group.
+   *
+   * Direction numbers are those of Joe and Kuo, expanded to a table once per process.
+   */
+  class SobolSampler : public Sampler {
+    public:
+      // Sobol dimensions making up a group.
+      static const unsigned int GROUP_DIMENSION_NUM = 4;
+
+    private:
+      // Direction numbers of each dimension of a group, one per index bit.
+      const uint32_t (*_directions)[32];
+
+    public:
+      explicit SobolSampler(uint32_t seed = 0);
+
+      double get(unsigned int x, unsigned int y, unsigned int sampleIndex,
+          unsigned int dimension) const override;
+
+      // Unscrambled point of the Sobol sequence in one of the first GROUP_DIMENSION_NUM
+      // dimensions, as a 32-bit fraction.
+      uint32_t sobol(uint32_t index, unsigned int dimension) const;
+  };
+}
+
+#endif // _SOBOL_SAMPLER_H_
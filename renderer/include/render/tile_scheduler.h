@@ -0,0 +1,114 @@
+#ifndef _TILE_SCHEDULER_H_
+#define _TILE_SCHEDULER_H_
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hd {
+  /**
+   * Splits an image into square tiles and renders them on a pool of worker threads.
+   *
+   * Tiles are dealt out up front in contiguous runs, one run per thread, so that each thread
+   * works on a coherent region of the image. Each thread keeps its tiles in a deque of its own
+   * and takes them from the front; a thread that runs out steals from the back of another
+   * thread's deque, i.e. the tile farthest from where its owner is working. Expensive regions of
+   * the image are thus spread over all threads without any central queue that every tile has to
+   * go through, which is what keeps throughput scaling with the number of cores.
+   *
+   * No tiles are added once a run started, so a thread that finds every deque empty is done.
+   */
+  class TileScheduler {
+    public:
+      /**
+       * A rectangle of pixels [x0, x1) x [y0, y1). Tiles on the right and bottom borders of the
+       * image are cut to fit it.
+       */
+      class Tile {
+        public:
+          unsigned int x0;
+          unsigned int y0;
+          unsigned int x1;
+          unsigned int y1;
+          // Index of the tile in row-major order of tiles.
+          unsigned int index;
+        public:
+          unsigned int pixelNum() const { return (x1 - x0) * (y1 - y0); }
+      };
+
+      /**
+       * What a worker thread did during a run.
+       */
+      class ThreadStats {
+        public:
+          // Time spent rendering tiles, i.e. not looking for work nor waiting for other threads.
+          double busySeconds;
+          unsigned int tileNum;
+          // Tiles taken from other threads' deques.
+          unsigned int stealNum;
+        public:
+          ThreadStats() : busySeconds(0.0), tileNum(0), stealNum(0) {}
+      };
+
+      /**
+       * Timings of a run.
+       */
+      class Stats {
+        public:
+          double wallSeconds;
+          std::vector<ThreadStats> threads;
+        public:
+          Stats() : wallSeconds(0.0) {}
+          // Fraction of the run a thread spent rendering tiles.
+          double utilisation(unsigned int threadId) const;
+          // Mean utilisation over all threads.
+          double utilisation() const;
+          // Multi-line report with one line per thread, for logs.
+          std::string toString() const;
+      };
+
+      // Renders a tile on the worker thread with the given id, in [0, threadNum()).
+      typedef std::function<void(const Tile& tile, unsigned int threadId)> TileFunction;
+
+    private:
+      class WorkQueue {
+        public:
+          std::mutex mutex;
+          std::deque<unsigned int> tileIds;
+      };
+
+      unsigned int _width;
+      unsigned int _height;
+      unsigned int _tileSize;
+      unsigned int _threadNum;
+      std::vector<Tile> _tiles;
+
+    public:
+      // threadNum of 0 uses one thread per core.
+      TileScheduler(unsigned int width, unsigned int height, unsigned int tileSize = 16,
+          unsigned int threadNum = 0);
+
+      unsigned int width() const { return _width; }
+      unsigned int height() const { return _height; }
+      unsigned int tileSize() const { return _tileSize; }
+      unsigned int threadNum() const { return _threadNum; }
+      unsigned int tileNum() const { return _tiles.size(); }
+      const Tile& tile(unsigned int index) const;
+
+      // Call fn once for every tile, on threadNum() threads including the calling one. Blocks
+      // until all tiles are done.
+      Stats run(const TileFunction& fn) const;
+
+    private:
+      // Take the next tile of thread threadId, from its own deque or else by stealing one.
+      bool _next(std::vector<std::unique_ptr<WorkQueue>>& queues, unsigned int threadId,
+          unsigned int& tileId, bool& stolen) const;
+  };
+}
+
+#endif // _TILE_SCHEDULER_H_
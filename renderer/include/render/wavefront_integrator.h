@@ -0,0 +1,95 @@
+#ifndef _WAVEFRONT_INTEGRATOR_H_
+#define _WAVEFRONT_INTEGRATOR_H_
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "geometry/bounding_box3.h"
+#include "geometry/kd_tree.h"
+#include "render/path_integrator.h"
+
+namespace hd {
+  /**
+   * Path tracer that advances a whole wave of paths one bounce at a time, through a pipeline of
+   * stages each run as a loop over all paths of the wave:
+   *   - generate: primary rays of all samples of the wave,
+   *   - intersect: closest hits of all active paths,
+   *   - shade: sky light for paths that escaped, and for those that hit a surface, a shadow
+   *     ray towards the sun and the ray of the next bounce,
+   *   - shadow test: sun light for shadow rays that are not occluded.
+   * Paths that end drop out of the queue of active paths, which is compacted by every shade
+   * stage, so that later stages only loop over live paths.
+   *
+   * Path state, rays and hits are kept in structure-of-arrays buffers, so that each stage
+   * streams through a few contiguous arrays and runs one small loop body, e.g. shading
+   * normals of all hits are interpolated by a single batched TriangularMesh::normal() call,
+   * and the random numbers of their next bounces are drawn by a single Sampler::fill() call.
+   * Stages also make a natural place to reorder rays for coherence: unless disabled, the rays
+   * of every bounce after the first are sorted before they are traced, by direction octant and
+   * then by the position of their origins along a Morton curve over the scene. Rays traced one
+   * after the other then start close to each other and head the same way, so they mostly visit
+   * tree nodes and faces that the previous rays left in cache. Primary rays need no sorting, as
+   * requests come in pixel order, and shadow rays follow the order of the hits they leave from
+   * and all head towards the sun. Paths do not depend on the order they are traced in, so
+   * sorting does not change the result.
+   *
+   * Traces the same paths as MegakernelIntegrator, so both give the same result up to rounding.
+   */
+  class WavefrontIntegrator : public PathIntegrator {
+    public:
+      // Default number of paths in flight. Large enough for stages to amortize their setup,
+      // small enough for the buffers of a wave to stay in cache.
+      static const std::size_t DEFAULT_WAVE_SIZE = 1 << 12;
+
+    private:
+      class Wave;
+
+      std::size_t _waveSize;
+      bool _isSortingRays;
+      // Bounds of the scene, over which ray origins are sorted.
+      BoundingBox3 _sceneBox;
+      // Rays traced so far, shadow rays included.
+      mutable std::atomic<uint64_t> _rayNum;
+      bool _isCountingTraversals;
+      // Traversals of all calls to render() so far, if counted.
+      mutable std::mutex _traversalStatsMutex;
+      mutable KdTree::TraversalStats _traversalStats;
+
+    public:
+      WavefrontIntegrator(const TriangularMesh& mesh, const KdTree& tree, const Camera& camera,
+          const Options& options = Options(), unsigned int seed = 0,
+          std::size_t waveSize = DEFAULT_WAVE_SIZE);
+
+      std::size_t waveSize() const { return _waveSize; }
+      // Whether secondary rays are sorted before they are traced. On by default.
+      bool isSortingRays() const { return _isSortingRays; }
+      void setSortingRays(bool isSortingRays) { _isSortingRays = isSortingRays; }
+      // Rays traced by all calls to render() so far, shadow rays included, e.g. to report rays
+      // per second.
+      uint64_t rayNum() const { return _rayNum.load(); }
+      // Whether traversals of the tree are counted (see KdTree::TraversalStats), e.g. to
+      // benchmark ray sorting where hardware counters are not available. Off by default, as
+      // counting slows down traversal. Each call to render() counts with a simulated cache of
+      // its own, as each thread has.
+      bool isCountingTraversals() const { return _isCountingTraversals; }
+      void setCountingTraversals(bool isCounting) { _isCountingTraversals = isCounting; }
+      KdTree::TraversalStats traversalStats() const;
+
+      // Requests are processed in waves of up to waveSize() paths.
+      void render(const SampleRequest* requests, std::size_t count,
+          Vector3* radiance) const override;
+
+    private:
+      void _generate(Wave& wave) const;
+      // Sort active paths by the coherence key of their rays.
+      void _sort(Wave& wave) const;
+      void _intersect(Wave& wave) const;
+      void _shade(Wave& wave) const;
+      void _shadowTest(Wave& wave) const;
+  };
+}
+
+#endif // _WAVEFRONT_INTEGRATOR_H_
@@ -0,0 +1,44 @@
+#ifndef _ROOM_GENERATOR_H_
+#define _ROOM_GENERATOR_H_
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "geometry/triangular_mesh.h"
+
+namespace hd {
+  /**
+   * Procedural interior scene, so that renders of a room, e.g. benchmarks of secondary ray
+   * coherence, can be reproduced from a few numbers rather than from a scene file.
+   *
+   * The room is a box of 10 x 4 x 10 units whose walls, floor and ceiling face inwards. It holds
+   * boxNum boxes of random sizes, some standing on the floor and others floating like shelves,
+   * around a clearing at the center of the room where a camera can stand (see
+   * RenderJob::isInside). Every side of the room and of the boxes is a grid of quads split in
+   * two triangles each, so that the face count scales independently of the layout.
+   *
+   * Boxes are drawn from a counter-based generator (see Philox4x32), so that the same options
+   * give the same mesh, face for face, on every platform.
+   */
+  class RoomGenerator {
+    public:
+      class Options {
+        public:
+          // Quads along each side of the walls, floor and ceiling.
+          unsigned int wallResolution;
+          unsigned int boxNum;
+          // Quads along each side of the faces of boxes.
+          unsigned int boxResolution;
+          uint32_t seed;
+        public:
+          Options() : wallResolution(64), boxNum(200), boxResolution(8), seed(0) {}
+      };
+
+    public:
+      // A populated mesh of 12 wallResolution^2 + 12 boxNum boxResolution^2 faces.
+      static std::unique_ptr<TriangularMesh> generate(const Options& options = Options());
+  };
+}
+
+#endif // _ROOM_GENERATOR_H_
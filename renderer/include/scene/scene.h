@@ -0,0 +1,50 @@
+#ifndef _SCENE_H_
+#define _SCENE_H_
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "geometry/kd_tree.h"
+#include "geometry/triangular_mesh.h"
+#include "util/arena.h"
+#include "util/memory_usage.h"
+
+namespace hd {
+  /**
+   * A scene to render: its meshes and the acceleration structures built over them.
+   *
+   * The scene owns an Arena meant to be shared by everything built for it (see
+   * TriangularMesh::Builder::setArena() and KdTree::build()), so that scene data is packed in
+   * a few large chunks and released in bulk along with the scene.
+   */
+  class Scene {
+    private:
+      std::shared_ptr<Arena> _arena;
+      std::vector<std::shared_ptr<const TriangularMesh>> _meshes;
+      std::vector<std::shared_ptr<const KdTree>> _kdTrees;
+
+    public:
+      Scene();
+      Scene(const Scene& scene) = delete;
+      Scene& operator=(const Scene& scene) = delete;
+      ~Scene() {}
+
+      std::shared_ptr<Arena> arena() const { return _arena; }
+
+      // Add a mesh or a tree to the scene, returning its index.
+      unsigned int addMesh(const std::shared_ptr<const TriangularMesh>& mesh);
+      unsigned int addKdTree(const std::shared_ptr<const KdTree>& tree);
+      unsigned int meshNum() const { return _meshes.size(); }
+      unsigned int kdTreeNum() const { return _kdTrees.size(); }
+      std::shared_ptr<const TriangularMesh> mesh(unsigned int index) const;
+      std::shared_ptr<const KdTree> kdTree(unsigned int index) const;
+
+      // Memory held by all meshes and trees of the scene. Geometry shared between meshes and
+      // arenas shared between structures are counted once, and unused space of all arenas
+      // involved is counted as slack.
+      MemoryUsage memoryUsage() const;
+  };
+}
+
+#endif // _SCENE_H_
@@ -0,0 +1,88 @@
+#ifndef _SCENE_CACHE_H_
+#define _SCENE_CACHE_H_
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "scene/scene.h"
+
+namespace hd {
+  /**
+   * Scenes loaded from mesh files, kept in memory between uses so that rendering the same scene
+   * again skips loading the mesh and building its tree.
+   *
+   * Each scene holds the mesh of one file, native (see MeshSerializer) or PLY, as mesh 0, and a
+   * tree over its faces as tree 0. Scenes are kept in an LRU cache bounded by a memory budget,
+   * as measured by Scene::memoryUsage(). A cached scene is reloaded if its file was modified
+   * since it was loaded.
+   *
+   * Scenes handed out are reference counted: evicting a scene never invalidates it for callers
+   * still holding it, it only stops counting against the budget. All methods are thread-safe.
+   */
+  class SceneCache {
+    public:
+      /**
+       * Cache activity since construction, and current occupancy.
+       */
+      class Stats {
+        public:
+          // Scenes loaded from files, and requests served from the cache.
+          std::size_t loads;
+          std::size_t hits;
+          std::size_t evictions;
+          std::size_t residentScenes;
+          std::size_t bytesResident;
+        public:
+          Stats() : loads(0), hits(0), evictions(0), residentScenes(0), bytesResident(0) {}
+      };
+
+    private:
+      class Entry {
+        public:
+          std::shared_ptr<const Scene> scene;
+          std::size_t bytes;
+          // Modification time in nanoseconds and size of the file when it was loaded.
+          int64_t fileTime;
+          int64_t fileSize;
+          // Position in _lru.
+          std::list<std::string>::iterator lruPosition;
+      };
+
+      std::size_t _memoryBudget;
+      std::unordered_map<std::string, Entry> _entries;
+      // Paths of cached scenes, most recently used first.
+      std::list<std::string> _lru;
+      Stats _stats;
+      mutable std::mutex _mutex;
+
+    public:
+      // Cached scenes are evicted whenever their total size exceeds memoryBudget bytes, except
+      // for the most recently used one.
+      explicit SceneCache(std::size_t memoryBudget) : _memoryBudget(memoryBudget) {}
+      SceneCache(const SceneCache& cache) = delete;
+      SceneCache& operator=(const SceneCache& cache) = delete;
+
+      // Scene of the mesh file at the given path, loaded and built first unless cached. Returns
+      // nullptr if the file cannot be read.
+      std::shared_ptr<const Scene> get(const std::string& path);
+      bool contains(const std::string& path) const;
+      void clear();
+      Stats stats() const;
+
+    private:
+      // Load the mesh at the given path and build its tree.
+      static std::shared_ptr<const Scene> _load(const std::string& path);
+      // Remove an entry. The lock must be held.
+      void _erase(std::unordered_map<std::string, Entry>::iterator entry);
+      // Evict least recently used scenes until within budget. The lock must be held.
+      void _evict();
+  };
+}
+
+#endif // _SCENE_CACHE_H_
@@ -0,0 +1,51 @@
+#ifndef _ALIAS_TABLE_H_
+#define _ALIAS_TABLE_H_
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace hd {
+  /**
+   * Walker's alias table for sampling indices from a fixed discrete distribution in O(1) time.
+   *
+   * The n outcomes are spread into n equally likely bins. Each bin holds at most two outcomes:
+   * its own, kept with a given probability, and an alias taking the rest of the bin. Sampling
+   * picks a bin and then one of its two outcomes, both from a single uniform number.
+   *
+   * The table is built with Vose's algorithm in O(n) time. For more details please read:
+   *     A Linear Algorithm for Generating Random Numbers with a Given Distribution. M. D. Vose.
+   *     IEEE Transactions on Software Engineering 17(9), 1991.
+   */
+  class AliasTable {
+    class Bin {
+      public:
+        // Probability of keeping the own outcome of the bin rather than its alias.
+        double probability;
+        unsigned int alias;
+    };
+
+    private:
+      std::vector<Bin> _bins;
+      // Normalized probability of each outcome.
+      std::vector<double> _pmf;
+      double _totalWeight;
+
+    public:
+      // Build the table from non-negative weights, at least one of which must be positive.
+      AliasTable(const std::vector<double>& weights);
+      ~AliasTable() {}
+
+      std::size_t size() const { return _bins.size(); }
+      double totalWeight() const { return _totalWeight; }
+      // Probability of sampling the given outcome, i.e. its weight over the total weight.
+      double pmf(unsigned int index) const { return _pmf[index]; }
+      // Sample an outcome from a uniform random number u in [0, 1).
+      unsigned int sample(double u) const;
+      // Heap memory held by the table, in bytes.
+      std::size_t memoryBytes() const;
+  };
+}
+
+#endif // _ALIAS_TABLE_H_
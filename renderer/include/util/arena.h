@@ -0,0 +1,130 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace hd {
+  /**
+   * A monotonic memory arena, meant to hold everything built for the lifetime of a scene, e.g.
+   * mesh adjacency lists and acceleration structure nodes, or the temporary buffers of a build.
+   *
+   * Memory is carved out of large chunks by bumping a pointer, and is never given back to the
+   * arena individually: it is all released at once when the arena is released or destroyed.
+   * Destructors of objects placed in the arena are not run, so only objects that need no
+   * destruction, or whose destruction can be skipped, should be placed in it.
+   *
+   * Allocation is thread-safe. Each thread bumps its own chunk, so that concurrent builders
+   * neither contend on a lock nor share cache lines; the arena lock is only taken to obtain a
+   * new chunk. release() must not run concurrently with allocations.
+   */
+  class Arena {
+    private:
+      class Chunk {
+        public:
+          char* data;
+          std::size_t size;
+      };
+
+      // Identifies the arena in per-thread chunk cursors. Changed upon release() so that
+      // cursors into released chunks are never used again.
+      std::atomic<uint64_t> _id;
+      std::size_t _chunkSize;
+      std::vector<Chunk> _chunks;
+      std::atomic<std::size_t> _bytesReserved;
+      std::mutex _mutex;
+
+    public:
+      static const std::size_t DEFAULT_CHUNK_SIZE = 1 << 20;
+
+      explicit Arena(std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+      Arena(const Arena& arena) = delete;
+      Arena& operator=(const Arena& arena) = delete;
+      ~Arena();
+
+      // Allocate size bytes aligned to alignment, which must be a power of two. Never fails
+      // other than by throwing std::bad_alloc, like operator new.
+      void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+      // Allocate uninitialized storage for count objects of type T.
+      template <typename T>
+      T* allocateArray(std::size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+      }
+      // Construct an object of type T in the arena. Its destructor is never run.
+      template <typename T, typename... Args>
+      T* create(Args&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+      }
+
+      // Release all memory of the arena at once, invalidating everything allocated from it.
+      void release();
+      // Total size of chunks obtained from the system so far.
+      std::size_t bytesReserved() const { return _bytesReserved.load(); }
+      std::size_t chunkSize() const { return _chunkSize; }
+
+    private:
+      // Obtain a new chunk of the given size from the system, to be freed upon release().
+      char* _newChunk(std::size_t size);
+  };
+
+  /**
+   * Standard allocator adapter over an Arena, to back STL containers with arena memory.
+   * Deallocation is a no-op: memory is reclaimed when the arena is released.
+   *
+   * An allocator without arena falls back to the global heap, so containers with this allocator
+   * behave like plain STL containers unless an arena is given. Copies of containers are always
+   * made on the heap, so that copying an arena-backed container out of its owner, e.g. by value
+   * from an accessor, never grows the arena nor outlives it.
+   */
+  template <typename T>
+  class ArenaAllocator {
+    private:
+      Arena* _arena;
+
+    public:
+      typedef T value_type;
+      typedef std::true_type propagate_on_container_move_assignment;
+      typedef std::true_type propagate_on_container_swap;
+
+      ArenaAllocator() : _arena(nullptr) {}
+      ArenaAllocator(Arena* arena) : _arena(arena) {}
+      template <typename U>
+      ArenaAllocator(const ArenaAllocator<U>& other) : _arena(other.arena()) {}
+
+      Arena* arena() const { return _arena; }
+
+      T* allocate(std::size_t n) {
+        if (_arena == nullptr) {
+          return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return _arena->allocateArray<T>(n);
+      }
+      void deallocate(T* p, std::size_t) {
+        if (_arena == nullptr) {
+          ::operator delete(p);
+        }
+      }
+      ArenaAllocator select_on_container_copy_construction() const {
+        return ArenaAllocator();
+      }
+
+      template <typename U>
+      friend bool operator==(const ArenaAllocator& lhs, const ArenaAllocator<U>& rhs) {
+        return lhs.arena() == rhs.arena();
+      }
+      template <typename U>
+      friend bool operator!=(const ArenaAllocator& lhs, const ArenaAllocator<U>& rhs) {
+        return lhs.arena() != rhs.arena();
+      }
+  };
+}
+
+#endif // _ARENA_H_
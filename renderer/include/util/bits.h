@@ -0,0 +1,21 @@
+#ifndef _BITS_H_
+#define _BITS_H_
+
+#pragma once
+
+#include <cstdint>
+
+namespace hd {
+  // Reverse the order of the 32 bits of x, e.g. to compute radical inverses in base 2, or to
+  // turn an index into its position in a binary Van der Corput sequence. Inline, as samplers
+  // call it once per sample dimension.
+  inline uint32_t reverseBits(uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+  }
+}
+
+#endif // _BITS_H_
@@ -0,0 +1,75 @@
+#ifndef _COW_VECTOR_H_
+#define _COW_VECTOR_H_
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace hd {
+  /**
+   * A reference-counted, copy-on-write array. Copying a CowVector only copies a pointer to the
+   * underlying buffer, which is shared until one of the copies is mutated: mutate() clones the
+   * buffer first if any other copy still refers to it.
+   *
+   * Only read access is offered directly, so that reading never triggers a copy. Writers must
+   * obtain the underlying std::vector through mutate(), preferably once per batch of writes.
+   *
+   * Distinct CowVectors sharing a buffer can be read and copied concurrently. Mutation is not
+   * thread-safe though: mutate() decides whether to clone from shared_ptr::use_count(), which
+   * does not order this thread's writes after another copy's reads of the same buffer. Any
+   * CowVector sharing a buffer must therefore only be mutated while no other thread accesses
+   * one of its copies.
+   */
+  template <typename T>
+  class CowVector {
+    private:
+      std::shared_ptr<std::vector<T>> _data;
+
+    public:
+      CowVector() : _data(std::make_shared<std::vector<T>>()) {}
+      CowVector(std::vector<T>&& data)
+          : _data(std::make_shared<std::vector<T>>(std::move(data))) {}
+      CowVector(const CowVector& other) : _data(other._data) {}
+      CowVector& operator=(const CowVector& other) {
+        _data = other._data;
+        return *this;
+      }
+      ~CowVector() {}
+
+      std::size_t size() const { return _data->size(); }
+      std::size_t capacity() const { return _data->capacity(); }
+      bool empty() const { return _data->empty(); }
+      const T& operator[](std::size_t index) const { return (*_data)[index]; }
+      typename std::vector<T>::const_iterator begin() const { return _data->cbegin(); }
+      typename std::vector<T>::const_iterator end() const { return _data->cend(); }
+      const std::vector<T>& get() const { return *_data; }
+
+      // Whether the buffer is shared with other copies.
+      bool isShared() const { return _data.use_count() > 1; }
+      // Address of the underlying buffer, identical for all copies sharing it.
+      const void* buffer() const { return _data.get(); }
+
+      // Writable access to the buffer, cloning it first if it is shared. The returned reference
+      // must no longer be written through once this CowVector has been copied. Not safe against
+      // concurrent access to other copies, see the class comment.
+      std::vector<T>& mutate() {
+        if (isShared()) {
+          _data = std::make_shared<std::vector<T>>(*_data);
+        }
+        return *_data;
+      }
+      // Replace the content with the given vector without copying it.
+      void assign(std::vector<T>&& data) {
+        _data = std::make_shared<std::vector<T>>(std::move(data));
+      }
+      // Drop the content, releasing this copy's reference to the buffer.
+      void clear() {
+        _data = std::make_shared<std::vector<T>>();
+      }
+  };
+}
+
+#endif // _COW_VECTOR_H_
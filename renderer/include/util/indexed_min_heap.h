@@ -0,0 +1,48 @@
+#ifndef _INDEXED_MIN_HEAP_H_
+#define _INDEXED_MIN_HEAP_H_
+
+#pragma once
+
+#include <vector>
+
+namespace hd {
+  /**
+   * Binary min-heap over a fixed range of integer keys [0, capacity), each carrying a priority.
+   * Unlike std::priority_queue, the heap tracks the position of every key, so the priority of any
+   * key can be updated, or the key removed, in O(log n) time.
+   */
+  class IndexedMinHeap {
+    private:
+      // Keys in heap order.
+      std::vector<unsigned int> _heap;
+      // Position of each key in _heap, or HD_INVALID_ID if the key is not in the heap.
+      std::vector<unsigned int> _positions;
+      std::vector<double> _priorities;
+
+    public:
+      IndexedMinHeap(unsigned int capacity);
+      ~IndexedMinHeap() {}
+
+      bool empty() const { return _heap.empty(); }
+      unsigned int size() const { return _heap.size(); }
+      bool contains(unsigned int key) const;
+      double priority(unsigned int key) const;
+
+      // Insert the key with given priority, or update its priority if it is already present.
+      void push(unsigned int key, double priority);
+      // Remove the key if present.
+      void remove(unsigned int key);
+      // Key with the lowest priority and its priority. The heap must not be empty.
+      unsigned int top() const;
+      double topPriority() const;
+      // Remove and return the key with the lowest priority. The heap must not be empty.
+      unsigned int pop();
+
+    private:
+      void _siftUp(unsigned int pos);
+      void _siftDown(unsigned int pos);
+      void _swap(unsigned int lhs, unsigned int rhs);
+  };
+}
+
+#endif // _INDEXED_MIN_HEAP_H_
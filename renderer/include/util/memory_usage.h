@@ -0,0 +1,81 @@
+#ifndef _MEMORY_USAGE_H_
+#define _MEMORY_USAGE_H_
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "util/arena.h"
+
+namespace hd {
+  /**
+   * Breakdown in bytes of the memory held by a scene structure, e.g. a mesh or an acceleration
+   * structure, or by a whole scene.
+   */
+  class MemoryUsage {
+    public:
+      // Vertex positions, or copies of them, e.g. entities of acceleration structures.
+      std::size_t positions;
+      // Vertex and face normals.
+      std::size_t normals;
+      // Faces and half-edges, or the index lists of compressed meshes.
+      std::size_t topology;
+      // Per-vertex lists of outgoing half-edges.
+      std::size_t adjacency;
+      // Acceleration structure nodes.
+      std::size_t nodes;
+      // Entity indices referred to by acceleration structure leaves.
+      std::size_t primitiveReferences;
+      // Derived data cached for faster queries, e.g. sampling tables.
+      std::size_t caches;
+      // Memory held but not used for any of the above: reserved capacity of containers, heap
+      // allocator headers and rounding, buffer bookkeeping and unused arena space.
+      std::size_t slack;
+    public:
+      MemoryUsage() : positions(0), normals(0), topology(0), adjacency(0), nodes(0),
+          primitiveReferences(0), caches(0), slack(0) {}
+
+      std::size_t total() const;
+      MemoryUsage& operator+=(const MemoryUsage& other);
+      // One line summary for logs, e.g. "total=1.2MiB positions=400.0KiB ...".
+      std::string toString() const;
+  };
+
+  /**
+   * Bookkeeping of buffers already counted while summing memory usage over several structures,
+   * so that buffers shared between them, such as geometry shared by mesh copies or arenas
+   * shared by a scene, are counted once.
+   */
+  class MemoryCounter {
+    private:
+      std::unordered_set<const void*> _buffers;
+      // Bytes used by counted structures in each arena.
+      std::unordered_map<const Arena*, std::size_t> _arenaBytes;
+
+    public:
+      // Whether the buffer at the given address was not counted yet. It is counted from now on.
+      bool add(const void* buffer);
+      // Record bytes used in an arena by a counted structure.
+      void addArenaBytes(const Arena* arena, std::size_t bytes);
+      // Space reserved by all recorded arenas and not used by any counted structure.
+      std::size_t arenaSlack() const;
+  };
+
+  // Bytes taken from the heap by an allocation of the given size, including allocator headers
+  // and rounding, as done by common malloc implementations: 8-byte headers, 16-byte granularity
+  // and 32-byte minimum, or whole pages for allocations large enough to be mapped on their own.
+  std::size_t heapBlockBytes(std::size_t size);
+
+  // Heap bytes held by the buffer of a vector beyond its elements, i.e. unused capacity and
+  // allocator overhead.
+  template <typename T, typename A>
+  std::size_t heapSlack(const std::vector<T, A>& v) {
+    return heapBlockBytes(v.capacity() * sizeof(T)) - v.size() * sizeof(T);
+  }
+}
+
+#endif // _MEMORY_USAGE_H_
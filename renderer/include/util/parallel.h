@@ -0,0 +1,22 @@
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace hd {
+  // Number of threads used by parallel loops, i.e. the hardware concurrency (at least 1).
+  unsigned int parallelThreadNum();
+
+  // Split index range [begin, end) into contiguous chunks, one per thread, and call
+  // fn(chunkBegin, chunkEnd) for each chunk concurrently. Blocks until all chunks are done.
+  // Ranges shorter than minChunkSize per thread are processed with fewer threads, down to
+  // running fn(begin, end) directly on the calling thread.
+  void parallelFor(std::size_t begin, std::size_t end,
+      const std::function<void(std::size_t, std::size_t)>& fn,
+      std::size_t minChunkSize = 4096);
+}
+
+#endif // _PARALLEL_H_
@@ -0,0 +1,44 @@
+#ifndef _PERF_COUNTER_H_
+#define _PERF_COUNTER_H_
+
+#pragma once
+
+#include <cstdint>
+
+namespace hd {
+  /**
+   * Hardware event counter of the calling process, e.g. to measure cache misses of a benchmark.
+   * Counts user-space events of the calling thread and of all threads it starts while counting.
+   *
+   * Backed by perf_event_open on Linux. Elsewhere, or where the kernel or a sandbox forbids it,
+   * the counter is unavailable and always reads 0.
+   */
+  class PerfCounter {
+    public:
+      enum class Event {
+        // Last level cache misses, and accesses.
+        CACHE_MISSES,
+        CACHE_REFERENCES,
+        INSTRUCTIONS,
+        CYCLES
+      };
+
+    private:
+      int _fd;
+
+    public:
+      explicit PerfCounter(Event event);
+      PerfCounter(const PerfCounter& counter) = delete;
+      PerfCounter& operator=(const PerfCounter& counter) = delete;
+      ~PerfCounter();
+
+      bool isAvailable() const { return _fd >= 0; }
+      // Reset the count to 0 and start counting.
+      void start();
+      void stop();
+      // Events counted since start().
+      uint64_t value() const;
+  };
+}
+
+#endif // _PERF_COUNTER_H_
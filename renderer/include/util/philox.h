@@ -0,0 +1,39 @@
+#ifndef _PHILOX_H_
+#define _PHILOX_H_
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace hd {
+  /**
+   * Philox4x32-10, the counter-based generator of Salmon et al., "Parallel random numbers: as
+   * easy as 1, 2, 3" (SC 2011): a keyed bijection of 128-bit counters, strong enough for its
+   * outputs on consecutive or otherwise structured counters to pass BigCrush.
+   *
+   * A generator is thus a pure function with no state to share, seed or advance: any thread can
+   * draw the numbers of any counter, e.g. of a (pixel, sample, bounce) triple, in any order and
+   * get the same bits. Each evaluation yields four 32-bit numbers.
+   */
+  class Philox4x32 {
+    public:
+      typedef std::array<uint32_t, 4> Counter;
+      typedef std::array<uint32_t, 2> Key;
+
+      static const unsigned int ROUND_NUM = 10;
+
+    public:
+      // The four numbers of the given counter under the given key.
+      static Counter generate(const Counter& counter, const Key& key);
+      // Batch variant over count counters given as structure of arrays: counter i is
+      // (counter[0][i], ..., counter[3][i]), and its numbers are written to result[0][i], ...,
+      // result[3][i]. Counters are processed in groups of lanes whose rounds run as plain
+      // loops over the group, which compilers turn into SIMD code. Same results as generate().
+      static void generate(std::size_t count, const uint32_t* const counter[4], const Key& key,
+          uint32_t* const result[4]);
+  };
+}
+
+#endif // _PHILOX_H_
@@ -0,0 +1,215 @@
+#include "geometry/compressed_mesh_storage.h"
+#include "const.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace hd {
+  namespace {
+    const uint64_t MASK_21 = (1ULL << 21) - 1;
+
+    double signNotZero(double v) {
+      return v >= 0.0 ? 1.0 : -1.0;
+    }
+
+    // Map [-1, 1] to a 16-bit signed integer and back.
+    int16_t quantizeSnorm16(double v) {
+      return static_cast<int16_t>(std::round(std::max(-1.0, std::min(1.0, v)) * 32767.0));
+    }
+
+    double dequantizeSnorm16(int16_t v) {
+      return std::max(-1.0, v / 32767.0);
+    }
+  }
+
+  const unsigned int CompressedMeshStorage::FACE_CLUSTER_SIZE;
+
+  double CompressedMeshStorage::Stats::ratio() const {
+    return compressedBytes == 0 ? 0.0 : static_cast<double>(originalBytes) / compressedBytes;
+  }
+
+  CompressedMeshStorage::CompressedMeshStorage(const std::vector<Vector3>& positions,
+      const std::vector<Vector3>& vertexNormals,
+      const std::vector<std::array<unsigned int, 3>>& faces,
+      const std::vector<Vector3>& faceNormals,
+      const BoundingBox3& boundingBox,
+      PositionPrecision precision)
+      : _precision(precision),
+        _origin(boundingBox.minCorner()),
+        _vertexNum(positions.size()),
+        _faceNum(faces.size()) {
+    assert(vertexNormals.empty() || vertexNormals.size() == positions.size());
+    assert(faceNormals.empty() || faceNormals.size() == faces.size());
+
+    unsigned int bits = precision == PositionPrecision::BITS_16 ? 16 : 21;
+    double maxLevel = static_cast<double>((1ULL << bits) - 1);
+    Vector3 size = boundingBox.size();
+    for (int i = 0; i < 3; ++i) {
+      _step[i] = size[i] / maxLevel;
+    }
+    auto quantize = [&](const Vector3& p, int axis) {
+      if (_step[axis] <= 0.0) {
+        return static_cast<uint64_t>(0);
+      }
+      double level = std::round((p[axis] - _origin[axis]) / _step[axis]);
+      return static_cast<uint64_t>(std::max(0.0, std::min(maxLevel, level)));
+    };
+    if (precision == PositionPrecision::BITS_16) {
+      _positions16.resize(positions.size() * 3);
+      for (std::size_t vid = 0; vid < positions.size(); ++vid) {
+        for (int i = 0; i < 3; ++i) {
+          _positions16[vid * 3 + i] = static_cast<uint16_t>(quantize(positions[vid], i));
+        }
+      }
+    } else {
+      _positions21.resize(positions.size());
+      for (std::size_t vid = 0; vid < positions.size(); ++vid) {
+        _positions21[vid] = quantize(positions[vid], 0)
+            | (quantize(positions[vid], 1) << 21)
+            | (quantize(positions[vid], 2) << 42);
+      }
+    }
+
+    _vertexNormals.reserve(vertexNormals.size());
+    for (auto& n : vertexNormals) {
+      _vertexNormals.push_back(encodeNormal(n));
+    }
+    _faceNormals.reserve(faceNormals.size());
+    for (auto& n : faceNormals) {
+      _faceNormals.push_back(encodeNormal(n));
+    }
+
+    unsigned int clusterNum = (_faceNum + FACE_CLUSTER_SIZE - 1) / FACE_CLUSTER_SIZE;
+    _clusters.reserve(clusterNum);
+    for (unsigned int c = 0; c < clusterNum; ++c) {
+      unsigned int begin = c * FACE_CLUSTER_SIZE;
+      unsigned int end = std::min(_faceNum, begin + FACE_CLUSTER_SIZE);
+      unsigned int minIndex = faces[begin][0];
+      unsigned int maxIndex = faces[begin][0];
+      for (unsigned int fid = begin; fid < end; ++fid) {
+        for (unsigned int vid : faces[fid]) {
+          minIndex = std::min(minIndex, vid);
+          maxIndex = std::max(maxIndex, vid);
+        }
+      }
+      FaceCluster cluster;
+      cluster.baseVertex = minIndex;
+      cluster.isWide = maxIndex - minIndex > 0xffff;
+      cluster.offset = cluster.isWide ? _wideIndices.size() : _narrowIndices.size();
+      for (unsigned int fid = begin; fid < end; ++fid) {
+        for (unsigned int vid : faces[fid]) {
+          if (cluster.isWide) {
+            _wideIndices.push_back(vid);
+          } else {
+            _narrowIndices.push_back(static_cast<uint16_t>(vid - minIndex));
+          }
+        }
+      }
+      _clusters.push_back(cluster);
+    }
+    _narrowIndices.shrink_to_fit();
+    _wideIndices.shrink_to_fit();
+  }
+
+  Vector3 CompressedMeshStorage::pos(unsigned int vid) const {
+    assert(vid < _vertexNum);
+    if (_precision == PositionPrecision::BITS_16) {
+      const uint16_t* q = &_positions16[vid * 3];
+      return Vector3(
+          _origin.x + q[0] * _step.x,
+          _origin.y + q[1] * _step.y,
+          _origin.z + q[2] * _step.z);
+    }
+    uint64_t q = _positions21[vid];
+    return Vector3(
+        _origin.x + (q & MASK_21) * _step.x,
+        _origin.y + ((q >> 21) & MASK_21) * _step.y,
+        _origin.z + ((q >> 42) & MASK_21) * _step.z);
+  }
+
+  Vector3 CompressedMeshStorage::vertexNormal(unsigned int vid) const {
+    assert(hasVertexNormals());
+    assert(vid < _vertexNum);
+    return decodeNormal(_vertexNormals[vid]);
+  }
+
+  Vector3 CompressedMeshStorage::faceNormal(unsigned int fid) const {
+    assert(hasFaceNormals());
+    assert(fid < _faceNum);
+    return decodeNormal(_faceNormals[fid]);
+  }
+
+  std::array<unsigned int, 3> CompressedMeshStorage::face(unsigned int fid) const {
+    assert(fid < _faceNum);
+    const FaceCluster& cluster = _clusters[fid / FACE_CLUSTER_SIZE];
+    unsigned int offset = cluster.offset + (fid % FACE_CLUSTER_SIZE) * 3;
+    if (cluster.isWide) {
+      return std::array<unsigned int, 3> {
+        _wideIndices[offset], _wideIndices[offset + 1], _wideIndices[offset + 2]
+      };
+    }
+    return std::array<unsigned int, 3> {
+      cluster.baseVertex + _narrowIndices[offset],
+      cluster.baseVertex + _narrowIndices[offset + 1],
+      cluster.baseVertex + _narrowIndices[offset + 2]
+    };
+  }
+
+  std::size_t CompressedMeshStorage::memoryBytes() const {
+    return sizeof(CompressedMeshStorage)
+        + _positions16.capacity() * sizeof(uint16_t)
+        + _positions21.capacity() * sizeof(uint64_t)
+        + _vertexNormals.capacity() * sizeof(uint32_t)
+        + _faceNormals.capacity() * sizeof(uint32_t)
+        + _clusters.capacity() * sizeof(FaceCluster)
+        + _narrowIndices.capacity() * sizeof(uint16_t)
+        + _wideIndices.capacity() * sizeof(uint32_t);
+  }
+
+  MemoryUsage CompressedMeshStorage::memoryUsage() const {
+    MemoryUsage usage;
+    usage.positions = _positions16.size() * sizeof(uint16_t)
+        + _positions21.size() * sizeof(uint64_t);
+    usage.normals = (_vertexNormals.size() + _faceNormals.size()) * sizeof(uint32_t);
+    usage.topology = _clusters.size() * sizeof(FaceCluster)
+        + _narrowIndices.size() * sizeof(uint16_t)
+        + _wideIndices.size() * sizeof(uint32_t);
+    usage.slack = sizeof(CompressedMeshStorage)
+        + heapSlack(_positions16) + heapSlack(_positions21)
+        + heapSlack(_vertexNormals) + heapSlack(_faceNormals)
+        + heapSlack(_clusters) + heapSlack(_narrowIndices) + heapSlack(_wideIndices);
+    return usage;
+  }
+
+  // Project the unit sphere onto the octahedron |x| + |y| + |z| = 1, then unfold the lower half
+  // of the octahedron onto the outer triangles of the unit square. Zero normals, as left on
+  // unreferenced vertices or degenerate faces, have no direction and are stored as +z.
+  uint32_t CompressedMeshStorage::encodeNormal(const Vector3& n) {
+    double l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (!(l1 > HD_EPSILON_TINY)) {
+      return 0;
+    }
+    double u = n.x / l1;
+    double v = n.y / l1;
+    if (n.z < 0.0) {
+      double foldedU = (1.0 - std::fabs(v)) * signNotZero(u);
+      double foldedV = (1.0 - std::fabs(u)) * signNotZero(v);
+      u = foldedU;
+      v = foldedV;
+    }
+    uint16_t qu = static_cast<uint16_t>(quantizeSnorm16(u));
+    uint16_t qv = static_cast<uint16_t>(quantizeSnorm16(v));
+    return static_cast<uint32_t>(qu) | (static_cast<uint32_t>(qv) << 16);
+  }
+
+  Vector3 CompressedMeshStorage::decodeNormal(uint32_t code) {
+    double u = dequantizeSnorm16(static_cast<int16_t>(code & 0xffff));
+    double v = dequantizeSnorm16(static_cast<int16_t>(code >> 16));
+    Vector3 n(u, v, 1.0 - std::fabs(u) - std::fabs(v));
+    if (n.z < 0.0) {
+      n.x = (1.0 - std::fabs(v)) * signNotZero(u);
+      n.y = (1.0 - std::fabs(u)) * signNotZero(v);
+    }
+    return n.normalize();
+  }
+}
@@ -1,5 +1,566 @@
 #include "geometry/kd_tree.h"
+#include "io/cluster_store.h"
+#include "util/parallel.h"
+#include "const.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <thread>
 
 namespace hd {
+  namespace {
+    // Number of buckets along each axis that SAH split candidates are evaluated at.
+    const unsigned int SAH_BIN_NUM = 16;
+    // Cost of traversing a node, relative to that of intersecting an entity.
+    const double SAH_TRAVERSAL_COST = 0.125;
+    // Nodes with more entities are split even where SAH estimates a leaf to be cheaper.
+    const unsigned int SAH_MAX_LEAF_ENTITIES = 32;
+    // Subtrees with fewer entities are not worth a thread of their own.
+    const unsigned int PARALLEL_MIN_ENTITIES = 4096;
+    // Trees up to this depth are traversed by ray queries with a stack on the call stack.
+    const unsigned int MAX_TRAVERSAL_DEPTH = 128;
 
+    // Axis-aligned bounds that, unlike BoundingBox3, can be empty and grown.
+    class Bounds {
+      public:
+        Vector3 minCorner;
+        Vector3 maxCorner;
+      public:
+        Bounds() : minCorner(Vector3::identity(HD_INFINITY)),
+            maxCorner(Vector3::identity(-HD_INFINITY)) {}
+        void grow(const Vector3& p) {
+          for (int i = 0; i < 3; ++i) {
+            minCorner[i] = std::min(minCorner[i], p[i]);
+            maxCorner[i] = std::max(maxCorner[i], p[i]);
+          }
+        }
+        void grow(const Bounds& b) {
+          grow(b.minCorner);
+          grow(b.maxCorner);
+        }
+        double surfaceArea() const {
+          if (minCorner.x > maxCorner.x) {
+            return 0.0;
+          }
+          Vector3 d = maxCorner - minCorner;
+          return 2.0 * (d.x * d.y + d.x * d.z + d.y * d.z);
+        }
+    };
+
+    bool overlaps(const BoundingBox3& lhs, const BoundingBox3& rhs) {
+      Vector3 lMin = lhs.minCorner();
+      Vector3 lMax = lhs.maxCorner();
+      Vector3 rMin = rhs.minCorner();
+      Vector3 rMax = rhs.maxCorner();
+      for (int i = 0; i < 3; ++i) {
+        if (lMin[i] > rMax[i] || rMin[i] > lMax[i]) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Distance range along a ray within a box, by the slab method, clipped to (tMin, tMax).
+    // Returns false if the ray misses the box within that range.
+    bool intersectBox(const BoundingBox3& box, const Vector3& origin,
+        const Vector3& invDirection, double tMin, double tMax, double& tNear) {
+      Vector3 minCorner = box.minCorner();
+      Vector3 maxCorner = box.maxCorner();
+      for (int i = 0; i < 3; ++i) {
+        double t0 = (minCorner[i] - origin[i]) * invDirection[i];
+        double t1 = (maxCorner[i] - origin[i]) * invDirection[i];
+        if (t0 > t1) {
+          std::swap(t0, t1);
+        }
+        // Written so that NaNs, from rays parallel to and lying on a slab, keep the range.
+        tMin = t0 > tMin ? t0 : tMin;
+        tMax = t1 < tMax ? t1 : tMax;
+        if (tMin > tMax) {
+          return false;
+        }
+      }
+      tNear = tMin;
+      return true;
+    }
+  }
+
+  /**
+   * State shared by all threads of a build.
+   */
+  class KdTree::BuildContext {
+    public:
+      const Options& options;
+      unsigned int maxLevel;
+      // Levels above which subtrees are built on threads of their own.
+      unsigned int parallelLevel;
+      // Per-entity data, in the scratch arena of the build.
+      const Vector3* centroids;
+      const Vector3* minCorners;
+      const Vector3* maxCorners;
+      std::atomic<unsigned int> nodeNum;
+      std::atomic<unsigned int> leafNum;
+      std::atomic<unsigned int> depth;
+    public:
+      BuildContext(const Options& opts) : options(opts), maxLevel(0), parallelLevel(0),
+          centroids(nullptr), minCorners(nullptr), maxCorners(nullptr), nodeNum(0),
+          leafNum(0), depth(0) {}
+  };
+
+  KdTree::KdTree() : _entities(nullptr), _entityNum(0), _root(nullptr), _nodeNum(0),
+      _leafNum(0), _depth(0) {}
+
+  KdTree::~KdTree() {
+    // Nodes and entities are released with the arena, once no longer shared.
+  }
+
+  std::unique_ptr<KdTree> KdTree::build(const std::vector<Triangle3>& entities,
+      const Options& options, const std::shared_ptr<Arena>& arena) {
+    auto tree = _allocate(arena, entities.size());
+    Triangle3* treeEntities = const_cast<Triangle3*>(tree->_entities);
+    for (unsigned int i = 0; i < entities.size(); ++i) {
+      new (&treeEntities[i]) Triangle3(entities[i]);
+    }
+    tree->_buildNodes(options);
+    return tree;
+  }
+
+  std::unique_ptr<KdTree> KdTree::build(const TriangularMesh& mesh,
+      const Options& options, const std::shared_ptr<Arena>& arena) {
+    assert(mesh.isPopulated());
+    if (mesh.isOutOfCore()) {
+      auto tree = _allocate(arena, 0);
+      tree->_entityNum = mesh.faceNum();
+      tree->_clusterStore = mesh.clusterStore();
+      tree->_buildNodes(options);
+      return tree;
+    }
+    auto tree = _allocate(arena, mesh.faceNum());
+    Triangle3* treeEntities = const_cast<Triangle3*>(tree->_entities);
+    parallelFor(0, mesh.faceNum(), [&](std::size_t begin, std::size_t end) {
+      for (std::size_t fid = begin; fid < end; ++fid) {
+        new (&treeEntities[fid]) Triangle3(mesh.triangle(fid));
+      }
+    });
+    tree->_buildNodes(options);
+    return tree;
+  }
+
+  std::unique_ptr<KdTree> KdTree::_allocate(const std::shared_ptr<Arena>& arena,
+      unsigned int entityNum) {
+    auto tree = std::unique_ptr<KdTree>(new KdTree());
+    tree->_arena = arena ? arena : std::make_shared<Arena>();
+    tree->_entityNum = entityNum;
+    tree->_entities = tree->_arena->allocateArray<Triangle3>(entityNum);
+    return tree;
+  }
+
+  void KdTree::_buildNodes(const Options& options) {
+    unsigned int n = _clusterStore ? _clusterStore->clusterNum() : _entityNum;
+    // Temporary per-entity data only lives for the build.
+    Arena scratch(std::max<std::size_t>(Arena::DEFAULT_CHUNK_SIZE,
+        static_cast<std::size_t>(n) * 3 * sizeof(Vector3) + 64));
+    Vector3* centroids = scratch.allocateArray<Vector3>(n);
+    Vector3* minCorners = scratch.allocateArray<Vector3>(n);
+    Vector3* maxCorners = scratch.allocateArray<Vector3>(n);
+    parallelFor(0, n, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        if (_clusterStore) {
+          // Bounds of clusters are known without paging them in.
+          const BoundingBox3& box = _clusterStore->bounds(i).boundingBox;
+          new (&minCorners[i]) Vector3(box.minCorner());
+          new (&maxCorners[i]) Vector3(box.maxCorner());
+          new (&centroids[i]) Vector3((box.minCorner() + box.maxCorner()) / 2.0);
+          continue;
+        }
+        Bounds b;
+        Vector3 sum = Vector3::zero();
+        for (unsigned int k = 0; k < 3; ++k) {
+          b.grow(_entities[i].v(k));
+          sum += _entities[i].v(k);
+        }
+        new (&minCorners[i]) Vector3(b.minCorner);
+        new (&maxCorners[i]) Vector3(b.maxCorner);
+        new (&centroids[i]) Vector3(sum / 3.0);
+      }
+    });
+
+    BuildContext context(options);
+    context.centroids = centroids;
+    context.minCorners = minCorners;
+    context.maxCorners = maxCorners;
+    context.maxLevel = options.maxLevel > 0 ? options.maxLevel
+        : static_cast<unsigned int>(8 + 1.3 * std::log2(std::max(1u, n)));
+    while ((1u << context.parallelLevel) < parallelThreadNum()) {
+      ++context.parallelLevel;
+    }
+    // Leaves refer to ranges of this list, partitioned in place while building.
+    unsigned int* entityIds = _arena->allocateArray<unsigned int>(n);
+    for (unsigned int i = 0; i < n; ++i) {
+      entityIds[i] = i;
+    }
+    _root = _buildNode(context, entityIds, n, 0);
+    _nodeNum = context.nodeNum;
+    _leafNum = context.leafNum;
+    _depth = context.depth;
+  }
+
+  KdTree::Node* KdTree::_buildNode(BuildContext& context, unsigned int* entityIds,
+      unsigned int count, unsigned int level) {
+    Node* node = _arena->create<Node>();
+    ++context.nodeNum;
+    unsigned int depth = context.depth.load();
+    while (depth < level + 1 && !context.depth.compare_exchange_weak(depth, level + 1)) {}
+
+    Bounds bounds;
+    Bounds centroidBounds;
+    for (unsigned int i = 0; i < count; ++i) {
+      unsigned int id = entityIds[i];
+      bounds.grow(context.minCorners[id]);
+      bounds.grow(context.maxCorners[id]);
+      centroidBounds.grow(context.centroids[id]);
+    }
+    if (count > 0) {
+      node->boundingBox = BoundingBox3(bounds.minCorner, bounds.maxCorner);
+    }
+
+    const Options& options = context.options;
+    bool isLeaf = count <= 1 || (options.depthLimitMode == MAX_LEVEL
+        ? level + 1 >= context.maxLevel : count <= options.minEntities);
+    unsigned int axis = 0;
+    Vector3 extent = centroidBounds.maxCorner - centroidBounds.minCorner;
+    if (!isLeaf) {
+      for (unsigned int i = 1; i < 3; ++i) {
+        if (extent[i] > extent[axis]) {
+          axis = i;
+        }
+      }
+      // Entities with coincident centers cannot be told apart by any plane.
+      isLeaf = extent[axis] <= 0.0;
+    }
+
+    unsigned int mid = 0;
+    double planeValue = 0.0;
+    if (!isLeaf && options.partitionMode == SAH && bounds.surfaceArea() > 0.0) {
+      // Evaluate planes between bins of centers along each axis, and keep the cheapest one.
+      bool hasSplit = false;
+      double bestCost = 0.0;
+      unsigned int bestAxis = 0;
+      unsigned int bestBin = 0;
+      for (unsigned int a = 0; a < 3; ++a) {
+        if (extent[a] <= 0.0) {
+          continue;
+        }
+        unsigned int binCounts[SAH_BIN_NUM] = {0};
+        Bounds binBounds[SAH_BIN_NUM];
+        double scale = SAH_BIN_NUM / extent[a];
+        for (unsigned int i = 0; i < count; ++i) {
+          unsigned int id = entityIds[i];
+          unsigned int bin = std::min(SAH_BIN_NUM - 1, static_cast<unsigned int>(
+              (context.centroids[id][a] - centroidBounds.minCorner[a]) * scale));
+          ++binCounts[bin];
+          binBounds[bin].grow(context.minCorners[id]);
+          binBounds[bin].grow(context.maxCorners[id]);
+        }
+        // Sweep from the right to get areas of the right side of every plane.
+        double rightAreas[SAH_BIN_NUM];
+        unsigned int rightCounts[SAH_BIN_NUM];
+        Bounds right;
+        unsigned int rightCount = 0;
+        for (unsigned int bin = SAH_BIN_NUM - 1; bin > 0; --bin) {
+          right.grow(binBounds[bin]);
+          rightCount += binCounts[bin];
+          rightAreas[bin] = right.surfaceArea();
+          rightCounts[bin] = rightCount;
+        }
+        Bounds left;
+        unsigned int leftCount = 0;
+        for (unsigned int bin = 0; bin + 1 < SAH_BIN_NUM; ++bin) {
+          left.grow(binBounds[bin]);
+          leftCount += binCounts[bin];
+          if (leftCount == 0 || rightCounts[bin + 1] == 0) {
+            continue;
+          }
+          double cost = left.surfaceArea() * leftCount
+              + rightAreas[bin + 1] * rightCounts[bin + 1];
+          if (!hasSplit || cost < bestCost) {
+            hasSplit = true;
+            bestCost = cost;
+            bestAxis = a;
+            bestBin = bin;
+          }
+        }
+      }
+      double leafCost = count;
+      bestCost = SAH_TRAVERSAL_COST + bestCost / bounds.surfaceArea();
+      if (!hasSplit || (bestCost >= leafCost && count <= SAH_MAX_LEAF_ENTITIES
+          && options.depthLimitMode == MIN_ENTITIES)) {
+        isLeaf = true;
+      } else {
+        axis = bestAxis;
+        double binWidth = extent[axis] / SAH_BIN_NUM;
+        planeValue = centroidBounds.minCorner[axis] + (bestBin + 1) * binWidth;
+        double scale = SAH_BIN_NUM / extent[axis];
+        unsigned int* split = std::partition(entityIds, entityIds + count, [&](unsigned int id) {
+          return std::min(SAH_BIN_NUM - 1, static_cast<unsigned int>(
+              (context.centroids[id][axis] - centroidBounds.minCorner[axis]) * scale))
+              <= bestBin;
+        });
+        mid = split - entityIds;
+      }
+    } else if (!isLeaf) {
+      mid = count / 2;
+      std::nth_element(entityIds, entityIds + mid, entityIds + count,
+          [&](unsigned int lhs, unsigned int rhs) {
+            return context.centroids[lhs][axis] < context.centroids[rhs][axis];
+          });
+      planeValue = context.centroids[entityIds[mid]][axis];
+    }
+    if (!isLeaf && (mid == 0 || mid == count)) {
+      isLeaf = true;
+    }
+
+    if (isLeaf) {
+      node->isLeaf = true;
+      node->entities = entityIds;
+      node->entityNum = count;
+      ++context.leafNum;
+      return node;
+    }
+    node->isLeaf = false;
+    node->partitionPlane = PartitionPlane(axis, planeValue);
+    if (level < context.parallelLevel && count >= PARALLEL_MIN_ENTITIES) {
+      std::thread leftBuilder([&]() {
+        node->left = _buildNode(context, entityIds, mid, level + 1);
+      });
+      node->right = _buildNode(context, entityIds + mid, count - mid, level + 1);
+      leftBuilder.join();
+    } else {
+      node->left = _buildNode(context, entityIds, mid, level + 1);
+      node->right = _buildNode(context, entityIds + mid, count - mid, level + 1);
+    }
+    return node;
+  }
+
+  Triangle3 KdTree::entity(unsigned int index) const {
+    assert(index < _entityNum);
+    if (_clusterStore) {
+      unsigned int clusterId;
+      unsigned int localFace;
+      _clusterStore->locate(index, clusterId, localFace);
+      return _clusterStore->requirePage(clusterId)->triangle(localFace);
+    }
+    return _entities[index];
+  }
+
+  BoundingBox3 KdTree::boundingBox3() const {
+    return _root == nullptr ? BoundingBox3() : _root->boundingBox;
+  }
+
+  MemoryUsage KdTree::memoryUsage(MemoryCounter* counter) const {
+    MemoryCounter localCounter;
+    bool isStandalone = counter == nullptr;
+    if (isStandalone) {
+      counter = &localCounter;
+    }
+    MemoryUsage usage;
+    if (!counter->add(this)) {
+      return usage;
+    }
+    // Trees over clusters hold no triangles, and leaves refer to clusters.
+    unsigned int referenceNum = _clusterStore ? _clusterStore->clusterNum() : _entityNum;
+    usage.positions = _clusterStore ? 0 : _entityNum * sizeof(Triangle3);
+    usage.nodes = _nodeNum * sizeof(Node);
+    usage.primitiveReferences = referenceNum * sizeof(unsigned int);
+    counter->addArenaBytes(_arena.get(),
+        usage.positions + usage.nodes + usage.primitiveReferences);
+    if (isStandalone && _arena.use_count() == 1) {
+      usage.slack += counter->arenaSlack();
+    }
+    return usage;
+  }
+
+  void KdTree::query(const BoundingBox3& range, std::vector<unsigned int>& entityIds) const {
+    if (_root == nullptr || _entityNum == 0) {
+      return;
+    }
+    std::vector<const Node*> stack;
+    stack.push_back(_root);
+    while (!stack.empty()) {
+      const Node* node = stack.back();
+      stack.pop_back();
+      if (!overlaps(node->boundingBox, range)) {
+        continue;
+      }
+      if (!node->isLeaf) {
+        stack.push_back(node->left);
+        stack.push_back(node->right);
+        continue;
+      }
+      for (unsigned int i = 0; i < node->entityNum; ++i) {
+        unsigned int id = node->entities[i];
+        if (!_clusterStore) {
+          if (overlaps(_entities[id].boundingBox3(), range)) {
+            entityIds.push_back(id);
+          }
+          continue;
+        }
+        if (!overlaps(_clusterStore->bounds(id).boundingBox, range)) {
+          continue;
+        }
+        auto page = _clusterStore->requirePage(id);
+        unsigned int firstFace = _clusterStore->firstFace(id);
+        for (unsigned int k = 0; k < page->faceNum(); ++k) {
+          if (overlaps(page->triangle(k).boundingBox3(), range)) {
+            entityIds.push_back(firstFace + k);
+          }
+        }
+      }
+    }
+  }
+
+  void KdTree::TraversalStats::access(const void* data, std::size_t size) {
+    if (size == 0) {
+      return;
+    }
+    if (_cacheLines.empty()) {
+      _cacheLines.assign(CACHE_LINE_NUM, ~static_cast<uintptr_t>(0));
+    }
+    uintptr_t first = reinterpret_cast<uintptr_t>(data) >> 6;
+    uintptr_t last = (reinterpret_cast<uintptr_t>(data) + size - 1) >> 6;
+    for (uintptr_t line = first; line <= last; ++line) {
+      uintptr_t& slot = _cacheLines[line & (CACHE_LINE_NUM - 1)];
+      if (slot != line) {
+        slot = line;
+        ++cacheMissNum;
+      }
+    }
+  }
+
+  KdTree::TraversalStats& KdTree::TraversalStats::operator+=(const TraversalStats& stats) {
+    traversalNum += stats.traversalNum;
+    nodeNum += stats.nodeNum;
+    entityNum += stats.entityNum;
+    cacheMissNum += stats.cacheMissNum;
+    return *this;
+  }
+
+  bool KdTree::intersect(const Ray3& ray, double tMin, double tMax, RayHit& hit,
+      TraversalStats* stats) const {
+    return _traverse(ray, tMin, tMax, false, &hit, stats);
+  }
+
+  bool KdTree::occluded(const Ray3& ray, double tMin, double tMax,
+      TraversalStats* stats) const {
+    return _traverse(ray, tMin, tMax, true, nullptr, stats);
+  }
+
+  bool KdTree::_traverse(const Ray3& ray, double tMin, double tMax, bool anyHit,
+      RayHit* hit, TraversalStats* stats) const {
+    if (stats != nullptr) {
+      ++stats->traversalNum;
+    }
+    if (_root == nullptr || _entityNum == 0) {
+      return false;
+    }
+    Vector3 invDirection(1.0 / ray.direction.x, 1.0 / ray.direction.y, 1.0 / ray.direction.z);
+    // Nodes to visit along with the distance at which the ray enters them. Children may
+    // overlap, so subtrees are only skipped once a closer hit than their entry is known.
+    class StackEntry {
+      public:
+        const Node* node;
+        double tNear;
+    };
+    // The stack holds at most one entry per level, plus the node being split.
+    StackEntry localStack[MAX_TRAVERSAL_DEPTH];
+    std::vector<StackEntry> heapStack;
+    StackEntry* stack = localStack;
+    if (_depth + 1 > MAX_TRAVERSAL_DEPTH) {
+      heapStack.resize(_depth + 1);
+      stack = heapStack.data();
+    }
+    unsigned int stackSize = 0;
+    double tNear;
+    if (!intersectBox(_root->boundingBox, ray.origin, invDirection, tMin, tMax, tNear)) {
+      return false;
+    }
+    stack[stackSize++] = StackEntry {_root, tNear};
+    bool found = false;
+    // Intersect an entity, keeping the closest hit so far. Returns whether traversal can stop.
+    auto testEntity = [&](const Triangle3& triangle, unsigned int id) {
+      double t, u, v;
+      if (!triangle.intersect(ray, tMin, tMax, t, u, v)) {
+        return false;
+      }
+      found = true;
+      if (anyHit) {
+        return true;
+      }
+      tMax = t;
+      hit->entityId = id;
+      hit->t = t;
+      hit->u = u;
+      hit->v = v;
+      return false;
+    };
+    while (stackSize > 0) {
+      StackEntry entry = stack[--stackSize];
+      if (entry.tNear >= tMax) {
+        continue;
+      }
+      const Node* node = entry.node;
+      if (stats != nullptr) {
+        ++stats->nodeNum;
+        stats->access(node, sizeof(Node));
+        if (node->isLeaf) {
+          stats->access(node->entities, node->entityNum * sizeof(unsigned int));
+        }
+      }
+      if (node->isLeaf) {
+        for (unsigned int i = 0; i < node->entityNum; ++i) {
+          unsigned int id = node->entities[i];
+          if (!_clusterStore) {
+            if (stats != nullptr) {
+              ++stats->entityNum;
+              stats->access(&_entities[id], sizeof(Triangle3));
+            }
+            if (testEntity(_entities[id], id)) {
+              return true;
+            }
+            continue;
+          }
+          // Leaves may hold several clusters: only page in those the ray reaches.
+          if (!intersectBox(_clusterStore->bounds(id).boundingBox, ray.origin, invDirection,
+              tMin, tMax, tNear)) {
+            continue;
+          }
+          auto page = _clusterStore->requirePage(id);
+          unsigned int firstFace = _clusterStore->firstFace(id);
+          for (unsigned int k = 0; k < page->faceNum(); ++k) {
+            if (testEntity(page->triangle(k), firstFace + k)) {
+              return true;
+            }
+          }
+        }
+        continue;
+      }
+      double tLeft, tRight;
+      bool hitLeft = intersectBox(node->left->boundingBox, ray.origin, invDirection,
+          tMin, tMax, tLeft);
+      bool hitRight = intersectBox(node->right->boundingBox, ray.origin, invDirection,
+          tMin, tMax, tRight);
+      // Push the far child first, so that the near one is visited first.
+      if (hitLeft && hitRight && tLeft < tRight) {
+        stack[stackSize++] = StackEntry {node->right, tRight};
+        stack[stackSize++] = StackEntry {node->left, tLeft};
+      } else {
+        if (hitLeft) {
+          stack[stackSize++] = StackEntry {node->left, tLeft};
+        }
+        if (hitRight) {
+          stack[stackSize++] = StackEntry {node->right, tRight};
+        }
+      }
+    }
+    return found;
+  }
 }
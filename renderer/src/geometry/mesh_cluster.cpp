@@ -0,0 +1,171 @@
+#include "geometry/mesh_cluster.h"
+#include "geometry/space_filling_curve.h"
+#include "geometry/triangle3.h"
+#include "const.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+namespace hd {
+  bool MeshCluster::isBackFacing(const Vector3& viewPos) const {
+    if (coneCosAngle <= 0.0) {
+      return false;
+    }
+    Vector3 toCenter = center - viewPos;
+    double dist = toCenter.len();
+    if (dist <= radius + HD_EPSILON) {
+      return false;
+    }
+    // Seen from viewPos, the cluster spans directions within angle asin(radius / dist) around
+    // toCenter. All faces point away if every such direction is less than 90 degrees away from
+    // every normal in the cone.
+    double coneAngle = std::acos(std::min(1.0, coneCosAngle));
+    double spreadAngle = std::asin(radius / dist);
+    if (coneAngle + spreadAngle >= HD_PI / 2) {
+      return false;
+    }
+    return (toCenter / dist) * coneAxis > std::sin(coneAngle + spreadAngle);
+  }
+
+  std::vector<MeshCluster> MeshCluster::partition(const TriangularMesh& mesh,
+      unsigned int maxFaceNum, unsigned int maxVertexNum) {
+    assert(mesh.isPopulated());
+    mesh.requireLists("MeshCluster::partition()");
+    assert(maxFaceNum > 0);
+    assert(maxVertexNum >= 3 && maxVertexNum <= 256);
+    std::vector<Vector3> positions(mesh.vertexNum());
+    for (unsigned int vid = 0; vid < mesh.vertexNum(); ++vid) {
+      positions[vid] = mesh.v(vid).pos;
+    }
+    unsigned int faceNum = mesh.faceNum();
+    std::vector<std::array<unsigned int, 3>> faceVertices(faceNum);
+    std::vector<Vector3> faceNormals(faceNum);
+    std::vector<Vector3> centroids(faceNum);
+    std::vector<std::pair<uint64_t, unsigned int>> seeds(faceNum);
+    for (unsigned int fid = 0; fid < faceNum; ++fid) {
+      Triangle3 t = mesh.triangle(fid);
+      faceVertices[fid] = mesh.f(fid).vertices;
+      faceNormals[fid] = t.normal();
+      centroids[fid] = (t.v(0) + t.v(1) + t.v(2)) / 3.0;
+      seeds[fid] = std::make_pair(spaceFillingCurveIndex(
+          SpaceFillingCurve::MORTON, centroids[fid], mesh.boundingBox3()), fid);
+    }
+    std::sort(seeds.begin(), seeds.end());
+
+    std::vector<MeshCluster> clusters;
+    std::vector<bool> assigned(faceNum, false);
+    // Index of each mesh vertex in the local vertex list of the cluster being built.
+    std::vector<unsigned int> localIndex(mesh.vertexNum(), HD_INVALID_ID);
+    // Unassigned faces adjacent to the cluster being built.
+    std::vector<unsigned int> frontier;
+    for (auto& seed : seeds) {
+      if (assigned[seed.second]) {
+        continue;
+      }
+      MeshCluster cluster;
+      Vector3 sumOfCentroids = Vector3::zero();
+      frontier.clear();
+      frontier.push_back(seed.second);
+      assigned[seed.second] = true;
+      // Faces are marked assigned when entering the frontier. Faces left in the frontier or
+      // dropped from it are unmarked again and left for later clusters.
+      while (!frontier.empty() && cluster.faces.size() < maxFaceNum) {
+        // Pick the face adding the fewest new vertices, which keeps clusters compact and
+        // fills holes first, then the one closest to the cluster centroid. Faces that no
+        // longer fit the vertex limit are dropped.
+        Vector3 clusterCentroid = cluster.faces.empty()
+            ? centroids[seed.second] : sumOfCentroids / cluster.faces.size();
+        std::size_t keptNum = 0;
+        std::size_t best = 0;
+        unsigned int bestNewVertexNum = 4;
+        double bestDist2 = HD_INFINITY;
+        for (unsigned int fid : frontier) {
+          unsigned int newVertexNum = 0;
+          for (unsigned int vid : faceVertices[fid]) {
+            if (localIndex[vid] == static_cast<unsigned int>(HD_INVALID_ID)) {
+              ++newVertexNum;
+            }
+          }
+          if (cluster.vertices.size() + newVertexNum > maxVertexNum) {
+            assigned[fid] = false;
+            continue;
+          }
+          double dist2 = (centroids[fid] - clusterCentroid).len2();
+          if (newVertexNum < bestNewVertexNum
+              || (newVertexNum == bestNewVertexNum && dist2 < bestDist2)) {
+            best = keptNum;
+            bestNewVertexNum = newVertexNum;
+            bestDist2 = dist2;
+          }
+          frontier[keptNum++] = fid;
+        }
+        frontier.resize(keptNum);
+        if (frontier.empty()) {
+          break;
+        }
+        unsigned int fid = frontier[best];
+        frontier[best] = frontier.back();
+        frontier.pop_back();
+
+        cluster.faces.push_back(fid);
+        sumOfCentroids += centroids[fid];
+        for (unsigned int vid : faceVertices[fid]) {
+          if (localIndex[vid] == static_cast<unsigned int>(HD_INVALID_ID)) {
+            localIndex[vid] = cluster.vertices.size();
+            cluster.vertices.push_back(vid);
+          }
+          cluster.localTriangles.push_back(static_cast<uint8_t>(localIndex[vid]));
+        }
+        for (unsigned int eid : mesh.f(fid).edges) {
+          unsigned int twin = mesh.e(eid).twinEdge;
+          if (twin == static_cast<unsigned int>(HD_INVALID_ID)) {
+            continue;
+          }
+          unsigned int neighbor = mesh.e(twin).face;
+          if (!assigned[neighbor]) {
+            assigned[neighbor] = true;
+            frontier.push_back(neighbor);
+          }
+        }
+      }
+      for (unsigned int fid : frontier) {
+        assigned[fid] = false;
+      }
+
+      Vector3 minBound = Vector3::identity(HD_INFINITY);
+      Vector3 maxBound = Vector3::identity(-HD_INFINITY);
+      for (unsigned int vid : cluster.vertices) {
+        localIndex[vid] = HD_INVALID_ID;
+        const Vector3& p = positions[vid];
+        for (int i = 0; i < 3; ++i) {
+          minBound[i] = std::min(minBound[i], p[i]);
+          maxBound[i] = std::max(maxBound[i], p[i]);
+        }
+      }
+      cluster.boundingBox = BoundingBox3(minBound, maxBound);
+      cluster.center = (minBound + maxBound) / 2.0;
+      for (unsigned int vid : cluster.vertices) {
+        cluster.radius = std::max(cluster.radius, (positions[vid] - cluster.center).len());
+      }
+
+      Vector3 sumOfNormals = Vector3::zero();
+      for (unsigned int fid : cluster.faces) {
+        sumOfNormals += faceNormals[fid];
+      }
+      if (sumOfNormals.len() > HD_EPSILON) {
+        cluster.coneAxis = sumOfNormals.normalize();
+        cluster.coneCosAngle = 1.0;
+        for (unsigned int fid : cluster.faces) {
+          cluster.coneCosAngle =
+              std::min(cluster.coneCosAngle, faceNormals[fid] * cluster.coneAxis);
+        }
+      } else {
+        cluster.coneAxis = Vector3::zUnit();
+        cluster.coneCosAngle = -1.0;
+      }
+      clusters.push_back(std::move(cluster));
+    }
+    return clusters;
+  }
+}
@@ -0,0 +1,389 @@
+#include "geometry/mesh_simplifier.h"
+#include "const.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+namespace hd {
+  namespace {
+    const unsigned int NO_ID = static_cast<unsigned int>(HD_INVALID_ID);
+    // Weight of the constraint planes added along boundary edges, relative to face planes.
+    const double BOUNDARY_WEIGHT = 1000.0;
+    // Quadric matrices with determinant below this are considered singular.
+    const double SINGULAR_DETERMINANT = 1e-10;
+
+    void removeValue(std::vector<unsigned int>& values, unsigned int value) {
+      auto it = std::find(values.begin(), values.end(), value);
+      if (it != values.end()) {
+        values.erase(it);
+      }
+    }
+  }
+
+  MeshSimplifier::Quadric::Quadric(const Vector3& n, double d, double weight) {
+    a = Matrix3(n * n.x, n * n.y, n * n.z) * weight;
+    b = n * (d * weight);
+    c = d * d * weight;
+  }
+
+  MeshSimplifier::Quadric& MeshSimplifier::Quadric::operator+=(const Quadric& rhs) {
+    a += rhs.a;
+    b += rhs.b;
+    c += rhs.c;
+    return *this;
+  }
+
+  double MeshSimplifier::Quadric::error(const Vector3& x) const {
+    return x * (a * x) + 2.0 * (b * x) + c;
+  }
+
+  MeshSimplifier::MeshSimplifier(const TriangularMesh& mesh)
+      : _vertexNormalMode(mesh.vertexNormalMode()),
+        _faceNormalMode(mesh.faceNormalMode()),
+        _faceNum(mesh.faceNum()),
+        _queue(mesh.edgeNum()) {
+    assert(mesh.isPopulated());
+    mesh.requireLists("MeshSimplifier");
+    unsigned int vertexNum = mesh.vertexNum();
+    unsigned int edgeNum = mesh.edgeNum();
+    _positions.reserve(vertexNum);
+    _vertexNormals.reserve(vertexNum);
+    _outgoingEdges.reserve(vertexNum);
+    for (unsigned int vid = 0; vid < vertexNum; ++vid) {
+      TriangularMesh::Vertex v = mesh.v(vid);
+      _positions.push_back(v.pos);
+      _vertexNormals.push_back(v.normal);
+      _outgoingEdges.push_back(std::vector<unsigned int>(v.edges.begin(), v.edges.end()));
+    }
+    _vertexAlive.assign(vertexNum, true);
+    _edges.reserve(edgeNum);
+    for (unsigned int eid = 0; eid < edgeNum; ++eid) {
+      _edges.push_back(mesh.e(eid));
+    }
+    _edgeAlive.assign(edgeNum, true);
+    _faceVertices.reserve(_faceNum);
+    _faceNormals.reserve(_faceNum);
+    for (unsigned int fid = 0; fid < _faceNum; ++fid) {
+      TriangularMesh::Face f = mesh.f(fid);
+      _faceVertices.push_back(f.vertices);
+      _faceNormals.push_back(f.normal);
+    }
+    _faceAlive.assign(_faceNum, true);
+
+    // Each vertex starts with the quadric of planes of all its adjacent faces. Geometric normals
+    // are used regardless of the normal mode of the mesh.
+    _quadrics.resize(vertexNum);
+    std::vector<Vector3> planeNormals(_faceNum);
+    for (unsigned int fid = 0; fid < _faceNum; ++fid) {
+      Vector3 n = mesh.triangle(fid).normal();
+      planeNormals[fid] = n;
+      Quadric q(n, -(n * _positions[_faceVertices[fid][0]]));
+      for (unsigned int vid : _faceVertices[fid]) {
+        _quadrics[vid] += q;
+      }
+    }
+    // Constrain boundary edges with planes perpendicular to their faces, so that the boundary
+    // can only slide along itself.
+    for (unsigned int eid = 0; eid < edgeNum; ++eid) {
+      const TriangularMesh::Edge& e = _edges[eid];
+      if (e.twinEdge != NO_ID) {
+        continue;
+      }
+      Vector3 dir = _positions[e.endVertex] - _positions[e.startVertex];
+      Vector3 n = (dir ^ planeNormals[e.face]).normalize();
+      Quadric q(n, -(n * _positions[e.startVertex]), BOUNDARY_WEIGHT);
+      _quadrics[e.startVertex] += q;
+      _quadrics[e.endVertex] += q;
+    }
+
+    _targets.resize(edgeNum);
+    for (unsigned int eid = 0; eid < edgeNum; ++eid) {
+      _updateEdge(eid);
+    }
+  }
+
+  std::unique_ptr<TriangularMesh> MeshSimplifier::simplify(unsigned int targetFaceNum) {
+    while (_faceNum > targetFaceNum && !_queue.empty()) {
+      if (_queue.topPriority() >= HD_INFINITY) {
+        // All remaining collapses are currently invalid.
+        break;
+      }
+      unsigned int eid = _queue.top();
+      if (!_canCollapse(eid)) {
+        // Park the edge until a collapse nearby re-evaluates it.
+        _queue.push(eid, HD_INFINITY);
+        continue;
+      }
+      _collapse(eid);
+    }
+    return _snapshot();
+  }
+
+  std::vector<std::unique_ptr<TriangularMesh>> MeshSimplifier::buildLods(
+      const TriangularMesh& mesh, const std::vector<unsigned int>& targetFaceNums) {
+    MeshSimplifier simplifier(mesh);
+    std::vector<std::unique_ptr<TriangularMesh>> lods;
+    for (unsigned int i = 0; i < targetFaceNums.size(); ++i) {
+      assert(i == 0 || targetFaceNums[i] <= targetFaceNums[i - 1]);
+      lods.push_back(simplifier.simplify(targetFaceNums[i]));
+    }
+    return lods;
+  }
+
+  bool MeshSimplifier::_isCanonical(unsigned int eid) const {
+    unsigned int twin = _edges[eid].twinEdge;
+    return twin == NO_ID || eid < twin;
+  }
+
+  bool MeshSimplifier::_isBoundaryVertex(unsigned int vid) const {
+    for (unsigned int eid : _outgoingEdges[vid]) {
+      if (_edges[eid].twinEdge == NO_ID || _edges[_edges[eid].prevEdge].twinEdge == NO_ID) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<unsigned int> MeshSimplifier::_neighbors(unsigned int vid) const {
+    std::vector<unsigned int> neighbors;
+    for (unsigned int eid : _outgoingEdges[vid]) {
+      // Boundary vertices have neighbors only reachable through incoming edges.
+      neighbors.push_back(_edges[eid].endVertex);
+      neighbors.push_back(_edges[_edges[eid].prevEdge].startVertex);
+    }
+    std::sort(neighbors.begin(), neighbors.end());
+    neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    return neighbors;
+  }
+
+  void MeshSimplifier::_updateEdge(unsigned int eid) {
+    if (!_edgeAlive[eid] || !_isCanonical(eid)) {
+      _queue.remove(eid);
+      return;
+    }
+    const Vector3& pu = _positions[_edges[eid].startVertex];
+    const Vector3& pv = _positions[_edges[eid].endVertex];
+    Quadric q = _quadrics[_edges[eid].startVertex];
+    q += _quadrics[_edges[eid].endVertex];
+    Vector3 mid = (pu + pv) * 0.5;
+
+    // The optimal position solves a * x = -b. Use Cramer's rule: replacing column i of a is
+    // replacing row i of its transpose.
+    bool solved = false;
+    Vector3 target;
+    double det = q.a.det();
+    if (std::fabs(det) > SINGULAR_DETERMINANT) {
+      Vector3 rhs = -1.0 * q.b;
+      Matrix3 at = q.a.t();
+      for (int i = 0; i < 3; ++i) {
+        Matrix3 m = at;
+        m[i] = rhs;
+        target[i] = m.det() / det;
+      }
+      // Nearly singular quadrics may place the vertex far away from the edge.
+      solved = (target - mid).len() <= (pv - pu).len();
+    }
+    if (!solved) {
+      target = mid;
+      if (q.error(pu) < q.error(target)) {
+        target = pu;
+      }
+      if (q.error(pv) < q.error(target)) {
+        target = pv;
+      }
+    }
+    _targets[eid] = target;
+    _queue.push(eid, std::max(0.0, q.error(target)));
+  }
+
+  bool MeshSimplifier::_canCollapse(unsigned int eid) const {
+    const TriangularMesh::Edge& h = _edges[eid];
+    unsigned int u = h.startVertex;
+    unsigned int v = h.endVertex;
+    unsigned int twin = h.twinEdge;
+    std::vector<unsigned int> opposites;
+    opposites.push_back(_edges[h.nextEdge].endVertex);
+    if (twin != NO_ID) {
+      opposites.push_back(_edges[_edges[twin].nextEdge].endVertex);
+    }
+
+    // Link condition: u and v may only share the neighbors opposite to the collapsed edge,
+    // otherwise the collapse creates non-manifold edges.
+    std::vector<unsigned int> nu = _neighbors(u);
+    std::vector<unsigned int> nv = _neighbors(v);
+    std::vector<unsigned int> shared;
+    std::set_intersection(nu.begin(), nu.end(), nv.begin(), nv.end(),
+        std::back_inserter(shared));
+    if (shared.size() != opposites.size()) {
+      return false;
+    }
+    // Collapsing an interior edge between two boundary vertices pinches the surface.
+    if (twin != NO_ID && _isBoundaryVertex(u) && _isBoundaryVertex(v)) {
+      return false;
+    }
+    // Interior vertices opposite to the edge lose one edge. Going below three creates
+    // doubled faces, e.g. when collapsing a tetrahedron.
+    for (unsigned int vid : opposites) {
+      if (!_isBoundaryVertex(vid) && _outgoingEdges[vid].size() <= 3) {
+        return false;
+      }
+    }
+
+    // Reject collapses that flip or degenerate any remaining face around u and v.
+    const Vector3& target = _targets[eid];
+    unsigned int removedFaces[2] = {h.face, twin != NO_ID ? _edges[twin].face : NO_ID};
+    for (unsigned int vid : {u, v}) {
+      for (unsigned int outgoing : _outgoingEdges[vid]) {
+        unsigned int fid = _edges[outgoing].face;
+        if (fid == removedFaces[0] || fid == removedFaces[1]) {
+          continue;
+        }
+        std::array<Vector3, 3> before;
+        std::array<Vector3, 3> after;
+        for (unsigned int i = 0; i < 3; ++i) {
+          unsigned int fv = _faceVertices[fid][i];
+          before[i] = _positions[fv];
+          after[i] = (fv == u || fv == v) ? target : before[i];
+        }
+        Vector3 n0 = (before[1] - before[0]) ^ (before[2] - before[1]);
+        Vector3 n1 = (after[1] - after[0]) ^ (after[2] - after[1]);
+        if (n1.len2() <= HD_EPSILON_TINY || n0 * n1 <= 0) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  void MeshSimplifier::_collapse(unsigned int eid) {
+    TriangularMesh::Edge h = _edges[eid];
+    unsigned int u = h.startVertex;
+    unsigned int v = h.endVertex;
+
+    auto linkTwins = [this](unsigned int lhs, unsigned int rhs) {
+      if (lhs != NO_ID) {
+        _edges[lhs].twinEdge = rhs;
+      }
+      if (rhs != NO_ID) {
+        _edges[rhs].twinEdge = lhs;
+      }
+    };
+    auto removeFace = [this](unsigned int edgeInFace) {
+      unsigned int fid = _edges[edgeInFace].face;
+      _faceAlive[fid] = false;
+      --_faceNum;
+      unsigned int faceEdges[3] = {
+        edgeInFace, _edges[edgeInFace].nextEdge, _edges[edgeInFace].prevEdge
+      };
+      for (unsigned int e : faceEdges) {
+        _edgeAlive[e] = false;
+        removeValue(_outgoingEdges[_edges[e].startVertex], e);
+        _queue.remove(e);
+      }
+    };
+
+    // Removing the face u->v->a leaves its other two edges' twins, a->v and u->a, facing each
+    // other. Same for the twin face v->u->b.
+    linkTwins(_edges[h.nextEdge].twinEdge, _edges[h.prevEdge].twinEdge);
+    removeFace(eid);
+    if (h.twinEdge != NO_ID) {
+      const TriangularMesh::Edge& t = _edges[h.twinEdge];
+      linkTwins(_edges[t.nextEdge].twinEdge, _edges[t.prevEdge].twinEdge);
+      removeFace(h.twinEdge);
+    }
+
+    // Hand all remaining edges of v over to u.
+    for (unsigned int e : _outgoingEdges[v]) {
+      _edges[e].startVertex = u;
+      _edges[_edges[e].prevEdge].endVertex = u;
+      for (unsigned int& fv : _faceVertices[_edges[e].face]) {
+        if (fv == v) {
+          fv = u;
+        }
+      }
+      _outgoingEdges[u].push_back(e);
+    }
+    _outgoingEdges[v].clear();
+    _vertexAlive[v] = false;
+
+    _positions[u] = _targets[eid];
+    _quadrics[u] += _quadrics[v];
+    if (_vertexNormalMode == TriangularMesh::VertexNormalMode::USER_SPECIFIED) {
+      Vector3 n = _vertexNormals[u] + _vertexNormals[v];
+      if (n.len2() > HD_EPSILON_TINY) {
+        _vertexNormals[u] = n.normalize();
+      }
+    }
+
+    // Only edges incident to u changed cost, as the cost of an edge depends only on its
+    // two vertices.
+    for (unsigned int e : _outgoingEdges[u]) {
+      unsigned int incoming = _edges[e].prevEdge;
+      _updateEdge(e);
+      _updateEdge(incoming);
+      if (_edges[e].twinEdge != NO_ID) {
+        _updateEdge(_edges[e].twinEdge);
+      }
+      if (_edges[incoming].twinEdge != NO_ID) {
+        _updateEdge(_edges[incoming].twinEdge);
+      }
+    }
+  }
+
+  std::unique_ptr<TriangularMesh> MeshSimplifier::_snapshot() const {
+    std::vector<unsigned int> newIndex(_positions.size(), NO_ID);
+    for (unsigned int fid = 0; fid < _faceAlive.size(); ++fid) {
+      if (_faceAlive[fid]) {
+        for (unsigned int vid : _faceVertices[fid]) {
+          newIndex[vid] = 0;
+        }
+      }
+    }
+    unsigned int vertexNum = 0;
+    for (unsigned int vid = 0; vid < newIndex.size(); ++vid) {
+      if (newIndex[vid] != NO_ID) {
+        assert(_vertexAlive[vid]);
+        newIndex[vid] = vertexNum++;
+      }
+    }
+
+    std::vector<TriangularMesh::Vertex> vertices;
+    std::vector<TriangularMesh::Face> faces;
+    vertices.reserve(vertexNum);
+    faces.reserve(_faceNum);
+    bool userVertexNormals =
+        _vertexNormalMode == TriangularMesh::VertexNormalMode::USER_SPECIFIED;
+    for (unsigned int vid = 0; vid < newIndex.size(); ++vid) {
+      if (newIndex[vid] == NO_ID) {
+        continue;
+      }
+      if (userVertexNormals) {
+        vertices.push_back(TriangularMesh::Vertex(_positions[vid], _vertexNormals[vid]));
+      } else {
+        vertices.push_back(TriangularMesh::Vertex(_positions[vid]));
+      }
+    }
+    bool userFaceNormals = _faceNormalMode == TriangularMesh::FaceNormalMode::USER_SPECIFIED;
+    for (unsigned int fid = 0; fid < _faceAlive.size(); ++fid) {
+      if (!_faceAlive[fid]) {
+        continue;
+      }
+      std::array<unsigned int, 3> face = {
+        newIndex[_faceVertices[fid][0]],
+        newIndex[_faceVertices[fid][1]],
+        newIndex[_faceVertices[fid][2]]
+      };
+      if (userFaceNormals) {
+        faces.push_back(TriangularMesh::Face(face, _faceNormals[fid]));
+      } else {
+        faces.push_back(TriangularMesh::Face(face));
+      }
+    }
+    return TriangularMesh::newBuilder(_vertexNormalMode, _faceNormalMode)
+        .setVertices(std::move(vertices))
+        .setFaces(std::move(faces))
+        .build();
+  }
+}
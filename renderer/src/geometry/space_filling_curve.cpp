@@ -0,0 +1,81 @@
+#include "geometry/space_filling_curve.h"
+#include "const.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace hd {
+  namespace {
+    // Spread the lowest 21 bits of v so that there are two zero bits between every two bits.
+    uint64_t spreadBits3(uint32_t v) {
+      uint64_t x = v & 0x1fffff;
+      x = (x | (x << 32)) & 0x1f00000000ffffULL;
+      x = (x | (x << 16)) & 0x1f0000ff0000ffULL;
+      x = (x | (x << 8)) & 0x100f00f00f00f00fULL;
+      x = (x | (x << 4)) & 0x10c30c30c30c30c3ULL;
+      x = (x | (x << 2)) & 0x1249249249249249ULL;
+      return x;
+    }
+  }
+
+  uint64_t mortonIndex3(uint32_t x, uint32_t y, uint32_t z) {
+    return spreadBits3(x) | (spreadBits3(y) << 1) | (spreadBits3(z) << 2);
+  }
+
+  uint64_t hilbertIndex3(uint32_t x, uint32_t y, uint32_t z, unsigned int bits) {
+    assert(bits >= 1 && bits <= SFC_MAX_BITS);
+    uint32_t coords[3] = {x, y, z};
+    uint32_t highest = 1u << (bits - 1);
+    // Convert the coordinates into the "transposed" Hilbert index in place, following
+    // Skilling's AxesToTranspose.
+    for (uint32_t q = highest; q > 1; q >>= 1) {
+      uint32_t p = q - 1;
+      for (int i = 0; i < 3; ++i) {
+        if (coords[i] & q) {
+          coords[0] ^= p;
+        } else {
+          uint32_t t = (coords[0] ^ coords[i]) & p;
+          coords[0] ^= t;
+          coords[i] ^= t;
+        }
+      }
+    }
+    for (int i = 1; i < 3; ++i) {
+      coords[i] ^= coords[i - 1];
+    }
+    uint32_t t = 0;
+    for (uint32_t q = highest; q > 1; q >>= 1) {
+      if (coords[2] & q) {
+        t ^= q - 1;
+      }
+    }
+    for (int i = 0; i < 3; ++i) {
+      coords[i] ^= t;
+    }
+    // Interleave the transposed index, with the first coordinate holding the most significant
+    // bit of each triple.
+    uint64_t index = 0;
+    for (int bit = bits - 1; bit >= 0; --bit) {
+      for (int i = 0; i < 3; ++i) {
+        index = (index << 1) | ((coords[i] >> bit) & 1);
+      }
+    }
+    return index;
+  }
+
+  uint64_t spaceFillingCurveIndex(SpaceFillingCurve curve, const Vector3& p,
+      const BoundingBox3& box) {
+    const double maxLevel = static_cast<double>((1u << SFC_MAX_BITS) - 1);
+    Vector3 origin = box.minCorner();
+    Vector3 size = box.size();
+    uint32_t cell[3];
+    for (int i = 0; i < 3; ++i) {
+      double level = size[i] > HD_EPSILON_TINY ? (p[i] - origin[i]) / size[i] * maxLevel : 0.0;
+      cell[i] = static_cast<uint32_t>(std::max(0.0, std::min(maxLevel, std::floor(level))));
+    }
+    if (curve == SpaceFillingCurve::MORTON) {
+      return mortonIndex3(cell[0], cell[1], cell[2]);
+    }
+    return hilbertIndex3(cell[0], cell[1], cell[2]);
+  }
+}
@@ -2,6 +2,7 @@
 #include "const.h"
 #include <cassert>
 #include <algorithm>
+#include <cmath>
 
 namespace hd {
   Triangle3::Triangle3() {
@@ -51,4 +52,37 @@ namespace hd {
   double Triangle3::surfaceArea() const {
     return (e(0) ^ e(1)).len() / 2.0;
   }
-}
\ No newline at end of file
+
+  // Solves origin + t * direction = v0 + u * (v1 - v0) + v * (v2 - v0) by Cramer's rule,
+  // with the determinants written as scalar triple products.
+  bool Triangle3::intersect(const Ray3& ray, double tMin, double tMax,
+      double& t, double& u, double& v) const {
+    Vector3 e0 = _vertices[1] - _vertices[0];
+    Vector3 e2 = _vertices[2] - _vertices[0];
+    Vector3 p = ray.direction ^ e2;
+    double det = e0 * p;
+    if (std::abs(det) < HD_EPSILON_TINY) {
+      // The ray is parallel to the triangle, or the triangle is degenerate.
+      return false;
+    }
+    double invDet = 1.0 / det;
+    Vector3 s = ray.origin - _vertices[0];
+    double hitU = (s * p) * invDet;
+    if (hitU < 0.0 || hitU > 1.0) {
+      return false;
+    }
+    Vector3 q = s ^ e0;
+    double hitV = (ray.direction * q) * invDet;
+    if (hitV < 0.0 || hitU + hitV > 1.0) {
+      return false;
+    }
+    double hitT = (e2 * q) * invDet;
+    if (hitT <= tMin || hitT >= tMax) {
+      return false;
+    }
+    t = hitT;
+    u = hitU;
+    v = hitV;
+    return true;
+  }
+}
@@ -1,8 +1,115 @@
 #include "geometry/triangular_mesh.h"
+#include "io/cluster_store.h"
 #include "const.h"
+#include "util/parallel.h"
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <unordered_map>
+#include <utility>
 
 namespace hd {
+  namespace {
+    // Integer coordinates of a cell of the spatial hash grid used by vertex welding.
+    class GridCell {
+      public:
+        int64_t x, y, z;
+      public:
+        GridCell(): x(0), y(0), z(0) {}
+        GridCell(int64_t cx, int64_t cy, int64_t cz): x(cx), y(cy), z(cz) {}
+        friend bool operator==(const GridCell& lhs, const GridCell& rhs) {
+          return lhs.x == rhs.x && lhs.y == rhs.y && lhs.z == rhs.z;
+        }
+        friend bool operator<(const GridCell& lhs, const GridCell& rhs) {
+          if (lhs.x != rhs.x) return lhs.x < rhs.x;
+          if (lhs.y != rhs.y) return lhs.y < rhs.y;
+          return lhs.z < rhs.z;
+        }
+    };
+
+    class GridCellHash {
+      public:
+        std::size_t operator()(const GridCell& c) const {
+          // Large primes from "Optimized Spatial Hashing for Collision Detection of Deformable
+          // Objects", M. Teschner et al.
+          return static_cast<std::size_t>((static_cast<uint64_t>(c.x) * 73856093)
+              ^ (static_cast<uint64_t>(c.y) * 19349663)
+              ^ (static_cast<uint64_t>(c.z) * 83492791));
+        }
+    };
+
+    // Heap bytes held by a copy-on-write buffer beyond its elements. The buffer is allocated
+    // along with its reference counts by std::make_shared.
+    template <typename T>
+    std::size_t cowSlack(const CowVector<T>& v) {
+      return heapSlack(v.get()) + heapBlockBytes(sizeof(std::vector<T>) + 16);
+    }
+
+    // Make room for count more elements ahead of a batch of push_back() calls. Capacity still
+    // grows geometrically, so that many small batches stay amortized linear, where reserving
+    // exactly size() + count would reallocate and copy upon every batch.
+    template <typename T, typename Allocator>
+    void reserveMore(std::vector<T, Allocator>& v, std::size_t count) {
+      if (v.size() + count > v.capacity()) {
+        v.reserve(std::max(v.size() + count, 2 * v.capacity()));
+      }
+    }
+
+    // Page holding a face of an out-of-core mesh, and the index of the face within it.
+    std::shared_ptr<const ClusterStore::Page> facePage(ClusterStore& store, unsigned int faceId,
+        unsigned int& localFace) {
+      unsigned int clusterId;
+      store.locate(faceId, clusterId, localFace);
+      return store.requirePage(clusterId);
+    }
+
+    // Number of points processed at once by batched evaluation. Gathered vertex data of a block
+    // (9 doubles per point) stays well within L1 cache.
+    const std::size_t BATCH_BLOCK_SIZE = 64;
+
+    // Vertex attributes of the three corners of each point of a block, in structure-of-arrays
+    // form: v[3 * k + axis][i] is coordinate axis of corner k of point i.
+    class CornerBlock {
+      public:
+        double v[9][BATCH_BLOCK_SIZE];
+    };
+
+    // out[axis][i] = a[i] * corner 0 + b[i] * corner 1 + c[i] * corner 2 of point i, for points
+    // [0, n) of a block.
+    void interpolateBlock(const CornerBlock& corners, std::size_t n,
+        const double* a, const double* b, const double* c,
+        double* x, double* y, double* z) {
+      double* out[3] = {x, y, z};
+      for (int axis = 0; axis < 3; ++axis) {
+        const double* v0 = corners.v[axis];
+        const double* v1 = corners.v[3 + axis];
+        const double* v2 = corners.v[6 + axis];
+        double* o = out[axis];
+        for (std::size_t i = 0; i < n; ++i) {
+          o[i] = a[i] * v0[i] + b[i] * v1[i] + c[i] * v2[i];
+        }
+      }
+    }
+
+    // Append a half-edge to an outgoing edge list. A list allocated from an arena is moved to
+    // the heap before it would reallocate, as the arena never reclaims the buffer it leaves
+    // behind: editing arena-backed meshes would otherwise grow the arena without bound.
+    void appendOutgoingEdge(std::vector<unsigned int, ArenaAllocator<unsigned int>>& list,
+        unsigned int eid) {
+      if (list.size() == list.capacity() && list.get_allocator().arena() != nullptr) {
+        std::vector<unsigned int, ArenaAllocator<unsigned int>> heapList;
+        heapList.reserve(list.size() * 2 + 1);
+        heapList.assign(list.begin(), list.end());
+        list = std::move(heapList);
+      }
+      list.push_back(eid);
+    }
+  }
+
   TriangularMesh::TriangularMesh() {
     _vertices.clear();
     _edges.clear();
@@ -12,14 +119,16 @@ namespace hd {
     _faceNormalMode = TriangularMesh::FaceNormalMode::FLAT;
   }
 
-  TriangularMesh::TriangularMesh(const TriangularMesh& mesh) {
-    _vertices.insert(_vertices.end(), mesh._vertices.begin(), mesh._vertices.end());
-    _edges.insert(_edges.end(), mesh._edges.begin(), mesh._edges.end());
-    _faces.insert(_faces.end(), mesh._faces.begin(), mesh._faces.end());
+  TriangularMesh::TriangularMesh(const TriangularMesh& mesh)
+      : _arena(mesh._arena), _vertices(mesh._vertices), _edges(mesh._edges),
+        _faces(mesh._faces) {
     _isPopulated = mesh._isPopulated;
     _boundingBox = mesh._boundingBox;
     _vertexNormalMode = mesh._vertexNormalMode;
     _faceNormalMode = mesh._faceNormalMode;
+    _compressed = mesh._compressed;
+    _clusterStore = mesh._clusterStore;
+    _areaTable = std::atomic_load(&mesh._areaTable);
   }
 
   TriangularMesh::~TriangularMesh() {
@@ -28,6 +137,12 @@ namespace hd {
     _faces.clear();
   }
 
+  TriangularMesh::Editor TriangularMesh::edit() {
+    assert(isPopulated());
+    requireLists("TriangularMesh::edit()");
+    return TriangularMesh::Editor(*this);
+  }
+
   TriangularMesh::Builder TriangularMesh::newBuilder(
       TriangularMesh::VertexNormalMode vertexNormalMode,
       TriangularMesh::FaceNormalMode faceNormalMode) {
@@ -35,22 +150,39 @@ namespace hd {
   }
 
   TriangularMesh::Vertex TriangularMesh::v(unsigned int index) const {
+    if (isOutOfCore()) {
+      requireLists("TriangularMesh::v()");
+    }
     assert(index <  vertexNum());
+    if (isCompressed()) {
+      return Vertex(_compressed->pos(index), _compressed->hasVertexNormals()
+          ? _compressed->vertexNormal(index) : Vector3::zero());
+    }
     return _vertices[index];
   }
 
   TriangularMesh::Face TriangularMesh::f(unsigned int index) const {
+    if (isOutOfCore()) {
+      requireLists("TriangularMesh::f()");
+    }
     assert(index < faceNum());
+    if (isCompressed()) {
+      Face face(_compressed->face(index), _compressed->hasFaceNormals()
+          ? _compressed->faceNormal(index) : triangle(index).normal());
+      face.edges.fill(HD_INVALID_ID);
+      return face;
+    }
     return _faces[index];
   }
 
   TriangularMesh::Edge TriangularMesh::e(unsigned int index) const {
+    requireLists("TriangularMesh::e()");
     assert(index < edgeNum());
     return _edges[index];
   }
 
   unsigned int TriangularMesh::vertexNum() const {
-    return _vertices.size();
+    return isCompressed() ? _compressed->vertexNum() : _vertices.size();
   }
 
   unsigned int TriangularMesh::edgeNum() const {
@@ -58,14 +190,28 @@ namespace hd {
   }
 
   unsigned int TriangularMesh::faceNum() const {
-    return _faces.size();
+    if (isOutOfCore()) {
+      return _clusterStore->faceNum();
+    }
+    return isCompressed() ? _compressed->faceNum() : _faces.size();
   }
 
   Triangle3 TriangularMesh::triangle(unsigned int index) const {
     assert(isPopulated());
     assert(index < faceNum());
-    auto f = _faces[index];
     auto faceVertices = std::array<Vector3, 3>();
+    if (isOutOfCore()) {
+      unsigned int localFace;
+      return facePage(*_clusterStore, index, localFace)->triangle(localFace);
+    }
+    if (isCompressed()) {
+      auto face = _compressed->face(index);
+      for (int vInd = 0; vInd < 3; ++vInd) {
+        faceVertices[vInd] = _compressed->pos(face[vInd]);
+      }
+      return Triangle3(faceVertices);
+    }
+    auto f = _faces[index];
     for (int vInd = 0; vInd < 3; ++vInd) {
       faceVertices[vInd] = v(f.vertices[vInd]).pos;
     }
@@ -75,6 +221,21 @@ namespace hd {
   Vector3 TriangularMesh::normal(const TriangularMesh::MeshPoint& p) const {
     assert(isPopulated());
     assert(p.faceId < faceNum());
+    if (isOutOfCore()) {
+      unsigned int localFace;
+      return facePage(*_clusterStore, p.faceId, localFace)->normal(localFace, p.params);
+    }
+    if (isCompressed()) {
+      if (_faceNormalMode != TriangularMesh::FaceNormalMode::PHONG) {
+        return _compressed->faceNormal(p.faceId);
+      }
+      auto face = _compressed->face(p.faceId);
+      Vector3 avgNormal = Vector3::zero();
+      for (unsigned int i = 0; i < 3; ++i) {
+        avgNormal += p.params[i] * _compressed->vertexNormal(face[i]);
+      }
+      return avgNormal.normalize();
+    }
     if (_faceNormalMode != TriangularMesh::FaceNormalMode::PHONG) {
       return f(p.faceId).normal;
     }
@@ -89,12 +250,166 @@ namespace hd {
     assert(isPopulated());
     assert(p.faceId < faceNum());
     Vector3 pos = Vector3::zero();
+    if (isOutOfCore()) {
+      Triangle3 t = triangle(p.faceId);
+      for (unsigned int i = 0; i < 3; ++i) {
+        pos += p.params[i] * t.v(i);
+      }
+      return pos;
+    }
+    if (isCompressed()) {
+      auto face = _compressed->face(p.faceId);
+      for (unsigned int i = 0; i < 3; ++i) {
+        pos += p.params[i] * _compressed->pos(face[i]);
+      }
+      return pos;
+    }
     for (unsigned int i = 0; i < 3; ++i) {
       pos += p.params[i] * v(f(p.faceId).vertices[i]).pos;
     }
     return pos;
   }
 
+  void TriangularMesh::pos(std::size_t count, const unsigned int* faceIds,
+      const double* a, const double* b, const double* c,
+      double* x, double* y, double* z) const {
+    assert(isPopulated());
+    if (isCompressed() || isOutOfCore()) {
+      for (std::size_t i = 0; i < count; ++i) {
+        Vector3 p = pos(MeshPoint(faceIds[i], Vector3(a[i], b[i], c[i])));
+        x[i] = p.x;
+        y[i] = p.y;
+        z[i] = p.z;
+      }
+      return;
+    }
+    const std::vector<Vertex>& vertices = _vertices.get();
+    const std::vector<Face>& faces = _faces.get();
+    CornerBlock corners;
+    for (std::size_t begin = 0; begin < count; begin += BATCH_BLOCK_SIZE) {
+      std::size_t n = std::min(BATCH_BLOCK_SIZE, count - begin);
+      for (std::size_t i = 0; i < n; ++i) {
+        assert(faceIds[begin + i] < faces.size());
+        const Face& face = faces[faceIds[begin + i]];
+        for (int k = 0; k < 3; ++k) {
+          const Vector3& p = vertices[face.vertices[k]].pos;
+          corners.v[3 * k][i] = p.x;
+          corners.v[3 * k + 1][i] = p.y;
+          corners.v[3 * k + 2][i] = p.z;
+        }
+      }
+      interpolateBlock(corners, n, a + begin, b + begin, c + begin,
+          x + begin, y + begin, z + begin);
+    }
+  }
+
+  void TriangularMesh::normal(std::size_t count, const unsigned int* faceIds,
+      const double* a, const double* b, const double* c,
+      double* x, double* y, double* z) const {
+    assert(isPopulated());
+    if (isCompressed() || isOutOfCore()) {
+      for (std::size_t i = 0; i < count; ++i) {
+        Vector3 n = normal(MeshPoint(faceIds[i], Vector3(a[i], b[i], c[i])));
+        x[i] = n.x;
+        y[i] = n.y;
+        z[i] = n.z;
+      }
+      return;
+    }
+    const std::vector<Vertex>& vertices = _vertices.get();
+    const std::vector<Face>& faces = _faces.get();
+    if (_faceNormalMode != TriangularMesh::FaceNormalMode::PHONG) {
+      for (std::size_t i = 0; i < count; ++i) {
+        assert(faceIds[i] < faces.size());
+        const Vector3& n = faces[faceIds[i]].normal;
+        x[i] = n.x;
+        y[i] = n.y;
+        z[i] = n.z;
+      }
+      return;
+    }
+    CornerBlock corners;
+    for (std::size_t begin = 0; begin < count; begin += BATCH_BLOCK_SIZE) {
+      std::size_t n = std::min(BATCH_BLOCK_SIZE, count - begin);
+      for (std::size_t i = 0; i < n; ++i) {
+        assert(faceIds[begin + i] < faces.size());
+        const Face& face = faces[faceIds[begin + i]];
+        for (int k = 0; k < 3; ++k) {
+          const Vector3& vn = vertices[face.vertices[k]].normal;
+          corners.v[3 * k][i] = vn.x;
+          corners.v[3 * k + 1][i] = vn.y;
+          corners.v[3 * k + 2][i] = vn.z;
+        }
+      }
+      double* bx = x + begin;
+      double* by = y + begin;
+      double* bz = z + begin;
+      interpolateBlock(corners, n, a + begin, b + begin, c + begin, bx, by, bz);
+      // Same as Vector3::normalize(), which leaves near-zero vectors untouched.
+      for (std::size_t i = 0; i < n; ++i) {
+        double l2 = bx[i] * bx[i] + by[i] * by[i] + bz[i] * bz[i];
+        double scale = l2 < HD_EPSILON_TINY ? 1.0 : 1.0 / std::sqrt(l2);
+        bx[i] *= scale;
+        by[i] *= scale;
+        bz[i] *= scale;
+      }
+    }
+  }
+
+  double TriangularMesh::surfaceArea() const {
+    assert(isPopulated());
+    if (faceNum() == 0) {
+      return 0.0;
+    }
+    return _getAreaTable()->totalWeight();
+  }
+
+  TriangularMesh::MeshPoint TriangularMesh::samplePoint(double uFace, double u1, double u2) const {
+    assert(isPopulated());
+    assert(faceNum() > 0);
+    unsigned int fid = _getAreaTable()->sample(uFace);
+    // Warp the unit square onto the triangle, uniformly by area.
+    double su = std::sqrt(u1);
+    return MeshPoint(fid, Vector3(1.0 - su, u2 * su, su * (1.0 - u2)));
+  }
+
+  void TriangularMesh::samplePoints(const double* u, std::size_t count,
+      std::vector<MeshPoint>& points) const {
+    assert(isPopulated());
+    assert(faceNum() > 0);
+    std::shared_ptr<const AliasTable> table = _getAreaTable();
+    reserveMore(points, count);
+    for (std::size_t i = 0; i < count; ++i, u += 3) {
+      double su = std::sqrt(u[1]);
+      points.push_back(MeshPoint(
+          table->sample(u[0]), Vector3(1.0 - su, u[2] * su, su * (1.0 - u[2]))));
+    }
+  }
+
+  std::shared_ptr<const AliasTable> TriangularMesh::_getAreaTable() const {
+    std::shared_ptr<const AliasTable> table = std::atomic_load(&_areaTable);
+    if (table != nullptr) {
+      return table;
+    }
+    std::vector<double> areas(faceNum());
+    parallelFor(0, areas.size(), [&](std::size_t begin, std::size_t end) {
+      for (std::size_t fid = begin; fid < end; ++fid) {
+        areas[fid] = triangle(fid).surfaceArea();
+      }
+    });
+    std::shared_ptr<const AliasTable> built = std::make_shared<AliasTable>(areas);
+    // If another thread got there first, use its table instead.
+    std::shared_ptr<const AliasTable> expected;
+    if (!std::atomic_compare_exchange_strong(&_areaTable, &expected, built)) {
+      return expected;
+    }
+    return built;
+  }
+
+  void TriangularMesh::_invalidateCaches() {
+    std::atomic_store(&_areaTable, std::shared_ptr<const AliasTable>());
+  }
+
   BoundingBox3 TriangularMesh::boundingBox3() const {
     assert(isPopulated());
     return _boundingBox;    
@@ -105,14 +420,30 @@ namespace hd {
     _populateEdges();
     _populateNormals();
     _populateBoundingBox();
+    _invalidateCaches();
     _isPopulated = true;
   }
 
   void TriangularMesh::_populateEdges() {
+    std::vector<Vertex>& vertices = _vertices.mutate();
+    std::vector<Edge>& edges = _edges.mutate();
+    std::vector<Face>& faces = _faces.mutate();
+    // Size outgoing edge lists of vertices exactly upfront, rather than growing them one edge
+    // at a time.
+    std::vector<unsigned int> degrees(vertices.size(), 0);
+    for (auto& face : faces) {
+      for (unsigned int vid : face.vertices) {
+        ++degrees[vid];
+      }
+    }
+    for (unsigned int vid = 0; vid < vertices.size(); ++vid) {
+      vertices[vid].edges = _newEdgeList();
+      vertices[vid].edges.reserve(degrees[vid]);
+    }
     // Generate all edges. Update edge lists of vertices and faces.
-    _edges.resize(_faces.size() * 3);
-    for (unsigned int fid = 0; fid < _faces.size(); ++fid) {
-      auto face = _faces[fid];
+    edges.resize(faces.size() * 3);
+    for (unsigned int fid = 0; fid < faces.size(); ++fid) {
+      auto face = faces[fid];
       for (unsigned int eid = 0; eid < 3; ++eid) {
         unsigned int edgeId = fid * 3 + eid;
         TriangularMesh::Edge edge = TriangularMesh::Edge();
@@ -123,23 +454,32 @@ namespace hd {
         // prev edge should be (eid - 1) % 3. To avoid overflow when eid is 0, we instead
         // use (eid + 2) % 3.
         edge.prevEdge = fid * 3 + (eid + 2) % 3;
-        _edges[edgeId] = edge;
-        _faces[fid].edges[eid] = edgeId;
-        _vertices[edge.startVertex].edges.push_back(edgeId);
+        edges[edgeId] = edge;
+        faces[fid].edges[eid] = edgeId;
+        vertices[edge.startVertex].edges.push_back(edgeId);
       }
     }
     // Rescan all edges, and populate twin edges.
-    for (unsigned int eid = 0; eid < _edges.size(); ++eid) {
-      unsigned int startVertex = _edges[eid].startVertex;
-      unsigned int endVertex = _edges[eid].endVertex;
-      for (unsigned int revEdgeId : _vertices[endVertex].edges) {
-        if (_edges[revEdgeId].endVertex == startVertex) {
-          _edges[eid].twinEdge = revEdgeId;
-          break;
-        }
-        _edges[eid].twinEdge = HD_INVALID_ID;
+    for (unsigned int eid = 0; eid < edges.size(); ++eid) {
+      edges[eid].twinEdge = _findTwinEdge(eid);
+    }
+  }
+
+  std::vector<unsigned int, ArenaAllocator<unsigned int>>
+      TriangularMesh::_newEdgeList() const {
+    return std::vector<unsigned int, ArenaAllocator<unsigned int>>(
+        ArenaAllocator<unsigned int>(_arena.get()));
+  }
+
+  unsigned int TriangularMesh::_findTwinEdge(unsigned int eid) const {
+    unsigned int startVertex = _edges[eid].startVertex;
+    unsigned int endVertex = _edges[eid].endVertex;
+    for (unsigned int revEdgeId : _vertices[endVertex].edges) {
+      if (_edges[revEdgeId].endVertex == startVertex) {
+        return revEdgeId;
       }
     }
+    return HD_INVALID_ID;
   }
 
   void TriangularMesh::_populateNormals() {
@@ -148,27 +488,104 @@ namespace hd {
       // not be used for Phong interpolation mode, it is still reqired as an intermeidate step
       // to calculate averaged vertex normals.
       for (unsigned int fid = 0; fid < faceNum(); ++fid) {
-        auto f = _faces[fid];
-        Vector3 e0 = v(f.vertices[1]).pos - v(f.vertices[0]).pos;
-        Vector3 e1 = v(f.vertices[2]).pos - v(f.vertices[1]).pos;
-        Vector3 n = e0 ^ e1;
-        assert(n.len2() > HD_EPSILON_TINY);
-        _faces[fid].normal = n.normalize();
+        _populateFaceNormal(fid);
       }
     }
     if (_vertexNormalMode != TriangularMesh::VertexNormalMode::USER_SPECIFIED) {
       for (unsigned int vid = 0; vid < vertexNum(); ++vid) {
-        Vector3 sumOfFaceNormals = Vector3::zero();
-        // Vertex does not directly store all of its adjacent faces. Instead, we go through
-        // every edge starts from it, whose belonging faces must be adjacent to this vertex.
-        for (unsigned int eid : v(vid).edges) {
-          sumOfFaceNormals += f(e(eid).face).normal;
+        _populateVertexNormal(vid);
+      }
+    }
+  }
+
+  void TriangularMesh::_populateFaceNormal(unsigned int fid) {
+    Face& face = _faces.mutate()[fid];
+    Vector3 e0 = _vertices[face.vertices[1]].pos - _vertices[face.vertices[0]].pos;
+    Vector3 e1 = _vertices[face.vertices[2]].pos - _vertices[face.vertices[1]].pos;
+    Vector3 n = e0 ^ e1;
+    assert(n.len2() > HD_EPSILON_TINY);
+    face.normal = n.normalize();
+  }
+
+  void TriangularMesh::_populateVertexNormal(unsigned int vid) {
+    Vertex& vertex = _vertices.mutate()[vid];
+    Vector3 sumOfFaceNormals = Vector3::zero();
+    // Vertex does not directly store all of its adjacent faces. Instead, we go through
+    // every edge starts from it, whose belonging faces must be adjacent to this vertex.
+    for (unsigned int eid : vertex.edges) {
+      sumOfFaceNormals += _faces[_edges[eid].face].normal;
+    }
+    // We don't need to devide sum vector by number of edges: normalization will just include
+    // this procedure.
+    vertex.normal = sumOfFaceNormals.normalize();
+  }
+
+  void TriangularMesh::_appendFace(const TriangularMesh::Face& face) {
+    std::vector<Vertex>& vertices = _vertices.mutate();
+    std::vector<Edge>& edges = _edges.mutate();
+    std::vector<Face>& faces = _faces.mutate();
+    // Half-edges of every face f are 3f, 3f + 1 and 3f + 2, as laid out by _populateEdges().
+    unsigned int fid = faces.size();
+    faces.push_back(face);
+    for (unsigned int eid = 0; eid < 3; ++eid) {
+      unsigned int edgeId = fid * 3 + eid;
+      TriangularMesh::Edge edge = TriangularMesh::Edge();
+      edge.startVertex = face.vertices[eid];
+      edge.endVertex = face.vertices[(eid + 1) % 3];
+      edge.face = fid;
+      edge.twinEdge = HD_INVALID_ID;
+      edge.nextEdge = fid * 3 + (eid + 1) % 3;
+      edge.prevEdge = fid * 3 + (eid + 2) % 3;
+      edges.push_back(edge);
+      faces[fid].edges[eid] = edgeId;
+      appendOutgoingEdge(vertices[edge.startVertex].edges, edgeId);
+    }
+    for (unsigned int eid = fid * 3; eid < fid * 3 + 3; ++eid) {
+      unsigned int twinEdge = _findTwinEdge(eid);
+      edges[eid].twinEdge = twinEdge;
+      if (twinEdge != static_cast<unsigned int>(HD_INVALID_ID)) {
+        edges[twinEdge].twinEdge = eid;
+      }
+    }
+  }
+
+  void TriangularMesh::_removeFace(unsigned int fid) {
+    std::vector<Vertex>& vertices = _vertices.mutate();
+    std::vector<Edge>& edges = _edges.mutate();
+    std::vector<Face>& faces = _faces.mutate();
+    assert(fid < faces.size());
+    for (unsigned int eid = fid * 3; eid < fid * 3 + 3; ++eid) {
+      assert(edges[eid].face == fid);
+      if (edges[eid].twinEdge != static_cast<unsigned int>(HD_INVALID_ID)) {
+        edges[edges[eid].twinEdge].twinEdge = HD_INVALID_ID;
+      }
+      auto& outgoing = vertices[edges[eid].startVertex].edges;
+      outgoing.erase(std::find(outgoing.begin(), outgoing.end(), eid));
+    }
+    unsigned int lastFid = faces.size() - 1;
+    if (fid != lastFid) {
+      // Move the last face and its half-edges into the freed slots.
+      auto remap = [&](unsigned int eid) { return eid - lastFid * 3 + fid * 3; };
+      for (unsigned int eid = lastFid * 3; eid < lastFid * 3 + 3; ++eid) {
+        unsigned int newEid = remap(eid);
+        Edge edge = edges[eid];
+        edge.face = fid;
+        edge.nextEdge = remap(edge.nextEdge);
+        edge.prevEdge = remap(edge.prevEdge);
+        if (edge.twinEdge != static_cast<unsigned int>(HD_INVALID_ID)) {
+          edges[edge.twinEdge].twinEdge = newEid;
         }
-        // We don't need to devide sum vector by number of edges: normalization will just include
-        // this procedure.
-        _vertices[vid].normal = sumOfFaceNormals.normalize();
+        edges[newEid] = edge;
+        auto& outgoing = vertices[edge.startVertex].edges;
+        *std::find(outgoing.begin(), outgoing.end(), eid) = newEid;
+      }
+      faces[fid] = faces[lastFid];
+      for (unsigned int eid = 0; eid < 3; ++eid) {
+        faces[fid].edges[eid] = remap(faces[fid].edges[eid]);
       }
     }
+    faces.pop_back();
+    edges.resize(lastFid * 3, TriangularMesh::Edge());
   }
 
   void TriangularMesh::_populateBoundingBox() {
@@ -178,7 +595,7 @@ namespace hd {
     }
     Vector3 minBound = Vector3::identity(HD_INFINITY);
     Vector3 maxBound = Vector3::identity(-HD_INFINITY);
-    for (auto v : _vertices) {
+    for (const auto& v : _vertices) {
       for (unsigned int i = 0; i < 3; ++i) {
         if (v.pos[i] < minBound[i]) {
           minBound[i] = v.pos[i];
@@ -191,10 +608,372 @@ namespace hd {
     _boundingBox = BoundingBox3(minBound, maxBound);
   }
 
+  void TriangularMesh::_weldVertices(double tolerance) {
+    assert(!isPopulated());
+    assert(tolerance > 0);
+    std::size_t n = _vertices.size();
+    if (n == 0) {
+      return;
+    }
+    bool compareNormals = _vertexNormalMode == TriangularMesh::VertexNormalMode::USER_SPECIFIED;
+
+    // Bucket vertices into a grid of cells as large as the tolerance. Any two vertices to be
+    // merged must then lie in the same or adjacent cells.
+    std::vector<GridCell> cells(n);
+    parallelFor(0, n, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t vid = begin; vid < end; ++vid) {
+        const Vector3& p = _vertices[vid].pos;
+        cells[vid] = GridCell(
+            static_cast<int64_t>(std::floor(p.x / tolerance)),
+            static_cast<int64_t>(std::floor(p.y / tolerance)),
+            static_cast<int64_t>(std::floor(p.z / tolerance)));
+      }
+    });
+    // Sort vertices by cell so that each cell maps to a contiguous range of sorted vertex ids,
+    // which are ascending within the cell.
+    std::vector<unsigned int> sorted(n);
+    for (std::size_t vid = 0; vid < n; ++vid) {
+      sorted[vid] = vid;
+    }
+    std::sort(sorted.begin(), sorted.end(), [&](unsigned int lhs, unsigned int rhs) {
+      return cells[lhs] < cells[rhs] || (cells[lhs] == cells[rhs] && lhs < rhs);
+    });
+    // Hash nodes are temporary, and released in bulk with the scratch arena.
+    Arena scratch;
+    std::unordered_map<GridCell, std::pair<unsigned int, unsigned int>, GridCellHash,
+        std::equal_to<GridCell>,
+        ArenaAllocator<std::pair<const GridCell, std::pair<unsigned int, unsigned int>>>> grid(
+            0, GridCellHash(), std::equal_to<GridCell>(), &scratch);
+    grid.reserve(n);
+    for (unsigned int i = 0; i < n;) {
+      unsigned int j = i;
+      while (j < n && cells[sorted[j]] == cells[sorted[i]]) {
+        ++j;
+      }
+      grid[cells[sorted[i]]] = std::make_pair(i, j);
+      i = j;
+    }
+
+    // For each vertex, find the lowest indexed vertex it coincides with. All lookups are
+    // read-only and independent, and therefore run in parallel.
+    std::vector<unsigned int> representative(n);
+    parallelFor(0, n, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t vid = begin; vid < end; ++vid) {
+        const Vertex& v = _vertices[vid];
+        unsigned int rep = vid;
+        for (int64_t dx = -1; dx <= 1; ++dx) {
+          for (int64_t dy = -1; dy <= 1; ++dy) {
+            for (int64_t dz = -1; dz <= 1; ++dz) {
+              auto it = grid.find(
+                  GridCell(cells[vid].x + dx, cells[vid].y + dy, cells[vid].z + dz));
+              if (it == grid.end()) {
+                continue;
+              }
+              for (unsigned int i = it->second.first; i < it->second.second; ++i) {
+                unsigned int other = sorted[i];
+                if (other >= rep) {
+                  break;
+                }
+                const Vertex& o = _vertices[other];
+                if (std::fabs(o.pos.x - v.pos.x) < tolerance
+                    && std::fabs(o.pos.y - v.pos.y) < tolerance
+                    && std::fabs(o.pos.z - v.pos.z) < tolerance
+                    && (!compareNormals || o.normal == v.normal)) {
+                  rep = other;
+                  break;
+                }
+              }
+            }
+          }
+        }
+        representative[vid] = rep;
+      }
+    });
+
+    // Representatives always have lower indices, so resolving them in ascending order makes
+    // merging transitive. Then compact remaining vertices, keeping their relative order.
+    std::vector<Vertex>& vertices = _vertices.mutate();
+    std::vector<unsigned int> newIndex(n);
+    unsigned int weldedNum = 0;
+    for (std::size_t vid = 0; vid < n; ++vid) {
+      unsigned int rep = representative[representative[vid]];
+      representative[vid] = rep;
+      if (rep == vid) {
+        newIndex[vid] = weldedNum;
+        if (weldedNum != vid) {
+          vertices[weldedNum] = std::move(vertices[vid]);
+        }
+        ++weldedNum;
+      } else {
+        newIndex[vid] = newIndex[rep];
+      }
+    }
+    vertices.erase(vertices.begin() + weldedNum, vertices.end());
+
+    std::vector<Face>& faces = _faces.mutate();
+    unsigned int faceNum = 0;
+    for (std::size_t fid = 0; fid < faces.size(); ++fid) {
+      Face face = faces[fid];
+      for (unsigned int i = 0; i < 3; ++i) {
+        assert(face.vertices[i] < n);
+        face.vertices[i] = newIndex[face.vertices[i]];
+      }
+      if (face.vertices[0] == face.vertices[1]
+          || face.vertices[1] == face.vertices[2]
+          || face.vertices[2] == face.vertices[0]) {
+        continue;
+      }
+      faces[faceNum++] = face;
+    }
+    faces.erase(faces.begin() + faceNum, faces.end());
+  }
+
   bool TriangularMesh::isPopulated() const {
     return _isPopulated;
   }
 
+  CompressedMeshStorage::Stats TriangularMesh::compress(
+      CompressedMeshStorage::PositionPrecision precision) {
+    assert(isPopulated());
+    requireLists("TriangularMesh::compress()");
+    CompressedMeshStorage::Stats stats;
+    stats.originalBytes = _vertices.capacity() * sizeof(Vertex)
+        + _edges.capacity() * sizeof(Edge)
+        + _faces.capacity() * sizeof(Face);
+    std::vector<Vector3> positions;
+    positions.reserve(_vertices.size());
+    for (auto& v : _vertices) {
+      positions.push_back(v.pos);
+      stats.originalBytes += v.edges.capacity() * sizeof(unsigned int);
+    }
+    // Keep only normals actually used for interpolation, see normal().
+    bool isPhong = _faceNormalMode == TriangularMesh::FaceNormalMode::PHONG;
+    std::vector<Vector3> vertexNormals;
+    std::vector<Vector3> faceNormals;
+    std::vector<std::array<unsigned int, 3>> faces;
+    faces.reserve(_faces.size());
+    for (auto& f : _faces) {
+      faces.push_back(f.vertices);
+      if (!isPhong) {
+        faceNormals.push_back(f.normal);
+      }
+    }
+    if (isPhong) {
+      for (auto& v : _vertices) {
+        vertexNormals.push_back(v.normal);
+      }
+    }
+    auto compressed = std::make_shared<CompressedMeshStorage>(
+        positions, vertexNormals, faces, faceNormals, _boundingBox, precision);
+
+    // Measure the error introduced by quantization.
+    for (unsigned int vid = 0; vid < _vertices.size(); ++vid) {
+      stats.maxPositionError = std::max(stats.maxPositionError,
+          (compressed->pos(vid) - _vertices[vid].pos).len());
+      if (isPhong) {
+        double cosAngle = compressed->vertexNormal(vid) * _vertices[vid].normal.normalize();
+        stats.maxNormalError = std::max(stats.maxNormalError,
+            std::acos(std::max(-1.0, std::min(1.0, cosAngle))));
+      }
+    }
+    for (unsigned int fid = 0; fid < faceNormals.size(); ++fid) {
+      double cosAngle = compressed->faceNormal(fid) * faceNormals[fid].normalize();
+      stats.maxNormalError = std::max(stats.maxNormalError,
+          std::acos(std::max(-1.0, std::min(1.0, cosAngle))));
+    }
+    stats.compressedBytes = compressed->memoryBytes();
+
+    // Release the uncompressed lists, including their capacity.
+    _vertices.clear();
+    _edges.clear();
+    _faces.clear();
+    _compressed = compressed;
+    _invalidateCaches();
+    return stats;
+  }
+
+  void TriangularMesh::reorder(SpaceFillingCurve curve) {
+    assert(isPopulated());
+    requireLists("TriangularMesh::reorder()");
+    // Sort by curve index, breaking ties by the original index to keep the result deterministic.
+    std::vector<std::pair<uint64_t, unsigned int>> vertexKeys(_vertices.size());
+    std::vector<std::pair<uint64_t, unsigned int>> faceKeys(_faces.size());
+    parallelFor(0, _vertices.size(), [&](std::size_t begin, std::size_t end) {
+      for (std::size_t vid = begin; vid < end; ++vid) {
+        vertexKeys[vid] = std::make_pair(
+            spaceFillingCurveIndex(curve, _vertices[vid].pos, _boundingBox),
+            static_cast<unsigned int>(vid));
+      }
+    });
+    parallelFor(0, _faces.size(), [&](std::size_t begin, std::size_t end) {
+      for (std::size_t fid = begin; fid < end; ++fid) {
+        auto& vertices = _faces[fid].vertices;
+        Vector3 centroid = (_vertices[vertices[0]].pos + _vertices[vertices[1]].pos
+            + _vertices[vertices[2]].pos) / 3.0;
+        faceKeys[fid] = std::make_pair(
+            spaceFillingCurveIndex(curve, centroid, _boundingBox),
+            static_cast<unsigned int>(fid));
+      }
+    });
+    std::sort(vertexKeys.begin(), vertexKeys.end());
+    std::sort(faceKeys.begin(), faceKeys.end());
+
+    // Old-to-new index maps. The k-th half-edge of a face becomes half-edge (3 * fid + k) of
+    // the face at its new index fid.
+    std::vector<unsigned int> vertexMap(_vertices.size());
+    for (unsigned int vid = 0; vid < vertexKeys.size(); ++vid) {
+      vertexMap[vertexKeys[vid].second] = vid;
+    }
+    std::vector<unsigned int> edgeMap(_edges.size(), HD_INVALID_ID);
+    for (unsigned int fid = 0; fid < faceKeys.size(); ++fid) {
+      auto& edges = _faces[faceKeys[fid].second].edges;
+      for (unsigned int k = 0; k < 3; ++k) {
+        edgeMap[edges[k]] = fid * 3 + k;
+      }
+    }
+    auto mapEdge = [&](unsigned int eid) {
+      return eid == static_cast<unsigned int>(HD_INVALID_ID) ? eid : edgeMap[eid];
+    };
+
+    // Outgoing edge lists keep their size, so they are renumbered in place and handed over to
+    // the new vertices rather than reallocated, which would leave the old ones in the arena.
+    std::vector<Vertex>& oldVertices = _vertices.mutate();
+    std::vector<Vertex> vertices;
+    vertices.reserve(oldVertices.size());
+    for (auto& key : vertexKeys) {
+      Vertex& vertex = oldVertices[key.second];
+      vertices.push_back(Vertex(vertex.pos, vertex.normal));
+      auto& edges = vertices.back().edges;
+      edges = std::move(vertex.edges);
+      for (unsigned int& eid : edges) {
+        eid = edgeMap[eid];
+      }
+      std::sort(edges.begin(), edges.end());
+    }
+    std::vector<Edge> edges(_edges.size());
+    std::vector<Face> faces;
+    faces.reserve(_faces.size());
+    for (unsigned int fid = 0; fid < faceKeys.size(); ++fid) {
+      const Face& face = _faces[faceKeys[fid].second];
+      faces.push_back(Face({vertexMap[face.vertices[0]], vertexMap[face.vertices[1]],
+          vertexMap[face.vertices[2]]}, face.normal));
+      for (unsigned int k = 0; k < 3; ++k) {
+        const Edge& edge = _edges[face.edges[k]];
+        Edge& newEdge = edges[fid * 3 + k];
+        newEdge.startVertex = vertexMap[edge.startVertex];
+        newEdge.endVertex = vertexMap[edge.endVertex];
+        newEdge.face = fid;
+        newEdge.twinEdge = mapEdge(edge.twinEdge);
+        newEdge.nextEdge = mapEdge(edge.nextEdge);
+        newEdge.prevEdge = mapEdge(edge.prevEdge);
+        faces.back().edges[k] = fid * 3 + k;
+      }
+    }
+    _vertices.assign(std::move(vertices));
+    _edges.assign(std::move(edges));
+    _faces.assign(std::move(faces));
+    _invalidateCaches();
+  }
+
+  bool TriangularMesh::isCompressed() const {
+    return _compressed != nullptr;
+  }
+
+  std::unique_ptr<TriangularMesh> TriangularMesh::outOfCore(
+      const std::shared_ptr<ClusterStore>& store) {
+    assert(store != nullptr);
+    std::unique_ptr<TriangularMesh> mesh(new TriangularMesh());
+    mesh->_vertexNormalMode = store->vertexNormalMode();
+    mesh->_faceNormalMode = store->faceNormalMode();
+    mesh->_boundingBox = store->boundingBox3();
+    mesh->_clusterStore = store;
+    mesh->_isPopulated = true;
+    return mesh;
+  }
+
+  bool TriangularMesh::isOutOfCore() const {
+    return _clusterStore != nullptr;
+  }
+
+  void TriangularMesh::requireLists(const char* caller) const {
+    // Not an assert: the lists are empty rather than absent, so release builds would otherwise
+    // read past their end.
+    if (isCompressed() || isOutOfCore()) {
+      std::fprintf(stderr, "%s: not available on %s meshes.\n", caller,
+          isCompressed() ? "compressed" : "out-of-core");
+      std::abort();
+    }
+  }
+
+  bool TriangularMesh::sharesGeometryWith(const TriangularMesh& other) const {
+    return _vertices.buffer() == other._vertices.buffer()
+        && _edges.buffer() == other._edges.buffer()
+        && _faces.buffer() == other._faces.buffer()
+        && _compressed == other._compressed
+        && _clusterStore == other._clusterStore;
+  }
+
+  std::shared_ptr<Arena> TriangularMesh::arena() const {
+    return _arena;
+  }
+
+  MemoryUsage TriangularMesh::memoryUsage(MemoryCounter* counter) const {
+    MemoryCounter localCounter;
+    bool isStandalone = counter == nullptr;
+    if (isStandalone) {
+      counter = &localCounter;
+    }
+    MemoryUsage usage;
+    if (isCompressed()) {
+      if (counter->add(_compressed.get())) {
+        usage += _compressed->memoryUsage();
+      }
+    }
+    if (isOutOfCore() && counter->add(_clusterStore.get())) {
+      // Only resident pages are in memory, as a cache of the store file.
+      usage.caches += _clusterStore->stats().bytesResident;
+    }
+    if (counter->add(_vertices.buffer())) {
+      const std::vector<Vertex>& vertices = _vertices.get();
+      usage.positions += vertices.size() * sizeof(Vector3);
+      usage.normals += vertices.size() * sizeof(Vector3);
+      usage.adjacency += vertices.size() * (sizeof(Vertex) - 2 * sizeof(Vector3));
+      usage.slack += cowSlack(_vertices);
+      std::size_t arenaBytes = 0;
+      for (auto& vertex : vertices) {
+        std::size_t bytes = vertex.edges.size() * sizeof(unsigned int);
+        std::size_t capacityBytes = vertex.edges.capacity() * sizeof(unsigned int);
+        usage.adjacency += bytes;
+        if (vertex.edges.get_allocator().arena() == nullptr) {
+          usage.slack += heapSlack(vertex.edges);
+        } else {
+          usage.slack += capacityBytes - bytes;
+          arenaBytes += capacityBytes;
+        }
+      }
+      if (arenaBytes > 0) {
+        counter->addArenaBytes(_arena.get(), arenaBytes);
+      }
+    }
+    if (counter->add(_edges.buffer())) {
+      usage.topology += _edges.size() * sizeof(Edge);
+      usage.slack += cowSlack(_edges);
+    }
+    if (counter->add(_faces.buffer())) {
+      usage.normals += _faces.size() * sizeof(Vector3);
+      usage.topology += _faces.size() * (sizeof(Face) - sizeof(Vector3));
+      usage.slack += cowSlack(_faces);
+    }
+    auto areaTable = std::atomic_load(&_areaTable);
+    if (areaTable && counter->add(areaTable.get())) {
+      usage.caches += areaTable->memoryBytes();
+    }
+    if (isStandalone && _arena && _arena.use_count() == 1) {
+      usage.slack += counter->arenaSlack();
+    }
+    return usage;
+  }
+
   TriangularMesh::VertexNormalMode TriangularMesh::vertexNormalMode() const {
     return _vertexNormalMode;
   }
@@ -205,16 +984,24 @@ namespace hd {
 
   TriangularMesh::Builder::Builder(
       TriangularMesh::VertexNormalMode vertexNormalMode,
-      TriangularMesh::FaceNormalMode faceNormalMode) {
+      TriangularMesh::FaceNormalMode faceNormalMode) : _weldTolerance(-1.0) {
     _instance = std::unique_ptr<TriangularMesh>(new TriangularMesh());
     _instance->_vertexNormalMode = vertexNormalMode;
     _instance->_faceNormalMode = faceNormalMode;
   }
 
+  TriangularMesh::Builder& TriangularMesh::Builder::reserve(
+      unsigned int vertexNum, unsigned int faceNum) {
+    assert(!_instance->isPopulated());
+    _instance->_vertices.mutate().reserve(vertexNum);
+    _instance->_faces.mutate().reserve(faceNum);
+    return *this;
+  }
+
   TriangularMesh::Builder& TriangularMesh::Builder::addVertex(const Vector3& v) {
     assert(_instance->vertexNormalMode() != TriangularMesh::VertexNormalMode::USER_SPECIFIED);
     assert(!_instance->isPopulated());
-    _instance->_vertices.push_back(TriangularMesh::Vertex(v));
+    _instance->_vertices.mutate().push_back(TriangularMesh::Vertex(v));
     return *this;
   }
 
@@ -222,7 +1009,7 @@ namespace hd {
       const Vector3& v, const Vector3& vn) {
     assert(_instance->vertexNormalMode() == TriangularMesh::VertexNormalMode::USER_SPECIFIED);
     assert(!_instance->isPopulated());
-    _instance->_vertices.push_back(TriangularMesh::Vertex(v, vn));
+    _instance->_vertices.mutate().push_back(TriangularMesh::Vertex(v, vn));
     return *this;
   }
 
@@ -230,7 +1017,7 @@ namespace hd {
       const std::array<unsigned int, 3>& face) {
     assert(_instance->faceNormalMode() != TriangularMesh::FaceNormalMode::USER_SPECIFIED);
     assert(!_instance->isPopulated());
-    _instance->_faces.push_back(TriangularMesh::Face(face));
+    _instance->_faces.mutate().push_back(TriangularMesh::Face(face));
     return *this;
   }
 
@@ -238,15 +1025,252 @@ namespace hd {
       const std::array<unsigned int, 3>& face, const Vector3& fn) {
     assert(_instance->faceNormalMode() == TriangularMesh::FaceNormalMode::USER_SPECIFIED);
     assert(!_instance->isPopulated());
-    _instance->_faces.push_back(TriangularMesh::Face(face, fn));
+    _instance->_faces.mutate().push_back(TriangularMesh::Face(face, fn));
+    return *this;
+  }
+
+  TriangularMesh::Builder& TriangularMesh::Builder::addVertices(
+      const Vector3* positions, std::size_t count) {
+    assert(_instance->vertexNormalMode() != TriangularMesh::VertexNormalMode::USER_SPECIFIED);
+    assert(!_instance->isPopulated());
+    auto& vertices = _instance->_vertices.mutate();
+    reserveMore(vertices, count);
+    for (std::size_t i = 0; i < count; ++i) {
+      vertices.push_back(TriangularMesh::Vertex(positions[i]));
+    }
+    return *this;
+  }
+
+  TriangularMesh::Builder& TriangularMesh::Builder::addVertices(
+      const Vector3* positions, const Vector3* normals, std::size_t count) {
+    assert(_instance->vertexNormalMode() == TriangularMesh::VertexNormalMode::USER_SPECIFIED);
+    assert(!_instance->isPopulated());
+    auto& vertices = _instance->_vertices.mutate();
+    reserveMore(vertices, count);
+    for (std::size_t i = 0; i < count; ++i) {
+      vertices.push_back(TriangularMesh::Vertex(positions[i], normals[i]));
+    }
+    return *this;
+  }
+
+  TriangularMesh::Builder& TriangularMesh::Builder::addFaces(
+      const std::array<unsigned int, 3>* faces, std::size_t count) {
+    assert(_instance->faceNormalMode() != TriangularMesh::FaceNormalMode::USER_SPECIFIED);
+    assert(!_instance->isPopulated());
+    auto& instanceFaces = _instance->_faces.mutate();
+    reserveMore(instanceFaces, count);
+    for (std::size_t i = 0; i < count; ++i) {
+      instanceFaces.push_back(TriangularMesh::Face(faces[i]));
+    }
+    return *this;
+  }
+
+  TriangularMesh::Builder& TriangularMesh::Builder::addFaces(
+      const std::array<unsigned int, 3>* faces, const Vector3* normals, std::size_t count) {
+    assert(_instance->faceNormalMode() == TriangularMesh::FaceNormalMode::USER_SPECIFIED);
+    assert(!_instance->isPopulated());
+    auto& instanceFaces = _instance->_faces.mutate();
+    reserveMore(instanceFaces, count);
+    for (std::size_t i = 0; i < count; ++i) {
+      instanceFaces.push_back(TriangularMesh::Face(faces[i], normals[i]));
+    }
+    return *this;
+  }
+
+  TriangularMesh::Builder& TriangularMesh::Builder::setVertices(
+      std::vector<TriangularMesh::Vertex>&& vertices) {
+    assert(!_instance->isPopulated());
+    _instance->_vertices.assign(std::move(vertices));
+    // Outgoing half-edges are collected upon population.
+    for (auto& vertex : _instance->_vertices.mutate()) {
+      vertex.edges.clear();
+    }
+    return *this;
+  }
+
+  TriangularMesh::Builder& TriangularMesh::Builder::setFaces(
+      std::vector<TriangularMesh::Face>&& faces) {
+    assert(!_instance->isPopulated());
+    _instance->_faces.assign(std::move(faces));
+    return *this;
+  }
+
+  TriangularMesh::Builder& TriangularMesh::Builder::weldVertices(double tolerance) {
+    assert(tolerance > 0);
+    _weldTolerance = tolerance;
+    return *this;
+  }
+
+  TriangularMesh::Builder& TriangularMesh::Builder::setArena(
+      const std::shared_ptr<Arena>& arena) {
+    assert(!_instance->isPopulated());
+    _instance->_arena = arena;
     return *this;
   }
 
   std::unique_ptr<TriangularMesh> TriangularMesh::Builder::build(bool populate) {
+    if (_weldTolerance > 0 && !_instance->isPopulated()) {
+      _instance->_weldVertices(_weldTolerance);
+    }
     if (populate && !_instance->isPopulated()) {
       _instance->populate();
     }
     auto ptr = std::unique_ptr<TriangularMesh>(_instance.release());
     return ptr;
   }
+
+  TriangularMesh::Editor::Editor(TriangularMesh& mesh) : _mesh(mesh) {}
+
+  unsigned int TriangularMesh::Editor::addVertex(const Vector3& v) {
+    assert(_mesh.vertexNormalMode() != TriangularMesh::VertexNormalMode::USER_SPECIFIED);
+    _addedVertices.push_back(TriangularMesh::Vertex(v));
+    return _mesh.vertexNum() + _addedVertices.size() - 1;
+  }
+
+  unsigned int TriangularMesh::Editor::addVertex(const Vector3& v, const Vector3& vn) {
+    assert(_mesh.vertexNormalMode() == TriangularMesh::VertexNormalMode::USER_SPECIFIED);
+    _addedVertices.push_back(TriangularMesh::Vertex(v, vn));
+    return _mesh.vertexNum() + _addedVertices.size() - 1;
+  }
+
+  TriangularMesh::Editor& TriangularMesh::Editor::moveVertex(
+      unsigned int vid, const Vector3& v) {
+    assert(vid < _mesh.vertexNum() + _addedVertices.size());
+    VertexMove move;
+    move.vid = vid;
+    move.pos = v;
+    move.hasNormal = false;
+    _movedVertices.push_back(move);
+    return *this;
+  }
+
+  TriangularMesh::Editor& TriangularMesh::Editor::moveVertex(
+      unsigned int vid, const Vector3& v, const Vector3& vn) {
+    assert(_mesh.vertexNormalMode() == TriangularMesh::VertexNormalMode::USER_SPECIFIED);
+    assert(vid < _mesh.vertexNum() + _addedVertices.size());
+    VertexMove move;
+    move.vid = vid;
+    move.pos = v;
+    move.normal = vn;
+    move.hasNormal = true;
+    _movedVertices.push_back(move);
+    return *this;
+  }
+
+  TriangularMesh::Editor& TriangularMesh::Editor::addFace(
+      const std::array<unsigned int, 3>& face) {
+    assert(_mesh.faceNormalMode() != TriangularMesh::FaceNormalMode::USER_SPECIFIED);
+    _addedFaces.push_back(TriangularMesh::Face(face));
+    return *this;
+  }
+
+  TriangularMesh::Editor& TriangularMesh::Editor::addFace(
+      const std::array<unsigned int, 3>& face, const Vector3& fn) {
+    assert(_mesh.faceNormalMode() == TriangularMesh::FaceNormalMode::USER_SPECIFIED);
+    _addedFaces.push_back(TriangularMesh::Face(face, fn));
+    return *this;
+  }
+
+  TriangularMesh::Editor& TriangularMesh::Editor::removeFace(unsigned int fid) {
+    assert(fid < _mesh.faceNum());
+    _removedFaces.push_back(fid);
+    return *this;
+  }
+
+  void TriangularMesh::Editor::commit() {
+    assert(_mesh.isPopulated());
+    assert(!_mesh.isCompressed());
+    std::vector<Vertex>& vertices = _mesh._vertices.mutate();
+    // Faces and vertices whose normals must be recomputed, possibly with duplicates.
+    std::vector<unsigned int> dirtyFaces;
+    std::vector<unsigned int> dirtyVertices;
+    const Vector3 oldMinBound = _mesh._boundingBox.minCorner();
+    const Vector3 oldMaxBound = _mesh._boundingBox.maxCorner();
+    Vector3 minBound = oldMinBound;
+    Vector3 maxBound = oldMaxBound;
+    // The bounding box of an empty mesh does not bound anything yet.
+    bool isBoundingBoxStale = vertices.empty();
+    auto growBoundingBox = [&](const Vector3& p) {
+      for (unsigned int i = 0; i < 3; ++i) {
+        minBound[i] = std::min(minBound[i], p[i]);
+        maxBound[i] = std::max(maxBound[i], p[i]);
+      }
+    };
+
+    for (auto& vertex : _addedVertices) {
+      dirtyVertices.push_back(vertices.size());
+      growBoundingBox(vertex.pos);
+      vertices.push_back(std::move(vertex));
+    }
+
+    // Remove faces from the highest index down, so that faces moved into freed slots are never
+    // among those still to be removed.
+    std::sort(_removedFaces.begin(), _removedFaces.end(), std::greater<unsigned int>());
+    _removedFaces.erase(std::unique(_removedFaces.begin(), _removedFaces.end()),
+        _removedFaces.end());
+    for (unsigned int fid : _removedFaces) {
+      for (unsigned int vid : _mesh._faces[fid].vertices) {
+        dirtyVertices.push_back(vid);
+      }
+      _mesh._removeFace(fid);
+    }
+
+    for (auto& move : _movedVertices) {
+      Vertex& vertex = vertices[move.vid];
+      for (unsigned int i = 0; i < 3; ++i) {
+        if (vertex.pos[i] == oldMinBound[i] || vertex.pos[i] == oldMaxBound[i]) {
+          isBoundingBoxStale = true;
+        }
+      }
+      vertex.pos = move.pos;
+      if (move.hasNormal) {
+        vertex.normal = move.normal;
+      }
+      growBoundingBox(move.pos);
+      dirtyVertices.push_back(move.vid);
+      for (unsigned int eid : vertex.edges) {
+        dirtyFaces.push_back(_mesh._edges[eid].face);
+      }
+    }
+
+    for (auto& face : _addedFaces) {
+      for (unsigned int vid : face.vertices) {
+        assert(vid < vertices.size());
+      }
+      dirtyFaces.push_back(_mesh.faceNum());
+      _mesh._appendFace(face);
+    }
+
+    std::sort(dirtyFaces.begin(), dirtyFaces.end());
+    dirtyFaces.erase(std::unique(dirtyFaces.begin(), dirtyFaces.end()), dirtyFaces.end());
+    for (unsigned int fid : dirtyFaces) {
+      if (_mesh._faceNormalMode != TriangularMesh::FaceNormalMode::USER_SPECIFIED) {
+        _mesh._populateFaceNormal(fid);
+      }
+      // Averaged normals of all vertices of the face depend on its normal.
+      for (unsigned int vid : _mesh._faces[fid].vertices) {
+        dirtyVertices.push_back(vid);
+      }
+    }
+    if (_mesh._vertexNormalMode != TriangularMesh::VertexNormalMode::USER_SPECIFIED) {
+      std::sort(dirtyVertices.begin(), dirtyVertices.end());
+      dirtyVertices.erase(std::unique(dirtyVertices.begin(), dirtyVertices.end()),
+          dirtyVertices.end());
+      for (unsigned int vid : dirtyVertices) {
+        _mesh._populateVertexNormal(vid);
+      }
+    }
+
+    if (isBoundingBoxStale) {
+      _mesh._populateBoundingBox();
+    } else {
+      _mesh._boundingBox = BoundingBox3(minBound, maxBound);
+    }
+    _mesh._invalidateCaches();
+
+    _addedVertices.clear();
+    _movedVertices.clear();
+    _addedFaces.clear();
+    _removedFaces.clear();
+  }
 }
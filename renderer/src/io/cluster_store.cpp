@@ -0,0 +1,417 @@
+#include "io/cluster_store.h"
+#include "const.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#define HD_HAS_PREAD 0
+#else
+#define HD_HAS_PREAD 1
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace hd {
+  namespace {
+    const char CLUSTER_FILE_MAGIC[8] = {'H', 'D', 'C', 'L', 'S', 'T', '\0', '\0'};
+    // Written in native byte order. Reading it back as anything else means the file was written
+    // on a machine of different endianness.
+    const uint32_t CLUSTER_FILE_ENDIANNESS_TAG = 0x01020304;
+
+    class ClusterFileHeader {
+      public:
+        char magic[8];
+        uint32_t version;
+        uint32_t endiannessTag;
+        uint32_t vertexNormalMode;
+        uint32_t faceNormalMode;
+        uint32_t clusterNum;
+        uint32_t faceNum;
+        double boundingBox[6];
+    };
+    static_assert(sizeof(ClusterFileHeader) % 8 == 0,
+        "Cluster file header must be 8-byte aligned.");
+
+    class ClusterRecord {
+      public:
+        double boundingBox[6];
+        double center[3];
+        double radius;
+        double coneAxis[3];
+        double coneCosAngle;
+        uint64_t offset;
+        uint32_t faceNum;
+        uint32_t vertexNum;
+    };
+    static_assert(sizeof(ClusterRecord) == 128, "Unexpected padding in cluster records.");
+
+    uint64_t alignTo8(uint64_t size) {
+      return (size + 7) & ~static_cast<uint64_t>(7);
+    }
+
+    // Size in bytes of the page of a cluster with given element counts.
+    uint64_t pageSize(unsigned int vertexNum, unsigned int faceNum, bool isPhong) {
+      uint64_t normalNum = isPhong ? vertexNum : faceNum;
+      return (vertexNum + normalNum) * 3 * sizeof(double)
+          + alignTo8(faceNum * sizeof(uint32_t) + faceNum * 3 * sizeof(uint8_t));
+    }
+
+    void putVector(std::vector<char>& buffer, const Vector3& v) {
+      double record[3] = {v.x, v.y, v.z};
+      buffer.insert(buffer.end(), reinterpret_cast<const char*>(record),
+          reinterpret_cast<const char*>(record) + sizeof(record));
+    }
+
+    Vector3 getVector(const char* data) {
+      double record[3];
+      std::memcpy(record, data, sizeof(record));
+      return Vector3(record[0], record[1], record[2]);
+    }
+  }
+
+  Triangle3 ClusterStore::Page::triangle(unsigned int localFace) const {
+    assert(localFace < faceNum());
+    const uint8_t* t = &localTriangles[localFace * 3];
+    return Triangle3(positions[t[0]], positions[t[1]], positions[t[2]]);
+  }
+
+  Vector3 ClusterStore::Page::normal(unsigned int localFace, const Vector3& params) const {
+    assert(localFace < faceNum());
+    if (!isPhong) {
+      return faceNormals[localFace];
+    }
+    const uint8_t* t = &localTriangles[localFace * 3];
+    Vector3 avgNormal = Vector3::zero();
+    for (unsigned int i = 0; i < 3; ++i) {
+      avgNormal += params[i] * vertexNormals[t[i]];
+    }
+    return avgNormal.normalize();
+  }
+
+  std::size_t ClusterStore::Page::memoryBytes() const {
+    return sizeof(Page)
+        + (positions.capacity() + vertexNormals.capacity() + faceNormals.capacity())
+            * sizeof(Vector3)
+        + faceIds.capacity() * sizeof(unsigned int)
+        + localTriangles.capacity() * sizeof(uint8_t);
+  }
+
+  ClusterStore::ClusterStore() : _fd(-1),
+      _vertexNormalMode(TriangularMesh::VertexNormalMode::AVERAGED),
+      _faceNormalMode(TriangularMesh::FaceNormalMode::FLAT), _isPhong(false), _faceNum(0),
+      _memoryBudget(0) {}
+
+  ClusterStore::~ClusterStore() {
+#if HD_HAS_PREAD
+    if (_fd >= 0) {
+      ::close(_fd);
+    }
+#endif
+  }
+
+  bool ClusterStore::write(const TriangularMesh& mesh, const std::vector<MeshCluster>& clusters,
+      const std::string& path) {
+    assert(mesh.isPopulated());
+    assert(!mesh.isCompressed());
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+    bool isPhong = mesh.faceNormalMode() == TriangularMesh::FaceNormalMode::PHONG;
+
+    ClusterFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CLUSTER_FILE_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.endiannessTag = CLUSTER_FILE_ENDIANNESS_TAG;
+    header.vertexNormalMode = static_cast<uint32_t>(mesh.vertexNormalMode());
+    header.faceNormalMode = static_cast<uint32_t>(mesh.faceNormalMode());
+    header.clusterNum = clusters.size();
+    header.faceNum = mesh.faceNum();
+    BoundingBox3 box = mesh.boundingBox3();
+    for (int i = 0; i < 3; ++i) {
+      header.boundingBox[i] = box.minCorner()[i];
+      header.boundingBox[i + 3] = box.maxCorner()[i];
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    uint64_t offset = sizeof(ClusterFileHeader) + clusters.size() * sizeof(ClusterRecord);
+    for (auto& cluster : clusters) {
+      assert(cluster.localTriangles.size() == cluster.faces.size() * 3);
+      ClusterRecord record;
+      std::memset(&record, 0, sizeof(record));
+      for (int i = 0; i < 3; ++i) {
+        record.boundingBox[i] = cluster.boundingBox.minCorner()[i];
+        record.boundingBox[i + 3] = cluster.boundingBox.maxCorner()[i];
+        record.center[i] = cluster.center[i];
+        record.coneAxis[i] = cluster.coneAxis[i];
+      }
+      record.radius = cluster.radius;
+      record.coneCosAngle = cluster.coneCosAngle;
+      record.offset = offset;
+      record.faceNum = cluster.faces.size();
+      record.vertexNum = cluster.vertices.size();
+      out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+      offset += pageSize(record.vertexNum, record.faceNum, isPhong);
+    }
+
+    std::vector<char> buffer;
+    for (auto& cluster : clusters) {
+      buffer.clear();
+      for (unsigned int vid : cluster.vertices) {
+        putVector(buffer, mesh.v(vid).pos);
+      }
+      if (isPhong) {
+        for (unsigned int vid : cluster.vertices) {
+          putVector(buffer, mesh.v(vid).normal);
+        }
+      } else {
+        for (unsigned int fid : cluster.faces) {
+          putVector(buffer, mesh.f(fid).normal);
+        }
+      }
+      for (unsigned int fid : cluster.faces) {
+        uint32_t id = fid;
+        buffer.insert(buffer.end(), reinterpret_cast<const char*>(&id),
+            reinterpret_cast<const char*>(&id) + sizeof(id));
+      }
+      buffer.insert(buffer.end(), cluster.localTriangles.begin(), cluster.localTriangles.end());
+      buffer.resize(alignTo8(buffer.size()), 0);
+      assert(buffer.size() == pageSize(cluster.vertices.size(), cluster.faces.size(), isPhong));
+      out.write(buffer.data(), buffer.size());
+    }
+    out.flush();
+    return static_cast<bool>(out);
+  }
+
+  std::unique_ptr<ClusterStore> ClusterStore::open(const std::string& path,
+      std::size_t memoryBudget) {
+    std::ifstream in(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!in) {
+      return nullptr;
+    }
+    uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+    ClusterFileHeader header;
+    if (fileSize < sizeof(header) || !in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+      return nullptr;
+    }
+    if (std::memcmp(header.magic, CLUSTER_FILE_MAGIC, sizeof(header.magic)) != 0
+        || header.endiannessTag != CLUSTER_FILE_ENDIANNESS_TAG
+        || header.version != VERSION
+        || header.vertexNormalMode
+            > static_cast<uint32_t>(TriangularMesh::VertexNormalMode::AVERAGED)
+        || header.faceNormalMode > static_cast<uint32_t>(TriangularMesh::FaceNormalMode::PHONG)) {
+      return nullptr;
+    }
+
+    std::unique_ptr<ClusterStore> store(new ClusterStore());
+    store->_path = path;
+    store->_vertexNormalMode =
+        static_cast<TriangularMesh::VertexNormalMode>(header.vertexNormalMode);
+    store->_faceNormalMode = static_cast<TriangularMesh::FaceNormalMode>(header.faceNormalMode);
+    store->_isPhong =
+        header.faceNormalMode == static_cast<uint32_t>(TriangularMesh::FaceNormalMode::PHONG);
+    store->_faceNum = header.faceNum;
+    store->_boundingBox = BoundingBox3(
+        Vector3(header.boundingBox[0], header.boundingBox[1], header.boundingBox[2]),
+        Vector3(header.boundingBox[3], header.boundingBox[4], header.boundingBox[5]));
+    store->_memoryBudget = memoryBudget;
+    store->_entries.resize(header.clusterNum);
+    store->_firstFaces.reserve(header.clusterNum + 1);
+    uint64_t faceNum = 0;
+    for (auto& entry : store->_entries) {
+      store->_firstFaces.push_back(static_cast<unsigned int>(faceNum));
+      ClusterRecord record;
+      if (!in.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        return nullptr;
+      }
+      entry.bounds.boundingBox = BoundingBox3(
+          Vector3(record.boundingBox[0], record.boundingBox[1], record.boundingBox[2]),
+          Vector3(record.boundingBox[3], record.boundingBox[4], record.boundingBox[5]));
+      entry.bounds.center = Vector3(record.center[0], record.center[1], record.center[2]);
+      entry.bounds.radius = record.radius;
+      entry.bounds.coneAxis = Vector3(record.coneAxis[0], record.coneAxis[1], record.coneAxis[2]);
+      entry.bounds.coneCosAngle = record.coneCosAngle;
+      entry.offset = record.offset;
+      entry.faceNum = record.faceNum;
+      entry.vertexNum = record.vertexNum;
+      entry.size = pageSize(record.vertexNum, record.faceNum, store->_isPhong);
+      if (record.vertexNum > 256 || entry.offset + entry.size > fileSize) {
+        return nullptr;
+      }
+      faceNum += record.faceNum;
+      if (faceNum > header.faceNum) {
+        return nullptr;
+      }
+    }
+    if (faceNum != header.faceNum) {
+      return nullptr;
+    }
+    store->_firstFaces.push_back(header.faceNum);
+#if HD_HAS_PREAD
+    store->_fd = ::open(path.c_str(), O_RDONLY);
+    if (store->_fd < 0) {
+      return nullptr;
+    }
+#endif
+    return store;
+  }
+
+  const MeshCluster& ClusterStore::bounds(unsigned int clusterId) const {
+    assert(clusterId < clusterNum());
+    return _entries[clusterId].bounds;
+  }
+
+  unsigned int ClusterStore::firstFace(unsigned int clusterId) const {
+    assert(clusterId < clusterNum());
+    return _firstFaces[clusterId];
+  }
+
+  void ClusterStore::locate(unsigned int faceId, unsigned int& clusterId,
+      unsigned int& localFace) const {
+    assert(faceId < _faceNum);
+    // The last cluster starting at or before the face, skipping empty clusters.
+    auto next = std::upper_bound(_firstFaces.begin(), _firstFaces.end(), faceId);
+    clusterId = static_cast<unsigned int>(next - _firstFaces.begin()) - 1;
+    localFace = faceId - _firstFaces[clusterId];
+  }
+
+  std::shared_ptr<const ClusterStore::Page> ClusterStore::page(unsigned int clusterId) {
+    assert(clusterId < clusterNum());
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      Entry& entry = _entries[clusterId];
+      if (entry.page != nullptr) {
+        ++_stats.hits;
+        _lru.splice(_lru.begin(), _lru, entry.lruPosition);
+        return entry.page;
+      }
+    }
+    // Read without holding the lock, so that other threads can be served meanwhile.
+    std::shared_ptr<const Page> page = _load(clusterId);
+    if (page == nullptr) {
+      return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    Entry& entry = _entries[clusterId];
+    if (entry.page != nullptr) {
+      // Another thread paged the same cluster in concurrently. Keep its copy, so that this
+      // access is eventually served from the cache.
+      ++_stats.hits;
+      _lru.splice(_lru.begin(), _lru, entry.lruPosition);
+      return entry.page;
+    }
+    ++_stats.pageIns;
+    _stats.bytesPagedIn += page->memoryBytes();
+    entry.page = page;
+    _lru.push_front(clusterId);
+    entry.lruPosition = _lru.begin();
+    ++_stats.residentPages;
+    _stats.bytesResident += page->memoryBytes();
+    _evict();
+    return page;
+  }
+
+  std::shared_ptr<const ClusterStore::Page> ClusterStore::requirePage(unsigned int clusterId) {
+    std::shared_ptr<const Page> page = this->page(clusterId);
+    if (page == nullptr) {
+      std::fprintf(stderr, "Cannot read page of cluster %u from %s.\n", clusterId,
+          _path.c_str());
+      std::abort();
+    }
+    return page;
+  }
+
+  bool ClusterStore::isResident(unsigned int clusterId) const {
+    assert(clusterId < clusterNum());
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries[clusterId].page != nullptr;
+  }
+
+  std::size_t ClusterStore::memoryBudget() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _memoryBudget;
+  }
+
+  void ClusterStore::setMemoryBudget(std::size_t memoryBudget) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _memoryBudget = memoryBudget;
+    _evict();
+  }
+
+  ClusterStore::Stats ClusterStore::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+  }
+
+  std::shared_ptr<const ClusterStore::Page> ClusterStore::_load(unsigned int clusterId) const {
+    const Entry& entry = _entries[clusterId];
+    std::vector<char> buffer(entry.size);
+    if (!_read(entry.offset, buffer.data(), buffer.size())) {
+      return nullptr;
+    }
+    std::shared_ptr<Page> page = std::make_shared<Page>();
+    page->isPhong = _isPhong;
+    const char* data = buffer.data();
+    page->positions.resize(entry.vertexNum);
+    for (auto& p : page->positions) {
+      p = getVector(data);
+      data += 3 * sizeof(double);
+    }
+    auto& normals = _isPhong ? page->vertexNormals : page->faceNormals;
+    normals.resize(_isPhong ? entry.vertexNum : entry.faceNum);
+    for (auto& n : normals) {
+      n = getVector(data);
+      data += 3 * sizeof(double);
+    }
+    page->faceIds.resize(entry.faceNum);
+    for (auto& fid : page->faceIds) {
+      uint32_t id;
+      std::memcpy(&id, data, sizeof(id));
+      fid = id;
+      data += sizeof(id);
+    }
+    page->localTriangles.assign(data, data + entry.faceNum * 3);
+    for (uint8_t index : page->localTriangles) {
+      if (index >= entry.vertexNum) {
+        return nullptr;
+      }
+    }
+    return page;
+  }
+
+  bool ClusterStore::_read(uint64_t offset, char* buffer, std::size_t size) const {
+#if HD_HAS_PREAD
+    // pread does not move the file offset, so concurrent reads need no synchronization.
+    std::size_t done = 0;
+    while (done < size) {
+      ssize_t n = ::pread(_fd, buffer + done, size - done, static_cast<off_t>(offset + done));
+      if (n <= 0) {
+        return false;
+      }
+      done += static_cast<std::size_t>(n);
+    }
+    return true;
+#else
+    std::ifstream in(_path, std::ios::in | std::ios::binary);
+    in.seekg(static_cast<std::streamoff>(offset));
+    return static_cast<bool>(in.read(buffer, size));
+#endif
+  }
+
+  void ClusterStore::_evict() {
+    while (_stats.bytesResident > _memoryBudget && _lru.size() > 1) {
+      Entry& entry = _entries[_lru.back()];
+      _lru.pop_back();
+      _stats.bytesResident -= entry.page->memoryBytes();
+      --_stats.residentPages;
+      ++_stats.evictions;
+      entry.page.reset();
+    }
+  }
+}
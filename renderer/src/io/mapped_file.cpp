@@ -0,0 +1,74 @@
+#include "io/mapped_file.h"
+#include <fstream>
+
+#if defined(_WIN32)
+#define HD_HAS_MMAP 0
+#else
+#define HD_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace hd {
+  MappedFile::~MappedFile() {
+    close();
+  }
+
+  bool MappedFile::open(const std::string& path) {
+    close();
+#if HD_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+      ::close(fd);
+      return false;
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+      return false;
+    }
+    _data = static_cast<const char*>(addr);
+    _size = static_cast<std::size_t>(st.st_size);
+    return true;
+#else
+    std::ifstream in(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!in) {
+      return false;
+    }
+    std::streamsize size = in.tellg();
+    if (size <= 0) {
+      return false;
+    }
+    _buffer.resize(static_cast<std::size_t>(size));
+    in.seekg(0);
+    if (!in.read(_buffer.data(), size)) {
+      _buffer.clear();
+      return false;
+    }
+    _data = _buffer.data();
+    _size = _buffer.size();
+    return true;
+#endif
+  }
+
+  void MappedFile::close() {
+    if (_data == nullptr) {
+      return;
+    }
+#if HD_HAS_MMAP
+    munmap(const_cast<char*>(_data), _size);
+#else
+    _buffer.clear();
+    _buffer.shrink_to_fit();
+#endif
+    _data = nullptr;
+    _size = 0;
+  }
+}
@@ -0,0 +1,345 @@
+#include "io/mesh_serializer.h"
+#include "io/mapped_file.h"
+#include "const.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace hd {
+  namespace {
+    const char MESH_FILE_MAGIC[8] = {'H', 'D', 'M', 'E', 'S', 'H', '\0', '\0'};
+    // Written in native byte order. Reading it back as anything else means the file was written
+    // on a machine of different endianness.
+    const uint32_t MESH_FILE_ENDIANNESS_TAG = 0x01020304;
+    const uint32_t MESH_FILE_FLAG_CHECKSUM = 1;
+
+    // FNV-1a parameters, applied to 64-bit words rather than single bytes for throughput.
+    const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+    const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+    class MeshFileHeader {
+      public:
+        char magic[8];
+        uint32_t version;
+        uint32_t endiannessTag;
+        uint32_t flags;
+        uint32_t vertexNormalMode;
+        uint32_t faceNormalMode;
+        uint32_t reserved;
+        uint64_t vertexNum;
+        uint64_t edgeNum;
+        uint64_t faceNum;
+        // Total number of entries in all vertices' outgoing half-edge lists.
+        uint64_t adjacencyNum;
+        double boundingBox[6];
+        // Checksum of the whole payload following the header. Zero if not computed.
+        uint64_t checksum;
+    };
+    static_assert(sizeof(MeshFileHeader) % 8 == 0, "Mesh file header must be 8-byte aligned.");
+
+    class EdgeRecord {
+      public:
+        uint32_t startVertex;
+        uint32_t endVertex;
+        uint32_t face;
+        uint32_t twinEdge;
+        uint32_t nextEdge;
+        uint32_t prevEdge;
+    };
+    static_assert(sizeof(EdgeRecord) == 24, "Unexpected padding in edge records.");
+
+    class FaceRecord {
+      public:
+        uint32_t vertices[3];
+        uint32_t edges[3];
+        double normal[3];
+    };
+    static_assert(sizeof(FaceRecord) == 48, "Unexpected padding in face records.");
+
+    uint64_t alignTo8(uint64_t size) {
+      return (size + 7) & ~static_cast<uint64_t>(7);
+    }
+
+    // Size in bytes of each payload section given the element counts of a header.
+    uint64_t vertexSectionSize(const MeshFileHeader& h) {
+      return h.vertexNum * 6 * sizeof(double);
+    }
+    uint64_t offsetSectionSize(const MeshFileHeader& h) {
+      return alignTo8((h.vertexNum + 1) * sizeof(uint32_t));
+    }
+    uint64_t adjacencySectionSize(const MeshFileHeader& h) {
+      return alignTo8(h.adjacencyNum * sizeof(uint32_t));
+    }
+    uint64_t edgeSectionSize(const MeshFileHeader& h) {
+      return h.edgeNum * sizeof(EdgeRecord);
+    }
+    uint64_t faceSectionSize(const MeshFileHeader& h) {
+      return h.faceNum * sizeof(FaceRecord);
+    }
+
+    // Elements are referred to by 32-bit indices, and HD_INVALID_ID is reserved. Counts within
+    // this bound also keep the section sizes computed from them far from overflowing.
+    const uint64_t MAX_ELEMENT_NUM = static_cast<uint32_t>(HD_INVALID_ID);
+
+    uint64_t updateChecksum(uint64_t hash, const char* data, std::size_t size) {
+      assert(size % 8 == 0);
+      for (std::size_t i = 0; i < size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash ^= word;
+        hash *= FNV_PRIME;
+      }
+      return hash;
+    }
+
+    /**
+     * Buffered writer of the payload, which checksums data as it is flushed. The buffer capacity
+     * is a multiple of 8 and the payload is padded to 8 bytes, so checksums are always computed
+     * over whole words.
+     */
+    class PayloadWriter {
+      private:
+        std::ofstream& _out;
+        std::vector<char> _buffer;
+        std::size_t _len;
+        bool _withChecksum;
+        uint64_t _checksum;
+
+      public:
+        PayloadWriter(std::ofstream& out, bool withChecksum)
+            : _out(out), _buffer(1 << 20), _len(0), _withChecksum(withChecksum),
+              _checksum(FNV_OFFSET_BASIS) {}
+
+        void put(const void* data, std::size_t size) {
+          const char* p = static_cast<const char*>(data);
+          while (size > 0) {
+            std::size_t n = std::min(size, _buffer.size() - _len);
+            std::memcpy(_buffer.data() + _len, p, n);
+            _len += n;
+            p += n;
+            size -= n;
+            if (_len == _buffer.size()) {
+              flush();
+            }
+          }
+        }
+
+        template <typename T>
+        void put(const T& value) {
+          put(&value, sizeof(T));
+        }
+
+        // Pad with zeros up to the next 8-byte boundary, given the size of the section so far.
+        void pad(uint64_t sectionSize) {
+          static const char zeros[8] = {0};
+          put(zeros, alignTo8(sectionSize) - sectionSize);
+        }
+
+        void flush() {
+          if (_withChecksum) {
+            _checksum = updateChecksum(_checksum, _buffer.data(), _len);
+          }
+          _out.write(_buffer.data(), _len);
+          _len = 0;
+        }
+
+        uint64_t checksum() const { return _withChecksum ? _checksum : 0; }
+    };
+  }
+
+  bool MeshSerializer::write(const TriangularMesh& mesh, const std::string& path,
+      bool withChecksum) {
+    assert(mesh.isPopulated());
+    // Compressed and out-of-core meshes have empty lists, which would be written as an empty
+    // mesh.
+    if (mesh.isCompressed() || mesh.isOutOfCore()) {
+      return false;
+    }
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+
+    MeshFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MESH_FILE_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.endiannessTag = MESH_FILE_ENDIANNESS_TAG;
+    header.flags = withChecksum ? MESH_FILE_FLAG_CHECKSUM : 0;
+    header.vertexNormalMode = static_cast<uint32_t>(mesh._vertexNormalMode);
+    header.faceNormalMode = static_cast<uint32_t>(mesh._faceNormalMode);
+    header.vertexNum = mesh._vertices.size();
+    header.edgeNum = mesh._edges.size();
+    header.faceNum = mesh._faces.size();
+    for (auto& v : mesh._vertices) {
+      header.adjacencyNum += v.edges.size();
+    }
+    Vector3 minCorner = mesh._boundingBox.minCorner();
+    Vector3 maxCorner = mesh._boundingBox.maxCorner();
+    for (int i = 0; i < 3; ++i) {
+      header.boundingBox[i] = minCorner[i];
+      header.boundingBox[i + 3] = maxCorner[i];
+    }
+    // The checksum is unknown until the payload is written. Write a placeholder header first
+    // and rewrite it at the end.
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    PayloadWriter writer(out, withChecksum);
+    for (auto& v : mesh._vertices) {
+      double record[6] = {v.pos.x, v.pos.y, v.pos.z, v.normal.x, v.normal.y, v.normal.z};
+      writer.put(record);
+    }
+    uint32_t offset = 0;
+    writer.put(offset);
+    for (auto& v : mesh._vertices) {
+      offset += v.edges.size();
+      writer.put(offset);
+    }
+    writer.pad((header.vertexNum + 1) * sizeof(uint32_t));
+    for (auto& v : mesh._vertices) {
+      for (unsigned int eid : v.edges) {
+        writer.put(static_cast<uint32_t>(eid));
+      }
+    }
+    writer.pad(header.adjacencyNum * sizeof(uint32_t));
+    for (auto& e : mesh._edges) {
+      EdgeRecord record = {
+        e.startVertex, e.endVertex, e.face, e.twinEdge, e.nextEdge, e.prevEdge
+      };
+      writer.put(record);
+    }
+    for (auto& f : mesh._faces) {
+      FaceRecord record;
+      for (int i = 0; i < 3; ++i) {
+        record.vertices[i] = f.vertices[i];
+        record.edges[i] = f.edges[i];
+        record.normal[i] = f.normal[i];
+      }
+      writer.put(record);
+    }
+    writer.flush();
+
+    header.checksum = writer.checksum();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.flush();
+    return static_cast<bool>(out);
+  }
+
+  std::unique_ptr<TriangularMesh> MeshSerializer::read(const std::string& path,
+      bool verifyChecksum) {
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(MeshFileHeader)) {
+      return nullptr;
+    }
+    MeshFileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, MESH_FILE_MAGIC, sizeof(header.magic)) != 0
+        || header.endiannessTag != MESH_FILE_ENDIANNESS_TAG
+        || header.version != VERSION
+        || header.vertexNormalMode > static_cast<uint32_t>(TriangularMesh::VertexNormalMode::AVERAGED)
+        || header.faceNormalMode > static_cast<uint32_t>(TriangularMesh::FaceNormalMode::PHONG)
+        || header.vertexNum >= MAX_ELEMENT_NUM || header.edgeNum >= MAX_ELEMENT_NUM
+        || header.faceNum >= MAX_ELEMENT_NUM || header.adjacencyNum >= MAX_ELEMENT_NUM) {
+      return nullptr;
+    }
+    uint64_t payloadSize = vertexSectionSize(header)
+        + offsetSectionSize(header)
+        + adjacencySectionSize(header)
+        + edgeSectionSize(header)
+        + faceSectionSize(header);
+    if (file.size() != sizeof(MeshFileHeader) + payloadSize) {
+      return nullptr;
+    }
+    const char* payload = file.data() + sizeof(MeshFileHeader);
+    if (verifyChecksum && (header.flags & MESH_FILE_FLAG_CHECKSUM)
+        && updateChecksum(FNV_OFFSET_BASIS, payload, payloadSize) != header.checksum) {
+      return nullptr;
+    }
+
+    const char* vertexData = payload;
+    const char* offsetData = vertexData + vertexSectionSize(header);
+    const char* adjacencyData = offsetData + offsetSectionSize(header);
+    const char* edgeData = adjacencyData + adjacencySectionSize(header);
+    const char* faceData = edgeData + edgeSectionSize(header);
+
+    std::unique_ptr<TriangularMesh> mesh(new TriangularMesh());
+    mesh->_vertexNormalMode =
+        static_cast<TriangularMesh::VertexNormalMode>(header.vertexNormalMode);
+    mesh->_faceNormalMode = static_cast<TriangularMesh::FaceNormalMode>(header.faceNormalMode);
+    mesh->_boundingBox = BoundingBox3(
+        Vector3(header.boundingBox[0], header.boundingBox[1], header.boundingBox[2]),
+        Vector3(header.boundingBox[3], header.boundingBox[4], header.boundingBox[5]));
+
+    std::vector<TriangularMesh::Vertex>& vertices = mesh->_vertices.mutate();
+    vertices.reserve(header.vertexNum);
+    uint32_t begin;
+    std::memcpy(&begin, offsetData, sizeof(uint32_t));
+    for (uint64_t vid = 0; vid < header.vertexNum; ++vid) {
+      double record[6];
+      std::memcpy(record, vertexData + vid * sizeof(record), sizeof(record));
+      uint32_t end;
+      std::memcpy(&end, offsetData + (vid + 1) * sizeof(uint32_t), sizeof(uint32_t));
+      if (end < begin || end > header.adjacencyNum) {
+        return nullptr;
+      }
+      TriangularMesh::Vertex v(
+          Vector3(record[0], record[1], record[2]),
+          Vector3(record[3], record[4], record[5]));
+      v.edges.resize(end - begin);
+      std::memcpy(v.edges.data(), adjacencyData + begin * sizeof(uint32_t),
+          (end - begin) * sizeof(uint32_t));
+      for (unsigned int eid : v.edges) {
+        if (eid >= header.edgeNum) {
+          return nullptr;
+        }
+      }
+      vertices.push_back(std::move(v));
+      begin = end;
+    }
+
+    std::vector<TriangularMesh::Edge>& edges = mesh->_edges.mutate();
+    edges.resize(header.edgeNum);
+    for (uint64_t eid = 0; eid < header.edgeNum; ++eid) {
+      EdgeRecord record;
+      std::memcpy(&record, edgeData + eid * sizeof(EdgeRecord), sizeof(EdgeRecord));
+      // Whatever the checksum says, indices must be checked before anything follows them.
+      if (record.startVertex >= header.vertexNum || record.endVertex >= header.vertexNum
+          || record.face >= header.faceNum || record.nextEdge >= header.edgeNum
+          || record.prevEdge >= header.edgeNum
+          || (record.twinEdge >= header.edgeNum
+              && record.twinEdge != static_cast<uint32_t>(HD_INVALID_ID))) {
+        return nullptr;
+      }
+      TriangularMesh::Edge& e = edges[eid];
+      e.startVertex = record.startVertex;
+      e.endVertex = record.endVertex;
+      e.face = record.face;
+      e.twinEdge = record.twinEdge;
+      e.nextEdge = record.nextEdge;
+      e.prevEdge = record.prevEdge;
+    }
+
+    std::vector<TriangularMesh::Face>& faces = mesh->_faces.mutate();
+    faces.reserve(header.faceNum);
+    for (uint64_t fid = 0; fid < header.faceNum; ++fid) {
+      FaceRecord record;
+      std::memcpy(&record, faceData + fid * sizeof(FaceRecord), sizeof(FaceRecord));
+      for (int i = 0; i < 3; ++i) {
+        if (record.vertices[i] >= header.vertexNum || record.edges[i] >= header.edgeNum) {
+          return nullptr;
+        }
+      }
+      TriangularMesh::Face f(
+          {record.vertices[0], record.vertices[1], record.vertices[2]},
+          Vector3(record.normal[0], record.normal[1], record.normal[2]));
+      f.edges = {record.edges[0], record.edges[1], record.edges[2]};
+      faces.push_back(f);
+    }
+    mesh->_isPopulated = true;
+    return mesh;
+  }
+}
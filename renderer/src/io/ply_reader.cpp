@@ -0,0 +1,447 @@
+#include "io/ply_reader.h"
+#include "const.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace hd {
+  namespace {
+    // Size of the buffer used to bulk read element blocks.
+    const std::size_t PLY_CHUNK_SIZE = 1 << 22;
+
+    enum class PlyType {
+      INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64, INVALID
+    };
+
+    class PlyProperty {
+      public:
+        std::string name;
+        PlyType type;
+        // For list properties, type is the type of list items and countType is the type of the
+        // leading item count.
+        bool isList;
+        PlyType countType;
+        // Byte offset of this property within an element. Only meaningful for elements
+        // without list properties.
+        unsigned int offset;
+    };
+
+    class PlyElement {
+      public:
+        std::string name;
+        unsigned long count;
+        std::vector<PlyProperty> properties;
+        // Size in bytes of a single element, or 0 if the element contains list properties.
+        unsigned int stride;
+    };
+
+    /**
+     * A thin buffered reader over a binary stream, which allows element blocks to be decoded
+     * directly from large contiguous chunks.
+     */
+    class ChunkedInput {
+      private:
+        std::istream& _in;
+        std::vector<char> _buffer;
+        std::size_t _pos;
+        std::size_t _len;
+
+      public:
+        ChunkedInput(std::istream& in)
+            : _in(in), _buffer(PLY_CHUNK_SIZE), _pos(0), _len(0) {}
+
+        // Make sure at least n bytes are available from data(). Returns false on premature EOF.
+        bool ensure(std::size_t n) {
+          if (_len - _pos >= n) {
+            return true;
+          }
+          std::size_t remaining = _len - _pos;
+          std::memmove(_buffer.data(), _buffer.data() + _pos, remaining);
+          if (_buffer.size() < n) {
+            _buffer.resize(n);
+          }
+          _in.read(_buffer.data() + remaining, _buffer.size() - remaining);
+          _pos = 0;
+          _len = remaining + static_cast<std::size_t>(_in.gcount());
+          return _len >= n;
+        }
+        // Number of bytes currently buffered.
+        std::size_t available() const { return _len - _pos; }
+        std::size_t capacity() const { return _buffer.size(); }
+        const char* data() const { return _buffer.data() + _pos; }
+        void consume(std::size_t n) {
+          assert(n <= _len - _pos);
+          _pos += n;
+        }
+    };
+
+    PlyType parseType(const std::string& name) {
+      if (name == "char" || name == "int8") return PlyType::INT8;
+      if (name == "uchar" || name == "uint8") return PlyType::UINT8;
+      if (name == "short" || name == "int16") return PlyType::INT16;
+      if (name == "ushort" || name == "uint16") return PlyType::UINT16;
+      if (name == "int" || name == "int32") return PlyType::INT32;
+      if (name == "uint" || name == "uint32") return PlyType::UINT32;
+      if (name == "float" || name == "float32") return PlyType::FLOAT32;
+      if (name == "double" || name == "float64") return PlyType::FLOAT64;
+      return PlyType::INVALID;
+    }
+
+    unsigned int sizeOf(PlyType type) {
+      switch (type) {
+        case PlyType::INT8:
+        case PlyType::UINT8:
+          return 1;
+        case PlyType::INT16:
+        case PlyType::UINT16:
+          return 2;
+        case PlyType::INT32:
+        case PlyType::UINT32:
+        case PlyType::FLOAT32:
+          return 4;
+        case PlyType::FLOAT64:
+          return 8;
+        default:
+          return 0;
+      }
+    }
+
+    bool isHostLittleEndian() {
+      const uint16_t probe = 1;
+      unsigned char firstByte;
+      std::memcpy(&firstByte, &probe, 1);
+      return firstByte == 1;
+    }
+
+    // Decode a scalar of given type at p, swapping its bytes first if needed.
+    double readScalar(const char* p, PlyType type, bool swapBytes) {
+      unsigned char bytes[8];
+      unsigned int size = sizeOf(type);
+      std::memcpy(bytes, p, size);
+      if (swapBytes) {
+        std::reverse(bytes, bytes + size);
+      }
+      switch (type) {
+        case PlyType::INT8: { int8_t v; std::memcpy(&v, bytes, 1); return v; }
+        case PlyType::UINT8: { uint8_t v; std::memcpy(&v, bytes, 1); return v; }
+        case PlyType::INT16: { int16_t v; std::memcpy(&v, bytes, 2); return v; }
+        case PlyType::UINT16: { uint16_t v; std::memcpy(&v, bytes, 2); return v; }
+        case PlyType::INT32: { int32_t v; std::memcpy(&v, bytes, 4); return v; }
+        case PlyType::UINT32: { uint32_t v; std::memcpy(&v, bytes, 4); return v; }
+        case PlyType::FLOAT32: { float v; std::memcpy(&v, bytes, 4); return v; }
+        case PlyType::FLOAT64: { double v; std::memcpy(&v, bytes, 8); return v; }
+        default:
+          assert(false);
+          return 0.0;
+      }
+    }
+
+    // Parse the ascii header. On success, the stream is positioned at the first byte of
+    // the binary body.
+    bool parseHeader(std::istream& in, std::vector<PlyElement>& elements, bool& isLittleEndian) {
+      std::string line;
+      if (!std::getline(in, line) || line.compare(0, 3, "ply") != 0) {
+        return false;
+      }
+      bool hasFormat = false;
+      while (std::getline(in, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+          line.erase(line.size() - 1);
+        }
+        std::istringstream tokens(line);
+        std::string keyword;
+        tokens >> keyword;
+        if (keyword == "end_header") {
+          return hasFormat;
+        } else if (keyword == "format") {
+          std::string format;
+          tokens >> format;
+          if (format == "binary_little_endian") {
+            isLittleEndian = true;
+          } else if (format == "binary_big_endian") {
+            isLittleEndian = false;
+          } else {
+            return false;
+          }
+          hasFormat = true;
+        } else if (keyword == "element") {
+          PlyElement element;
+          if (!(tokens >> element.name >> element.count)) {
+            return false;
+          }
+          element.stride = 0;
+          elements.push_back(element);
+        } else if (keyword == "property") {
+          if (elements.empty()) {
+            return false;
+          }
+          PlyProperty prop;
+          std::string typeName;
+          tokens >> typeName;
+          if (typeName == "list") {
+            std::string countTypeName;
+            tokens >> countTypeName >> typeName;
+            prop.isList = true;
+            prop.countType = parseType(countTypeName);
+            if (prop.countType == PlyType::INVALID) {
+              return false;
+            }
+          } else {
+            prop.isList = false;
+            prop.countType = PlyType::INVALID;
+          }
+          prop.type = parseType(typeName);
+          if (prop.type == PlyType::INVALID || !(tokens >> prop.name)) {
+            return false;
+          }
+          elements.back().properties.push_back(prop);
+        }
+        // Comments, obj_info and unknown keywords are ignored.
+      }
+      return false;
+    }
+
+    // Compute property offsets and element strides for elements without list properties.
+    void computeLayouts(std::vector<PlyElement>& elements) {
+      for (auto& element : elements) {
+        unsigned int offset = 0;
+        bool hasList = false;
+        for (auto& prop : element.properties) {
+          prop.offset = offset;
+          if (prop.isList) {
+            hasList = true;
+          } else {
+            offset += sizeOf(prop.type);
+          }
+        }
+        element.stride = hasList ? 0 : offset;
+      }
+    }
+
+    const PlyProperty* findProperty(const PlyElement& element, const std::string& name) {
+      for (auto& prop : element.properties) {
+        if (prop.name == name) {
+          return &prop;
+        }
+      }
+      return nullptr;
+    }
+
+    // Skip a single element containing list properties. Returns false on premature EOF.
+    bool skipListElement(ChunkedInput& input, const PlyElement& element, bool swapBytes) {
+      for (auto& prop : element.properties) {
+        if (!prop.isList) {
+          if (!input.ensure(sizeOf(prop.type))) {
+            return false;
+          }
+          input.consume(sizeOf(prop.type));
+          continue;
+        }
+        unsigned int countSize = sizeOf(prop.countType);
+        if (!input.ensure(countSize)) {
+          return false;
+        }
+        double count = readScalar(input.data(), prop.countType, swapBytes);
+        input.consume(countSize);
+        std::size_t listSize = static_cast<std::size_t>(count) * sizeOf(prop.type);
+        if (count < 0 || !input.ensure(listSize)) {
+          return false;
+        }
+        input.consume(listSize);
+      }
+      return true;
+    }
+
+    bool skipElement(ChunkedInput& input, const PlyElement& element, bool swapBytes) {
+      if (element.stride == 0) {
+        for (unsigned long i = 0; i < element.count; ++i) {
+          if (!skipListElement(input, element, swapBytes)) {
+            return false;
+          }
+        }
+        return true;
+      }
+      unsigned long remaining = element.count;
+      while (remaining > 0) {
+        unsigned long batch = std::min<unsigned long>(
+            remaining, std::max<std::size_t>(1, input.capacity() / element.stride));
+        if (!input.ensure(batch * element.stride)) {
+          return false;
+        }
+        input.consume(batch * element.stride);
+        remaining -= batch;
+      }
+      return true;
+    }
+  }
+
+  std::unique_ptr<TriangularMesh> PlyReader::read(const std::string& path,
+      TriangularMesh::FaceNormalMode faceNormalMode) {
+    assert(faceNormalMode != TriangularMesh::FaceNormalMode::USER_SPECIFIED);
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in) {
+      return nullptr;
+    }
+    std::vector<PlyElement> elements;
+    bool isLittleEndian = true;
+    if (!parseHeader(in, elements, isLittleEndian)) {
+      return nullptr;
+    }
+    computeLayouts(elements);
+    bool swapBytes = isLittleEndian != isHostLittleEndian();
+
+    const PlyElement* vertexElement = nullptr;
+    const PlyElement* faceElement = nullptr;
+    for (auto& element : elements) {
+      if (element.name == "vertex") {
+        vertexElement = &element;
+      } else if (element.name == "face") {
+        faceElement = &element;
+      }
+    }
+    if (vertexElement == nullptr || vertexElement->stride == 0 || faceElement == nullptr) {
+      return nullptr;
+    }
+    const PlyProperty* posProps[3] = {
+      findProperty(*vertexElement, "x"),
+      findProperty(*vertexElement, "y"),
+      findProperty(*vertexElement, "z")
+    };
+    const PlyProperty* normalProps[3] = {
+      findProperty(*vertexElement, "nx"),
+      findProperty(*vertexElement, "ny"),
+      findProperty(*vertexElement, "nz")
+    };
+    const PlyProperty* indexProp = findProperty(*faceElement, "vertex_indices");
+    if (indexProp == nullptr) {
+      indexProp = findProperty(*faceElement, "vertex_index");
+    }
+    if (posProps[0] == nullptr || posProps[1] == nullptr || posProps[2] == nullptr
+        || indexProp == nullptr || !indexProp->isList) {
+      return nullptr;
+    }
+    bool hasNormals = normalProps[0] != nullptr
+        && normalProps[1] != nullptr
+        && normalProps[2] != nullptr;
+
+    auto builder = TriangularMesh::newBuilder(
+        hasNormals ? TriangularMesh::VertexNormalMode::USER_SPECIFIED
+                   : TriangularMesh::VertexNormalMode::AVERAGED,
+        faceNormalMode);
+    // Elements are decoded into local lists handed over to the builder at the end, without
+    // copying. Most scans are pure triangle meshes, so the face count in the header is a good
+    // estimate of the final number of triangles. The header is not trusted though: reservations
+    // are capped by how many elements the rest of the file can hold at all, so a truncated or
+    // hostile count cannot trigger a huge allocation.
+    std::streampos bodyStart = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::streampos fileEnd = in.tellg();
+    in.seekg(bodyStart);
+    if (!in || bodyStart < 0 || fileEnd < bodyStart) {
+      return nullptr;
+    }
+    unsigned long bodySize = static_cast<unsigned long>(fileEnd - bodyStart);
+    std::vector<TriangularMesh::Vertex> vertices;
+    std::vector<TriangularMesh::Face> faces;
+    vertices.reserve(std::min<unsigned long>(
+        vertexElement->count, bodySize / vertexElement->stride));
+    faces.reserve(std::min<unsigned long>(
+        faceElement->count, bodySize / std::max(1u, sizeOf(indexProp->countType))));
+
+    ChunkedInput input(in);
+    unsigned long vertexNum = vertexElement->count;
+    for (auto& element : elements) {
+      if (&element == vertexElement) {
+        // Decode the vertex block chunk by chunk, each chunk holding as many whole vertices as
+        // the buffer allows.
+        unsigned int stride = element.stride;
+        unsigned long remaining = element.count;
+        while (remaining > 0) {
+          unsigned long batch = std::min<unsigned long>(
+              remaining, std::max<std::size_t>(1, input.capacity() / stride));
+          if (!input.ensure(batch * stride)) {
+            return nullptr;
+          }
+          const char* data = input.data();
+          for (unsigned long i = 0; i < batch; ++i) {
+            const char* p = data + i * stride;
+            Vector3 pos;
+            for (int k = 0; k < 3; ++k) {
+              pos[k] = readScalar(p + posProps[k]->offset, posProps[k]->type, swapBytes);
+            }
+            if (hasNormals) {
+              Vector3 normal;
+              for (int k = 0; k < 3; ++k) {
+                normal[k] = readScalar(
+                    p + normalProps[k]->offset, normalProps[k]->type, swapBytes);
+              }
+              vertices.push_back(TriangularMesh::Vertex(pos, normal));
+            } else {
+              vertices.push_back(TriangularMesh::Vertex(pos));
+            }
+          }
+          input.consume(batch * stride);
+          remaining -= batch;
+        }
+      } else if (&element == faceElement) {
+        std::vector<unsigned int> polygon;
+        for (unsigned long i = 0; i < element.count; ++i) {
+          for (auto& prop : element.properties) {
+            if (&prop != indexProp) {
+              if (prop.isList) {
+                PlyElement single;
+                single.properties.push_back(prop);
+                if (!skipListElement(input, single, swapBytes)) {
+                  return nullptr;
+                }
+              } else {
+                if (!input.ensure(sizeOf(prop.type))) {
+                  return nullptr;
+                }
+                input.consume(sizeOf(prop.type));
+              }
+              continue;
+            }
+            unsigned int countSize = sizeOf(prop.countType);
+            unsigned int indexSize = sizeOf(prop.type);
+            if (!input.ensure(countSize)) {
+              return nullptr;
+            }
+            double count = readScalar(input.data(), prop.countType, swapBytes);
+            input.consume(countSize);
+            if (count < 0 || !input.ensure(static_cast<std::size_t>(count) * indexSize)) {
+              return nullptr;
+            }
+            polygon.resize(static_cast<std::size_t>(count));
+            const char* data = input.data();
+            for (std::size_t k = 0; k < polygon.size(); ++k) {
+              double index = readScalar(data + k * indexSize, prop.type, swapBytes);
+              if (index < 0 || index >= vertexNum) {
+                return nullptr;
+              }
+              polygon[k] = static_cast<unsigned int>(index);
+            }
+            input.consume(polygon.size() * indexSize);
+            // Triangulate polygons as fans around their first vertex. Faces referring to the
+            // same vertex more than once are degenerate and dropped.
+            for (std::size_t k = 2; k < polygon.size(); ++k) {
+              std::array<unsigned int, 3> face = {polygon[0], polygon[k - 1], polygon[k]};
+              if (face[0] == face[1] || face[1] == face[2] || face[2] == face[0]) {
+                continue;
+              }
+              faces.push_back(TriangularMesh::Face(face));
+            }
+          }
+        }
+      } else if (!skipElement(input, element, swapBytes)) {
+        return nullptr;
+      }
+    }
+    return builder.setVertices(std::move(vertices)).setFaces(std::move(faces)).build();
+  }
+}
@@ -0,0 +1,350 @@
+#include "io/socket.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace hd {
+  namespace {
+    // Largest payload receive() accepts without a limit per message type.
+    const uint64_t DEFAULT_MAX_PAYLOAD_SIZE = 1 << 16;
+
+    class MessageHeader {
+      public:
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t size;
+    };
+
+    // Split "unix:<path>" or "tcp:<host>:<port>". Returns false if malformed.
+    bool parseAddress(const std::string& address, bool& isUnix, std::string& host,
+        std::string& port) {
+      if (address.compare(0, 5, "unix:") == 0) {
+        isUnix = true;
+        host = address.substr(5);
+        return !host.empty() && host.size() < sizeof(sockaddr_un().sun_path);
+      }
+      if (address.compare(0, 4, "tcp:") == 0) {
+        isUnix = false;
+        std::size_t colon = address.rfind(':');
+        if (colon <= 4) {
+          return false;
+        }
+        host = address.substr(4, colon - 4);
+        port = address.substr(colon + 1);
+        return !host.empty() && !port.empty();
+      }
+      return false;
+    }
+
+    sockaddr_un unixAddress(const std::string& path) {
+      sockaddr_un addr;
+      std::memset(&addr, 0, sizeof(addr));
+      addr.sun_family = AF_UNIX;
+      std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+      return addr;
+    }
+
+    // Make room for a unix socket at the given path. Only a socket file left by a process that
+    // did not shut down, i.e. one refusing connections, is removed: regular files and sockets
+    // still served by a running process are kept, and false is returned.
+    bool removeStaleUnixSocket(const std::string& path) {
+      struct stat status;
+      if (::lstat(path.c_str(), &status) != 0) {
+        return errno == ENOENT;
+      }
+      if (!S_ISSOCK(status.st_mode)) {
+        return false;
+      }
+      int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      if (fd < 0) {
+        return false;
+      }
+      sockaddr_un addr = unixAddress(path);
+      bool isStale = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+          && errno == ECONNREFUSED;
+      ::close(fd);
+      return isStale && ::unlink(path.c_str()) == 0;
+    }
+  }
+
+  void Message::putBytes(const void* data, std::size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    payload.insert(payload.end(), bytes, bytes + size);
+  }
+
+  void Message::putString(const std::string& value) {
+    put<uint64_t>(value.size());
+    putBytes(value.data(), value.size());
+  }
+
+  bool Message::getBytes(void* data, std::size_t size) {
+    if (payload.size() - _readOffset < size) {
+      return false;
+    }
+    std::memcpy(data, payload.data() + _readOffset, size);
+    _readOffset += size;
+    return true;
+  }
+
+  bool Message::getString(std::string& value) {
+    uint64_t size;
+    if (!get(size) || payload.size() - _readOffset < size) {
+      return false;
+    }
+    value.assign(payload.data() + _readOffset, size);
+    _readOffset += size;
+    return true;
+  }
+
+  Socket::Socket(Socket&& socket) : _fd(socket._fd), _receiveTimeout(socket._receiveTimeout) {
+    socket._fd = -1;
+  }
+
+  Socket& Socket::operator=(Socket&& socket) {
+    if (this != &socket) {
+      close();
+      _fd = socket._fd;
+      _receiveTimeout = socket._receiveTimeout;
+      socket._fd = -1;
+    }
+    return *this;
+  }
+
+  Socket::~Socket() {
+    close();
+  }
+
+  Socket Socket::connect(const std::string& address) {
+    bool isUnix;
+    std::string host, port;
+    if (!parseAddress(address, isUnix, host, port)) {
+      return Socket();
+    }
+    if (isUnix) {
+      Socket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+      sockaddr_un addr = unixAddress(host);
+      if (!socket.isOpen()
+          || ::connect(socket._fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        return Socket();
+      }
+      return socket;
+    }
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &results) != 0) {
+      return Socket();
+    }
+    Socket socket;
+    for (addrinfo* r = results; r != nullptr; r = r->ai_next) {
+      Socket candidate(::socket(r->ai_family, r->ai_socktype, r->ai_protocol));
+      if (candidate.isOpen() && ::connect(candidate._fd, r->ai_addr, r->ai_addrlen) == 0) {
+        // Messages are small and latency bound.
+        int one = 1;
+        setsockopt(candidate._fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        socket = std::move(candidate);
+        break;
+      }
+    }
+    freeaddrinfo(results);
+    return socket;
+  }
+
+  void Socket::close() {
+    if (_fd >= 0) {
+      ::close(_fd);
+      _fd = -1;
+    }
+  }
+
+  bool Socket::setReceiveTimeout(double seconds) {
+    if (_fd < 0 || !(seconds >= 0.0)) {
+      return false;
+    }
+    _receiveTimeout = seconds;
+    return true;
+  }
+
+  bool Socket::send(const Message& message) {
+    MessageHeader header;
+    header.type = message.type;
+    header.reserved = 0;
+    header.size = message.payload.size();
+    return _sendAll(&header, sizeof(header))
+        && _sendAll(message.payload.data(), message.payload.size());
+  }
+
+  bool Socket::receive(Message& message) {
+    return receive(message, [](uint32_t) { return DEFAULT_MAX_PAYLOAD_SIZE; });
+  }
+
+  bool Socket::receive(Message& message, const PayloadLimit& maxPayloadSize) {
+    // A single deadline for the whole message: a timeout per recv() would let a peer sending
+    // one byte at a time block the receiver indefinitely.
+    bool hasDeadline = _receiveTimeout > 0.0;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now()
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(_receiveTimeout));
+    MessageHeader header;
+    if (!_receiveAll(&header, sizeof(header), hasDeadline, deadline)
+        || header.size > maxPayloadSize(header.type)) {
+      return false;
+    }
+    message = Message(header.type);
+    message.payload.resize(header.size);
+    return _receiveAll(message.payload.data(), header.size, hasDeadline, deadline);
+  }
+
+  bool Socket::_sendAll(const void* data, std::size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+      // A peer that went away must not kill the process with SIGPIPE.
+      ssize_t n = ::send(_fd, p, size, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      p += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  bool Socket::_receiveAll(void* data, std::size_t size, bool hasDeadline,
+      std::chrono::steady_clock::time_point deadline) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+      if (hasDeadline) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+          return false;
+        }
+        pollfd entry;
+        entry.fd = _fd;
+        entry.events = POLLIN;
+        entry.revents = 0;
+        int ready = ::poll(&entry, 1, static_cast<int>(std::min<long long>(remaining, 1 << 30)));
+        if (ready < 0 && errno == EINTR) {
+          continue;
+        }
+        if (ready <= 0) {
+          return false;
+        }
+      }
+      ssize_t n = ::recv(_fd, p, size, 0);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        return false;
+      }
+      p += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  ServerSocket::~ServerSocket() {
+    close();
+  }
+
+  bool ServerSocket::listen(const std::string& address) {
+    close();
+    bool isUnix;
+    std::string host, port;
+    if (!parseAddress(address, isUnix, host, port)) {
+      return false;
+    }
+    if (isUnix) {
+      // A socket left by a previous run that did not shut down would make bind() fail.
+      if (!removeStaleUnixSocket(host)) {
+        return false;
+      }
+      _fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      sockaddr_un addr = unixAddress(host);
+      if (_fd < 0 || ::bind(_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+          || ::listen(_fd, SOMAXCONN) != 0) {
+        close();
+        return false;
+      }
+      _unixPath = host;
+      _address = address;
+      return true;
+    }
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* results = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &results) != 0) {
+      return false;
+    }
+    for (addrinfo* r = results; r != nullptr && _fd < 0; r = r->ai_next) {
+      _fd = ::socket(r->ai_family, r->ai_socktype, r->ai_protocol);
+      int one = 1;
+      if (_fd >= 0 && (setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0
+          || ::bind(_fd, r->ai_addr, r->ai_addrlen) != 0 || ::listen(_fd, SOMAXCONN) != 0)) {
+        ::close(_fd);
+        _fd = -1;
+      }
+    }
+    freeaddrinfo(results);
+    if (_fd < 0) {
+      return false;
+    }
+    sockaddr_storage bound;
+    socklen_t length = sizeof(bound);
+    getsockname(_fd, reinterpret_cast<sockaddr*>(&bound), &length);
+    char service[NI_MAXSERV];
+    if (getnameinfo(reinterpret_cast<sockaddr*>(&bound), length, nullptr, 0, service,
+        sizeof(service), NI_NUMERICSERV) != 0) {
+      close();
+      return false;
+    }
+    _address = "tcp:" + host + ":" + service;
+    return true;
+  }
+
+  void ServerSocket::close() {
+    if (_fd >= 0) {
+      ::close(_fd);
+      _fd = -1;
+    }
+    if (!_unixPath.empty()) {
+      ::unlink(_unixPath.c_str());
+      _unixPath.clear();
+    }
+    _address.clear();
+  }
+
+  Socket ServerSocket::accept() {
+    int fd;
+    do {
+      fd = ::accept(_fd, nullptr, nullptr);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) {
+      return Socket();
+    }
+    if (_unixPath.empty()) {
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return Socket(fd);
+  }
+}
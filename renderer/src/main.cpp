@@ -1,11 +1,511 @@
 /**
- * Temporarily set for verification of environment setup purpose.
- * Will be refactored soon.
+ * Renders a PLY mesh, or a native mesh file (see MeshSerializer), to a PFM image.
+ *
+ * Usage: HyperDoom <scene.ply|scene.hdmesh> <output.pfm> [--width W] [--height H] [--spp N]
+ *            [--threads N] [--tile N] [--integrator headlight|megakernel|wavefront]
+ *            [--target-error E] [--time-budget SECONDS] [--max-spp N]
+ *            [--sampler independent|sobol|lattice] [--filter box|tent] [--filter-radius R]
+ *            [--checkpoint PATH] [--checkpoint-interval SECONDS]
+ *            [--listen ADDRESS] [--local-workers N] [--submit ADDRESS]
+ *            [--inside] [--ray-sort on|off] [--traversal-stats] [--repeat N]
+ *        HyperDoom --generate-room <output.hdmesh> [--wall-resolution N] [--boxes N]
+ *            [--box-resolution N] [--seed S]
+ *        HyperDoom --worker ADDRESS [--threads N]
+ *        HyperDoom --daemon ADDRESS [--threads N] [--cache-mb N] [--max-megapixels N]
+ *        HyperDoom --stop-daemon ADDRESS
+ *
+ * With a target error, a time budget or a checkpoint, rendering is adaptive (see
+ * AdaptiveRenderer), and --spp is the minimum number of samples per pixel. Otherwise tiles are
+ * written to the output file while rendering, as soon as they are final.
+ *
+ * With a checkpoint, progress is saved to it periodically, and a render started with a
+ * checkpoint that already exists carries on from it, e.g. after the machine was preempted. The
+ * render fails rather than overwrite a checkpoint taken of another scene or with other settings.
+ *
+ * With --listen or --local-workers, tiles are rendered by worker processes instead (see
+ * RenderCoordinator): workers started with --worker connect to the address listened at, e.g.
+ * tcp:0.0.0.0:7000 or unix:/tmp/hd.sock, and --local-workers starts that many of them on this
+ * machine. The scene is handed to workers as a mesh file written next to the output, which
+ * remote workers must see at the same path, e.g. on a shared file system.
+ *
+ * With --submit, the job is rendered by a daemon started with --daemon instead (see
+ * RenderDaemon), which keeps recently rendered scenes loaded, so that rendering a scene again,
+ * e.g. from another viewpoint, starts right away.
+ *
+ * With --inside, the camera is at the center of the scene, e.g. to render interior scenes.
+ * --generate-room writes such a scene (see RoomGenerator), which is the same for the same
+ * options on every machine, e.g. to reproduce benchmarks.
+ *
+ * Prints scheduling stats and throughput, so that integrators can be benchmarked against each
+ * other on the same scene, along with rays per second and cache misses per ray where hardware
+ * counters are available, e.g. to benchmark --ray-sort of the wavefront integrator. Where they
+ * are not, --traversal-stats counts kd-tree nodes visited and misses of a simulated cache per
+ * ray instead (see KdTree::TraversalStats), at some cost in throughput. --repeat renders the
+ * image several times, and prints the median and range of throughput over the runs.
  */
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include "math/vector3.h"
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "geometry/kd_tree.h"
+#include "io/mesh_serializer.h"
+#include "io/ply_reader.h"
+#include "render/checkpoint.h"
+#include "render/film.h"
+#include "render/adaptive_renderer.h"
+#include "render/render_coordinator.h"
+#include "render/render_daemon.h"
+#include "render/render_job.h"
+#include "render/render_worker.h"
+#include "render/renderer.h"
+#include "render/wavefront_integrator.h"
+#include "scene/room_generator.h"
+#include "util/perf_counter.h"
+
+namespace {
+  void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <scene.ply|scene.hdmesh> <output.pfm>"
+        << " [--width W] [--height H] [--spp N] [--threads N] [--tile N]"
+        << " [--integrator headlight|megakernel|wavefront]"
+        << " [--target-error E] [--time-budget SECONDS] [--max-spp N]"
+        << " [--sampler independent|sobol|lattice] [--filter box|tent] [--filter-radius R]"
+        << " [--checkpoint PATH] [--checkpoint-interval SECONDS]"
+        << " [--listen ADDRESS] [--local-workers N] [--submit ADDRESS]"
+        << " [--inside] [--ray-sort on|off] [--traversal-stats] [--repeat N]" << std::endl;
+    std::cerr << "       " << program << " --generate-room <output.hdmesh>"
+        << " [--wall-resolution N] [--boxes N] [--box-resolution N] [--seed S]" << std::endl;
+    std::cerr << "       " << program << " --worker ADDRESS [--threads N]" << std::endl;
+    std::cerr << "       " << program << " --daemon ADDRESS [--threads N] [--cache-mb N]"
+        << " [--max-megapixels N]" << std::endl;
+    std::cerr << "       " << program << " --stop-daemon ADDRESS" << std::endl;
+  }
+
+  int runWorker(const std::string& address, unsigned int threadNum) {
+    hd::RenderWorker::Options options;
+    options.threadNum = threadNum;
+    hd::RenderWorker worker(options);
+    if (!worker.run(address)) {
+      std::cerr << "Worker failed to render for " << address << std::endl;
+      return 1;
+    }
+    std::cout << "worker: " << worker.stats().tileNum << " tiles in "
+        << worker.stats().wallSeconds << " s" << std::endl;
+    return 0;
+  }
+
+  int runDaemon(const std::string& address, const hd::RenderDaemon::Options& options) {
+    hd::RenderDaemon daemon(options);
+    if (!daemon.listen(address)) {
+      std::cerr << "Failed to listen at " << address << std::endl;
+      return 1;
+    }
+    std::cout << "listening at " << daemon.address() << std::endl;
+    daemon.run();
+    hd::SceneCache::Stats cacheStats = daemon.cache().stats();
+    std::cout << "jobs=" << daemon.stats().jobNum << " failed=" << daemon.stats().failedJobNum
+        << " scene loads=" << cacheStats.loads << " hits=" << cacheStats.hits << std::endl;
+    return 0;
+  }
+
+  int generateRoom(const std::string& outputPath, const hd::RoomGenerator::Options& options) {
+    auto room = hd::RoomGenerator::generate(options);
+    if (!hd::MeshSerializer::write(*room, outputPath)) {
+      std::cerr << "Failed to write " << outputPath << std::endl;
+      return 1;
+    }
+    std::cout << room->faceNum() << " faces" << std::endl;
+    return 0;
+  }
+
+  // Load a native mesh file if the path ends with .hdmesh, a PLY file otherwise.
+  std::unique_ptr<hd::TriangularMesh> readScene(const std::string& path) {
+    const std::string extension = ".hdmesh";
+    if (path.size() >= extension.size()
+        && path.compare(path.size() - extension.size(), extension.size(), extension) == 0) {
+      return hd::MeshSerializer::read(path);
+    }
+    return hd::PlyReader::read(path);
+  }
+
+  // Median and range of measurements of repeated runs.
+  std::string spread(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    std::size_t n = values.size();
+    double median = n % 2 == 1 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+    std::ostringstream out;
+    out << median << " (min " << values.front() << ", max " << values.back() << " over " << n
+        << " runs)";
+    return out.str();
+  }
+
+  // Start a worker process running this executable. Returns its pid, or -1 on failure.
+  pid_t startLocalWorker(const char* program, const std::string& address,
+      unsigned int threadNum) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      std::string threads = std::to_string(threadNum);
+      execl("/proc/self/exe", program, "--worker", address.c_str(), "--threads",
+          threads.c_str(), static_cast<char*>(nullptr));
+      _exit(127);
+    }
+    return pid;
+  }
+}
 
 int main(int argc, char **argv) {
-  std::cout << "OK!" << std::endl;
+  if (argc >= 3 && std::strcmp(argv[1], "--worker") == 0) {
+    unsigned int threadNum = 0;
+    if (argc == 5 && std::strcmp(argv[3], "--threads") == 0) {
+      threadNum = std::strtoul(argv[4], nullptr, 10);
+    } else if (argc != 3) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    return runWorker(argv[2], threadNum);
+  }
+  if (argc >= 3 && std::strcmp(argv[1], "--daemon") == 0) {
+    hd::RenderDaemon::Options options;
+    for (int i = 3; i < argc; i += 2) {
+      unsigned int value = i + 1 < argc ? std::strtoul(argv[i + 1], nullptr, 10) : 0;
+      if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+        options.threadNum = value;
+      } else if (std::strcmp(argv[i], "--cache-mb") == 0 && i + 1 < argc) {
+        options.cacheBytes = static_cast<std::size_t>(value) << 20;
+      } else if (std::strcmp(argv[i], "--max-megapixels") == 0 && value > 0) {
+        options.maxPixelNum = static_cast<uint64_t>(value) << 20;
+      } else {
+        printUsage(argv[0]);
+        return 1;
+      }
+    }
+    return runDaemon(argv[2], options);
+  }
+  if (argc >= 3 && std::strcmp(argv[1], "--generate-room") == 0) {
+    hd::RoomGenerator::Options options;
+    for (int i = 3; i < argc; i += 2) {
+      unsigned int value = i + 1 < argc ? std::strtoul(argv[i + 1], nullptr, 10) : 0;
+      if (std::strcmp(argv[i], "--wall-resolution") == 0 && value > 0) {
+        options.wallResolution = value;
+      } else if (std::strcmp(argv[i], "--boxes") == 0 && i + 1 < argc) {
+        options.boxNum = value;
+      } else if (std::strcmp(argv[i], "--box-resolution") == 0 && value > 0) {
+        options.boxResolution = value;
+      } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+        options.seed = value;
+      } else {
+        printUsage(argv[0]);
+        return 1;
+      }
+    }
+    return generateRoom(argv[2], options);
+  }
+  if (argc == 3 && std::strcmp(argv[1], "--stop-daemon") == 0) {
+    if (!hd::RenderDaemon::shutdown(argv[2])) {
+      std::cerr << "No daemon at " << argv[2] << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+  if (argc < 3) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  std::string scenePath = argv[1];
+  std::string outputPath = argv[2];
+  hd::RenderJob job;
+  hd::Renderer::Options options;
+  hd::AdaptiveRenderer::Options adaptiveOptions;
+  bool isAdaptive = false;
+  std::string listenAddress;
+  unsigned int localWorkerNum = 0;
+  std::string daemonAddress;
+  bool isCountingTraversals = false;
+  unsigned int repeatNum = 1;
+  for (int i = 3; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--inside") == 0) {
+      job.isInside = true;
+      continue;
+    }
+    if (std::strcmp(argv[i], "--traversal-stats") == 0) {
+      isCountingTraversals = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    unsigned int value = std::strtoul(argv[i + 1], nullptr, 10);
+    if (std::strcmp(argv[i], "--integrator") == 0) {
+      job.integrator = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--sampler") == 0) {
+      job.sampler = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--filter") == 0) {
+      if (std::strcmp(argv[i + 1], "box") == 0) {
+        options.filter.type = hd::Film::Filter::Type::BOX;
+      } else if (std::strcmp(argv[i + 1], "tent") == 0) {
+        options.filter.type = hd::Film::Filter::Type::TENT;
+      } else {
+        printUsage(argv[0]);
+        return 1;
+      }
+    } else if (std::strcmp(argv[i], "--filter-radius") == 0) {
+      options.filter.radius = std::strtod(argv[i + 1], nullptr);
+    } else if (std::strcmp(argv[i], "--target-error") == 0) {
+      adaptiveOptions.targetError = std::strtod(argv[i + 1], nullptr);
+      isAdaptive = true;
+    } else if (std::strcmp(argv[i], "--time-budget") == 0) {
+      adaptiveOptions.timeBudgetSeconds = std::strtod(argv[i + 1], nullptr);
+      isAdaptive = true;
+    } else if (std::strcmp(argv[i], "--checkpoint") == 0) {
+      adaptiveOptions.checkpointPath = argv[i + 1];
+      isAdaptive = true;
+    } else if (std::strcmp(argv[i], "--checkpoint-interval") == 0) {
+      adaptiveOptions.checkpointIntervalSeconds = std::strtod(argv[i + 1], nullptr);
+    } else if (std::strcmp(argv[i], "--listen") == 0) {
+      listenAddress = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--local-workers") == 0) {
+      localWorkerNum = value;
+    } else if (std::strcmp(argv[i], "--ray-sort") == 0) {
+      if (std::strcmp(argv[i + 1], "on") == 0) {
+        job.isSortingRays = true;
+      } else if (std::strcmp(argv[i + 1], "off") == 0) {
+        job.isSortingRays = false;
+      } else {
+        printUsage(argv[0]);
+        return 1;
+      }
+    } else if (std::strcmp(argv[i], "--repeat") == 0) {
+      repeatNum = value;
+    } else if (std::strcmp(argv[i], "--submit") == 0) {
+      daemonAddress = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--max-spp") == 0) {
+      adaptiveOptions.maxSamplesPerPixel = value;
+    } else if (std::strcmp(argv[i], "--width") == 0) {
+      job.width = value;
+    } else if (std::strcmp(argv[i], "--height") == 0) {
+      job.height = value;
+    } else if (std::strcmp(argv[i], "--spp") == 0) {
+      options.samplesPerPixel = value;
+    } else if (std::strcmp(argv[i], "--threads") == 0) {
+      options.threadNum = value;
+    } else if (std::strcmp(argv[i], "--tile") == 0) {
+      options.tileSize = value;
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+    ++i;
+  }
+  bool isDistributed = !listenAddress.empty() || localWorkerNum > 0;
+  if (job.width == 0 || job.height == 0 || options.samplesPerPixel == 0 || options.tileSize == 0
+      || !(options.filter.radius > 0.0) || (isDistributed && isAdaptive)
+      || (!daemonAddress.empty() && (isDistributed || isAdaptive)) || repeatNum == 0
+      || (repeatNum > 1 && (isAdaptive || isDistributed || !daemonAddress.empty()))) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  job.samplesPerPixel = options.samplesPerPixel;
+  job.filter = options.filter;
+  if (!daemonAddress.empty()) {
+    // The daemon resolves the path, so it must not depend on the working directory.
+    char* absolutePath = realpath(scenePath.c_str(), nullptr);
+    if (absolutePath == nullptr) {
+      std::cerr << "Failed to read " << scenePath << std::endl;
+      return 1;
+    }
+    job.meshPath = absolutePath;
+    std::free(absolutePath);
+    hd::RenderDaemon::JobStats jobStats;
+    std::string error;
+    auto image = hd::RenderDaemon::render(daemonAddress, job, &jobStats, &error);
+    if (image == nullptr) {
+      std::cerr << "Daemon failed to render: " << error << std::endl;
+      return 1;
+    }
+    if (!image->writePfm(outputPath)) {
+      std::cerr << "Failed to write " << outputPath << std::endl;
+      return 1;
+    }
+    std::cout << "scene " << (jobStats.isSceneCached ? "cached" : "loaded") << " in "
+        << jobStats.loadSeconds << " s, rendered in " << jobStats.renderSeconds << " s"
+        << std::endl;
+    return 0;
+  }
+  adaptiveOptions.minSamplesPerPixel = std::max(2u, options.samplesPerPixel);
+  adaptiveOptions.maxSamplesPerPixel = std::max(adaptiveOptions.maxSamplesPerPixel,
+      adaptiveOptions.minSamplesPerPixel);
+  adaptiveOptions.tileSize = options.tileSize;
+  adaptiveOptions.threadNum = options.threadNum;
+  adaptiveOptions.integratorName = job.integrator;
+  adaptiveOptions.samplerName = job.sampler;
+  adaptiveOptions.filter = options.filter;
+
+  auto mesh = readScene(scenePath);
+  if (mesh == nullptr) {
+    std::cerr << "Failed to read " << scenePath << std::endl;
+    return 1;
+  }
+  auto tree = hd::KdTree::build(*mesh);
+  auto integrator = job.createIntegrator(*mesh, *tree);
+  if (integrator == nullptr) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  auto wavefront = dynamic_cast<hd::WavefrontIntegrator*>(integrator.get());
+  if (wavefront != nullptr) {
+    wavefront->setCountingTraversals(isCountingTraversals);
+  }
+  uint64_t sampleNum = static_cast<uint64_t>(job.width) * job.height * options.samplesPerPixel;
+  if (isDistributed) {
+    // Workers load the scene from a file of their own, and build their own trees.
+    wavefront = nullptr;
+    integrator.reset();
+    tree.reset();
+    job.meshPath = outputPath + ".hdmesh";
+    if (!hd::MeshSerializer::write(*mesh, job.meshPath)) {
+      std::cerr << "Failed to write " << job.meshPath << std::endl;
+      return 1;
+    }
+    mesh.reset();
+    if (listenAddress.empty()) {
+      listenAddress = "unix:" + outputPath + ".sock";
+    }
+    std::vector<pid_t> workers;
+    hd::RenderCoordinator::Options coordinatorOptions;
+    coordinatorOptions.tileSize = options.tileSize;
+    if (localWorkerNum > 0) {
+      // Reap local workers as they exit, so that the job is abandoned rather than waited for
+      // forever once all of them died, e.g. by running out of memory.
+      coordinatorOptions.isWorkerExpected = [&workers]() {
+        workers.erase(std::remove_if(workers.begin(), workers.end(), [](pid_t pid) {
+          return waitpid(pid, nullptr, WNOHANG) != 0;
+        }), workers.end());
+        return !workers.empty();
+      };
+    }
+    hd::RenderCoordinator coordinator(job, coordinatorOptions);
+    if (!coordinator.listen(listenAddress)) {
+      std::cerr << "Failed to listen at " << listenAddress << std::endl;
+      std::remove(job.meshPath.c_str());
+      return 1;
+    }
+    std::cout << "listening at " << coordinator.address() << std::endl;
+    for (unsigned int i = 0; i < localWorkerNum; ++i) {
+      pid_t pid = startLocalWorker(argv[0], coordinator.address(), options.threadNum);
+      if (pid > 0) {
+        workers.push_back(pid);
+      }
+    }
+    auto image = coordinator.run();
+    for (pid_t pid : workers) {
+      waitpid(pid, nullptr, 0);
+    }
+    std::remove(job.meshPath.c_str());
+    if (image == nullptr || !image->writePfm(outputPath)) {
+      std::cerr << "Failed to write " << outputPath << std::endl;
+      return 1;
+    }
+    const hd::RenderCoordinator::Stats& coordinatorStats = coordinator.stats();
+    std::cout << job.integrator << ": "
+        << sampleNum / coordinatorStats.wallSeconds / 1e6
+        << " Msamples/s" << std::endl;
+    std::cout << "workers=" << coordinatorStats.workerNum
+        << " lost=" << coordinatorStats.lostWorkerNum
+        << " reassigned tiles=" << coordinatorStats.reassignedTileNum << std::endl;
+    return 0;
+  }
+  hd::TileScheduler::Stats stats;
+  std::unique_ptr<hd::Image> image;
+  // Rays traced by the last run only, matching the wall time in stats.
+  uint64_t lastRunRayNum = 0;
+  hd::PerfCounter cacheMisses(hd::PerfCounter::Event::CACHE_MISSES);
+  cacheMisses.start();
+  if (isAdaptive) {
+    hd::AdaptiveRenderer renderer(*integrator, adaptiveOptions);
+    const std::string& checkpointPath = adaptiveOptions.checkpointPath;
+    if (!checkpointPath.empty() && access(checkpointPath.c_str(), F_OK) == 0) {
+      // Never overwrite a checkpoint that is not resumed, e.g. of another render.
+      auto checkpoint = hd::Checkpoint::read(checkpointPath);
+      if (checkpoint == nullptr) {
+        std::cerr << "Checkpoint " << checkpointPath
+            << " cannot be read, remove it to start over" << std::endl;
+        return 1;
+      }
+      if (!renderer.resume(*checkpoint)) {
+        std::cerr << "Checkpoint " << checkpointPath
+            << " was taken of another scene or with other settings" << std::endl;
+        return 1;
+      }
+      std::cout << "resumed after " << checkpoint->passNum << " passes" << std::endl;
+    }
+    image = renderer.render();
+    lastRunRayNum = wavefront != nullptr ? wavefront->rayNum() : 0;
+    const hd::AdaptiveRenderer::Stats& adaptiveStats = renderer.stats();
+    stats = adaptiveStats.scheduling;
+    sampleNum = adaptiveStats.sampleNum;
+    std::cout << "passes=" << adaptiveStats.passNum
+        << " converged=" << adaptiveStats.convergedPixelNum << "/" << job.width * job.height
+        << " spp=" << static_cast<double>(sampleNum) / (job.width * job.height)
+        << (adaptiveStats.outOfTime ? " (out of time)" : "") << std::endl;
+    if (adaptiveStats.checkpointFailureNum > 0) {
+      std::cerr << "Failed to write checkpoint " << adaptiveOptions.checkpointPath << std::endl;
+    }
+  } else {
+    options.outputPath = outputPath;
+    std::vector<double> sampleRates, rayRates;
+    for (unsigned int run = 0; run < repeatNum && (run == 0 || image != nullptr); ++run) {
+      uint64_t previousRayNum = wavefront != nullptr ? wavefront->rayNum() : 0;
+      image = hd::Renderer(*integrator).render(options, &stats);
+      sampleRates.push_back(sampleNum / stats.wallSeconds / 1e6);
+      if (wavefront != nullptr) {
+        lastRunRayNum = wavefront->rayNum() - previousRayNum;
+        rayRates.push_back(lastRunRayNum / stats.wallSeconds / 1e6);
+      }
+    }
+    if (image != nullptr && repeatNum > 1) {
+      std::cout << job.integrator << ": " << spread(sampleRates) << " Msamples/s" << std::endl;
+      if (!rayRates.empty()) {
+        std::cout << "rays: " << spread(rayRates) << " Mrays/s" << std::endl;
+      }
+    }
+  }
+  cacheMisses.stop();
+  if (image == nullptr || (isAdaptive && !image->writePfm(outputPath))) {
+    std::cerr << "Failed to write " << outputPath << std::endl;
+    return 1;
+  }
+  // Throughput of the last run, and counts per ray over all runs.
+  std::cout << job.integrator << ": "
+      << sampleNum / stats.wallSeconds / 1e6
+      << " Msamples/s" << std::endl;
+  if (wavefront != nullptr) {
+    double rayNum = static_cast<double>(wavefront->rayNum());
+    std::cout << "rays: " << lastRunRayNum / stats.wallSeconds / 1e6 << " Mrays/s";
+    if (cacheMisses.isAvailable() && rayNum > 0.0) {
+      std::cout << ", " << cacheMisses.value() / rayNum << " cache misses/ray";
+    }
+    std::cout << std::endl;
+    if (isCountingTraversals && rayNum > 0.0) {
+      hd::KdTree::TraversalStats traversalStats = wavefront->traversalStats();
+      std::cout << "traversals: " << traversalStats.nodeNum / rayNum << " nodes/ray, "
+          << traversalStats.entityNum / rayNum << " triangles/ray, "
+          << traversalStats.cacheMissNum / rayNum << " simulated cache misses/ray"
+          << std::endl;
+    }
+  }
+  if (cacheMisses.isAvailable()) {
+    std::cout << "cache misses: " << cacheMisses.value() << std::endl;
+  } else {
+    std::cout << "cache misses: n/a, no hardware counters" << std::endl;
+  }
+  std::cout << stats.toString();
   return 0;
 }
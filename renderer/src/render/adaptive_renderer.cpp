@@ -0,0 +1,262 @@
+#include "render/adaptive_renderer.h"
+#include "render/checkpoint_writer.h"
+#include "const.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+namespace hd {
+  namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    // Mean luminances are floored at this value when computing relative errors, so that the
+    // error of black or nearly black pixels is relative to a dim gray rather than to zero.
+    const double MIN_ERROR_LUMINANCE = 1e-2;
+
+    double secondsSince(const Clock::time_point& start) {
+      return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Relative luminance of linear sRGB.
+    double luminance(const Vector3& rgb) {
+      return 0.2126 * rgb.x + 0.7152 * rgb.y + 0.0722 * rgb.z;
+    }
+  }
+
+  AdaptiveRenderer::AdaptiveRenderer(const Integrator& integrator, const Options& options)
+      : _integrator(integrator), _options(options),
+        _scheduler(integrator.camera().width(), integrator.camera().height(), options.tileSize,
+            options.threadNum) {
+    assert(options.minSamplesPerPixel >= 2);
+    assert(options.samplesPerPass > 0);
+    assert(options.maxSamplesPerPixel >= options.minSamplesPerPixel);
+    std::size_t pixelNum = static_cast<std::size_t>(_scheduler.width()) * _scheduler.height();
+    _sums.assign(pixelNum, Vector3::zero());
+    _luminanceSquareSums.assign(pixelNum, 0.0);
+    _sampleCounts.assign(pixelNum, 0);
+    _converged.assign(pixelNum, 0);
+    _meshChecksum = Checkpoint::checksum(integrator.mesh());
+    _stats.scheduling.threads.resize(_scheduler.threadNum());
+  }
+
+  std::unique_ptr<Image> AdaptiveRenderer::render() {
+    Clock::time_point start = Clock::now();
+    double previousSeconds = _stats.wallSeconds;
+    double lastPassSeconds = 0.0;
+    std::size_t lastActivePixelNum = 0;
+    _stats.outOfTime = false;
+    std::unique_ptr<CheckpointWriter> writer;
+    if (!_options.checkpointPath.empty()) {
+      writer.reset(new CheckpointWriter(_options.checkpointPath));
+    }
+    Clock::time_point lastCheckpoint = start;
+    unsigned int checkpointPassNum = _stats.passNum;
+    while (!isDone()) {
+      std::size_t activePixelNum = _sampleCounts.size() - _stats.convergedPixelNum;
+      // Passes cost about the same per active pixel, so the next one is predicted from the
+      // last one. The first pass of a render always runs, so that there is an image.
+      if (_options.timeBudgetSeconds > 0.0 && _stats.passNum > 0) {
+        double predicted = lastActivePixelNum > 0
+            ? lastPassSeconds * activePixelNum / lastActivePixelNum : 0.0;
+        if (previousSeconds + secondsSince(start) + predicted > _options.timeBudgetSeconds) {
+          _stats.outOfTime = true;
+          break;
+        }
+      }
+      Clock::time_point passStart = Clock::now();
+      renderPass();
+      lastPassSeconds = secondsSince(passStart);
+      lastActivePixelNum = activePixelNum;
+      if (writer != nullptr
+          && secondsSince(lastCheckpoint) >= _options.checkpointIntervalSeconds) {
+        writer->submit(checkpoint());
+        lastCheckpoint = Clock::now();
+        checkpointPassNum = _stats.passNum;
+      }
+    }
+    if (writer != nullptr) {
+      if (checkpointPassNum != _stats.passNum) {
+        writer->submit(checkpoint());
+      }
+      writer->flush();
+      _stats.checkpointNum += writer->writeNum();
+      _stats.checkpointFailureNum += writer->failureNum();
+    }
+    return image();
+  }
+
+  bool AdaptiveRenderer::renderPass() {
+    if (isDone()) {
+      return false;
+    }
+    Clock::time_point start = Clock::now();
+    TileScheduler::Stats passStats = _scheduler.run(
+        [&](const TileScheduler::Tile& tile, unsigned int) {
+          _renderTile(tile);
+        });
+
+    ++_stats.passNum;
+    _countPixels();
+    _stats.wallSeconds += secondsSince(start);
+    TileScheduler::Stats& scheduling = _stats.scheduling;
+    scheduling.wallSeconds += passStats.wallSeconds;
+    for (unsigned int t = 0; t < passStats.threads.size(); ++t) {
+      scheduling.threads[t].busySeconds += passStats.threads[t].busySeconds;
+      scheduling.threads[t].tileNum += passStats.threads[t].tileNum;
+      scheduling.threads[t].stealNum += passStats.threads[t].stealNum;
+    }
+    return true;
+  }
+
+  // Tiles are disjoint, so threads update pixel sums without synchronization.
+  void AdaptiveRenderer::_renderTile(const TileScheduler::Tile& tile) {
+    std::vector<Integrator::SampleRequest> requests;
+    std::vector<unsigned int> pixels;
+    for (unsigned int y = tile.y0; y < tile.y1; ++y) {
+      for (unsigned int x = tile.x0; x < tile.x1; ++x) {
+        unsigned int pixel = y * _scheduler.width() + x;
+        unsigned int count = _passSampleCount(pixel);
+        for (unsigned int s = 0; s < count; ++s) {
+          requests.push_back(Integrator::SampleRequest(x, y, _sampleCounts[pixel] + s));
+          pixels.push_back(pixel);
+        }
+      }
+    }
+    if (requests.empty()) {
+      return;
+    }
+    std::vector<Vector3> radiance(requests.size());
+    _integrator.render(requests.data(), requests.size(), radiance.data());
+    // Samples of a pixel are consecutive, and are summed up in sample order.
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+      unsigned int pixel = pixels[i];
+      double y = luminance(radiance[i]);
+      _sums[pixel] += radiance[i];
+      _luminanceSquareSums[pixel] += y * y;
+      ++_sampleCounts[pixel];
+      if (i + 1 == requests.size() || pixels[i + 1] != pixel) {
+        _converged[pixel] = _isConverged(pixel);
+      }
+    }
+  }
+
+  unsigned int AdaptiveRenderer::_passSampleCount(unsigned int pixel) const {
+    if (_converged[pixel]) {
+      return 0;
+    }
+    unsigned int count = _sampleCounts[pixel] == 0
+        ? _options.minSamplesPerPixel : _options.samplesPerPass;
+    return std::min(count, _options.maxSamplesPerPixel - _sampleCounts[pixel]);
+  }
+
+  double AdaptiveRenderer::_relativeError(unsigned int pixel) const {
+    unsigned int n = _sampleCounts[pixel];
+    if (n < 2) {
+      return HD_INFINITY;
+    }
+    double mean = luminance(_sums[pixel]) / n;
+    double variance = std::max(0.0,
+        (_luminanceSquareSums[pixel] - mean * mean * n) / (n - 1));
+    return std::sqrt(variance / n) / std::max(std::fabs(mean), MIN_ERROR_LUMINANCE);
+  }
+
+  bool AdaptiveRenderer::_isConverged(unsigned int pixel) const {
+    return _sampleCounts[pixel] >= _options.maxSamplesPerPixel
+        || _relativeError(pixel) <= _options.targetError;
+  }
+
+  void AdaptiveRenderer::_countPixels() {
+    _stats.convergedPixelNum = std::count(_converged.begin(), _converged.end(), 1);
+    _stats.sampleNum = 0;
+    for (unsigned int count : _sampleCounts) {
+      _stats.sampleNum += count;
+    }
+  }
+
+  std::unique_ptr<Checkpoint> AdaptiveRenderer::checkpoint() const {
+    std::unique_ptr<Checkpoint> checkpoint(new Checkpoint());
+    checkpoint->width = _scheduler.width();
+    checkpoint->height = _scheduler.height();
+    checkpoint->samplerSeed = _integrator.sampler().seed();
+    checkpoint->minSamplesPerPixel = _options.minSamplesPerPixel;
+    checkpoint->maxSamplesPerPixel = _options.maxSamplesPerPixel;
+    checkpoint->samplesPerPass = _options.samplesPerPass;
+    checkpoint->targetError = _options.targetError;
+    checkpoint->integrator = _options.integratorName;
+    checkpoint->sampler = _options.samplerName;
+    checkpoint->filter = _options.filter;
+    const Camera& camera = _integrator.camera();
+    checkpoint->cameraPosition = camera.position();
+    checkpoint->cameraForward = camera.forward();
+    checkpoint->cameraRight = camera.right();
+    checkpoint->cameraUp = camera.up();
+    checkpoint->meshVertexNum = _integrator.mesh().vertexNum();
+    checkpoint->meshFaceNum = _integrator.mesh().faceNum();
+    checkpoint->meshChecksum = _meshChecksum;
+    checkpoint->passNum = _stats.passNum;
+    checkpoint->wallSeconds = _stats.wallSeconds;
+    checkpoint->sums = _sums;
+    checkpoint->luminanceSquareSums = _luminanceSquareSums;
+    checkpoint->sampleCounts = _sampleCounts;
+    return checkpoint;
+  }
+
+  bool AdaptiveRenderer::resume(const Checkpoint& checkpoint) {
+    const Camera& camera = _integrator.camera();
+    if (checkpoint.meshVertexNum != _integrator.mesh().vertexNum()
+        || checkpoint.meshFaceNum != _integrator.mesh().faceNum()
+        || checkpoint.meshChecksum != _meshChecksum
+        || !(checkpoint.cameraPosition == camera.position())
+        || !(checkpoint.cameraForward == camera.forward())
+        || !(checkpoint.cameraRight == camera.right()) || !(checkpoint.cameraUp == camera.up())
+        || checkpoint.integrator != _options.integratorName
+        || checkpoint.sampler != _options.samplerName
+        || checkpoint.filter.type != _options.filter.type
+        || checkpoint.filter.radius != _options.filter.radius
+        || checkpoint.width != _scheduler.width() || checkpoint.height != _scheduler.height()
+        || checkpoint.samplerSeed != _integrator.sampler().seed()
+        || checkpoint.minSamplesPerPixel != _options.minSamplesPerPixel
+        || checkpoint.maxSamplesPerPixel != _options.maxSamplesPerPixel
+        || checkpoint.samplesPerPass != _options.samplesPerPass
+        || checkpoint.targetError != _options.targetError
+        || checkpoint.sums.size() != _sums.size()
+        || checkpoint.luminanceSquareSums.size() != _sums.size()
+        || checkpoint.sampleCounts.size() != _sums.size()) {
+      return false;
+    }
+    _sums = checkpoint.sums;
+    _luminanceSquareSums = checkpoint.luminanceSquareSums;
+    _sampleCounts = checkpoint.sampleCounts;
+    for (std::size_t pixel = 0; pixel < _sampleCounts.size(); ++pixel) {
+      _converged[pixel] = _isConverged(pixel);
+    }
+    _stats.passNum = checkpoint.passNum;
+    _stats.wallSeconds = checkpoint.wallSeconds;
+    _countPixels();
+    return true;
+  }
+
+  std::unique_ptr<Image> AdaptiveRenderer::image() const {
+    std::unique_ptr<Image> result(new Image(_scheduler.width(), _scheduler.height()));
+    for (unsigned int y = 0; y < _scheduler.height(); ++y) {
+      for (unsigned int x = 0; x < _scheduler.width(); ++x) {
+        unsigned int pixel = y * _scheduler.width() + x;
+        if (_sampleCounts[pixel] > 0) {
+          result->at(x, y) = _sums[pixel] / _sampleCounts[pixel];
+        }
+      }
+    }
+    return result;
+  }
+
+  unsigned int AdaptiveRenderer::sampleCount(unsigned int x, unsigned int y) const {
+    assert(x < _scheduler.width() && y < _scheduler.height());
+    return _sampleCounts[y * _scheduler.width() + x];
+  }
+
+  double AdaptiveRenderer::relativeError(unsigned int x, unsigned int y) const {
+    assert(x < _scheduler.width() && y < _scheduler.height());
+    return _relativeError(y * _scheduler.width() + x);
+  }
+}
@@ -0,0 +1,40 @@
+#include "render/camera.h"
+#include "const.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace hd {
+  Camera::Camera(const Vector3& position, const Vector3& lookAt, const Vector3& up, double fovY,
+      unsigned int width, unsigned int height)
+      : _position(position), _width(width), _height(height) {
+    assert(width > 0 && height > 0);
+    assert(fovY > 0.0 && fovY < 180.0);
+    _forward = (lookAt - position).normalize();
+    Vector3 right = _forward ^ up;
+    assert(right.len2() > HD_EPSILON_TINY);
+    right.normalizeSelf();
+    double halfHeight = std::tan(fovY * HD_PI / 360.0);
+    double halfWidth = halfHeight * width / height;
+    _up = (right ^ _forward) * halfHeight;
+    _right = right * halfWidth;
+  }
+
+  Camera Camera::frame(const BoundingBox3& box, const Vector3& viewDirection,
+      const Vector3& up, double fovY, unsigned int width, unsigned int height) {
+    Vector3 center = box.minCorner() + box.size() / 2.0;
+    double radius = std::max(box.size().len() / 2.0, HD_EPSILON);
+    // Distance at which the bounding sphere of the box fits the narrower field of view.
+    double halfFov = std::tan(fovY * HD_PI / 360.0);
+    halfFov = std::min(halfFov, halfFov * width / height);
+    double distance = radius * std::sqrt(1.0 + 1.0 / (halfFov * halfFov));
+    Vector3 position = center - viewDirection.normalize() * distance;
+    return Camera(position, center, up, fovY, width, height);
+  }
+
+  Ray3 Camera::generateRay(double x, double y) const {
+    double sx = 2.0 * x / _width - 1.0;
+    double sy = 1.0 - 2.0 * y / _height;
+    return Ray3(_position, (_forward + _right * sx + _up * sy).normalize());
+  }
+}
@@ -0,0 +1,272 @@
+#include "render/checkpoint.h"
+#include "io/mapped_file.h"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace hd {
+  namespace {
+    const char CHECKPOINT_FILE_MAGIC[8] = {'H', 'D', 'C', 'K', 'P', 'T', '\0', '\0'};
+    // Written in native byte order, see mesh files.
+    const uint32_t CHECKPOINT_FILE_ENDIANNESS_TAG = 0x01020304;
+
+    // FNV-1a parameters, applied to 64-bit words as for mesh files.
+    const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+    const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+    class CheckpointFileHeader {
+      public:
+        char magic[8];
+        uint32_t version;
+        uint32_t endiannessTag;
+        uint32_t width;
+        uint32_t height;
+        uint32_t samplerSeed;
+        uint32_t minSamplesPerPixel;
+        uint32_t maxSamplesPerPixel;
+        uint32_t samplesPerPass;
+        double targetError;
+        uint32_t passNum;
+        // 0 for a box filter, 1 for a tent filter.
+        uint32_t filterType;
+        double wallSeconds;
+        // Zero-terminated names.
+        char integrator[Checkpoint::MAX_NAME_LENGTH + 1];
+        char sampler[Checkpoint::MAX_NAME_LENGTH + 1];
+        double filterRadius;
+        // Position, forward, right and up vectors of the camera.
+        double camera[12];
+        uint32_t meshVertexNum;
+        uint32_t meshFaceNum;
+        uint64_t meshChecksum;
+        // Checksum of the whole payload following the header.
+        uint64_t checksum;
+    };
+    static_assert(sizeof(CheckpointFileHeader) % 8 == 0,
+        "Checkpoint file header must be 8-byte aligned.");
+
+    uint64_t alignTo8(uint64_t size) {
+      return (size + 7) & ~static_cast<uint64_t>(7);
+    }
+
+    uint64_t payloadSize(uint64_t pixelNum) {
+      return pixelNum * 4 * sizeof(double) + alignTo8(pixelNum * sizeof(uint32_t));
+    }
+
+    uint64_t updateChecksum(uint64_t hash, const char* data, std::size_t size) {
+      assert(size % 8 == 0);
+      for (std::size_t i = 0; i < size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash ^= word;
+        hash *= FNV_PRIME;
+      }
+      return hash;
+    }
+
+    bool putName(char* field, const std::string& name) {
+      if (name.size() > Checkpoint::MAX_NAME_LENGTH) {
+        return false;
+      }
+      std::memcpy(field, name.data(), name.size());
+      return true;
+    }
+
+    // Names are not trusted to be terminated.
+    std::string getName(const char* field) {
+      return std::string(field, strnlen(field, Checkpoint::MAX_NAME_LENGTH + 1));
+    }
+
+    void putVector3(double* values, const Vector3& v) {
+      values[0] = v.x;
+      values[1] = v.y;
+      values[2] = v.z;
+    }
+
+    Vector3 getVector3(const double* values) {
+      return Vector3(values[0], values[1], values[2]);
+    }
+
+    // Write all of the data to a new file and sync it to disk. Returns false on failure, leaving
+    // whatever was written.
+    bool writeSynced(const std::string& path, const char* header, std::size_t headerSize,
+        const char* payload, std::size_t payloadSize) {
+      int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+      if (fd < 0) {
+        return false;
+      }
+      bool ok = true;
+      const char* parts[2] = {header, payload};
+      std::size_t sizes[2] = {headerSize, payloadSize};
+      for (int i = 0; i < 2 && ok; ++i) {
+        std::size_t written = 0;
+        while (written < sizes[i]) {
+          ssize_t n = ::write(fd, parts[i] + written, sizes[i] - written);
+          if (n < 0) {
+            ok = false;
+            break;
+          }
+          written += n;
+        }
+      }
+      ok = ok && ::fsync(fd) == 0;
+      return ::close(fd) == 0 && ok;
+    }
+
+    // Sync the directory holding a file, so that a rename to it is on disk.
+    bool syncDirectoryOf(const std::string& path) {
+      std::size_t slash = path.rfind('/');
+      std::string directory = slash == std::string::npos ? "."
+          : slash == 0 ? "/" : path.substr(0, slash);
+      int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      if (fd < 0) {
+        return false;
+      }
+      bool ok = ::fsync(fd) == 0;
+      return ::close(fd) == 0 && ok;
+    }
+  }
+
+  bool Checkpoint::write(const std::string& path) const {
+    std::size_t pixelNum = static_cast<std::size_t>(width) * height;
+    assert(sums.size() == pixelNum && luminanceSquareSums.size() == pixelNum
+        && sampleCounts.size() == pixelNum);
+    // Checkpoints are small next to the scene, so the payload is built in memory and
+    // checksummed before the header is written.
+    std::vector<char> payload(payloadSize(pixelNum), 0);
+    char* p = payload.data();
+    for (const Vector3& sum : sums) {
+      double values[3] = {sum.x, sum.y, sum.z};
+      std::memcpy(p, values, sizeof(values));
+      p += sizeof(values);
+    }
+    std::memcpy(p, luminanceSquareSums.data(), pixelNum * sizeof(double));
+    p += pixelNum * sizeof(double);
+    for (unsigned int count : sampleCounts) {
+      uint32_t value = count;
+      std::memcpy(p, &value, sizeof(value));
+      p += sizeof(value);
+    }
+
+    CheckpointFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CHECKPOINT_FILE_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.endiannessTag = CHECKPOINT_FILE_ENDIANNESS_TAG;
+    header.width = width;
+    header.height = height;
+    header.samplerSeed = samplerSeed;
+    header.minSamplesPerPixel = minSamplesPerPixel;
+    header.maxSamplesPerPixel = maxSamplesPerPixel;
+    header.samplesPerPass = samplesPerPass;
+    header.targetError = targetError;
+    if (!putName(header.integrator, integrator) || !putName(header.sampler, sampler)) {
+      return false;
+    }
+    header.filterType = filter.type == Film::Filter::Type::TENT ? 1 : 0;
+    header.filterRadius = filter.radius;
+    putVector3(header.camera, cameraPosition);
+    putVector3(header.camera + 3, cameraForward);
+    putVector3(header.camera + 6, cameraRight);
+    putVector3(header.camera + 9, cameraUp);
+    header.meshVertexNum = meshVertexNum;
+    header.meshFaceNum = meshFaceNum;
+    header.meshChecksum = meshChecksum;
+    header.passNum = passNum;
+    header.wallSeconds = wallSeconds;
+    header.checksum = updateChecksum(FNV_OFFSET_BASIS, payload.data(), payload.size());
+
+    // The temporary file is synced before the rename, so that the rename never makes an
+    // incomplete file visible after a crash, and the directory after it, so that the rename
+    // itself is not lost.
+    std::string tmpPath = path + ".tmp";
+    if (!writeSynced(tmpPath, reinterpret_cast<const char*>(&header), sizeof(header),
+        payload.data(), payload.size())) {
+      std::remove(tmpPath.c_str());
+      return false;
+    }
+    // Renaming over an existing file is atomic on POSIX systems.
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+      std::remove(tmpPath.c_str());
+      return false;
+    }
+    return syncDirectoryOf(path);
+  }
+
+  std::unique_ptr<Checkpoint> Checkpoint::read(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(CheckpointFileHeader)) {
+      return nullptr;
+    }
+    CheckpointFileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, CHECKPOINT_FILE_MAGIC, sizeof(header.magic)) != 0
+        || header.endiannessTag != CHECKPOINT_FILE_ENDIANNESS_TAG
+        || header.version != VERSION || header.filterType > 1) {
+      return nullptr;
+    }
+    uint64_t pixelNum = static_cast<uint64_t>(header.width) * header.height;
+    uint64_t size = payloadSize(pixelNum);
+    if (file.size() != sizeof(CheckpointFileHeader) + size) {
+      return nullptr;
+    }
+    const char* p = file.data() + sizeof(CheckpointFileHeader);
+    if (updateChecksum(FNV_OFFSET_BASIS, p, size) != header.checksum) {
+      return nullptr;
+    }
+
+    std::unique_ptr<Checkpoint> checkpoint(new Checkpoint());
+    checkpoint->width = header.width;
+    checkpoint->height = header.height;
+    checkpoint->samplerSeed = header.samplerSeed;
+    checkpoint->minSamplesPerPixel = header.minSamplesPerPixel;
+    checkpoint->maxSamplesPerPixel = header.maxSamplesPerPixel;
+    checkpoint->samplesPerPass = header.samplesPerPass;
+    checkpoint->targetError = header.targetError;
+    checkpoint->integrator = getName(header.integrator);
+    checkpoint->sampler = getName(header.sampler);
+    checkpoint->filter = Film::Filter(header.filterType == 1
+        ? Film::Filter::Type::TENT : Film::Filter::Type::BOX, header.filterRadius);
+    checkpoint->cameraPosition = getVector3(header.camera);
+    checkpoint->cameraForward = getVector3(header.camera + 3);
+    checkpoint->cameraRight = getVector3(header.camera + 6);
+    checkpoint->cameraUp = getVector3(header.camera + 9);
+    checkpoint->meshVertexNum = header.meshVertexNum;
+    checkpoint->meshFaceNum = header.meshFaceNum;
+    checkpoint->meshChecksum = header.meshChecksum;
+    checkpoint->passNum = header.passNum;
+    checkpoint->wallSeconds = header.wallSeconds;
+    checkpoint->sums.resize(pixelNum);
+    for (Vector3& sum : checkpoint->sums) {
+      double values[3];
+      std::memcpy(values, p, sizeof(values));
+      p += sizeof(values);
+      sum = Vector3(values[0], values[1], values[2]);
+    }
+    checkpoint->luminanceSquareSums.resize(pixelNum);
+    std::memcpy(checkpoint->luminanceSquareSums.data(), p, pixelNum * sizeof(double));
+    p += pixelNum * sizeof(double);
+    checkpoint->sampleCounts.resize(pixelNum);
+    for (unsigned int& count : checkpoint->sampleCounts) {
+      uint32_t value;
+      std::memcpy(&value, p, sizeof(value));
+      p += sizeof(value);
+      count = value;
+    }
+    return checkpoint;
+  }
+  uint64_t Checkpoint::checksum(const TriangularMesh& mesh) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (unsigned int i = 0; i < mesh.faceNum(); ++i) {
+      Triangle3 triangle = mesh.triangle(i);
+      double values[9];
+      for (unsigned int v = 0; v < 3; ++v) {
+        putVector3(values + 3 * v, triangle.v(v));
+      }
+      hash = updateChecksum(hash, reinterpret_cast<const char*>(values), sizeof(values));
+    }
+    return hash;
+  }
+}
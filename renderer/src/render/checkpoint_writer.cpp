@@ -0,0 +1,67 @@
+#include "render/checkpoint_writer.h"
+#include <cassert>
+#include <utility>
+
+namespace hd {
+  CheckpointWriter::CheckpointWriter(const std::string& path) : _path(path), _writing(false),
+      _closing(false), _writeNum(0), _failureNum(0) {
+    _writer = std::thread(&CheckpointWriter::_run, this);
+  }
+
+  CheckpointWriter::~CheckpointWriter() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _closing = true;
+    }
+    _condition.notify_all();
+    _writer.join();
+  }
+
+  void CheckpointWriter::submit(std::unique_ptr<Checkpoint> checkpoint) {
+    assert(checkpoint != nullptr);
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _pending = std::move(checkpoint);
+    }
+    _condition.notify_all();
+  }
+
+  bool CheckpointWriter::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _condition.wait(lock, [this]() { return _pending == nullptr && !_writing; });
+    return _failureNum == 0;
+  }
+
+  std::size_t CheckpointWriter::writeNum() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _writeNum;
+  }
+
+  std::size_t CheckpointWriter::failureNum() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _failureNum;
+  }
+
+  void CheckpointWriter::_run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+      _condition.wait(lock, [this]() { return _closing || _pending != nullptr; });
+      if (_pending == nullptr) {
+        return;
+      }
+      std::unique_ptr<Checkpoint> checkpoint = std::move(_pending);
+      _writing = true;
+      lock.unlock();
+      bool ok = checkpoint->write(_path);
+      lock.lock();
+      _writing = false;
+      if (ok) {
+        ++_writeNum;
+      } else {
+        ++_failureNum;
+      }
+      // Wake up flush().
+      _condition.notify_all();
+    }
+  }
+}
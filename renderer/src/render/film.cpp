@@ -0,0 +1,181 @@
+#include "render/film.h"
+#include "const.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace hd {
+  namespace {
+    // Atomic addition, which std::atomic<double> only offers from C++20 on.
+    void atomicAdd(std::atomic<double>& target, double value) {
+      double old = target.load(std::memory_order_relaxed);
+      while (!target.compare_exchange_weak(old, old + value, std::memory_order_relaxed)) {}
+    }
+
+    // Range [begin, end) of pixels on one axis whose centers are in (p - radius, p + radius],
+    // clipped to [low, high).
+    void footprint(double p, double radius, unsigned int low, unsigned int high,
+        unsigned int& begin, unsigned int& end) {
+      double first = std::floor(p - radius - 0.5) + 1.0;
+      double last = std::floor(p + radius - 0.5);
+      begin = first <= low ? low : static_cast<unsigned int>(std::min<double>(first, high));
+      end = last < low ? low : static_cast<unsigned int>(std::min<double>(last + 1.0, high));
+      end = std::max(begin, end);
+    }
+  }
+
+  template <typename Function>
+  void Film::_forEachFootprintPixel(const Filter& filter, double px, double py,
+      unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, Function fn) {
+    unsigned int xBegin, xEnd, yBegin, yEnd;
+    footprint(px, filter.radius, x0, x1, xBegin, xEnd);
+    footprint(py, filter.radius, y0, y1, yBegin, yEnd);
+    for (unsigned int y = yBegin; y < yEnd; ++y) {
+      double wy = filter.weight(y + 0.5 - py);
+      for (unsigned int x = xBegin; x < xEnd; ++x) {
+        double weight = wy * filter.weight(x + 0.5 - px);
+        if (weight > 0.0) {
+          fn(x, y, weight);
+        }
+      }
+    }
+  }
+
+  double Film::Filter::weight(double d) const {
+    d = std::fabs(d);
+    if (d > radius) {
+      return 0.0;
+    }
+    return type == Type::BOX ? 1.0 : 1.0 - d / radius;
+  }
+
+  unsigned int Film::Filter::margin() const {
+    return radius > 0.5 ? static_cast<unsigned int>(std::ceil(radius - 0.5)) : 0;
+  }
+
+  Film::TileBuffer::TileBuffer(const Filter& filter, unsigned int width, unsigned int height,
+      unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) : _filter(filter) {
+    assert(x0 <= x1 && x1 <= width && y0 <= y1 && y1 <= height);
+    unsigned int margin = filter.margin();
+    _x0 = x0 - std::min(x0, margin);
+    _y0 = y0 - std::min(y0, margin);
+    _x1 = std::min(x1 + margin, width);
+    _y1 = std::min(y1 + margin, height);
+    _sums.assign((_x1 - _x0) * (_y1 - _y0), Vector3::zero());
+    _weights.assign(_sums.size(), 0.0);
+  }
+
+  void Film::TileBuffer::addSample(double px, double py, const Vector3& value) {
+    unsigned int width = _x1 - _x0;
+    _forEachFootprintPixel(_filter, px, py, _x0, _y0, _x1, _y1,
+        [&](unsigned int x, unsigned int y, double weight) {
+          std::size_t i = (y - _y0) * width + (x - _x0);
+          _sums[i] += value * weight;
+          _weights[i] += weight;
+        });
+  }
+
+  const Vector3& Film::TileBuffer::sum(unsigned int x, unsigned int y) const {
+    assert(x >= _x0 && x < _x1 && y >= _y0 && y < _y1);
+    return _sums[(y - _y0) * (_x1 - _x0) + (x - _x0)];
+  }
+
+  double Film::TileBuffer::weight(unsigned int x, unsigned int y) const {
+    assert(x >= _x0 && x < _x1 && y >= _y0 && y < _y1);
+    return _weights[(y - _y0) * (_x1 - _x0) + (x - _x0)];
+  }
+
+  void Film::TileBuffer::add(unsigned int x, unsigned int y, const Vector3& sum,
+      double weight) {
+    assert(x >= _x0 && x < _x1 && y >= _y0 && y < _y1);
+    std::size_t i = (y - _y0) * (_x1 - _x0) + (x - _x0);
+    _sums[i] += sum;
+    _weights[i] += weight;
+  }
+
+  Film::Film(unsigned int width, unsigned int height, const Filter& filter)
+      : _width(width), _height(height), _filter(filter),
+        // Value-initialized, i.e. all zero.
+        _pixels(new Pixel[static_cast<std::size_t>(width) * height]()) {
+    assert(filter.radius > 0.0);
+  }
+
+  Film::TileBuffer Film::tileBuffer(unsigned int x0, unsigned int y0, unsigned int x1,
+      unsigned int y1) const {
+    return TileBuffer(_filter, _width, _height, x0, y0, x1, y1);
+  }
+
+  void Film::merge(const TileBuffer& buffer) {
+    assert(buffer._x1 <= _width && buffer._y1 <= _height);
+    std::size_t i = 0;
+    for (unsigned int y = buffer._y0; y < buffer._y1; ++y) {
+      for (unsigned int x = buffer._x0; x < buffer._x1; ++x, ++i) {
+        if (buffer._weights[i] == 0.0) {
+          continue;
+        }
+        Pixel& pixel = _pixels[static_cast<std::size_t>(y) * _width + x];
+        for (int c = 0; c < 3; ++c) {
+          atomicAdd(pixel.sum[c], buffer._sums[i][c]);
+        }
+        atomicAdd(pixel.weight, buffer._weights[i]);
+      }
+    }
+  }
+
+  void Film::addSample(double px, double py, const Vector3& value) {
+    _forEachFootprintPixel(_filter, px, py, 0, 0, _width, _height,
+        [&](unsigned int x, unsigned int y, double weight) {
+          Pixel& pixel = _pixels[static_cast<std::size_t>(y) * _width + x];
+          for (int c = 0; c < 3; ++c) {
+            atomicAdd(pixel.sum[c], value[c] * weight);
+          }
+          atomicAdd(pixel.weight, weight);
+        });
+  }
+
+  void Film::splat(double px, double py, const Vector3& value) {
+    if (!(px >= 0.0 && py >= 0.0 && px < _width && py < _height)) {
+      return;
+    }
+    Pixel& pixel = _pixels[static_cast<std::size_t>(py) * _width
+        + static_cast<unsigned int>(px)];
+    for (int c = 0; c < 3; ++c) {
+      atomicAdd(pixel.splat[c], value[c]);
+    }
+  }
+
+  void Film::clear() {
+    for (std::size_t i = 0; i < static_cast<std::size_t>(_width) * _height; ++i) {
+      for (int c = 0; c < 3; ++c) {
+        _pixels[i].sum[c].store(0.0);
+        _pixels[i].splat[c].store(0.0);
+      }
+      _pixels[i].weight.store(0.0);
+    }
+  }
+
+  Vector3 Film::pixel(unsigned int x, unsigned int y, double splatScale) const {
+    assert(x < _width && y < _height);
+    const Pixel& pixel = _pixels[static_cast<std::size_t>(y) * _width + x];
+    Vector3 sum = Vector3::zero();
+    Vector3 splat = Vector3::zero();
+    for (int c = 0; c < 3; ++c) {
+      sum[c] = pixel.sum[c].load(std::memory_order_relaxed);
+      splat[c] = pixel.splat[c].load(std::memory_order_relaxed);
+    }
+    double weight = pixel.weight.load(std::memory_order_relaxed);
+    // Pixels with no sample, or only samples at the very edge of their footprint, are black.
+    Vector3 value = weight > HD_EPSILON_TINY ? sum / weight : Vector3::zero();
+    return value + splat * splatScale;
+  }
+
+  std::unique_ptr<Image> Film::image(double splatScale) const {
+    std::unique_ptr<Image> image(new Image(_width, _height));
+    for (unsigned int y = 0; y < _height; ++y) {
+      for (unsigned int x = 0; x < _width; ++x) {
+        image->at(x, y) = pixel(x, y, splatScale);
+      }
+    }
+    return image;
+  }
+}
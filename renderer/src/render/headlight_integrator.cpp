@@ -0,0 +1,18 @@
+#include "render/headlight_integrator.h"
+#include "const.h"
+#include <cmath>
+
+namespace hd {
+  void HeadlightIntegrator::render(const SampleRequest* requests, std::size_t count,
+      Vector3* radiance) const {
+    for (std::size_t i = 0; i < count; ++i) {
+      Ray3 ray = _generateRay(requests[i]);
+      RayHit hit;
+      if (!_tree.intersect(ray, 0.0, HD_INFINITY, hit)) {
+        radiance[i] = Vector3::zero();
+        continue;
+      }
+      radiance[i] = Vector3::one() * std::fabs(_mesh.normal(_meshPoint(hit)) * ray.direction);
+    }
+  }
+}
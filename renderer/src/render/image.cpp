@@ -0,0 +1,95 @@
+#include "render/image.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+namespace hd {
+  namespace {
+    bool isLittleEndian() {
+      const uint16_t one = 1;
+      unsigned char first;
+      std::memcpy(&first, &one, 1);
+      return first == 1;
+    }
+
+    float swapBytes(float value) {
+      unsigned char bytes[sizeof(float)];
+      std::memcpy(bytes, &value, sizeof(float));
+      std::swap(bytes[0], bytes[3]);
+      std::swap(bytes[1], bytes[2]);
+      std::memcpy(&value, bytes, sizeof(float));
+      return value;
+    }
+  }
+
+  Image::Image(unsigned int width, unsigned int height)
+      : _width(width), _height(height),
+        _pixels(static_cast<std::size_t>(width) * height, Vector3::zero()) {}
+
+  Vector3& Image::at(unsigned int x, unsigned int y) {
+    assert(x < _width && y < _height);
+    return _pixels[static_cast<std::size_t>(y) * _width + x];
+  }
+
+  const Vector3& Image::at(unsigned int x, unsigned int y) const {
+    assert(x < _width && y < _height);
+    return _pixels[static_cast<std::size_t>(y) * _width + x];
+  }
+
+  // PFM stores rows from the bottom up, and a negative scale marks little-endian data.
+  bool Image::writePfm(const std::string& path) const {
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+    out << "PF\n" << _width << " " << _height << "\n-1.0\n";
+    bool swap = !isLittleEndian();
+    std::vector<float> row(3 * _width);
+    for (unsigned int y = _height; y-- > 0;) {
+      for (unsigned int x = 0; x < _width; ++x) {
+        const Vector3& p = at(x, y);
+        for (int c = 0; c < 3; ++c) {
+          float value = static_cast<float>(p[c]);
+          row[3 * x + c] = swap ? swapBytes(value) : value;
+        }
+      }
+      out.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+    }
+    return static_cast<bool>(out);
+  }
+
+  std::unique_ptr<Image> Image::readPfm(const std::string& path) {
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in) {
+      return nullptr;
+    }
+    std::string magic;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    double scale = 0.0;
+    in >> magic >> width >> height >> scale;
+    // A single whitespace character separates the header from the data.
+    in.get();
+    if (!in || magic != "PF" || width == 0 || height == 0 || scale == 0.0) {
+      return nullptr;
+    }
+    bool swap = (scale < 0.0) != isLittleEndian();
+    std::unique_ptr<Image> image(new Image(width, height));
+    std::vector<float> row(3 * width);
+    for (unsigned int y = height; y-- > 0;) {
+      if (!in.read(reinterpret_cast<char*>(row.data()), row.size() * sizeof(float))) {
+        return nullptr;
+      }
+      for (unsigned int x = 0; x < width; ++x) {
+        Vector3& p = image->at(x, y);
+        for (int c = 0; c < 3; ++c) {
+          p[c] = swap ? swapBytes(row[3 * x + c]) : row[3 * x + c];
+        }
+      }
+    }
+    return image;
+  }
+}
@@ -0,0 +1,59 @@
+#include "render/independent_sampler.h"
+#include "util/philox.h"
+#include <algorithm>
+
+namespace hd {
+  namespace {
+    // Second key word, telling the streams of samplers apart from other uses of Philox.
+    const uint32_t KEY_TAG = 0x53414d50;
+    // Samples evaluated together by fill().
+    const std::size_t BATCH_SIZE = 256;
+
+    // Number in [0, 1) with the top 53 of the 64 bits of two 32-bit words.
+    double toUnit(uint32_t high, uint32_t low) {
+      uint64_t bits = (static_cast<uint64_t>(high) << 32) | low;
+      return (bits >> 11) * (1.0 / 9007199254740992.0);
+    }
+  }
+
+  double IndependentSampler::get(unsigned int x, unsigned int y, unsigned int sampleIndex,
+      unsigned int dimension) const {
+    Philox4x32::Counter r = Philox4x32::generate(
+        {{x, y, sampleIndex, dimension / 2}}, {{_seed, KEY_TAG}});
+    return dimension % 2 == 0 ? toUnit(r[0], r[1]) : toUnit(r[2], r[3]);
+  }
+
+  void IndependentSampler::fill(std::size_t count, const unsigned int* xs,
+      const unsigned int* ys, const unsigned int* sampleIndices, unsigned int dimension,
+      unsigned int dimensionNum, double* values) const {
+    if (dimensionNum == 0) {
+      return;
+    }
+    uint32_t pair[BATCH_SIZE];
+    uint32_t r[4][BATCH_SIZE];
+    const uint32_t* counter[4] = {nullptr, nullptr, nullptr, pair};
+    uint32_t* result[4] = {r[0], r[1], r[2], r[3]};
+    unsigned int endDimension = dimension + dimensionNum;
+    for (std::size_t begin = 0; begin < count; begin += BATCH_SIZE) {
+      std::size_t n = std::min(count - begin, BATCH_SIZE);
+      counter[0] = xs + begin;
+      counter[1] = ys + begin;
+      counter[2] = sampleIndices + begin;
+      // One evaluation per pair of dimensions overlapping the requested ones.
+      for (unsigned int p = dimension / 2; p <= (endDimension - 1) / 2; ++p) {
+        std::fill(pair, pair + n, p);
+        Philox4x32::generate(n, counter, {{_seed, KEY_TAG}}, result);
+        for (unsigned int half = 0; half < 2; ++half) {
+          unsigned int d = 2 * p + half;
+          if (d < dimension || d >= endDimension) {
+            continue;
+          }
+          double* out = values + (d - dimension) * count + begin;
+          for (std::size_t i = 0; i < n; ++i) {
+            out[i] = toUnit(r[2 * half][i], r[2 * half + 1][i]);
+          }
+        }
+      }
+    }
+  }
+}
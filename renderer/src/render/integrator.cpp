@@ -0,0 +1,28 @@
+#include "render/integrator.h"
+#include "render/independent_sampler.h"
+#include <cassert>
+
+namespace hd {
+  Integrator::Integrator(const TriangularMesh& mesh, const KdTree& tree, const Camera& camera,
+      unsigned int seed) : _mesh(mesh), _tree(tree), _camera(camera),
+        _sampler(std::make_shared<IndependentSampler>(seed)) {
+    assert(tree.entityNum() == mesh.faceNum());
+  }
+
+  void Integrator::setSampler(const std::shared_ptr<const Sampler>& sampler) {
+    assert(sampler != nullptr);
+    _sampler = sampler;
+  }
+
+  double Integrator::_random(const SampleRequest& request, unsigned int dimension) const {
+    return _sampler->get(request.x, request.y, request.sampleIndex, dimension);
+  }
+
+  Ray3 Integrator::_generateRay(const SampleRequest& request) const {
+    return _camera.generateRay(request.x + _random(request, 0), request.y + _random(request, 1));
+  }
+
+  TriangularMesh::MeshPoint Integrator::_meshPoint(const RayHit& hit) const {
+    return TriangularMesh::MeshPoint(hit.entityId, Vector3(1.0 - hit.u - hit.v, hit.u, hit.v));
+  }
+}
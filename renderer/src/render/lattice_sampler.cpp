@@ -0,0 +1,170 @@
+#include "render/lattice_sampler.h"
+#include "util/bits.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace hd {
+  namespace {
+    // Generating vector of the extensible lattice sequence lattice-39102-1024-1048576.3600 of
+    // Cools, Kuo and Nuyens, good for up to 2^20 points.
+    const uint32_t GENERATING_VECTOR[LatticeSampler::LATTICE_DIMENSION_NUM] = {
+      1, 182667, 469891, 498753, 110745, 446247, 250185, 118627,
+      245333, 283199, 408519, 391023, 246327, 126539, 399185, 461527
+    };
+
+    // Per-dimension shifts of the blue noise mask, from the R2 sequence so that dimensions
+    // read far apart parts of the mask.
+    const double R2_A1 = 0.7548776662466927;
+    const double R2_A2 = 0.5698402909980532;
+
+    // Spread of the Gaussian that void-and-cluster measures clustering of pixels with.
+    const double VOID_AND_CLUSTER_SIGMA = 1.5;
+    // Fraction of pixels in the initial pattern.
+    const double VOID_AND_CLUSTER_INITIAL_FILL = 0.1;
+
+    /**
+     * Blue noise mask made by Ulichney's void-and-cluster method: pixels are ranked by adding
+     * them one at a time where they are farthest from all pixels added before, measured by a
+     * Gaussian "energy" of neighboring pixels over the torus, so that every prefix of the ranks
+     * is evenly spread.
+     */
+    class BlueNoiseMask {
+      public:
+        static const unsigned int SIZE = LatticeSampler::BLUE_NOISE_SIZE;
+        std::vector<uint16_t> ranks;
+
+      private:
+        std::vector<uint8_t> _pattern;
+        std::vector<double> _energy;
+        // Gaussian of toroidal offsets, by offset in row-major order.
+        std::vector<double> _kernel;
+
+      public:
+        BlueNoiseMask() : ranks(SIZE * SIZE), _pattern(SIZE * SIZE, 0),
+            _energy(SIZE * SIZE, 0.0), _kernel(SIZE * SIZE) {
+          for (unsigned int dy = 0; dy < SIZE; ++dy) {
+            for (unsigned int dx = 0; dx < SIZE; ++dx) {
+              double x = std::min(dx, SIZE - dx);
+              double y = std::min(dy, SIZE - dy);
+              _kernel[dy * SIZE + dx] = std::exp(-(x * x + y * y)
+                  / (2.0 * VOID_AND_CLUSTER_SIGMA * VOID_AND_CLUSTER_SIGMA));
+            }
+          }
+
+          // Initial pattern: random pixels, then moved from the tightest cluster to the
+          // largest void until that no longer changes anything.
+          std::mt19937 rng(1);
+          unsigned int initialNum = SIZE * SIZE * VOID_AND_CLUSTER_INITIAL_FILL;
+          for (unsigned int n = 0; n < initialNum;) {
+            unsigned int p = rng() % (SIZE * SIZE);
+            if (!_pattern[p]) {
+              _set(p, true);
+              ++n;
+            }
+          }
+          for (unsigned int i = 0; i < SIZE * SIZE; ++i) {
+            unsigned int cluster = _tightestCluster();
+            _set(cluster, false);
+            unsigned int largestVoid = _largestVoid();
+            _set(largestVoid, true);
+            if (largestVoid == cluster) {
+              break;
+            }
+          }
+
+          // Rank the initial pattern by taking out tightest clusters last-ranked first, then
+          // rank the rest by filling largest voids.
+          std::vector<uint8_t> initial = _pattern;
+          std::vector<double> initialEnergy = _energy;
+          for (unsigned int rank = initialNum; rank-- > 0;) {
+            unsigned int cluster = _tightestCluster();
+            _set(cluster, false);
+            ranks[cluster] = rank;
+          }
+          _pattern = initial;
+          _energy = initialEnergy;
+          for (unsigned int rank = initialNum; rank < SIZE * SIZE; ++rank) {
+            unsigned int largestVoid = _largestVoid();
+            _set(largestVoid, true);
+            ranks[largestVoid] = rank;
+          }
+        }
+
+      private:
+        void _set(unsigned int p, bool value) {
+          _pattern[p] = value;
+          double sign = value ? 1.0 : -1.0;
+          unsigned int px = p % SIZE;
+          unsigned int py = p / SIZE;
+          for (unsigned int y = 0; y < SIZE; ++y) {
+            const double* kernelRow = &_kernel[((y + SIZE - py) % SIZE) * SIZE];
+            double* energyRow = &_energy[y * SIZE];
+            for (unsigned int x = 0; x < SIZE; ++x) {
+              energyRow[x] += sign * kernelRow[(x + SIZE - px) % SIZE];
+            }
+          }
+        }
+
+        unsigned int _tightestCluster() const {
+          unsigned int best = 0;
+          double bestEnergy = -1.0;
+          for (unsigned int p = 0; p < SIZE * SIZE; ++p) {
+            if (_pattern[p] && _energy[p] > bestEnergy) {
+              best = p;
+              bestEnergy = _energy[p];
+            }
+          }
+          return best;
+        }
+
+        unsigned int _largestVoid() const {
+          unsigned int best = 0;
+          double bestEnergy = HUGE_VAL;
+          for (unsigned int p = 0; p < SIZE * SIZE; ++p) {
+            if (!_pattern[p] && _energy[p] < bestEnergy) {
+              best = p;
+              bestEnergy = _energy[p];
+            }
+          }
+          return best;
+        }
+    };
+
+    const BlueNoiseMask& blueNoiseMask() {
+      static const BlueNoiseMask mask;
+      return mask;
+    }
+  }
+
+  LatticeSampler::LatticeSampler(uint32_t seed)
+      : Sampler(seed), _blueNoise(blueNoiseMask().ranks.data()) {}
+
+  double LatticeSampler::get(unsigned int x, unsigned int y, unsigned int sampleIndex,
+      unsigned int dimension) const {
+    uint32_t pixelHash = _pixelHash(x, y);
+    uint32_t point;
+    if (dimension < LATTICE_DIMENSION_NUM) {
+      // The radical inverse of the index scaled by the generating vector, modulo 1.
+      point = reverseBits(sampleIndex) * GENERATING_VECTOR[dimension];
+    } else {
+      point = _hash(_hash(pixelHash, sampleIndex), dimension);
+    }
+    // The blue noise rank makes the leading bits of the offset, and a hash the others.
+    uint32_t seedShift = _hash(_seed, 0);
+    double shift = seedShift * (1.0 / 4294967296.0);
+    unsigned int dx = BLUE_NOISE_SIZE * std::fmod(shift + R2_A1 * dimension, 1.0);
+    unsigned int dy = BLUE_NOISE_SIZE * std::fmod(shift + R2_A2 * dimension, 1.0);
+    uint32_t rank = _blueNoise[((y + dy) % BLUE_NOISE_SIZE) * BLUE_NOISE_SIZE
+        + (x + dx) % BLUE_NOISE_SIZE];
+    uint32_t offset = (rank << 20) | (_hash(pixelHash, dimension) >> 12);
+    // Addition of 32-bit fractions wraps around modulo 1.
+    return _toUnit(point + offset);
+  }
+
+  double LatticeSampler::blueNoise(unsigned int x, unsigned int y) const {
+    return (_blueNoise[(y % BLUE_NOISE_SIZE) * BLUE_NOISE_SIZE + x % BLUE_NOISE_SIZE] + 0.5)
+        / (BLUE_NOISE_SIZE * BLUE_NOISE_SIZE);
+  }
+}
@@ -0,0 +1,44 @@
+#include "render/megakernel_integrator.h"
+#include "const.h"
+
+namespace hd {
+  void MegakernelIntegrator::render(const SampleRequest* requests, std::size_t count,
+      Vector3* radiance) const {
+    for (std::size_t i = 0; i < count; ++i) {
+      radiance[i] = _trace(requests[i]);
+    }
+  }
+
+  Vector3 MegakernelIntegrator::_trace(const SampleRequest& request) const {
+    Vector3 result = Vector3::zero();
+    Ray3 ray = _generateRay(request);
+    double throughput = 1.0;
+    for (unsigned int depth = 0; depth < _options.maxDepth; ++depth) {
+      RayHit hit;
+      if (!_tree.intersect(ray, 0.0, HD_INFINITY, hit)) {
+        result += _options.skyRadiance * throughput;
+        break;
+      }
+      Vector3 p = ray.pointAt(hit.t);
+      Vector3 geometricNormal = _tree.entity(hit.entityId).normal();
+      Vector3 shadingNormal = _mesh.normal(_meshPoint(hit));
+      _orientNormals(ray.direction, geometricNormal, shadingNormal);
+      Vector3 origin = _offsetOrigin(p, geometricNormal);
+
+      double sunWeight = _sunWeight(geometricNormal, shadingNormal);
+      if (sunWeight > 0.0
+          && !_tree.occluded(Ray3(origin, _options.sunDirection), 0.0, HD_INFINITY)) {
+        result += _options.sunIrradiance * (throughput * sunWeight);
+      }
+
+      if (depth + 1 == _options.maxDepth) {
+        break;
+      }
+      Vector3 direction = _sampleBounce(shadingNormal,
+          _random(request, 2 + 2 * depth), _random(request, 3 + 2 * depth));
+      ray = Ray3(origin, direction);
+      throughput *= _options.albedo;
+    }
+    return result;
+  }
+}
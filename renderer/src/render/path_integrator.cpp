@@ -0,0 +1,55 @@
+#include "render/path_integrator.h"
+#include "const.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace hd {
+  PathIntegrator::PathIntegrator(const TriangularMesh& mesh, const KdTree& tree,
+      const Camera& camera, const Options& options, unsigned int seed)
+      : Integrator(mesh, tree, camera, seed), _options(options) {
+    assert(options.maxDepth > 0);
+    _options.sunDirection = _options.sunDirection.normalize();
+    _rayOffset = HD_EPSILON * std::max(1.0, tree.boundingBox3().size().len());
+  }
+
+  void PathIntegrator::_orientNormals(const Vector3& rayDirection, Vector3& geometricNormal,
+      Vector3& shadingNormal) const {
+    if (geometricNormal * rayDirection > 0.0) {
+      geometricNormal = geometricNormal * -1.0;
+    }
+    if (shadingNormal * rayDirection > 0.0) {
+      shadingNormal = shadingNormal * -1.0;
+    }
+  }
+
+  Vector3 PathIntegrator::_offsetOrigin(const Vector3& p, const Vector3& geometricNormal) const {
+    return p + geometricNormal * _rayOffset;
+  }
+
+  double PathIntegrator::_sunWeight(const Vector3& geometricNormal,
+      const Vector3& shadingNormal) const {
+    double cosTheta = shadingNormal * _options.sunDirection;
+    if (cosTheta <= 0.0 || geometricNormal * _options.sunDirection <= 0.0) {
+      return 0.0;
+    }
+    // Lambertian BRDF albedo / pi times the cosine at the surface.
+    return _options.albedo / HD_PI * cosTheta;
+  }
+
+  // Malley's method: uniform points on the unit disk, projected up to the hemisphere, in a frame
+  // built around the normal without branches on its direction (Duff et al. 2017).
+  Vector3 PathIntegrator::_sampleBounce(const Vector3& shadingNormal, double u1,
+      double u2) const {
+    const Vector3& n = shadingNormal;
+    double sign = std::copysign(1.0, n.z);
+    double a = -1.0 / (sign + n.z);
+    double b = n.x * n.y * a;
+    Vector3 tangent(1.0 + sign * n.x * n.x * a, sign * b, -sign * n.x);
+    Vector3 bitangent(b, sign + n.y * n.y * a, -n.y);
+    double r = std::sqrt(u1);
+    double phi = 2.0 * HD_PI * u2;
+    double z = std::sqrt(std::max(0.0, 1.0 - u1));
+    return tangent * (r * std::cos(phi)) + bitangent * (r * std::sin(phi)) + n * z;
+  }
+}
@@ -0,0 +1,133 @@
+#include "render/pfm_stream.h"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <utility>
+
+namespace hd {
+  namespace {
+    bool isLittleEndian() {
+      const uint16_t one = 1;
+      unsigned char first;
+      std::memcpy(&first, &one, 1);
+      return first == 1;
+    }
+
+    float swapBytes(float value) {
+      unsigned char bytes[sizeof(float)];
+      std::memcpy(bytes, &value, sizeof(float));
+      std::swap(bytes[0], bytes[3]);
+      std::swap(bytes[1], bytes[2]);
+      std::memcpy(&value, bytes, sizeof(float));
+      return value;
+    }
+  }
+
+  PfmStream::PfmStream() : _film(nullptr), _dataOffset(0), _closing(false), _failed(false),
+      _regionNum(0) {}
+
+  PfmStream::~PfmStream() {
+    if (isOpen()) {
+      close();
+    }
+  }
+
+  bool PfmStream::open(const std::string& path, const Film& film) {
+    assert(!isOpen());
+    _file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!_file) {
+      return false;
+    }
+    // Same header as Image::writePfm(): little-endian data, rows from the bottom up.
+    std::ostringstream header;
+    header << "PF\n" << film.width() << " " << film.height() << "\n-1.0\n";
+    _file << header.str();
+    _dataOffset = static_cast<std::streamoff>(header.str().size());
+    // Size the file for all pixels, black until written.
+    std::streamoff dataSize = static_cast<std::streamoff>(film.width()) * film.height() * 3
+        * sizeof(float);
+    if (dataSize > 0) {
+      _file.seekp(_dataOffset + dataSize - 1);
+      _file.put('\0');
+    }
+    if (!_file) {
+      _file.close();
+      return false;
+    }
+    _film = &film;
+    _closing = false;
+    _failed = false;
+    _regionNum = 0;
+    _writer = std::thread(&PfmStream::_run, this);
+    return true;
+  }
+
+  void PfmStream::write(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) {
+    assert(isOpen());
+    assert(x0 <= x1 && x1 <= _film->width() && y0 <= y1 && y1 <= _film->height());
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _queue.push_back(Region{x0, y0, x1, y1});
+    }
+    _condition.notify_one();
+  }
+
+  bool PfmStream::close() {
+    if (!isOpen()) {
+      return false;
+    }
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _closing = true;
+    }
+    _condition.notify_one();
+    _writer.join();
+    _file.flush();
+    bool ok = !_failed && static_cast<bool>(_file);
+    _file.close();
+    _film = nullptr;
+    return ok;
+  }
+
+  void PfmStream::_run() {
+    std::vector<float> row;
+    while (true) {
+      Region region;
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait(lock, [this]() { return _closing || !_queue.empty(); });
+        if (_queue.empty()) {
+          return;
+        }
+        region = _queue.front();
+        _queue.pop_front();
+      }
+      if (!_writeRegion(region, row)) {
+        _failed = true;
+      }
+      ++_regionNum;
+    }
+  }
+
+  bool PfmStream::_writeRegion(const Region& region, std::vector<float>& row) {
+    bool swap = !isLittleEndian();
+    unsigned int width = _film->width();
+    unsigned int height = _film->height();
+    row.resize(3 * (region.x1 - region.x0));
+    for (unsigned int y = region.y0; y < region.y1; ++y) {
+      for (unsigned int x = region.x0; x < region.x1; ++x) {
+        Vector3 p = _film->pixel(x, y);
+        for (int c = 0; c < 3; ++c) {
+          float value = static_cast<float>(p[c]);
+          row[3 * (x - region.x0) + c] = swap ? swapBytes(value) : value;
+        }
+      }
+      std::streamoff pixelIndex = static_cast<std::streamoff>(height - 1 - y) * width
+          + region.x0;
+      _file.seekp(_dataOffset + pixelIndex * 3 * static_cast<std::streamoff>(sizeof(float)));
+      _file.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+    }
+    return static_cast<bool>(_file);
+  }
+}
@@ -0,0 +1,225 @@
+#include "render/render_coordinator.h"
+#include "render/render_protocol.h"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <utility>
+#include <poll.h>
+
+namespace hd {
+  namespace {
+    // Time a whole message may take to arrive once its first bytes did, so that a worker
+    // stalling or trickling bytes mid-message cannot block the coordinator for longer.
+    const double MESSAGE_TIMEOUT_SECONDS = 30.0;
+    // Time a poll waits for any socket, between checks of the timeouts.
+    const int POLL_TIMEOUT_MILLISECONDS = 100;
+
+    double secondsBetween(std::chrono::steady_clock::time_point start,
+        std::chrono::steady_clock::time_point end) {
+      return std::chrono::duration<double>(end - start).count();
+    }
+  }
+
+  RenderCoordinator::RenderCoordinator(const RenderJob& job, const Options& options)
+      : _job(job), _options(options) {
+    assert(options.tileSize > 0);
+  }
+
+  bool RenderCoordinator::listen(const std::string& address) {
+    return _server.listen(address);
+  }
+
+  std::unique_ptr<Image> RenderCoordinator::run() {
+    if (!_server.isOpen()) {
+      return nullptr;
+    }
+    _stats = Stats();
+    Clock::time_point start = Clock::now();
+    // Tiles are only laid out by the scheduler here; workers render them with their own.
+    TileScheduler scheduler(_job.width, _job.height, _options.tileSize, 1);
+    Film film(_job.width, _job.height, _job.filter);
+    std::deque<unsigned int> queue;
+    for (unsigned int i = 0; i < scheduler.tileNum(); ++i) {
+      queue.push_back(i);
+    }
+    std::vector<bool> merged(scheduler.tileNum(), false);
+    unsigned int mergedNum = 0;
+    std::vector<std::unique_ptr<Connection>> connections;
+    Clock::time_point lastProgress = start;
+
+    while (mergedNum < scheduler.tileNum()) {
+      std::vector<pollfd> fds(connections.size() + 1);
+      fds[0].fd = _server.fd();
+      fds[0].events = POLLIN;
+      for (std::size_t i = 0; i < connections.size(); ++i) {
+        fds[i + 1].fd = connections[i]->socket.fd();
+        fds[i + 1].events = POLLIN;
+      }
+      if (poll(fds.data(), fds.size(), POLL_TIMEOUT_MILLISECONDS) < 0 && errno != EINTR) {
+        return nullptr;
+      }
+      Clock::time_point now = Clock::now();
+      for (std::size_t i = 0; i < connections.size(); ++i) {
+        Connection& connection = *connections[i];
+        bool isAlive = true;
+        if (fds[i + 1].revents != 0) {
+          unsigned int oldMergedNum = mergedNum;
+          isAlive = _receive(connection, scheduler, film, merged, mergedNum);
+          if (mergedNum > oldMergedNum) {
+            lastProgress = Clock::now();
+          }
+        }
+        if (_options.tileTimeoutSeconds > 0.0 && !connection.tiles.empty()
+            && secondsBetween(connection.waitingSince, now) > _options.tileTimeoutSeconds) {
+          isAlive = false;
+        }
+        if (!isAlive) {
+          _drop(connection, merged, queue);
+        }
+      }
+      if ((fds[0].revents & POLLIN) != 0) {
+        Socket socket = _server.accept();
+        if (socket.isOpen() && socket.setReceiveTimeout(MESSAGE_TIMEOUT_SECONDS)) {
+          connections.emplace_back(new Connection(std::move(socket)));
+          ++_stats.workerNum;
+        }
+      }
+      for (auto& connection : connections) {
+        if (connection->socket.isOpen() && !_assign(*connection, scheduler, merged, queue)) {
+          _drop(*connection, merged, queue);
+        }
+      }
+      std::size_t openNum = 0;
+      for (std::size_t i = 0; i < connections.size(); ++i) {
+        if (connections[i]->socket.isOpen()) {
+          std::swap(connections[openNum++], connections[i]);
+        }
+      }
+      connections.resize(openNum);
+      bool isAbandoned = connections.empty() && _options.isWorkerExpected
+          && !_options.isWorkerExpected();
+      if (isAbandoned || (_options.idleTimeoutSeconds > 0.0
+          && secondsBetween(lastProgress, Clock::now()) > _options.idleTimeoutSeconds)) {
+        _stats.wallSeconds = secondsBetween(start, Clock::now());
+        return nullptr;
+      }
+    }
+
+    for (auto& connection : connections) {
+      if (connection->threadNum > 0) {
+        connection->socket.send(Message(RenderProtocol::DONE));
+      }
+    }
+    _stats.wallSeconds = secondsBetween(start, Clock::now());
+    return film.image();
+  }
+
+  bool RenderCoordinator::_receive(Connection& connection, const TileScheduler& scheduler,
+      Film& film, std::vector<bool>& merged, unsigned int& mergedNum) {
+    // Tile buffers extend past their tile by the filter margin, within the image.
+    uint64_t bufferSize = _options.tileSize + 2 * _job.filter.margin();
+    uint64_t bufferPixelNum = std::min<uint64_t>(bufferSize, _job.width)
+        * std::min<uint64_t>(bufferSize, _job.height);
+    Message message;
+    if (!connection.socket.receive(message, [bufferPixelNum](uint32_t type) {
+          return RenderProtocol::maxPayloadSize(type, bufferPixelNum);
+        })) {
+      return false;
+    }
+    if (message.type == RenderProtocol::HELLO && connection.threadNum == 0) {
+      uint32_t version, endiannessTag, threadNum;
+      if (!message.get(version) || !message.get(endiannessTag) || !message.get(threadNum)
+          || version != RenderProtocol::VERSION
+          || endiannessTag != RenderProtocol::ENDIANNESS_TAG || threadNum == 0) {
+        return false;
+      }
+      connection.threadNum = threadNum;
+      Message job(RenderProtocol::JOB);
+      _job.write(job);
+      return connection.socket.send(job);
+    }
+    if (message.type != RenderProtocol::RESULT || connection.threadNum == 0) {
+      return false;
+    }
+    uint32_t tileIndex, x0, y0, x1, y1;
+    if (!message.get(tileIndex) || !message.get(x0) || !message.get(y0) || !message.get(x1)
+        || !message.get(y1)) {
+      return false;
+    }
+    auto assigned = connection.tiles.find(tileIndex);
+    if (assigned == connection.tiles.end()) {
+      return false;
+    }
+    connection.tiles.erase(assigned);
+    connection.waitingSince = Clock::now();
+    // Tiles are handed out again only once their worker is dropped, so this is a safeguard.
+    if (merged[tileIndex]) {
+      return true;
+    }
+    const TileScheduler::Tile& tile = scheduler.tile(tileIndex);
+    Film::TileBuffer buffer = film.tileBuffer(tile.x0, tile.y0, tile.x1, tile.y1);
+    if (x0 != buffer.x0() || y0 != buffer.y0() || x1 != buffer.x1() || y1 != buffer.y1()) {
+      return false;
+    }
+    for (unsigned int y = y0; y < y1; ++y) {
+      for (unsigned int x = x0; x < x1; ++x) {
+        double values[4];
+        if (!message.getBytes(values, sizeof(values))) {
+          return false;
+        }
+        buffer.add(x, y, Vector3(values[0], values[1], values[2]), values[3]);
+      }
+    }
+    if (!message.isFullyRead()) {
+      return false;
+    }
+    film.merge(buffer);
+    merged[tileIndex] = true;
+    ++mergedNum;
+    return true;
+  }
+
+  bool RenderCoordinator::_assign(Connection& connection, const TileScheduler& scheduler,
+      const std::vector<bool>& merged, std::deque<unsigned int>& queue) {
+    if (connection.threadNum == 0) {
+      return true;
+    }
+    if (connection.tiles.empty()) {
+      connection.waitingSince = Clock::now();
+    }
+    // Twice the threads, so that a worker has its next tiles at hand when it finishes one.
+    while (connection.tiles.size() < 2 * connection.threadNum && !queue.empty()) {
+      unsigned int tileIndex = queue.front();
+      queue.pop_front();
+      if (merged[tileIndex]) {
+        continue;
+      }
+      const TileScheduler::Tile& tile = scheduler.tile(tileIndex);
+      Message message(RenderProtocol::TILE);
+      message.put<uint32_t>(tileIndex);
+      message.put<uint32_t>(tile.x0);
+      message.put<uint32_t>(tile.y0);
+      message.put<uint32_t>(tile.x1);
+      message.put<uint32_t>(tile.y1);
+      connection.tiles.insert(tileIndex);
+      if (!connection.socket.send(message)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void RenderCoordinator::_drop(Connection& connection, const std::vector<bool>& merged,
+      std::deque<unsigned int>& queue) {
+    connection.socket.close();
+    ++_stats.lostWorkerNum;
+    // In reverse, so that the tiles keep their order at the front of the queue.
+    for (auto tile = connection.tiles.rbegin(); tile != connection.tiles.rend(); ++tile) {
+      if (!merged[*tile]) {
+        queue.push_front(*tile);
+        ++_stats.reassignedTileNum;
+      }
+    }
+    connection.tiles.clear();
+  }
+}
@@ -0,0 +1,185 @@
+#include "render/render_daemon.h"
+#include "render/render_protocol.h"
+#include "render/renderer.h"
+#include <chrono>
+#include <string>
+
+namespace hd {
+  namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    // Size of the values preceding the pixels in an IMAGE message.
+    const std::size_t IMAGE_HEADER_SIZE = 3 * sizeof(uint32_t) + 2 * sizeof(double);
+
+    double secondsSince(Clock::time_point start) {
+      return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+  }
+
+  RenderDaemon::RenderDaemon(const Options& options) : _options(options),
+      _cache(options.cacheBytes) {}
+
+  bool RenderDaemon::listen(const std::string& address) {
+    return _server.listen(address);
+  }
+
+  bool RenderDaemon::run() {
+    if (!_server.isOpen()) {
+      return false;
+    }
+    while (true) {
+      Socket socket = _server.accept();
+      if (socket.isOpen() && !_serve(socket)) {
+        _server.close();
+        return true;
+      }
+    }
+  }
+
+  std::unique_ptr<Image> RenderDaemon::render(const std::string& address, const RenderJob& job,
+      JobStats* stats, std::string* error) {
+    std::string reason;
+    Socket socket = Socket::connect(address);
+    Message request(RenderProtocol::RENDER);
+    request.put<uint32_t>(RenderProtocol::VERSION);
+    request.put<uint32_t>(RenderProtocol::ENDIANNESS_TAG);
+    job.write(request);
+    Message response;
+    if (!socket.isOpen()) {
+      reason = "cannot connect to " + address;
+    } else if (!socket.send(request) || !socket.receive(response, [&job](uint32_t type) {
+          return RenderProtocol::maxPayloadSize(type,
+              static_cast<uint64_t>(job.width) * job.height);
+        })) {
+      reason = "connection lost";
+    } else if (response.type == RenderProtocol::FAILED) {
+      if (!response.getString(reason)) {
+        reason = "malformed response";
+      }
+    } else {
+      uint32_t isSceneCached, width, height;
+      JobStats jobStats;
+      if (response.type == RenderProtocol::IMAGE && response.get(isSceneCached)
+          && response.get(jobStats.loadSeconds) && response.get(jobStats.renderSeconds)
+          && response.get(width) && response.get(height)
+          && response.payload.size() - IMAGE_HEADER_SIZE
+              == static_cast<std::size_t>(width) * height * 3 * sizeof(double)) {
+        std::unique_ptr<Image> image(new Image(width, height));
+        for (unsigned int y = 0; y < height; ++y) {
+          for (unsigned int x = 0; x < width; ++x) {
+            double values[3];
+            response.getBytes(values, sizeof(values));
+            image->at(x, y) = Vector3(values[0], values[1], values[2]);
+          }
+        }
+        jobStats.isSceneCached = isSceneCached != 0;
+        if (stats != nullptr) {
+          *stats = jobStats;
+        }
+        return image;
+      }
+      reason = "malformed response";
+    }
+    if (error != nullptr) {
+      *error = reason;
+    }
+    return nullptr;
+  }
+
+  bool RenderDaemon::shutdown(const std::string& address) {
+    Socket socket = Socket::connect(address);
+    Message response;
+    return socket.isOpen() && socket.send(Message(RenderProtocol::SHUTDOWN))
+        && socket.receive(response) && response.type == RenderProtocol::DONE;
+  }
+
+  bool RenderDaemon::_serve(Socket& socket) {
+    Message request;
+    if (!socket.setReceiveTimeout(_options.requestTimeoutSeconds)
+        || !socket.receive(request)) {
+      ++_stats.badRequestNum;
+      return true;
+    }
+    if (request.type == RenderProtocol::SHUTDOWN) {
+      socket.send(Message(RenderProtocol::DONE));
+      return false;
+    }
+    uint32_t version, endiannessTag;
+    RenderJob job;
+    if (request.type != RenderProtocol::RENDER || !request.get(version)
+        || !request.get(endiannessTag) || version != RenderProtocol::VERSION
+        || endiannessTag != RenderProtocol::ENDIANNESS_TAG || !job.read(request)
+        || !request.isFullyRead()) {
+      ++_stats.badRequestNum;
+      Message response(RenderProtocol::FAILED);
+      response.putString("malformed request");
+      socket.send(response);
+      return true;
+    }
+
+    ++_stats.jobNum;
+    JobStats stats;
+    std::string error;
+    std::unique_ptr<Image> image = _render(job, stats, error);
+    if (image == nullptr) {
+      ++_stats.failedJobNum;
+      Message response(RenderProtocol::FAILED);
+      response.putString(error);
+      socket.send(response);
+      return true;
+    }
+    Message response(RenderProtocol::IMAGE);
+    response.payload.reserve(IMAGE_HEADER_SIZE
+        + static_cast<std::size_t>(image->width()) * image->height() * 3 * sizeof(double));
+    response.put<uint32_t>(stats.isSceneCached ? 1 : 0);
+    response.put(stats.loadSeconds);
+    response.put(stats.renderSeconds);
+    response.put<uint32_t>(image->width());
+    response.put<uint32_t>(image->height());
+    for (unsigned int y = 0; y < image->height(); ++y) {
+      for (unsigned int x = 0; x < image->width(); ++x) {
+        const Vector3& pixel = image->at(x, y);
+        double values[3] = {pixel.x, pixel.y, pixel.z};
+        response.putBytes(values, sizeof(values));
+      }
+    }
+    socket.send(response);
+    return true;
+  }
+
+  std::unique_ptr<Image> RenderDaemon::_render(const RenderJob& job, JobStats& stats,
+      std::string& error) {
+    if (job.width == 0 || job.height == 0 || job.samplesPerPixel == 0
+        || !(job.filter.radius > 0.0)) {
+      error = "invalid job settings";
+      return nullptr;
+    }
+    if (static_cast<uint64_t>(job.width) * job.height > _options.maxPixelNum) {
+      error = "image larger than " + std::to_string(_options.maxPixelNum) + " pixels";
+      return nullptr;
+    }
+    Clock::time_point start = Clock::now();
+    std::size_t loadNum = _cache.stats().loads;
+    std::shared_ptr<const Scene> scene = _cache.get(job.meshPath);
+    if (scene == nullptr) {
+      error = "cannot read scene " + job.meshPath;
+      return nullptr;
+    }
+    stats.isSceneCached = _cache.stats().loads == loadNum;
+    auto integrator = job.createIntegrator(*scene->mesh(0), *scene->kdTree(0));
+    if (integrator == nullptr) {
+      error = "unknown integrator " + job.integrator + " or sampler " + job.sampler;
+      return nullptr;
+    }
+    stats.loadSeconds = secondsSince(start);
+    start = Clock::now();
+    Renderer::Options options;
+    options.samplesPerPixel = job.samplesPerPixel;
+    options.tileSize = _options.tileSize;
+    options.threadNum = _options.threadNum;
+    options.filter = job.filter;
+    std::unique_ptr<Image> image = Renderer(*integrator).render(options);
+    stats.renderSeconds = secondsSince(start);
+    return image;
+  }
+}
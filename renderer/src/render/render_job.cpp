@@ -0,0 +1,100 @@
+#include "render/render_job.h"
+#include "render/headlight_integrator.h"
+#include "render/independent_sampler.h"
+#include "render/lattice_sampler.h"
+#include "render/megakernel_integrator.h"
+#include "render/sobol_sampler.h"
+#include "render/wavefront_integrator.h"
+
+namespace hd {
+  namespace {
+    void putVector3(Message& message, const Vector3& v) {
+      message.put(v.x);
+      message.put(v.y);
+      message.put(v.z);
+    }
+
+    bool getVector3(Message& message, Vector3& v) {
+      double x, y, z;
+      if (!message.get(x) || !message.get(y) || !message.get(z)) {
+        return false;
+      }
+      v = Vector3(x, y, z);
+      return true;
+    }
+  }
+
+  Camera RenderJob::camera(const BoundingBox3& sceneBox) const {
+    if (isInside) {
+      Vector3 center = sceneBox.minCorner() + sceneBox.size() / 2.0;
+      return Camera(center, center + viewDirection, up, fovY, width, height);
+    }
+    return Camera::frame(sceneBox, viewDirection, up, fovY, width, height);
+  }
+
+  std::unique_ptr<Integrator> RenderJob::createIntegrator(const TriangularMesh& mesh,
+      const KdTree& tree) const {
+    Camera camera = this->camera(tree.boundingBox3());
+    std::unique_ptr<Integrator> result;
+    if (integrator == "headlight") {
+      result.reset(new HeadlightIntegrator(mesh, tree, camera));
+    } else if (integrator == "megakernel") {
+      result.reset(new MegakernelIntegrator(mesh, tree, camera));
+    } else if (integrator == "wavefront") {
+      WavefrontIntegrator* wavefront = new WavefrontIntegrator(mesh, tree, camera);
+      wavefront->setSortingRays(isSortingRays);
+      result.reset(wavefront);
+    } else {
+      return nullptr;
+    }
+    if (sampler == "independent") {
+      result->setSampler(std::make_shared<IndependentSampler>(samplerSeed));
+    } else if (sampler == "sobol") {
+      result->setSampler(std::make_shared<SobolSampler>(samplerSeed));
+    } else if (sampler == "lattice") {
+      result->setSampler(std::make_shared<LatticeSampler>(samplerSeed));
+    } else {
+      return nullptr;
+    }
+    return result;
+  }
+
+  void RenderJob::write(Message& message) const {
+    message.putString(meshPath);
+    message.put<uint32_t>(width);
+    message.put<uint32_t>(height);
+    putVector3(message, viewDirection);
+    putVector3(message, up);
+    message.put(fovY);
+    message.put<uint32_t>(isInside ? 1 : 0);
+    message.putString(integrator);
+    message.putString(sampler);
+    message.put(samplerSeed);
+    message.put<uint32_t>(samplesPerPixel);
+    message.put<uint32_t>(filter.type == Film::Filter::Type::TENT ? 1 : 0);
+    message.put(filter.radius);
+    message.put<uint32_t>(isSortingRays ? 1 : 0);
+  }
+
+  const uint64_t RenderJob::MAX_PIXEL_NUM;
+
+  bool RenderJob::read(Message& message) {
+    uint32_t w, h, inside, spp, filterType, sortingRays;
+    if (!message.getString(meshPath) || !message.get(w) || !message.get(h)
+        || !getVector3(message, viewDirection) || !getVector3(message, up)
+        || !message.get(fovY) || !message.get(inside) || !message.getString(integrator)
+        || !message.getString(sampler) || !message.get(samplerSeed) || !message.get(spp)
+        || !message.get(filterType) || !message.get(filter.radius) || filterType > 1
+        || !message.get(sortingRays)
+        || static_cast<uint64_t>(w) * h > MAX_PIXEL_NUM) {
+      return false;
+    }
+    isInside = inside != 0;
+    isSortingRays = sortingRays != 0;
+    width = w;
+    height = h;
+    samplesPerPixel = spp;
+    filter.type = filterType == 1 ? Film::Filter::Type::TENT : Film::Filter::Type::BOX;
+    return true;
+  }
+}
@@ -0,0 +1,159 @@
+#include "render/render_worker.h"
+#include "geometry/kd_tree.h"
+#include "io/mesh_serializer.h"
+#include "io/socket.h"
+#include "render/render_job.h"
+#include "render/render_protocol.h"
+#include "render/renderer.h"
+#include "util/parallel.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hd {
+  namespace {
+    // Time between two attempts to connect.
+    const int CONNECT_RETRY_MILLISECONDS = 50;
+
+    bool readTile(Message& message, TileScheduler::Tile& tile) {
+      uint32_t index, x0, y0, x1, y1;
+      if (!message.get(index) || !message.get(x0) || !message.get(y0) || !message.get(x1)
+          || !message.get(y1) || !message.isFullyRead() || x0 > x1 || y0 > y1) {
+        return false;
+      }
+      tile.index = index;
+      tile.x0 = x0;
+      tile.y0 = y0;
+      tile.x1 = x1;
+      tile.y1 = y1;
+      return true;
+    }
+  }
+
+  bool RenderWorker::run(const std::string& address) {
+    typedef std::chrono::steady_clock Clock;
+    _stats = Stats();
+    Clock::time_point start = Clock::now();
+    Socket socket = Socket::connect(address);
+    while (!socket.isOpen() && std::chrono::duration<double>(Clock::now() - start).count()
+        < _options.connectTimeoutSeconds) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(CONNECT_RETRY_MILLISECONDS));
+      socket = Socket::connect(address);
+    }
+    if (!socket.isOpen()) {
+      return false;
+    }
+    unsigned int threadNum = _options.threadNum > 0 ? _options.threadNum : parallelThreadNum();
+    Message hello(RenderProtocol::HELLO);
+    hello.put<uint32_t>(RenderProtocol::VERSION);
+    hello.put<uint32_t>(RenderProtocol::ENDIANNESS_TAG);
+    hello.put<uint32_t>(threadNum);
+    Message message;
+    RenderJob job;
+    if (!socket.send(hello) || !socket.receive(message) || message.type != RenderProtocol::JOB
+        || !job.read(message) || !message.isFullyRead()) {
+      return false;
+    }
+    auto mesh = MeshSerializer::read(job.meshPath);
+    if (mesh == nullptr) {
+      return false;
+    }
+    auto tree = KdTree::build(*mesh);
+    auto integrator = job.createIntegrator(*mesh, *tree);
+    if (integrator == nullptr || integrator->camera().width() != job.width
+        || integrator->camera().height() != job.height) {
+      return false;
+    }
+    Renderer renderer(*integrator);
+
+    // Tiles are received on this thread and rendered on the pool, whose threads send results
+    // in turn.
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<TileScheduler::Tile> tiles;
+    bool isClosing = false;
+    bool isBroken = false;
+    std::mutex sendMutex;
+    auto work = [&]() {
+      while (true) {
+        TileScheduler::Tile tile;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          condition.wait(lock, [&]() { return isClosing || !tiles.empty(); });
+          if (isClosing) {
+            return;
+          }
+          tile = tiles.front();
+          tiles.pop_front();
+        }
+        Film::TileBuffer buffer(job.filter, job.width, job.height, tile.x0, tile.y0, tile.x1,
+            tile.y1);
+        renderer.renderTile(tile, job.samplesPerPixel, buffer);
+        Message result(RenderProtocol::RESULT);
+        result.put<uint32_t>(tile.index);
+        result.put<uint32_t>(buffer.x0());
+        result.put<uint32_t>(buffer.y0());
+        result.put<uint32_t>(buffer.x1());
+        result.put<uint32_t>(buffer.y1());
+        result.payload.reserve(result.payload.size()
+            + (buffer.x1() - buffer.x0()) * (buffer.y1() - buffer.y0()) * 4 * sizeof(double));
+        for (unsigned int y = buffer.y0(); y < buffer.y1(); ++y) {
+          for (unsigned int x = buffer.x0(); x < buffer.x1(); ++x) {
+            const Vector3& sum = buffer.sum(x, y);
+            double values[4] = {sum.x, sum.y, sum.z, buffer.weight(x, y)};
+            result.putBytes(values, sizeof(values));
+          }
+        }
+        bool isSent;
+        {
+          std::lock_guard<std::mutex> lock(sendMutex);
+          isSent = socket.send(result);
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (isSent) {
+          ++_stats.tileNum;
+        } else {
+          isBroken = true;
+        }
+      }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < threadNum; ++i) {
+      threads.push_back(std::thread(work));
+    }
+
+    // Receiving blocks for as long as the coordinator has nothing to say, which may be the time
+    // all tiles of the job take.
+    socket.setReceiveTimeout(0.0);
+    bool isDone = false;
+    while (!isDone) {
+      TileScheduler::Tile tile;
+      if (!socket.receive(message)) {
+        break;
+      }
+      if (message.type == RenderProtocol::DONE) {
+        isDone = true;
+      } else if (message.type == RenderProtocol::TILE && readTile(message, tile)
+          && tile.x1 <= job.width && tile.y1 <= job.height) {
+        std::lock_guard<std::mutex> lock(mutex);
+        tiles.push_back(tile);
+        condition.notify_one();
+      } else {
+        break;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      isClosing = true;
+    }
+    condition.notify_all();
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    _stats.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return isDone && !isBroken;
+  }
+}
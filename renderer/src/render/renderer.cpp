@@ -0,0 +1,92 @@
+#include "render/renderer.h"
+#include "render/pfm_stream.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <vector>
+
+namespace hd {
+  std::unique_ptr<Image> Renderer::render(const Options& options,
+      TileScheduler::Stats* stats) const {
+    assert(options.samplesPerPixel > 0);
+    const Camera& camera = _integrator.camera();
+    Film film(camera.width(), camera.height(), options.filter);
+    TileScheduler scheduler(camera.width(), camera.height(), options.tileSize,
+        options.threadNum);
+    PfmStream stream;
+    if (!options.outputPath.empty() && !stream.open(options.outputPath, film)) {
+      return nullptr;
+    }
+
+    // Tiles, in row-major order, whose samples may reach a tile: those up to reach tiles away.
+    unsigned int columnNum = (camera.width() + options.tileSize - 1) / options.tileSize;
+    unsigned int rowNum = (camera.height() + options.tileSize - 1) / options.tileSize;
+    unsigned int reach = (options.filter.margin() + options.tileSize - 1) / options.tileSize;
+    auto forEachNeighbour = [&](unsigned int tileIndex,
+        const std::function<void(unsigned int)>& fn) {
+      unsigned int column = tileIndex % columnNum;
+      unsigned int row = tileIndex / columnNum;
+      for (unsigned int r = row - std::min(row, reach); r <= std::min(row + reach, rowNum - 1);
+          ++r) {
+        for (unsigned int c = column - std::min(column, reach);
+            c <= std::min(column + reach, columnNum - 1); ++c) {
+          fn(r * columnNum + c);
+        }
+      }
+    };
+    // Number of tiles reaching each tile that are not merged yet. A tile is final at 0.
+    std::unique_ptr<std::atomic<unsigned int>[]> pendingNums(
+        new std::atomic<unsigned int>[scheduler.tileNum()]);
+    for (unsigned int i = 0; i < scheduler.tileNum(); ++i) {
+      unsigned int pendingNum = 0;
+      forEachNeighbour(i, [&](unsigned int) { ++pendingNum; });
+      pendingNums[i].store(pendingNum);
+    }
+
+    TileScheduler::Stats runStats = scheduler.run(
+        [&](const TileScheduler::Tile& tile, unsigned int) {
+          Film::TileBuffer buffer = film.tileBuffer(tile.x0, tile.y0, tile.x1, tile.y1);
+          renderTile(tile, options.samplesPerPixel, buffer);
+          film.merge(buffer);
+          if (stream.isOpen()) {
+            forEachNeighbour(tile.index, [&](unsigned int neighbour) {
+              if (--pendingNums[neighbour] == 0) {
+                const TileScheduler::Tile& done = scheduler.tile(neighbour);
+                stream.write(done.x0, done.y0, done.x1, done.y1);
+              }
+            });
+          }
+        });
+    if (stats != nullptr) {
+      *stats = runStats;
+    }
+    if (stream.isOpen() && !stream.close()) {
+      return nullptr;
+    }
+    return film.image();
+  }
+
+  void Renderer::renderTile(const TileScheduler::Tile& tile, unsigned int samplesPerPixel,
+      Film::TileBuffer& buffer) const {
+    std::vector<Integrator::SampleRequest> requests;
+    requests.reserve(tile.pixelNum() * samplesPerPixel);
+    for (unsigned int y = tile.y0; y < tile.y1; ++y) {
+      for (unsigned int x = tile.x0; x < tile.x1; ++x) {
+        for (unsigned int s = 0; s < samplesPerPixel; ++s) {
+          requests.push_back(Integrator::SampleRequest(x, y, s));
+        }
+      }
+    }
+    std::vector<Vector3> radiance(requests.size());
+    _integrator.render(requests.data(), requests.size(), radiance.data());
+    const Sampler& sampler = _integrator.sampler();
+    for (std::size_t i = 0; i < requests.size(); ++i) {
+      const Integrator::SampleRequest& request = requests[i];
+      // Where in its pixel the sample was taken, as jittered by the integrator.
+      double px = request.x + sampler.get(request.x, request.y, request.sampleIndex, 0);
+      double py = request.y + sampler.get(request.x, request.y, request.sampleIndex, 1);
+      buffer.addSample(px, py, radiance[i]);
+    }
+  }
+}
@@ -0,0 +1,30 @@
+#include "render/sampler.h"
+
+namespace hd {
+  void Sampler::fill(std::size_t count, const unsigned int* xs, const unsigned int* ys,
+      const unsigned int* sampleIndices, unsigned int dimension, unsigned int dimensionNum,
+      double* values) const {
+    for (unsigned int d = 0; d < dimensionNum; ++d) {
+      for (std::size_t i = 0; i < count; ++i) {
+        values[d * count + i] = get(xs[i], ys[i], sampleIndices[i], dimension + d);
+      }
+    }
+  }
+
+  uint32_t Sampler::_pixelHash(unsigned int x, unsigned int y) const {
+    return _hash(_hash(_seed, x), y);
+  }
+
+  uint32_t Sampler::_hash(uint32_t a, uint32_t b) {
+    return static_cast<uint32_t>(_mix((static_cast<uint64_t>(a) << 32) | b) >> 32);
+  }
+
+  uint64_t Sampler::_mix(uint64_t h) {
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+  }
+}
@@ -0,0 +1,92 @@
+#include "render/sobol_sampler.h"
+#include "util/bits.h"
+#include <cassert>
+
+namespace hd {
+  namespace {
+    // Primitive polynomial degree s, coefficients a and initial direction numbers m of Sobol
+    // dimensions 1 to 3, from new-joe-kuo-6.21201 (Joe and Kuo, 2008). Dimension 0 is the van
+    // der Corput sequence.
+    class JoeKuoDimension {
+      public:
+        unsigned int s;
+        unsigned int a;
+        uint32_t m[3];
+    };
+    const JoeKuoDimension JOE_KUO_DIMENSIONS[SobolSampler::GROUP_DIMENSION_NUM - 1] = {
+      {1, 0, {1}},
+      {2, 1, {1, 3}},
+      {3, 1, {1, 3, 1}},
+    };
+
+    class DirectionTable {
+      public:
+        uint32_t v[SobolSampler::GROUP_DIMENSION_NUM][32];
+      public:
+        DirectionTable() {
+          for (unsigned int i = 0; i < 32; ++i) {
+            v[0][i] = 1u << (31 - i);
+          }
+          for (unsigned int d = 1; d < SobolSampler::GROUP_DIMENSION_NUM; ++d) {
+            const JoeKuoDimension& dim = JOE_KUO_DIMENSIONS[d - 1];
+            for (unsigned int i = 0; i < 32; ++i) {
+              if (i < dim.s) {
+                v[d][i] = dim.m[i] << (31 - i);
+                continue;
+              }
+              v[d][i] = v[d][i - dim.s] ^ (v[d][i - dim.s] >> dim.s);
+              for (unsigned int k = 1; k < dim.s; ++k) {
+                if ((dim.a >> (dim.s - 1 - k)) & 1) {
+                  v[d][i] ^= v[d][i - k];
+                }
+              }
+            }
+          }
+        }
+    };
+
+    const DirectionTable& directionTable() {
+      static const DirectionTable table;
+      return table;
+    }
+
+    // Hash that only lets bits of its input affect more significant bits, i.e. a nested
+    // uniform scramble of reversed bits (Laine and Karras, with Burley's constants).
+    uint32_t laineKarrasPermutation(uint32_t x, uint32_t seed) {
+      x += seed;
+      x ^= x * 0x6c50b47cu;
+      x ^= x * 0xb82f1e52u;
+      x ^= x * 0xc7afe638u;
+      x ^= x * 0x8d22f6e6u;
+      return x;
+    }
+
+    // Owen scramble of a 32-bit fraction: each bit is flipped or not depending on all more
+    // significant bits and the seed.
+    uint32_t nestedUniformScramble(uint32_t x, uint32_t seed) {
+      return reverseBits(laineKarrasPermutation(reverseBits(x), seed));
+    }
+  }
+
+  SobolSampler::SobolSampler(uint32_t seed) : Sampler(seed), _directions(directionTable().v) {}
+
+  uint32_t SobolSampler::sobol(uint32_t index, unsigned int dimension) const {
+    assert(dimension < GROUP_DIMENSION_NUM);
+    uint32_t x = 0;
+    for (unsigned int bit = 0; index != 0; index >>= 1, ++bit) {
+      if (index & 1) {
+        x ^= _directions[dimension][bit];
+      }
+    }
+    return x;
+  }
+
+  double SobolSampler::get(unsigned int x, unsigned int y, unsigned int sampleIndex,
+      unsigned int dimension) const {
+    uint32_t pixelHash = _pixelHash(x, y);
+    unsigned int group = dimension / GROUP_DIMENSION_NUM;
+    uint32_t index = nestedUniformScramble(sampleIndex, _hash(pixelHash, group));
+    uint32_t point = sobol(index, dimension % GROUP_DIMENSION_NUM);
+    return _toUnit(nestedUniformScramble(point, _hash(pixelHash ^ 0x5bd1e995u, dimension)));
+  }
+}
@@ -0,0 +1,135 @@
+#include "render/tile_scheduler.h"
+#include "util/parallel.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace hd {
+  namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    double secondsSince(const Clock::time_point& start) {
+      return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+  }
+
+  double TileScheduler::Stats::utilisation(unsigned int threadId) const {
+    assert(threadId < threads.size());
+    return wallSeconds > 0.0 ? threads[threadId].busySeconds / wallSeconds : 0.0;
+  }
+
+  double TileScheduler::Stats::utilisation() const {
+    if (threads.empty()) {
+      return 0.0;
+    }
+    double sum = 0.0;
+    for (unsigned int t = 0; t < threads.size(); ++t) {
+      sum += utilisation(t);
+    }
+    return sum / threads.size();
+  }
+
+  std::string TileScheduler::Stats::toString() const {
+    char buffer[128];
+    std::snprintf(buffer, sizeof(buffer), "wall=%.3fs threads=%zu utilisation=%.1f%%\n",
+        wallSeconds, threads.size(), 100.0 * utilisation());
+    std::string result(buffer);
+    for (unsigned int t = 0; t < threads.size(); ++t) {
+      std::snprintf(buffer, sizeof(buffer),
+          "  thread %u: busy=%.3fs utilisation=%.1f%% tiles=%u steals=%u\n",
+          t, threads[t].busySeconds, 100.0 * utilisation(t), threads[t].tileNum,
+          threads[t].stealNum);
+      result += buffer;
+    }
+    return result;
+  }
+
+  TileScheduler::TileScheduler(unsigned int width, unsigned int height, unsigned int tileSize,
+      unsigned int threadNum)
+      : _width(width), _height(height), _tileSize(tileSize),
+        _threadNum(threadNum > 0 ? threadNum : parallelThreadNum()) {
+    assert(tileSize > 0);
+    for (unsigned int y = 0; y < height; y += tileSize) {
+      for (unsigned int x = 0; x < width; x += tileSize) {
+        Tile tile;
+        tile.x0 = x;
+        tile.y0 = y;
+        tile.x1 = std::min(width, x + tileSize);
+        tile.y1 = std::min(height, y + tileSize);
+        tile.index = _tiles.size();
+        _tiles.push_back(tile);
+      }
+    }
+  }
+
+  const TileScheduler::Tile& TileScheduler::tile(unsigned int index) const {
+    assert(index < _tiles.size());
+    return _tiles[index];
+  }
+
+  TileScheduler::Stats TileScheduler::run(const TileFunction& fn) const {
+    Clock::time_point start = Clock::now();
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    for (unsigned int t = 0; t < _threadNum; ++t) {
+      queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+      std::size_t begin = static_cast<std::size_t>(_tiles.size()) * t / _threadNum;
+      std::size_t end = static_cast<std::size_t>(_tiles.size()) * (t + 1) / _threadNum;
+      for (std::size_t i = begin; i < end; ++i) {
+        queues.back()->tileIds.push_back(i);
+      }
+    }
+
+    Stats stats;
+    stats.threads.resize(_threadNum);
+    auto work = [&](unsigned int threadId) {
+      ThreadStats& threadStats = stats.threads[threadId];
+      unsigned int tileId;
+      bool stolen;
+      while (_next(queues, threadId, tileId, stolen)) {
+        Clock::time_point tileStart = Clock::now();
+        fn(_tiles[tileId], threadId);
+        threadStats.busySeconds += secondsSince(tileStart);
+        ++threadStats.tileNum;
+        threadStats.stealNum += stolen ? 1 : 0;
+      }
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(_threadNum - 1);
+    for (unsigned int t = 1; t < _threadNum; ++t) {
+      workers.push_back(std::thread(work, t));
+    }
+    work(0);
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    stats.wallSeconds = secondsSince(start);
+    return stats;
+  }
+
+  bool TileScheduler::_next(std::vector<std::unique_ptr<WorkQueue>>& queues,
+      unsigned int threadId, unsigned int& tileId, bool& stolen) const {
+    {
+      WorkQueue& own = *queues[threadId];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tileIds.empty()) {
+        tileId = own.tileIds.front();
+        own.tileIds.pop_front();
+        stolen = false;
+        return true;
+      }
+    }
+    for (unsigned int i = 1; i < queues.size(); ++i) {
+      WorkQueue& victim = *queues[(threadId + i) % queues.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tileIds.empty()) {
+        tileId = victim.tileIds.back();
+        victim.tileIds.pop_back();
+        stolen = true;
+        return true;
+      }
+    }
+    return false;
+  }
+}
@@ -0,0 +1,245 @@
+#include "render/wavefront_integrator.h"
+#include "geometry/space_filling_curve.h"
+#include "const.h"
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace hd {
+  /**
+   * Buffers of a wave, reused from one wave to the next. Path state, rays and hits are indexed
+   * by path, i.e. by request within the wave; queues hold indices of paths.
+   */
+  class WavefrontIntegrator::Wave {
+    public:
+      const SampleRequest* requests;
+      Vector3* radiance;
+      std::size_t pathNum;
+      // Bounce all active paths are at, as they all advance together.
+      unsigned int bounce;
+
+      // Ray of the current bounce of each path.
+      std::vector<double> originX, originY, originZ;
+      std::vector<double> directionX, directionY, directionZ;
+      std::vector<double> throughput;
+      // Closest hit of the current ray of each path.
+      std::vector<unsigned int> hitFaceId;
+      std::vector<double> hitT, hitU, hitV;
+
+      // Counts of the traversals of the wave, or nullptr if not counted.
+      KdTree::TraversalStats* traversalStats;
+
+      // Paths with a ray to intersect, and those left for the next bounce.
+      std::vector<unsigned int> active;
+      std::vector<unsigned int> nextActive;
+      // Coherence keys of active paths, for sorting.
+      std::vector<std::pair<uint64_t, unsigned int>> sortKeys;
+
+      // Hits being shaded, compacted from active paths, with their parameters on the faces hit
+      // and their interpolated shading normals.
+      std::vector<unsigned int> shadePaths;
+      std::vector<unsigned int> shadeFaceIds;
+      std::vector<double> shadeA, shadeB, shadeC;
+      std::vector<double> normalX, normalY, normalZ;
+      // Pixels and sample indices of the hits, and the two numbers of each for sampling its
+      // next bounce, drawn from the sampler in one batch.
+      std::vector<unsigned int> sampleX, sampleY, sampleIndex;
+      std::vector<double> bounceRandom;
+
+      // Shadow rays towards the sun, and the sun light each adds to its path if unoccluded.
+      std::vector<unsigned int> shadowPaths;
+      std::vector<double> shadowOriginX, shadowOriginY, shadowOriginZ;
+      std::vector<double> shadowWeight;
+
+    public:
+      explicit Wave(std::size_t capacity) : requests(nullptr), radiance(nullptr), pathNum(0),
+          bounce(0), traversalStats(nullptr) {
+        for (auto* buffer : {&originX, &originY, &originZ, &directionX, &directionY,
+            &directionZ, &throughput, &hitT, &hitU, &hitV, &shadeA, &shadeB, &shadeC,
+            &normalX, &normalY, &normalZ, &shadowOriginX, &shadowOriginY, &shadowOriginZ,
+            &shadowWeight}) {
+          buffer->resize(capacity);
+        }
+        for (auto* buffer : {&hitFaceId, &shadeFaceIds, &sampleX, &sampleY, &sampleIndex}) {
+          buffer->resize(capacity);
+        }
+        bounceRandom.resize(2 * capacity);
+        for (auto* queue : {&active, &nextActive, &shadePaths, &shadowPaths}) {
+          queue->reserve(capacity);
+        }
+        sortKeys.reserve(capacity);
+      }
+
+      Ray3 ray(unsigned int path) const {
+        return Ray3(Vector3(originX[path], originY[path], originZ[path]),
+            Vector3(directionX[path], directionY[path], directionZ[path]));
+      }
+
+      void setRay(unsigned int path, const Ray3& ray) {
+        originX[path] = ray.origin.x;
+        originY[path] = ray.origin.y;
+        originZ[path] = ray.origin.z;
+        directionX[path] = ray.direction.x;
+        directionY[path] = ray.direction.y;
+        directionZ[path] = ray.direction.z;
+      }
+  };
+
+  WavefrontIntegrator::WavefrontIntegrator(const TriangularMesh& mesh, const KdTree& tree,
+      const Camera& camera, const Options& options, unsigned int seed, std::size_t waveSize)
+      : PathIntegrator(mesh, tree, camera, options, seed), _waveSize(waveSize),
+        _isSortingRays(true), _sceneBox(tree.boundingBox3()), _rayNum(0),
+        _isCountingTraversals(false) {
+    assert(waveSize > 0);
+  }
+
+  KdTree::TraversalStats WavefrontIntegrator::traversalStats() const {
+    std::lock_guard<std::mutex> lock(_traversalStatsMutex);
+    return _traversalStats;
+  }
+
+  void WavefrontIntegrator::render(const SampleRequest* requests, std::size_t count,
+      Vector3* radiance) const {
+    Wave wave(std::min(count, _waveSize));
+    KdTree::TraversalStats traversalStats;
+    if (_isCountingTraversals) {
+      wave.traversalStats = &traversalStats;
+    }
+    for (std::size_t begin = 0; begin < count; begin += _waveSize) {
+      wave.requests = requests + begin;
+      wave.radiance = radiance + begin;
+      wave.pathNum = std::min(count - begin, _waveSize);
+      _generate(wave);
+      while (!wave.active.empty()) {
+        if (_isSortingRays && wave.bounce > 0) {
+          _sort(wave);
+        }
+        _intersect(wave);
+        _shade(wave);
+        _shadowTest(wave);
+      }
+    }
+    if (_isCountingTraversals) {
+      std::lock_guard<std::mutex> lock(_traversalStatsMutex);
+      _traversalStats += traversalStats;
+    }
+  }
+
+  void WavefrontIntegrator::_generate(Wave& wave) const {
+    wave.active.clear();
+    wave.bounce = 0;
+    for (unsigned int path = 0; path < wave.pathNum; ++path) {
+      wave.setRay(path, _generateRay(wave.requests[path]));
+      wave.throughput[path] = 1.0;
+      wave.radiance[path] = Vector3::zero();
+      wave.active.push_back(path);
+    }
+  }
+
+  void WavefrontIntegrator::_sort(Wave& wave) const {
+    wave.sortKeys.clear();
+    for (unsigned int path : wave.active) {
+      uint64_t octant = (wave.directionX[path] < 0.0 ? 1 : 0)
+          | (wave.directionY[path] < 0.0 ? 2 : 0) | (wave.directionZ[path] < 0.0 ? 4 : 0);
+      Vector3 origin(wave.originX[path], wave.originY[path], wave.originZ[path]);
+      // The octant takes the place of the finest level of the 63-bit Morton index.
+      uint64_t cell = spaceFillingCurveIndex(SpaceFillingCurve::MORTON, origin, _sceneBox);
+      wave.sortKeys.push_back(std::make_pair((octant << 60) | (cell >> 3), path));
+    }
+    std::sort(wave.sortKeys.begin(), wave.sortKeys.end());
+    for (std::size_t i = 0; i < wave.sortKeys.size(); ++i) {
+      wave.active[i] = wave.sortKeys[i].second;
+    }
+  }
+
+  void WavefrontIntegrator::_intersect(Wave& wave) const {
+    _rayNum += wave.active.size();
+    for (unsigned int path : wave.active) {
+      RayHit hit;
+      _tree.intersect(wave.ray(path), 0.0, HD_INFINITY, hit, wave.traversalStats);
+      wave.hitFaceId[path] = hit.entityId;
+      wave.hitT[path] = hit.t;
+      wave.hitU[path] = hit.u;
+      wave.hitV[path] = hit.v;
+    }
+  }
+
+  void WavefrontIntegrator::_shade(Wave& wave) const {
+    // Paths that escaped see the sky and end. The others are gathered for shading.
+    wave.shadePaths.clear();
+    for (unsigned int path : wave.active) {
+      if (wave.hitFaceId[path] == static_cast<unsigned int>(HD_INVALID_ID)) {
+        wave.radiance[path] += _options.skyRadiance * wave.throughput[path];
+        continue;
+      }
+      std::size_t k = wave.shadePaths.size();
+      wave.shadePaths.push_back(path);
+      wave.shadeFaceIds[k] = wave.hitFaceId[path];
+      wave.shadeA[k] = 1.0 - wave.hitU[path] - wave.hitV[path];
+      wave.shadeB[k] = wave.hitU[path];
+      wave.shadeC[k] = wave.hitV[path];
+    }
+    std::size_t hitNum = wave.shadePaths.size();
+    _mesh.normal(hitNum, wave.shadeFaceIds.data(), wave.shadeA.data(), wave.shadeB.data(),
+        wave.shadeC.data(), wave.normalX.data(), wave.normalY.data(), wave.normalZ.data());
+
+    // All hits continue to the next bounce, or none does.
+    bool lastBounce = wave.bounce + 1 == _options.maxDepth;
+    if (!lastBounce) {
+      for (std::size_t k = 0; k < hitNum; ++k) {
+        const SampleRequest& request = wave.requests[wave.shadePaths[k]];
+        wave.sampleX[k] = request.x;
+        wave.sampleY[k] = request.y;
+        wave.sampleIndex[k] = request.sampleIndex;
+      }
+      _sampler->fill(hitNum, wave.sampleX.data(), wave.sampleY.data(), wave.sampleIndex.data(),
+          2 + 2 * wave.bounce, 2, wave.bounceRandom.data());
+    }
+
+    wave.shadowPaths.clear();
+    wave.nextActive.clear();
+    for (std::size_t k = 0; k < hitNum; ++k) {
+      unsigned int path = wave.shadePaths[k];
+      Ray3 ray = wave.ray(path);
+      Vector3 p = ray.pointAt(wave.hitT[path]);
+      Vector3 geometricNormal = _tree.entity(wave.hitFaceId[path]).normal();
+      Vector3 shadingNormal(wave.normalX[k], wave.normalY[k], wave.normalZ[k]);
+      _orientNormals(ray.direction, geometricNormal, shadingNormal);
+      Vector3 origin = _offsetOrigin(p, geometricNormal);
+
+      double sunWeight = _sunWeight(geometricNormal, shadingNormal);
+      if (sunWeight > 0.0) {
+        std::size_t s = wave.shadowPaths.size();
+        wave.shadowPaths.push_back(path);
+        wave.shadowOriginX[s] = origin.x;
+        wave.shadowOriginY[s] = origin.y;
+        wave.shadowOriginZ[s] = origin.z;
+        wave.shadowWeight[s] = wave.throughput[path] * sunWeight;
+      }
+
+      if (lastBounce) {
+        continue;
+      }
+      Vector3 direction = _sampleBounce(shadingNormal, wave.bounceRandom[k],
+          wave.bounceRandom[hitNum + k]);
+      wave.setRay(path, Ray3(origin, direction));
+      wave.throughput[path] *= _options.albedo;
+      wave.nextActive.push_back(path);
+    }
+    wave.active.swap(wave.nextActive);
+    ++wave.bounce;
+  }
+
+  void WavefrontIntegrator::_shadowTest(Wave& wave) const {
+    _rayNum += wave.shadowPaths.size();
+    for (std::size_t s = 0; s < wave.shadowPaths.size(); ++s) {
+      Vector3 origin(wave.shadowOriginX[s], wave.shadowOriginY[s], wave.shadowOriginZ[s]);
+      if (!_tree.occluded(Ray3(origin, _options.sunDirection), 0.0, HD_INFINITY,
+          wave.traversalStats)) {
+        wave.radiance[wave.shadowPaths[s]] += _options.sunIrradiance * wave.shadowWeight[s];
+      }
+    }
+  }
+}
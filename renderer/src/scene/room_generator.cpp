@@ -0,0 +1,102 @@
+#include "scene/room_generator.h"
+#include "util/philox.h"
+#include <array>
+#include <cassert>
+
+namespace hd {
+  namespace {
+    const double ROOM_WIDTH = 10.0;
+    const double ROOM_HEIGHT = 4.0;
+    const double ROOM_DEPTH = 10.0;
+    // Half the side of the clearing at the center of the room that boxes stay out of.
+    const double CLEARING_HALF_SIDE = 1.0;
+
+    // Number in [0, 1) from 32 random bits.
+    double toUnit(uint32_t bits) {
+      return bits * (1.0 / 4294967296.0);
+    }
+
+    // Append a grid of resolution x resolution quads over the parallelogram spanned by u and v
+    // from corner, facing along u x v.
+    void addGrid(TriangularMesh::Builder& builder, unsigned int& vertexNum,
+        const Vector3& corner, const Vector3& u, const Vector3& v, unsigned int resolution) {
+      for (unsigned int i = 0; i <= resolution; ++i) {
+        for (unsigned int j = 0; j <= resolution; ++j) {
+          builder.addVertex(corner + u * (static_cast<double>(i) / resolution)
+              + v * (static_cast<double>(j) / resolution));
+        }
+      }
+      for (unsigned int i = 0; i < resolution; ++i) {
+        for (unsigned int j = 0; j < resolution; ++j) {
+          unsigned int a = vertexNum + i * (resolution + 1) + j;
+          unsigned int b = a + resolution + 1;
+          builder.addFace({a, b, b + 1});
+          builder.addFace({a, b + 1, a + 1});
+        }
+      }
+      vertexNum += (resolution + 1) * (resolution + 1);
+    }
+
+    // Append the six sides of an axis-aligned box, facing outwards, or inwards for the room.
+    void addBox(TriangularMesh::Builder& builder, unsigned int& vertexNum,
+        const Vector3& minCorner, const Vector3& size, unsigned int resolution, bool isInwards) {
+      Vector3 x(size.x, 0.0, 0.0);
+      Vector3 y(0.0, size.y, 0.0);
+      Vector3 z(0.0, 0.0, size.z);
+      // Corner and spanning vectors of each side, with u x v pointing out of the box.
+      std::array<std::array<Vector3, 3>, 6> sides = {{
+        {{minCorner, z, y}}, {{minCorner + x, y, z}},
+        {{minCorner, x, z}}, {{minCorner + y, z, x}},
+        {{minCorner, y, x}}, {{minCorner + z, x, y}}
+      }};
+      for (const auto& side : sides) {
+        if (isInwards) {
+          addGrid(builder, vertexNum, side[0], side[2], side[1], resolution);
+        } else {
+          addGrid(builder, vertexNum, side[0], side[1], side[2], resolution);
+        }
+      }
+    }
+  }
+
+  std::unique_ptr<TriangularMesh> RoomGenerator::generate(const Options& options) {
+    assert(options.wallResolution > 0 && options.boxResolution > 0);
+    unsigned int wallVertexNum = (options.wallResolution + 1) * (options.wallResolution + 1);
+    unsigned int boxVertexNum = (options.boxResolution + 1) * (options.boxResolution + 1);
+    auto builder = TriangularMesh::newBuilder(
+        TriangularMesh::VertexNormalMode::AVERAGED,
+        TriangularMesh::FaceNormalMode::FLAT);
+    builder.reserve(6 * (wallVertexNum + options.boxNum * boxVertexNum),
+        12 * (options.wallResolution * options.wallResolution
+            + options.boxNum * options.boxResolution * options.boxResolution));
+    unsigned int vertexNum = 0;
+    addBox(builder, vertexNum, Vector3::zero(), Vector3(ROOM_WIDTH, ROOM_HEIGHT, ROOM_DEPTH),
+        options.wallResolution, true);
+
+    Philox4x32::Key key = {{options.seed, 0}};
+    for (unsigned int i = 0; i < options.boxNum; ++i) {
+      Vector3 size, minCorner;
+      // Boxes overlapping the clearing are drawn again, from the next counters.
+      for (uint32_t attempt = 0; ; ++attempt) {
+        Philox4x32::Counter first = Philox4x32::generate({{i, attempt, 0, 0}}, key);
+        Philox4x32::Counter second = Philox4x32::generate({{i, attempt, 1, 0}}, key);
+        size = Vector3(0.3 + 1.2 * toUnit(first[0]), 0.2 + 1.0 * toUnit(first[1]),
+            0.3 + 1.2 * toUnit(first[2]));
+        bool isFloating = toUnit(first[3]) < 0.3;
+        double y = isFloating
+            ? 1.0 + (ROOM_HEIGHT - size.y - 1.1) * toUnit(second[1]) : 0.0;
+        minCorner = Vector3((ROOM_WIDTH - size.x) * toUnit(second[0]), y,
+            (ROOM_DEPTH - size.z) * toUnit(second[2]));
+        bool isInClearing = minCorner.x < ROOM_WIDTH / 2 + CLEARING_HALF_SIDE
+            && minCorner.x + size.x > ROOM_WIDTH / 2 - CLEARING_HALF_SIDE
+            && minCorner.z < ROOM_DEPTH / 2 + CLEARING_HALF_SIDE
+            && minCorner.z + size.z > ROOM_DEPTH / 2 - CLEARING_HALF_SIDE;
+        if (!isInClearing) {
+          break;
+        }
+      }
+      addBox(builder, vertexNum, minCorner, size, options.boxResolution, false);
+    }
+    return builder.build();
+  }
+}
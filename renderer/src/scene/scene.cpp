@@ -0,0 +1,41 @@
+#include "scene/scene.h"
+#include <cassert>
+
+namespace hd {
+  Scene::Scene() : _arena(std::make_shared<Arena>()) {}
+
+  unsigned int Scene::addMesh(const std::shared_ptr<const TriangularMesh>& mesh) {
+    assert(mesh);
+    _meshes.push_back(mesh);
+    return _meshes.size() - 1;
+  }
+
+  unsigned int Scene::addKdTree(const std::shared_ptr<const KdTree>& tree) {
+    assert(tree);
+    _kdTrees.push_back(tree);
+    return _kdTrees.size() - 1;
+  }
+
+  std::shared_ptr<const TriangularMesh> Scene::mesh(unsigned int index) const {
+    assert(index < _meshes.size());
+    return _meshes[index];
+  }
+
+  std::shared_ptr<const KdTree> Scene::kdTree(unsigned int index) const {
+    assert(index < _kdTrees.size());
+    return _kdTrees[index];
+  }
+
+  MemoryUsage Scene::memoryUsage() const {
+    MemoryCounter counter;
+    MemoryUsage usage;
+    for (auto& mesh : _meshes) {
+      usage += mesh->memoryUsage(&counter);
+    }
+    for (auto& tree : _kdTrees) {
+      usage += tree->memoryUsage(&counter);
+    }
+    usage.slack += counter.arenaSlack();
+    return usage;
+  }
+}
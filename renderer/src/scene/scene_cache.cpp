@@ -0,0 +1,110 @@
+#include "scene/scene_cache.h"
+#include "geometry/kd_tree.h"
+#include "io/mesh_serializer.h"
+#include "io/ply_reader.h"
+#include <sys/stat.h>
+
+namespace hd {
+  namespace {
+    // Modification time in nanoseconds and size of a file. Returns false if it does not exist.
+    bool fileStatus(const std::string& path, int64_t& time, int64_t& size) {
+      struct stat status;
+      if (stat(path.c_str(), &status) != 0) {
+        return false;
+      }
+      time = static_cast<int64_t>(status.st_mtim.tv_sec) * 1000000000
+          + status.st_mtim.tv_nsec;
+      size = status.st_size;
+      return true;
+    }
+  }
+
+  std::shared_ptr<const Scene> SceneCache::get(const std::string& path) {
+    int64_t fileTime, fileSize;
+    if (!fileStatus(path, fileTime, fileSize)) {
+      return nullptr;
+    }
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto entry = _entries.find(path);
+      if (entry != _entries.end()) {
+        if (entry->second.fileTime == fileTime && entry->second.fileSize == fileSize) {
+          ++_stats.hits;
+          _lru.splice(_lru.begin(), _lru, entry->second.lruPosition);
+          return entry->second.scene;
+        }
+        _erase(entry);
+      }
+    }
+    // Load without holding the lock, so that cached scenes can be served meanwhile.
+    std::shared_ptr<const Scene> scene = _load(path);
+    if (scene == nullptr) {
+      return nullptr;
+    }
+    std::size_t bytes = scene->memoryUsage().total();
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_stats.loads;
+    auto entry = _entries.find(path);
+    if (entry != _entries.end()) {
+      // Another thread loaded the same scene concurrently. Keep its copy.
+      _lru.splice(_lru.begin(), _lru, entry->second.lruPosition);
+      return entry->second.scene;
+    }
+    _lru.push_front(path);
+    Entry& added = _entries[path];
+    added.scene = scene;
+    added.bytes = bytes;
+    added.fileTime = fileTime;
+    added.fileSize = fileSize;
+    added.lruPosition = _lru.begin();
+    ++_stats.residentScenes;
+    _stats.bytesResident += bytes;
+    _evict();
+    return scene;
+  }
+
+  bool SceneCache::contains(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.count(path) > 0;
+  }
+
+  void SceneCache::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    while (!_entries.empty()) {
+      _erase(_entries.begin());
+    }
+  }
+
+  SceneCache::Stats SceneCache::stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _stats;
+  }
+
+  std::shared_ptr<const Scene> SceneCache::_load(const std::string& path) {
+    std::shared_ptr<const TriangularMesh> mesh = MeshSerializer::read(path);
+    if (mesh == nullptr) {
+      mesh = PlyReader::read(path);
+    }
+    if (mesh == nullptr) {
+      return nullptr;
+    }
+    std::shared_ptr<Scene> scene = std::make_shared<Scene>();
+    scene->addMesh(mesh);
+    scene->addKdTree(KdTree::build(*mesh, KdTree::Options(), scene->arena()));
+    return scene;
+  }
+
+  void SceneCache::_erase(std::unordered_map<std::string, Entry>::iterator entry) {
+    _lru.erase(entry->second.lruPosition);
+    _stats.bytesResident -= entry->second.bytes;
+    --_stats.residentScenes;
+    _entries.erase(entry);
+  }
+
+  void SceneCache::_evict() {
+    while (_stats.bytesResident > _memoryBudget && _lru.size() > 1) {
+      _erase(_entries.find(_lru.back()));
+      ++_stats.evictions;
+    }
+  }
+}
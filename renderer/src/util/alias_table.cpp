@@ -0,0 +1,69 @@
+#include "util/alias_table.h"
+#include "util/memory_usage.h"
+#include "util/parallel.h"
+#include <algorithm>
+#include <cassert>
+
+namespace hd {
+  AliasTable::AliasTable(const std::vector<double>& weights)
+      : _bins(weights.size()), _pmf(weights.size()), _totalWeight(0.0) {
+    assert(!weights.empty());
+    std::size_t n = weights.size();
+    for (double w : weights) {
+      assert(w >= 0.0);
+      _totalWeight += w;
+    }
+    assert(_totalWeight > 0.0);
+
+    // Scale probabilities so that the average bin holds exactly 1.
+    std::vector<double> scaled(n);
+    parallelFor(0, n, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        _pmf[i] = weights[i] / _totalWeight;
+        scaled[i] = _pmf[i] * n;
+      }
+    });
+    std::vector<unsigned int> small;
+    std::vector<unsigned int> large;
+    for (std::size_t i = 0; i < n; ++i) {
+      (scaled[i] < 1.0 ? small : large).push_back(i);
+    }
+    // Fill each underfull bin up with the excess of an overfull one.
+    while (!small.empty() && !large.empty()) {
+      unsigned int s = small.back();
+      small.pop_back();
+      unsigned int l = large.back();
+      _bins[s].probability = scaled[s];
+      _bins[s].alias = l;
+      scaled[l] -= 1.0 - scaled[s];
+      if (scaled[l] < 1.0) {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+    // Whatever remains is full up to rounding errors.
+    for (unsigned int i : small) {
+      _bins[i].probability = 1.0;
+      _bins[i].alias = i;
+    }
+    for (unsigned int i : large) {
+      _bins[i].probability = 1.0;
+      _bins[i].alias = i;
+    }
+  }
+
+  std::size_t AliasTable::memoryBytes() const {
+    return sizeof(AliasTable)
+        + heapBlockBytes(_bins.capacity() * sizeof(Bin))
+        + heapBlockBytes(_pmf.capacity() * sizeof(double));
+  }
+
+  unsigned int AliasTable::sample(double u) const {
+    assert(u >= 0.0 && u < 1.0);
+    // The integer part of u * n selects the bin, and the fraction selects within the bin.
+    double scaled = u * _bins.size();
+    unsigned int index = std::min(static_cast<std::size_t>(scaled), _bins.size() - 1);
+    const Bin& bin = _bins[index];
+    return scaled - index < bin.probability ? index : bin.alias;
+  }
+}
@@ -0,0 +1,103 @@
+#include "util/arena.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+namespace hd {
+  namespace {
+    // Ids of arenas and of their successive generations. 0 marks unused cursors.
+    std::atomic<uint64_t> nextArenaId(1);
+
+    // Unallocated end of the chunk a thread currently bumps in a given arena.
+    class ThreadCursor {
+      public:
+        uint64_t arenaId;
+        char* next;
+        char* end;
+    };
+
+    // Number of arenas a thread can bump in concurrently without falling back to new chunks,
+    // e.g. a scene arena and the scratch arena of a build.
+    const unsigned int CURSOR_NUM = 4;
+    thread_local ThreadCursor cursors[CURSOR_NUM];
+    thread_local unsigned int nextVictim = 0;
+
+    // Allocations larger than this fraction of the chunk size get a chunk of their own, rather
+    // than wasting the rest of the current chunk.
+    const std::size_t LARGE_ALLOCATION_RATIO = 4;
+
+    char* alignUp(char* p, std::size_t alignment) {
+      uintptr_t address = reinterpret_cast<uintptr_t>(p);
+      return p + ((alignment - address % alignment) % alignment);
+    }
+  }
+
+  const std::size_t Arena::DEFAULT_CHUNK_SIZE;
+
+  Arena::Arena(std::size_t chunkSize)
+      : _id(nextArenaId++), _chunkSize(std::max<std::size_t>(chunkSize, 64)),
+        _bytesReserved(0) {}
+
+  Arena::~Arena() {
+    release();
+  }
+
+  void* Arena::allocate(std::size_t size, std::size_t alignment) {
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    size = std::max<std::size_t>(size, 1);
+    uint64_t id = _id.load(std::memory_order_relaxed);
+    ThreadCursor* cursor = nullptr;
+    for (unsigned int i = 0; i < CURSOR_NUM; ++i) {
+      if (cursors[i].arenaId == id) {
+        cursor = &cursors[i];
+        break;
+      }
+    }
+    if (cursor != nullptr) {
+      char* p = alignUp(cursor->next, alignment);
+      if (p + size <= cursor->end) {
+        cursor->next = p + size;
+        return p;
+      }
+    }
+    if (size + alignment > _chunkSize / LARGE_ALLOCATION_RATIO) {
+      return alignUp(_newChunk(size + alignment), alignment);
+    }
+    if (cursor == nullptr) {
+      cursor = &cursors[nextVictim];
+      nextVictim = (nextVictim + 1) % CURSOR_NUM;
+    }
+    char* chunk = _newChunk(_chunkSize);
+    char* p = alignUp(chunk, alignment);
+    cursor->arenaId = id;
+    cursor->next = p + size;
+    cursor->end = chunk + _chunkSize;
+    return p;
+  }
+
+  char* Arena::_newChunk(std::size_t size) {
+    char* data = static_cast<char*>(std::malloc(size));
+    if (data == nullptr) {
+      throw std::bad_alloc();
+    }
+    Chunk chunk;
+    chunk.data = data;
+    chunk.size = size;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _chunks.push_back(chunk);
+    }
+    _bytesReserved += size;
+    return data;
+  }
+
+  void Arena::release() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& chunk : _chunks) {
+      std::free(chunk.data);
+    }
+    _chunks.clear();
+    _bytesReserved = 0;
+    _id = nextArenaId++;
+  }
+}
@@ -0,0 +1,110 @@
+#include "util/indexed_min_heap.h"
+#include "const.h"
+#include <cassert>
+#include <utility>
+
+namespace hd {
+  IndexedMinHeap::IndexedMinHeap(unsigned int capacity)
+      : _positions(capacity, HD_INVALID_ID), _priorities(capacity, 0.0) {
+    _heap.reserve(capacity);
+  }
+
+  bool IndexedMinHeap::contains(unsigned int key) const {
+    assert(key < _positions.size());
+    return _positions[key] != static_cast<unsigned int>(HD_INVALID_ID);
+  }
+
+  double IndexedMinHeap::priority(unsigned int key) const {
+    assert(contains(key));
+    return _priorities[key];
+  }
+
+  void IndexedMinHeap::push(unsigned int key, double priority) {
+    assert(key < _positions.size());
+    if (!contains(key)) {
+      _priorities[key] = priority;
+      _positions[key] = _heap.size();
+      _heap.push_back(key);
+      _siftUp(_positions[key]);
+      return;
+    }
+    double oldPriority = _priorities[key];
+    _priorities[key] = priority;
+    if (priority < oldPriority) {
+      _siftUp(_positions[key]);
+    } else {
+      _siftDown(_positions[key]);
+    }
+  }
+
+  void IndexedMinHeap::remove(unsigned int key) {
+    if (!contains(key)) {
+      return;
+    }
+    unsigned int pos = _positions[key];
+    unsigned int last = _heap.size() - 1;
+    if (pos != last) {
+      _swap(pos, last);
+    }
+    _heap.pop_back();
+    _positions[key] = HD_INVALID_ID;
+    if (pos != last) {
+      // The key moved into the hole may need to go either way.
+      _siftUp(pos);
+      _siftDown(pos);
+    }
+  }
+
+  unsigned int IndexedMinHeap::top() const {
+    assert(!empty());
+    return _heap[0];
+  }
+
+  double IndexedMinHeap::topPriority() const {
+    assert(!empty());
+    return _priorities[_heap[0]];
+  }
+
+  unsigned int IndexedMinHeap::pop() {
+    unsigned int key = top();
+    remove(key);
+    return key;
+  }
+
+  void IndexedMinHeap::_siftUp(unsigned int pos) {
+    while (pos > 0) {
+      unsigned int parent = (pos - 1) / 2;
+      if (_priorities[_heap[parent]] <= _priorities[_heap[pos]]) {
+        break;
+      }
+      _swap(pos, parent);
+      pos = parent;
+    }
+  }
+
+  void IndexedMinHeap::_siftDown(unsigned int pos) {
+    unsigned int n = _heap.size();
+    while (true) {
+      unsigned int smallest = pos;
+      unsigned int left = 2 * pos + 1;
+      unsigned int right = left + 1;
+      if (left < n && _priorities[_heap[left]] < _priorities[_heap[smallest]]) {
+        smallest = left;
+      }
+      if (right < n && _priorities[_heap[right]] < _priorities[_heap[smallest]]) {
+        smallest = right;
+      }
+      if (smallest == pos) {
+        break;
+      }
+      _swap(pos, smallest);
+      pos = smallest;
+    }
+  }
+
+  void IndexedMinHeap::_swap(unsigned int lhs, unsigned int rhs) {
+    std::swap(_heap[lhs], _heap[rhs]);
+    _positions[_heap[lhs]] = lhs;
+    _positions[_heap[rhs]] = rhs;
+  }
+}
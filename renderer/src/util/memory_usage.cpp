@@ -0,0 +1,84 @@
+#include "util/memory_usage.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace hd {
+  namespace {
+    // Allocations from this size on are mapped separately by the allocator.
+    const std::size_t MAPPED_ALLOCATION_SIZE = 128 * 1024;
+    const std::size_t PAGE_SIZE = 4096;
+
+    std::string formatBytes(std::size_t bytes) {
+      const char* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+      double value = static_cast<double>(bytes);
+      unsigned int unit = 0;
+      while (value >= 1024.0 && unit + 1 < sizeof(units) / sizeof(units[0])) {
+        value /= 1024.0;
+        ++unit;
+      }
+      char buffer[32];
+      if (unit == 0) {
+        std::snprintf(buffer, sizeof(buffer), "%zuB", bytes);
+      } else {
+        std::snprintf(buffer, sizeof(buffer), "%.1f%s", value, units[unit]);
+      }
+      return std::string(buffer);
+    }
+  }
+
+  std::size_t MemoryUsage::total() const {
+    return positions + normals + topology + adjacency + nodes + primitiveReferences + caches
+        + slack;
+  }
+
+  MemoryUsage& MemoryUsage::operator+=(const MemoryUsage& other) {
+    positions += other.positions;
+    normals += other.normals;
+    topology += other.topology;
+    adjacency += other.adjacency;
+    nodes += other.nodes;
+    primitiveReferences += other.primitiveReferences;
+    caches += other.caches;
+    slack += other.slack;
+    return *this;
+  }
+
+  std::string MemoryUsage::toString() const {
+    return "total=" + formatBytes(total())
+        + " positions=" + formatBytes(positions)
+        + " normals=" + formatBytes(normals)
+        + " topology=" + formatBytes(topology)
+        + " adjacency=" + formatBytes(adjacency)
+        + " nodes=" + formatBytes(nodes)
+        + " primitiveReferences=" + formatBytes(primitiveReferences)
+        + " caches=" + formatBytes(caches)
+        + " slack=" + formatBytes(slack);
+  }
+
+  bool MemoryCounter::add(const void* buffer) {
+    return _buffers.insert(buffer).second;
+  }
+
+  void MemoryCounter::addArenaBytes(const Arena* arena, std::size_t bytes) {
+    _arenaBytes[arena] += bytes;
+  }
+
+  std::size_t MemoryCounter::arenaSlack() const {
+    std::size_t slack = 0;
+    for (auto& entry : _arenaBytes) {
+      std::size_t reserved = entry.first->bytesReserved();
+      slack += reserved - std::min(reserved, entry.second);
+    }
+    return slack;
+  }
+
+  std::size_t heapBlockBytes(std::size_t size) {
+    if (size == 0) {
+      return 0;
+    }
+    if (size >= MAPPED_ALLOCATION_SIZE) {
+      return (size + 16 + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    }
+    return std::max<std::size_t>(32, (size + 8 + 15) / 16 * 16);
+  }
+}
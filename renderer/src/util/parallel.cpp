@@ -0,0 +1,42 @@
+#include "util/parallel.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace hd {
+  unsigned int parallelThreadNum() {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  void parallelFor(std::size_t begin, std::size_t end,
+      const std::function<void(std::size_t, std::size_t)>& fn,
+      std::size_t minChunkSize) {
+    if (end <= begin) {
+      return;
+    }
+    std::size_t total = end - begin;
+    std::size_t maxChunkNum = total / std::max<std::size_t>(1, minChunkSize);
+    std::size_t chunkNum = std::max<std::size_t>(
+        1, std::min<std::size_t>(parallelThreadNum(), maxChunkNum));
+    if (chunkNum <= 1) {
+      fn(begin, end);
+      return;
+    }
+    std::size_t chunkSize = (total + chunkNum - 1) / chunkNum;
+    std::vector<std::thread> workers;
+    workers.reserve(chunkNum - 1);
+    // The calling thread processes the first chunk itself.
+    for (std::size_t chunk = 1; chunk < chunkNum; ++chunk) {
+      std::size_t chunkBegin = begin + chunk * chunkSize;
+      std::size_t chunkEnd = std::min(end, chunkBegin + chunkSize);
+      if (chunkBegin >= chunkEnd) {
+        break;
+      }
+      workers.push_back(std::thread(fn, chunkBegin, chunkEnd));
+    }
+    fn(begin, std::min(end, begin + chunkSize));
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#include "util/perf_counter.h"
+
+#if defined(__linux__)
+#define HD_HAS_PERF_EVENT 1
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#define HD_HAS_PERF_EVENT 0
+#endif
+
+namespace hd {
+#if HD_HAS_PERF_EVENT
+  namespace {
+    uint64_t eventConfig(PerfCounter::Event event) {
+      switch (event) {
+        case PerfCounter::Event::CACHE_MISSES:
+          return PERF_COUNT_HW_CACHE_MISSES;
+        case PerfCounter::Event::CACHE_REFERENCES:
+          return PERF_COUNT_HW_CACHE_REFERENCES;
+        case PerfCounter::Event::INSTRUCTIONS:
+          return PERF_COUNT_HW_INSTRUCTIONS;
+        case PerfCounter::Event::CYCLES:
+          return PERF_COUNT_HW_CPU_CYCLES;
+      }
+      return PERF_COUNT_HW_CPU_CYCLES;
+    }
+  }
+
+  PerfCounter::PerfCounter(Event event) : _fd(-1) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = eventConfig(event);
+    attr.disabled = 1;
+    // Follow the threads started while counting, e.g. those of a TileScheduler.
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    _fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+
+  PerfCounter::~PerfCounter() {
+    if (_fd >= 0) {
+      close(_fd);
+    }
+  }
+
+  void PerfCounter::start() {
+    if (_fd >= 0) {
+      ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  void PerfCounter::stop() {
+    if (_fd >= 0) {
+      ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+  }
+
+  uint64_t PerfCounter::value() const {
+    uint64_t count = 0;
+    if (_fd < 0 || read(_fd, &count, sizeof(count)) != sizeof(count)) {
+      return 0;
+    }
+    return count;
+  }
+#else
+  PerfCounter::PerfCounter(Event) : _fd(-1) {}
+  PerfCounter::~PerfCounter() {}
+  void PerfCounter::start() {}
+  void PerfCounter::stop() {}
+  uint64_t PerfCounter::value() const { return 0; }
+#endif
+}
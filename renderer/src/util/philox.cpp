@@ -0,0 +1,66 @@
+#include "util/philox.h"
+#include <algorithm>
+
+namespace hd {
+  namespace {
+    const uint32_t MULTIPLIER_0 = 0xD2511F53;
+    const uint32_t MULTIPLIER_1 = 0xCD9E8D57;
+    // Weyl sequence increments of the round keys: golden ratio and sqrt(3) - 1.
+    const uint32_t KEY_INCREMENT_0 = 0x9E3779B9;
+    const uint32_t KEY_INCREMENT_1 = 0xBB67AE85;
+    // Counters processed together by the batch variant.
+    const std::size_t LANE_NUM = 64;
+  }
+
+  Philox4x32::Counter Philox4x32::generate(const Counter& counter, const Key& key) {
+    uint32_t x0 = counter[0], x1 = counter[1], x2 = counter[2], x3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+    for (unsigned int round = 0; round < ROUND_NUM; ++round) {
+      uint64_t p0 = static_cast<uint64_t>(MULTIPLIER_0) * x0;
+      uint64_t p1 = static_cast<uint64_t>(MULTIPLIER_1) * x2;
+      uint32_t y0 = static_cast<uint32_t>(p1 >> 32) ^ x1 ^ k0;
+      uint32_t y1 = static_cast<uint32_t>(p1);
+      uint32_t y2 = static_cast<uint32_t>(p0 >> 32) ^ x3 ^ k1;
+      uint32_t y3 = static_cast<uint32_t>(p0);
+      x0 = y0;
+      x1 = y1;
+      x2 = y2;
+      x3 = y3;
+      k0 += KEY_INCREMENT_0;
+      k1 += KEY_INCREMENT_1;
+    }
+    return Counter{{x0, x1, x2, x3}};
+  }
+
+  void Philox4x32::generate(std::size_t count, const uint32_t* const counter[4],
+      const Key& key, uint32_t* const result[4]) {
+    uint32_t x0[LANE_NUM], x1[LANE_NUM], x2[LANE_NUM], x3[LANE_NUM];
+    for (std::size_t begin = 0; begin < count; begin += LANE_NUM) {
+      std::size_t laneNum = std::min(count - begin, LANE_NUM);
+      std::copy(counter[0] + begin, counter[0] + begin + laneNum, x0);
+      std::copy(counter[1] + begin, counter[1] + begin + laneNum, x1);
+      std::copy(counter[2] + begin, counter[2] + begin + laneNum, x2);
+      std::copy(counter[3] + begin, counter[3] + begin + laneNum, x3);
+      uint32_t k0 = key[0], k1 = key[1];
+      for (unsigned int round = 0; round < ROUND_NUM; ++round) {
+        // Same round as generate(), with every lane independent of the others.
+        for (std::size_t i = 0; i < laneNum; ++i) {
+          uint64_t p0 = static_cast<uint64_t>(MULTIPLIER_0) * x0[i];
+          uint64_t p1 = static_cast<uint64_t>(MULTIPLIER_1) * x2[i];
+          uint32_t y0 = static_cast<uint32_t>(p1 >> 32) ^ x1[i] ^ k0;
+          uint32_t y2 = static_cast<uint32_t>(p0 >> 32) ^ x3[i] ^ k1;
+          x1[i] = static_cast<uint32_t>(p1);
+          x3[i] = static_cast<uint32_t>(p0);
+          x0[i] = y0;
+          x2[i] = y2;
+        }
+        k0 += KEY_INCREMENT_0;
+        k1 += KEY_INCREMENT_1;
+      }
+      std::copy(x0, x0 + laneNum, result[0] + begin);
+      std::copy(x1, x1 + laneNum, result[1] + begin);
+      std::copy(x2, x2 + laneNum, result[2] + begin);
+      std::copy(x3, x3 + laneNum, result[3] + begin);
+    }
+  }
+}
@@ -0,0 +1,63 @@
+#include "geometry/compressed_mesh_storage.h"
+#include "geometry/bounding_box3.h"
+#include "math/vector3.h"
+#include "const.h"
+#include <array>
+#include <cmath>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(CompressedMeshStorageTest, TestNormalEncoding) {
+  vector<Vector3> normals = {
+    Vector3::xUnit(), Vector3::yUnit(), Vector3::zUnit(),
+    -1 * Vector3::xUnit(), -1 * Vector3::yUnit(), -1 * Vector3::zUnit(),
+    Vector3(1, -2, 3).normalize(), Vector3(-0.3, 0.2, -0.9).normalize(),
+    Vector3(-1, -1, -1).normalize()
+  };
+  for (auto& n : normals) {
+    Vector3 decoded = CompressedMeshStorage::decodeNormal(CompressedMeshStorage::encodeNormal(n));
+    EXPECT_NEAR(decoded.len(), 1.0, HD_EPSILON);
+    // 16 bits per component give an angular error well below 1e-4 radians.
+    EXPECT_GT(decoded * n, cos(1e-4));
+  }
+  // Zero normals have no direction and decode to a fixed unit vector.
+  Vector3 zero = CompressedMeshStorage::decodeNormal(
+      CompressedMeshStorage::encodeNormal(Vector3::zero()));
+  EXPECT_NEAR((zero - Vector3::zUnit()).len(), 0.0, HD_EPSILON);
+}
+
+TEST(CompressedMeshStorageTest, TestPositionsAndFaces) {
+  vector<Vector3> positions;
+  for (unsigned int i = 0; i < 70000; ++i) {
+    positions.push_back(Vector3(i % 100, (i / 100) % 100, i / 10000) * 0.1);
+  }
+  // The first cluster of faces spans a small range of vertices and is delta-encoded, the
+  // second one spans a range too large for 16-bit offsets.
+  vector<array<unsigned int, 3>> faces;
+  for (unsigned int fid = 0; fid < 64; ++fid) {
+    faces.push_back({fid + 100, fid + 101, fid + 200});
+  }
+  faces.push_back({0, 1, 69999});
+  faces.push_back({5, 69998, 3});
+  BoundingBox3 box = BoundingBox3(Vector3(0, 0, 0), Vector3(9.9, 9.9, 0.6));
+
+  for (auto precision : {CompressedMeshStorage::PositionPrecision::BITS_16,
+      CompressedMeshStorage::PositionPrecision::BITS_21}) {
+    CompressedMeshStorage storage(positions, {}, faces, {}, box, precision);
+    EXPECT_EQ(storage.vertexNum(), positions.size());
+    EXPECT_EQ(storage.faceNum(), faces.size());
+    EXPECT_FALSE(storage.hasVertexNormals());
+    EXPECT_FALSE(storage.hasFaceNormals());
+    double bits = precision == CompressedMeshStorage::PositionPrecision::BITS_16 ? 16 : 21;
+    double maxError = 9.9 / (pow(2.0, bits) - 1) / 2 * sqrt(3.0);
+    for (unsigned int vid = 0; vid < positions.size(); vid += 7) {
+      EXPECT_LE((storage.pos(vid) - positions[vid]).len(), maxError);
+    }
+    for (unsigned int fid = 0; fid < faces.size(); ++fid) {
+      EXPECT_EQ(storage.face(fid), faces[fid]);
+    }
+  }
+}
@@ -0,0 +1,53 @@
+#ifndef _GRID_MESH_H_
+#define _GRID_MESH_H_
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include "geometry/triangular_mesh.h"
+#include "math/vector3.h"
+
+namespace hd {
+  // Height of the grid vertex at column x and row y.
+  typedef std::function<double(unsigned int x, unsigned int y)> GridHeight;
+
+  /**
+   * Add an n x n grid of unit quads to an empty builder, shared by tests that need a large,
+   * regular mesh. Vertex (x, y) is at (x, y, height(x, y)), or on the xOy plane if height is
+   * empty, and has index y * (n + 1) + x. Quad (x, y) is split along its diagonal from vertex
+   * (x, y) to vertex (x + 1, y + 1) into faces 2 * (y * n + x) and 2 * (y * n + x) + 1, wound
+   * counterclockwise seen from +z, or clockwise if isWindingFlipped.
+   */
+  inline void addGridMesh(TriangularMesh::Builder& builder, unsigned int n,
+      const GridHeight& height, bool isWindingFlipped = false) {
+    for (unsigned int y = 0; y <= n; ++y) {
+      for (unsigned int x = 0; x <= n; ++x) {
+        builder.addVertex(Vector3(x, y, height ? height(x, y) : 0.0));
+      }
+    }
+    for (unsigned int y = 0; y < n; ++y) {
+      for (unsigned int x = 0; x < n; ++x) {
+        unsigned int v0 = y * (n + 1) + x;
+        if (isWindingFlipped) {
+          builder.addFace({v0, v0 + n + 1, v0 + n + 2});
+          builder.addFace({v0, v0 + n + 2, v0 + 1});
+        } else {
+          builder.addFace({v0, v0 + 1, v0 + n + 2});
+          builder.addFace({v0, v0 + n + 2, v0 + n + 1});
+        }
+      }
+    }
+  }
+
+  // Build and populate a grid mesh, see addGridMesh().
+  inline std::unique_ptr<TriangularMesh> buildGridMesh(unsigned int n, const GridHeight& height,
+      TriangularMesh::VertexNormalMode vertexNormalMode,
+      TriangularMesh::FaceNormalMode faceNormalMode, bool isWindingFlipped = false) {
+    auto builder = TriangularMesh::newBuilder(vertexNormalMode, faceNormalMode);
+    addGridMesh(builder, n, height, isWindingFlipped);
+    return builder.build();
+  }
+}
+
+#endif // _GRID_MESH_H_
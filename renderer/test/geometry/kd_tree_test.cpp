@@ -0,0 +1,189 @@
+#include "geometry/kd_tree.h"
+#include "geometry/bounding_box3.h"
+#include "geometry/triangle3.h"
+#include "geometry/triangular_mesh.h"
+#include "math/vector3.h"
+#include "util/arena.h"
+#include "grid_mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+class KdTreeTest : public ::testing::Test {
+  protected:
+    // A wavy 64x64 grid of 8192 faces, enough for subtrees to be built concurrently.
+    unique_ptr<TriangularMesh> grid;
+
+    virtual void SetUp() {
+      grid = buildGridMesh(64,
+          [](unsigned int x, unsigned int y) { return 4.0 * sin(x * 0.1) * cos(y * 0.1); },
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::FLAT);
+    }
+
+    virtual void TearDown() {}
+
+  protected:
+    // Check queries of random ranges against a linear scan over all entities.
+    void verifyQueries(const KdTree& tree) {
+      mt19937 rng(1);
+      uniform_real_distribution<double> uniform(-10.0, 74.0);
+      for (int i = 0; i < 50; ++i) {
+        Vector3 minCorner(uniform(rng), uniform(rng), -2.0);
+        Vector3 range = Vector3(uniform(rng), uniform(rng), 10.0) * 0.1;
+        BoundingBox3 box(minCorner, minCorner + Vector3(fabs(range.x), fabs(range.y), 4.0));
+        vector<unsigned int> actual;
+        tree.query(box, actual);
+        sort(actual.begin(), actual.end());
+        vector<unsigned int> expected;
+        for (unsigned int id = 0; id < tree.entityNum(); ++id) {
+          BoundingBox3 b = tree.entity(id).boundingBox3();
+          bool overlaps = true;
+          for (int k = 0; k < 3; ++k) {
+            overlaps = overlaps && b.minCorner()[k] <= box.maxCorner()[k]
+                && box.minCorner()[k] <= b.maxCorner()[k];
+          }
+          if (overlaps) {
+            expected.push_back(id);
+          }
+        }
+        EXPECT_EQ(actual, expected);
+      }
+    }
+};
+
+TEST_F(KdTreeTest, TestBuildSAH) {
+  auto tree = KdTree::build(*grid);
+  EXPECT_EQ(tree->entityNum(), grid->faceNum());
+  EXPECT_EQ(tree->boundingBox3(), grid->boundingBox3());
+  EXPECT_EQ(tree->nodeNum(), 2 * tree->leafNum() - 1);
+  EXPECT_GT(tree->leafNum(), grid->faceNum() / 32);
+  EXPECT_EQ(tree->entity(7), grid->triangle(7));
+  verifyQueries(*tree);
+}
+
+TEST_F(KdTreeTest, TestBuildCenterMedian) {
+  KdTree::Options options;
+  options.partitionMode = KdTree::CENTER_MEDIAN;
+  options.depthLimitMode = KdTree::MAX_LEVEL;
+  options.maxLevel = 10;
+  auto tree = KdTree::build(*grid, options);
+  EXPECT_EQ(tree->depth(), 10);
+  EXPECT_EQ(tree->leafNum(), 512);
+  EXPECT_EQ(tree->nodeNum(), 1023);
+  verifyQueries(*tree);
+
+  options.depthLimitMode = KdTree::MIN_ENTITIES;
+  options.minEntities = 1;
+  tree = KdTree::build(*grid, options);
+  EXPECT_EQ(tree->leafNum(), grid->faceNum());
+  verifyQueries(*tree);
+}
+
+TEST_F(KdTreeTest, TestDegenerateInputs) {
+  auto empty = KdTree::build(vector<Triangle3>());
+  EXPECT_EQ(empty->entityNum(), 0);
+  vector<unsigned int> ids;
+  empty->query(BoundingBox3(Vector3::zero(), Vector3::identity(1.0)), ids);
+  EXPECT_TRUE(ids.empty());
+
+  // Coincident entities end up in a single leaf.
+  Triangle3 t(Vector3(0, 0, 0), Vector3(1, 0, 0), Vector3(0, 1, 0));
+  auto same = KdTree::build(vector<Triangle3>(10, t));
+  EXPECT_EQ(same->nodeNum(), 1);
+  same->query(BoundingBox3(Vector3::zero(), Vector3::identity(1.0)), ids);
+  EXPECT_EQ(ids.size(), 10);
+}
+
+TEST_F(KdTreeTest, TestSharedArena) {
+  auto arena = make_shared<Arena>();
+  auto tree = KdTree::build(*grid, KdTree::Options(), arena);
+  EXPECT_EQ(tree->arena(), arena);
+  size_t reserved = arena->bytesReserved();
+  EXPECT_GE(reserved, grid->faceNum() * (sizeof(Triangle3) + sizeof(unsigned int)));
+  // Nodes are packed in a few chunks rather than allocated one by one.
+  EXPECT_LE(reserved, 4 * grid->faceNum() * sizeof(Triangle3) + 64 * Arena::DEFAULT_CHUNK_SIZE);
+  verifyQueries(*tree);
+}
+
+TEST_F(KdTreeTest, TestIntersect) {
+  KdTree::Options options;
+  auto tree = KdTree::build(*grid, options);
+  mt19937 rng(3);
+  uniform_real_distribution<double> uniform(-1.0, 1.0);
+  unsigned int hitNum = 0;
+  for (int i = 0; i < 500; ++i) {
+    // Rays from above the grid, aimed roughly downwards in random directions.
+    Ray3 ray(Vector3(32.0 + 40.0 * uniform(rng), 32.0 + 40.0 * uniform(rng), 10.0),
+        Vector3(uniform(rng), uniform(rng), -1.0 - fabs(uniform(rng))));
+    RayHit expected;
+    for (unsigned int id = 0; id < tree->entityNum(); ++id) {
+      double t, u, v;
+      if (tree->entity(id).intersect(ray, 0.0, expected.t, t, u, v)) {
+        expected.entityId = id;
+        expected.t = t;
+      }
+    }
+    RayHit actual;
+    EXPECT_EQ(tree->intersect(ray, 0.0, HD_INFINITY, actual), expected.isHit());
+    EXPECT_EQ(tree->occluded(ray, 0.0, HD_INFINITY), expected.isHit());
+    if (!expected.isHit()) {
+      EXPECT_FALSE(actual.isHit());
+      continue;
+    }
+    ++hitNum;
+    EXPECT_DOUBLE_EQ(actual.t, expected.t);
+    // Hits closer than tMax only.
+    EXPECT_FALSE(tree->occluded(ray, 0.0, expected.t * 0.999));
+    RayHit clipped;
+    EXPECT_FALSE(tree->intersect(ray, 0.0, expected.t * 0.999, clipped));
+    EXPECT_FALSE(clipped.isHit());
+  }
+  EXPECT_GT(hitNum, 100);
+}
+
+TEST_F(KdTreeTest, TestTraversalStats) {
+  auto tree = KdTree::build(*grid);
+  Ray3 ray(Vector3(20.5, 30.5, 10.0), Vector3(0.1, 0.2, -1.0));
+  RayHit hit;
+  KdTree::TraversalStats stats;
+  EXPECT_TRUE(tree->intersect(ray, 0.0, HD_INFINITY, hit, &stats));
+  EXPECT_EQ(stats.traversalNum, 1u);
+  EXPECT_GT(stats.nodeNum, 1u);
+  EXPECT_GT(stats.entityNum, 0u);
+  EXPECT_LE(stats.nodeNum, tree->nodeNum());
+  EXPECT_GT(stats.cacheMissNum, 0u);
+  // Counting does not change the result.
+  RayHit uncounted;
+  EXPECT_TRUE(tree->intersect(ray, 0.0, HD_INFINITY, uncounted));
+  EXPECT_EQ(uncounted.t, hit.t);
+  EXPECT_EQ(uncounted.entityId, hit.entityId);
+
+  // The same ray again visits the same nodes, which are all in the simulated cache by now.
+  KdTree::TraversalStats first = stats;
+  EXPECT_TRUE(tree->intersect(ray, 0.0, HD_INFINITY, hit, &stats));
+  EXPECT_EQ(stats.traversalNum, 2u);
+  EXPECT_EQ(stats.nodeNum, 2 * first.nodeNum);
+  EXPECT_EQ(stats.entityNum, 2 * first.entityNum);
+  EXPECT_EQ(stats.cacheMissNum, first.cacheMissNum);
+
+  // Shadow rays stop at the first hit found.
+  KdTree::TraversalStats shadow;
+  EXPECT_TRUE(tree->occluded(ray, 0.0, HD_INFINITY, &shadow));
+  EXPECT_EQ(shadow.traversalNum, 1u);
+  EXPECT_LE(shadow.nodeNum, first.nodeNum);
+
+  // Counts add up, caches do not.
+  KdTree::TraversalStats total;
+  total += first;
+  total += shadow;
+  EXPECT_EQ(total.traversalNum, 2u);
+  EXPECT_EQ(total.nodeNum, first.nodeNum + shadow.nodeNum);
+  EXPECT_EQ(total.cacheMissNum, first.cacheMissNum + shadow.cacheMissNum);
+}
@@ -0,0 +1,152 @@
+#include "geometry/mesh_cluster.h"
+#include "geometry/triangular_mesh.h"
+#include "geometry/triangle3.h"
+#include "math/vector3.h"
+#include "const.h"
+#include "grid_mesh.h"
+#include <array>
+#include <map>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+class MeshClusterTest : public ::testing::Test {
+  protected:
+    // A flat 32x32 square on the xOy plane made of 2048 faces facing +z.
+    unique_ptr<TriangularMesh> grid;
+    // A unit sphere approximated by subdividing an octahedron 4 times, i.e. 2048 faces.
+    unique_ptr<TriangularMesh> sphere;
+
+    virtual void SetUp() {
+      grid = buildGridMesh(32, nullptr,
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::FLAT);
+
+      vector<Vector3> positions = {
+        Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0),
+        Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1)
+      };
+      vector<array<unsigned int, 3>> faces = {
+        {0, 2, 4}, {2, 1, 4}, {1, 3, 4}, {3, 0, 4},
+        {2, 0, 5}, {1, 2, 5}, {3, 1, 5}, {0, 3, 5}
+      };
+      for (int level = 0; level < 4; ++level) {
+        map<pair<unsigned int, unsigned int>, unsigned int> midpoints;
+        auto midpoint = [&](unsigned int a, unsigned int b) {
+          auto key = make_pair(min(a, b), max(a, b));
+          auto it = midpoints.find(key);
+          if (it != midpoints.end()) {
+            return it->second;
+          }
+          positions.push_back((positions[a] + positions[b]).normalize());
+          midpoints[key] = positions.size() - 1;
+          return static_cast<unsigned int>(positions.size() - 1);
+        };
+        vector<array<unsigned int, 3>> subdivided;
+        for (auto& f : faces) {
+          unsigned int m01 = midpoint(f[0], f[1]);
+          unsigned int m12 = midpoint(f[1], f[2]);
+          unsigned int m20 = midpoint(f[2], f[0]);
+          subdivided.push_back({f[0], m01, m20});
+          subdivided.push_back({m01, f[1], m12});
+          subdivided.push_back({m20, m12, f[2]});
+          subdivided.push_back({m01, m12, m20});
+        }
+        faces = subdivided;
+      }
+      sphere = TriangularMesh::newBuilder(
+              TriangularMesh::VertexNormalMode::AVERAGED,
+              TriangularMesh::FaceNormalMode::FLAT)
+          .addVertices(positions.data(), positions.size())
+          .addFaces(faces.data(), faces.size())
+          .build();
+    }
+
+    virtual void TearDown() {}
+
+    // Verify clusters cover every face exactly once within limits, and that local data and
+    // bounds are consistent with the mesh.
+    void verifyClusters(const TriangularMesh& mesh, const vector<MeshCluster>& clusters,
+        unsigned int maxFaceNum, unsigned int maxVertexNum) {
+      vector<unsigned int> count(mesh.faceNum(), 0);
+      for (auto& cluster : clusters) {
+        ASSERT_GT(cluster.faces.size(), 0);
+        EXPECT_LE(cluster.faces.size(), maxFaceNum);
+        EXPECT_LE(cluster.vertices.size(), maxVertexNum);
+        ASSERT_EQ(cluster.localTriangles.size(), cluster.faces.size() * 3);
+        for (unsigned int i = 0; i < cluster.faces.size(); ++i) {
+          unsigned int fid = cluster.faces[i];
+          ++count[fid];
+          auto vertices = mesh.f(fid).vertices;
+          for (unsigned int k = 0; k < 3; ++k) {
+            EXPECT_EQ(cluster.vertices[cluster.localTriangles[i * 3 + k]], vertices[k]);
+          }
+          EXPECT_GE(mesh.triangle(fid).normal() * cluster.coneAxis,
+              cluster.coneCosAngle - HD_EPSILON);
+        }
+        for (unsigned int vid : cluster.vertices) {
+          Vector3 p = mesh.v(vid).pos;
+          EXPECT_LE((p - cluster.center).len(), cluster.radius + HD_EPSILON);
+          Vector3 minCorner = cluster.boundingBox.minCorner();
+          Vector3 maxCorner = cluster.boundingBox.maxCorner();
+          for (int i = 0; i < 3; ++i) {
+            EXPECT_GE(p[i], minCorner[i] - HD_EPSILON);
+            EXPECT_LE(p[i], maxCorner[i] + HD_EPSILON);
+          }
+        }
+      }
+      for (unsigned int fid = 0; fid < mesh.faceNum(); ++fid) {
+        EXPECT_EQ(count[fid], 1);
+      }
+    }
+};
+
+TEST_F(MeshClusterTest, TestPartitionFlatGrid) {
+  auto clusters = MeshCluster::partition(*grid);
+  verifyClusters(*grid, clusters, 128, 128);
+  // Clusters are mostly full.
+  EXPECT_LE(clusters.size(), 2 * grid->faceNum() / 128);
+  for (auto& cluster : clusters) {
+    EXPECT_EQ(cluster.coneAxis, Vector3::zUnit());
+    EXPECT_NEAR(cluster.coneCosAngle, 1.0, HD_EPSILON);
+    EXPECT_TRUE(cluster.isBackFacing(cluster.center - Vector3(0, 0, 50)));
+    EXPECT_FALSE(cluster.isBackFacing(cluster.center + Vector3(0, 0, 50)));
+    // Views within the bounding sphere are never culled.
+    EXPECT_FALSE(cluster.isBackFacing(cluster.center));
+  }
+}
+
+TEST_F(MeshClusterTest, TestPartitionWithSmallLimits) {
+  auto clusters = MeshCluster::partition(*sphere, 8, 6);
+  verifyClusters(*sphere, clusters, 8, 6);
+}
+
+TEST_F(MeshClusterTest, TestBackFacingIsConservative) {
+  auto clusters = MeshCluster::partition(*sphere, 64, 64);
+  verifyClusters(*sphere, clusters, 64, 64);
+  mt19937 rng(7);
+  uniform_real_distribution<double> dist(-10.0, 10.0);
+  unsigned int culled = 0;
+  for (int i = 0; i < 50; ++i) {
+    Vector3 viewPos(dist(rng), dist(rng), dist(rng));
+    for (auto& cluster : clusters) {
+      if (!cluster.isBackFacing(viewPos)) {
+        continue;
+      }
+      ++culled;
+      for (unsigned int fid : cluster.faces) {
+        Triangle3 t = sphere->triangle(fid);
+        for (unsigned int k = 0; k < 3; ++k) {
+          EXPECT_GT((t.v(k) - viewPos) * t.normal(), 0.0);
+        }
+      }
+    }
+  }
+  // From outside a convex object, a good share of it faces away.
+  EXPECT_GT(culled, 50 * clusters.size() / 5);
+}
@@ -0,0 +1,141 @@
+#include "geometry/mesh_simplifier.h"
+#include "geometry/triangular_mesh.h"
+#include "geometry/bounding_box3.h"
+#include "math/vector3.h"
+#include "const.h"
+#include "grid_mesh.h"
+#include <cmath>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+class MeshSimplifierTest : public ::testing::Test {
+  protected:
+    // A flat 16x16 square made of a 16x16 grid of quads, i.e. 512 faces.
+    unique_ptr<TriangularMesh> grid;
+    // A unit sphere approximated by subdividing an octahedron 3 times, i.e. 512 faces.
+    unique_ptr<TriangularMesh> sphere;
+
+    virtual void SetUp() {
+      grid = buildGridMesh(16, nullptr,
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::FLAT);
+
+      vector<Vector3> positions = {
+        Vector3(1, 0, 0), Vector3(-1, 0, 0), Vector3(0, 1, 0),
+        Vector3(0, -1, 0), Vector3(0, 0, 1), Vector3(0, 0, -1)
+      };
+      vector<array<unsigned int, 3>> faces = {
+        {0, 2, 4}, {2, 1, 4}, {1, 3, 4}, {3, 0, 4},
+        {2, 0, 5}, {1, 2, 5}, {3, 1, 5}, {0, 3, 5}
+      };
+      for (int level = 0; level < 3; ++level) {
+        map<pair<unsigned int, unsigned int>, unsigned int> midpoints;
+        auto midpoint = [&](unsigned int a, unsigned int b) {
+          auto key = make_pair(min(a, b), max(a, b));
+          auto it = midpoints.find(key);
+          if (it != midpoints.end()) {
+            return it->second;
+          }
+          positions.push_back((positions[a] + positions[b]).normalize());
+          midpoints[key] = positions.size() - 1;
+          return static_cast<unsigned int>(positions.size() - 1);
+        };
+        vector<array<unsigned int, 3>> subdivided;
+        for (auto& f : faces) {
+          unsigned int m01 = midpoint(f[0], f[1]);
+          unsigned int m12 = midpoint(f[1], f[2]);
+          unsigned int m20 = midpoint(f[2], f[0]);
+          subdivided.push_back({f[0], m01, m20});
+          subdivided.push_back({m01, f[1], m12});
+          subdivided.push_back({m20, m12, f[2]});
+          subdivided.push_back({m01, m12, m20});
+        }
+        faces = subdivided;
+      }
+      auto sphereBuilder = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::PHONG);
+      for (auto& p : positions) {
+        sphereBuilder.addVertex(p);
+      }
+      for (auto& f : faces) {
+        sphereBuilder.addFace(f);
+      }
+      sphere = sphereBuilder.build();
+    }
+
+    virtual void TearDown() {}
+
+    // Verify the mesh is a closed 2-manifold of genus 0: every half-edge has a twin pointing
+    // backwards, and V - E + F = 2.
+    void verifyClosedSphere(const TriangularMesh& mesh) {
+      for (unsigned int eid = 0; eid < mesh.edgeNum(); ++eid) {
+        unsigned int twin = mesh.e(eid).twinEdge;
+        ASSERT_NE(twin, HD_INVALID_ID);
+        EXPECT_EQ(mesh.e(twin).twinEdge, eid);
+        EXPECT_EQ(mesh.e(twin).startVertex, mesh.e(eid).endVertex);
+      }
+      EXPECT_EQ(static_cast<int>(mesh.vertexNum())
+          - static_cast<int>(mesh.edgeNum() / 2)
+          + static_cast<int>(mesh.faceNum()), 2);
+    }
+};
+
+TEST_F(MeshSimplifierTest, TestSimplifyFlatGridKeepsShape) {
+  MeshSimplifier simplifier(*grid);
+  EXPECT_EQ(simplifier.faceNum(), 512);
+  auto lod = simplifier.simplify(8);
+  EXPECT_LE(lod->faceNum(), 8);
+  EXPECT_EQ(simplifier.faceNum(), lod->faceNum());
+  EXPECT_TRUE(lod->isPopulated());
+  // Corners are pinned by boundary constraints, and everything stays on the plane.
+  EXPECT_EQ(lod->boundingBox3(), grid->boundingBox3());
+  double area = 0.0;
+  for (unsigned int fid = 0; fid < lod->faceNum(); ++fid) {
+    EXPECT_EQ(lod->f(fid).normal, Vector3::zUnit());
+    area += lod->triangle(fid).surfaceArea();
+  }
+  EXPECT_NEAR(area, 256.0, HD_EPSILON);
+}
+
+TEST_F(MeshSimplifierTest, TestBuildLodChainOnClosedMesh) {
+  auto lods = MeshSimplifier::buildLods(*sphere, {256, 64, 16});
+  ASSERT_EQ(lods.size(), 3);
+  unsigned int expectedMaxFaces[3] = {256, 64, 16};
+  for (unsigned int i = 0; i < lods.size(); ++i) {
+    EXPECT_LE(lods[i]->faceNum(), expectedMaxFaces[i]);
+    EXPECT_GT(lods[i]->faceNum(), 0);
+    verifyClosedSphere(*lods[i]);
+    for (unsigned int vid = 0; vid < lods[i]->vertexNum(); ++vid) {
+      EXPECT_NEAR(lods[i]->v(vid).pos.len(), 1.0, 0.25);
+    }
+  }
+  // Coarser LODs deviate more from the original surface.
+  EXPECT_GT(lods[0]->faceNum(), lods[1]->faceNum());
+  EXPECT_GT(lods[1]->faceNum(), lods[2]->faceNum());
+}
+
+TEST_F(MeshSimplifierTest, TestTetrahedronCannotCollapse) {
+  auto tetra = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::FLAT)
+      .addVertex(Vector3(0, 0, 0))
+      .addVertex(Vector3(1, 0, 0))
+      .addVertex(Vector3(0, 1, 0))
+      .addVertex(Vector3(0, 0, 1))
+      .addFace({1, 0, 2})
+      .addFace({1, 3, 0})
+      .addFace({0, 3, 2})
+      .addFace({1, 2, 3})
+      .build();
+  MeshSimplifier simplifier(*tetra);
+  auto lod = simplifier.simplify(0);
+  EXPECT_EQ(lod->faceNum(), 4);
+  verifyClosedSphere(*lod);
+}
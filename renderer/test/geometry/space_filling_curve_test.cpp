@@ -0,0 +1,67 @@
+#include "geometry/space_filling_curve.h"
+#include "geometry/bounding_box3.h"
+#include "math/vector3.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(SpaceFillingCurveTest, TestMortonIndex) {
+  EXPECT_EQ(mortonIndex3(0, 0, 0), 0);
+  EXPECT_EQ(mortonIndex3(1, 0, 0), 1);
+  EXPECT_EQ(mortonIndex3(0, 1, 0), 2);
+  EXPECT_EQ(mortonIndex3(0, 0, 1), 4);
+  EXPECT_EQ(mortonIndex3(3, 3, 3), 63);
+  EXPECT_EQ(mortonIndex3(2, 0, 1), 12);
+  const uint32_t maxCoord = (1u << SFC_MAX_BITS) - 1;
+  EXPECT_EQ(mortonIndex3(maxCoord, maxCoord, maxCoord), (1ULL << 63) - 1);
+  EXPECT_EQ(mortonIndex3(0, 0, maxCoord), 0x4924924924924924ULL);
+}
+
+TEST(SpaceFillingCurveTest, TestHilbertIndexVisitsAdjacentCells) {
+  const unsigned int bits = 3;
+  const uint32_t n = 1u << bits;
+  vector<pair<uint64_t, vector<uint32_t>>> cells;
+  for (uint32_t x = 0; x < n; ++x) {
+    for (uint32_t y = 0; y < n; ++y) {
+      for (uint32_t z = 0; z < n; ++z) {
+        cells.push_back(make_pair(hilbertIndex3(x, y, z, bits), vector<uint32_t>{x, y, z}));
+      }
+    }
+  }
+  sort(cells.begin(), cells.end());
+  // The curve is a bijection between cells and [0, n^3), and consecutive cells share a face.
+  for (unsigned int i = 0; i < cells.size(); ++i) {
+    ASSERT_EQ(cells[i].first, i);
+    if (i > 0) {
+      int dist = 0;
+      for (int axis = 0; axis < 3; ++axis) {
+        dist += abs(static_cast<int>(cells[i].second[axis])
+            - static_cast<int>(cells[i - 1].second[axis]));
+      }
+      EXPECT_EQ(dist, 1);
+    }
+  }
+  EXPECT_EQ(hilbertIndex3(0, 0, 0), 0);
+}
+
+TEST(SpaceFillingCurveTest, TestPointIndex) {
+  BoundingBox3 box(Vector3(-1, -1, -1), Vector3(1, 1, 1));
+  for (auto curve : {SpaceFillingCurve::MORTON, SpaceFillingCurve::HILBERT}) {
+    EXPECT_EQ(spaceFillingCurveIndex(curve, Vector3(-1, -1, -1), box), 0);
+    // Points outside the box are clamped.
+    EXPECT_EQ(spaceFillingCurveIndex(curve, Vector3(-5, -2, -3), box), 0);
+    EXPECT_EQ(spaceFillingCurveIndex(curve, Vector3(1, 1, 1), box),
+        spaceFillingCurveIndex(curve, Vector3(2, 3, 4), box));
+  }
+  EXPECT_EQ(spaceFillingCurveIndex(SpaceFillingCurve::MORTON, Vector3(1, 1, 1), box),
+      (1ULL << 63) - 1);
+  // Flat boxes map all points to the lowest cell along the flat axis.
+  BoundingBox3 flat(Vector3(0, 0, 0), Vector3(1, 1, 0));
+  EXPECT_EQ(spaceFillingCurveIndex(SpaceFillingCurve::MORTON, Vector3(0, 0, 7), flat), 0);
+}
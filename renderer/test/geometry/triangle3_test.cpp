@@ -55,3 +55,37 @@ TEST_F(Triangle3Test, TestProperties) {
   // sqrt(3) / 4 * (sqrt(2) ^ 2)
   EXPECT_EQ(tri2.surfaceArea(), sqrt(3) / 2.0);
 }
+
+TEST_F(Triangle3Test, TestIntersect) {
+  double t, u, v;
+  // Straight down onto tri1, from either side.
+  hd::Ray3 down(hd::Vector3(0.25, 0.5, 1.0), hd::Vector3(0.0, 0.0, -1.0));
+  EXPECT_TRUE(tri1.intersect(down, 0.0, HD_INFINITY, t, u, v));
+  EXPECT_DOUBLE_EQ(t, 1.0);
+  EXPECT_DOUBLE_EQ(u, 0.25);
+  EXPECT_DOUBLE_EQ(v, 0.25);
+  EXPECT_EQ(down.pointAt(t), hd::Vector3(0.25, 0.5, 0.0));
+  hd::Ray3 up(hd::Vector3(0.25, 0.5, -2.0), hd::Vector3(0.0, 0.0, 2.0));
+  EXPECT_TRUE(tri1.intersect(up, 0.0, HD_INFINITY, t, u, v));
+  EXPECT_DOUBLE_EQ(t, 1.0);
+
+  // Out of the distance range.
+  EXPECT_FALSE(tri1.intersect(down, 0.0, 0.5, t, u, v));
+  EXPECT_FALSE(tri1.intersect(down, 1.5, HD_INFINITY, t, u, v));
+  // Pointing away.
+  hd::Ray3 away(hd::Vector3(0.25, 0.5, 1.0), hd::Vector3(0.0, 0.0, 1.0));
+  EXPECT_FALSE(tri1.intersect(away, 0.0, HD_INFINITY, t, u, v));
+  // Outside of the triangle.
+  hd::Ray3 miss(hd::Vector3(0.75, 1.0, 1.0), hd::Vector3(0.0, 0.0, -1.0));
+  EXPECT_FALSE(tri1.intersect(miss, 0.0, HD_INFINITY, t, u, v));
+  // Parallel to the triangle.
+  hd::Ray3 parallel(hd::Vector3(-1.0, 0.5, 0.0), hd::Vector3(1.0, 0.0, 0.0));
+  EXPECT_FALSE(tri1.intersect(parallel, 0.0, HD_INFINITY, t, u, v));
+
+  // Through the center of tri2 from the origin.
+  hd::Ray3 diagonal(hd::Vector3::zero(), hd::Vector3::one());
+  EXPECT_TRUE(tri2.intersect(diagonal, 0.0, HD_INFINITY, t, u, v));
+  EXPECT_NEAR(t, 1.0 / 3.0, HD_EPSILON);
+  EXPECT_NEAR(u, 1.0 / 3.0, HD_EPSILON);
+  EXPECT_NEAR(v, 1.0 / 3.0, HD_EPSILON);
+}
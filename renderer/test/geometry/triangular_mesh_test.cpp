@@ -4,8 +4,15 @@
 #include "math/vector3.h"
 #include "math/matrix3.h"
 #include "const.h"
+#include "grid_mesh.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <memory>
+#include <numeric>
+#include <random>
 #include <set>
+#include <vector>
 #include <gtest/gtest.h>
 
 using namespace hd;
@@ -233,3 +240,543 @@ TEST_F(TriangularMeshTest, TestNormalInterpolation) {
   //    = (0.2769861700, -0.5874728184, -0.7603646160)
   EXPECT_EQ(tetra2->normal(p2), Vector3(0.2769861700, -0.5874728184, -0.7603646160));
 }
+
+TEST_F(TriangularMeshTest, TestWeldVertices) {
+  // Two triangles of a unit square given as a vertex soup, with slightly jittered copies of
+  // the shared vertices, plus a sliver face that collapses when welded.
+  auto buildSoup = [](bool weld) {
+    auto builder = TriangularMesh::newBuilder(
+        TriangularMesh::VertexNormalMode::AVERAGED,
+        TriangularMesh::FaceNormalMode::FLAT);
+    builder
+        .addVertex(Vector3(0, 0, 0))
+        .addVertex(Vector3(1, 0, 0))
+        .addVertex(Vector3(1, 1, 0))
+        .addVertex(Vector3(1 + 1e-8, 1, 0))
+        .addVertex(Vector3(0, 1, 0))
+        .addVertex(Vector3(0, -1e-8, 0))
+        .addVertex(Vector3(0, 0, 1e-8))
+        .addFace({0, 1, 2})
+        .addFace({3, 4, 5})
+        .addFace({0, 6, 4});
+    if (weld) {
+      builder.weldVertices();
+    }
+    // The sliver face is too thin to have a normal, so the soup cannot be populated as is.
+    return builder.build(weld /* populate */);
+  };
+
+  auto soup = buildSoup(false);
+  EXPECT_EQ(soup->vertexNum(), 7);
+  EXPECT_EQ(soup->faceNum(), 3);
+
+  auto welded = buildSoup(true);
+  EXPECT_EQ(welded->vertexNum(), 4);
+  EXPECT_EQ(welded->faceNum(), 2);
+  EXPECT_EQ(welded->f(1).vertices, (array<unsigned int, 3>{2, 3, 0}));
+  EXPECT_EQ(welded->v(2).pos, Vector3(1, 1, 0));
+  // The diagonal is now shared by both faces, so its half-edges are twins.
+  verifyTraversal(welded, 0, /* vertex id */
+      Vector3(0, 0, 0), /* expected pos */
+      2, /* expected degree */
+      1, /* edge index from picked vertex */
+      true /* should have a twin edge */);
+  EXPECT_EQ(welded->v(0).normal, Vector3::zUnit());
+}
+
+TEST_F(TriangularMeshTest, TestWeldVerticesKeepsDistinctNormals) {
+  // Coincident vertices with different user specified normals form a crease and must not
+  // be merged.
+  auto mesh = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::USER_SPECIFIED,
+          TriangularMesh::FaceNormalMode::FLAT)
+      .addVertex(Vector3(0, 0, 0), Vector3(0, 0, 1))
+      .addVertex(Vector3(1, 0, 0), Vector3(0, 0, 1))
+      .addVertex(Vector3(0, 1, 0), Vector3(0, 0, 1))
+      .addVertex(Vector3(0, 0, 0), Vector3(1, 0, 0))
+      .addVertex(Vector3(0, 1, 0), Vector3(1, 0, 0))
+      .addVertex(Vector3(0, 0, 1), Vector3(1, 0, 0))
+      .addVertex(Vector3(0, 1, 0), Vector3(0, 0, 1))
+      .addFace({0, 1, 2})
+      .addFace({3, 5, 4})
+      .addFace({6, 1, 5})
+      .weldVertices()
+      .build();
+  EXPECT_EQ(mesh->vertexNum(), 6);
+  EXPECT_EQ(mesh->faceNum(), 3);
+  EXPECT_EQ(mesh->f(2).vertices, (array<unsigned int, 3>{2, 1, 5}));
+}
+
+TEST_F(TriangularMeshTest, TestCompress) {
+  TriangularMesh::MeshPoint p1 = TriangularMesh::MeshPoint(3, Vector3::one() / 3.0);
+  TriangularMesh::MeshPoint p2 = TriangularMesh::MeshPoint(0, Vector3(0.6, 0.3, 0.1));
+  Vector3 expectedNormal = tetra2->normal(p2);
+
+  TriangularMesh copy = TriangularMesh(*tetra2);
+  auto stats = tetra2->compress(CompressedMeshStorage::PositionPrecision::BITS_21);
+  EXPECT_TRUE(tetra2->isCompressed());
+  EXPECT_FALSE(copy.isCompressed());
+  EXPECT_GT(stats.ratio(), 2.0);
+  EXPECT_LT(stats.maxPositionError, 1e-6);
+  EXPECT_LT(stats.maxNormalError, 1e-4);
+  EXPECT_EQ(tetra2->vertexNum(), 4);
+  EXPECT_EQ(tetra2->faceNum(), 4);
+  EXPECT_EQ(tetra2->edgeNum(), 0);
+  EXPECT_EQ(tetra2->pos(p1), Vector3::one() / 3.0);
+  EXPECT_EQ(tetra2->pos(p2), Vector3(0.6, 0.1, 0.0));
+  EXPECT_NEAR(tetra2->normal(p2) * expectedNormal, 1.0, 1e-8);
+  EXPECT_EQ(tetra2->triangle(3), copy.triangle(3));
+  EXPECT_EQ(tetra2->boundingBox3(), copy.boundingBox3());
+  // Elements are decoded, without half-edges.
+  EXPECT_EQ(tetra2->v(2).pos, copy.v(2).pos);
+  EXPECT_NEAR(tetra2->v(2).normal * copy.v(2).normal.normalize(), 1.0, 1e-8);
+  EXPECT_TRUE(tetra2->v(2).edges.empty());
+  EXPECT_EQ(tetra2->f(1).vertices, copy.f(1).vertices);
+  EXPECT_EQ(tetra2->f(1).edges[0], HD_INVALID_ID);
+  EXPECT_NEAR(tetra2->f(1).normal * copy.triangle(1).normal(), 1.0, 1e-8);
+  EXPECT_DEATH(tetra2->e(0), "not available on compressed meshes");
+
+  // Copies of compressed meshes share the compressed data.
+  TriangularMesh compressedCopy = TriangularMesh(*tetra2);
+  EXPECT_TRUE(compressedCopy.isCompressed());
+  EXPECT_EQ(compressedCopy.triangle(3), copy.triangle(3));
+
+  // Normals are still exact in the flat case, positions within half a quantization step.
+  plane2->compress(CompressedMeshStorage::PositionPrecision::BITS_21);
+  EXPECT_EQ(plane2->normal(p2), Vector3::zUnit());
+  EXPECT_EQ(plane2->triangle(3), Triangle3(Vector3(2, 0, 0), Vector3(1, 1, 0), Vector3(2, 1, 0)));
+}
+
+TEST_F(TriangularMeshTest, TestCompressLargeMesh) {
+  const unsigned int n = 64;
+  auto mesh = buildGridMesh(n,
+      [](unsigned int x, unsigned int y) { return sin(x * 0.1) * cos(y * 0.1); },
+      TriangularMesh::VertexNormalMode::AVERAGED,
+      TriangularMesh::FaceNormalMode::PHONG);
+  auto stats = mesh->compress();
+  EXPECT_GE(stats.ratio(), 3.0);
+  EXPECT_LT(stats.maxPositionError, n / 65535.0);
+  EXPECT_LT(stats.maxNormalError, 1e-4);
+}
+
+TEST_F(TriangularMeshTest, TestReorder) {
+  // A grid with its vertices and faces inserted in shuffled order.
+  auto grid = buildGridMesh(16, nullptr,
+      TriangularMesh::VertexNormalMode::AVERAGED,
+      TriangularMesh::FaceNormalMode::PHONG);
+  const unsigned int vertexNum = grid->vertexNum();
+  mt19937 rng(42);
+  vector<unsigned int> slot(vertexNum);
+  iota(slot.begin(), slot.end(), 0);
+  shuffle(slot.begin(), slot.end(), rng);
+  vector<unsigned int> vertexIndex(vertexNum);
+  for (unsigned int i = 0; i < vertexNum; ++i) {
+    vertexIndex[slot[i]] = i;
+  }
+  vector<array<unsigned int, 3>> faces;
+  for (unsigned int fid = 0; fid < grid->faceNum(); ++fid) {
+    auto face = grid->f(fid).vertices;
+    faces.push_back({vertexIndex[face[0]], vertexIndex[face[1]], vertexIndex[face[2]]});
+  }
+  shuffle(faces.begin(), faces.end(), rng);
+  auto builder = TriangularMesh::newBuilder(
+      TriangularMesh::VertexNormalMode::AVERAGED,
+      TriangularMesh::FaceNormalMode::PHONG);
+  for (unsigned int i = 0; i < vertexNum; ++i) {
+    builder.addVertex(grid->v(slot[i]).pos);
+  }
+  for (auto& face : faces) {
+    builder.addFace(face);
+  }
+  auto mesh = builder.build();
+
+  // Sum of index distances between faces sharing an edge.
+  auto adjacencySpread = [](const TriangularMesh& m) {
+    double spread = 0.0;
+    for (unsigned int eid = 0; eid < m.edgeNum(); ++eid) {
+      unsigned int twin = m.e(eid).twinEdge;
+      if (twin != static_cast<unsigned int>(HD_INVALID_ID)) {
+        spread += fabs(static_cast<double>(m.e(eid).face) - m.e(twin).face);
+      }
+    }
+    return spread;
+  };
+
+  for (auto curve : {SpaceFillingCurve::MORTON, SpaceFillingCurve::HILBERT}) {
+    TriangularMesh reordered = TriangularMesh(*mesh);
+    reordered.reorder(curve);
+    ASSERT_EQ(reordered.vertexNum(), mesh->vertexNum());
+    ASSERT_EQ(reordered.edgeNum(), mesh->edgeNum());
+    ASSERT_EQ(reordered.faceNum(), mesh->faceNum());
+    EXPECT_EQ(reordered.boundingBox3(), mesh->boundingBox3());
+    EXPECT_LT(adjacencySpread(reordered), adjacencySpread(*mesh) / 4);
+
+    // The DCEL is consistent under the new indices.
+    for (unsigned int eid = 0; eid < reordered.edgeNum(); ++eid) {
+      auto edge = reordered.e(eid);
+      EXPECT_EQ(reordered.f(edge.face).edges[eid % 3], eid);
+      EXPECT_EQ(reordered.e(edge.nextEdge).startVertex, edge.endVertex);
+      EXPECT_EQ(reordered.e(edge.prevEdge).endVertex, edge.startVertex);
+      if (edge.twinEdge != static_cast<unsigned int>(HD_INVALID_ID)) {
+        EXPECT_EQ(reordered.e(edge.twinEdge).twinEdge, eid);
+        EXPECT_EQ(reordered.e(edge.twinEdge).startVertex, edge.endVertex);
+      }
+      auto outgoing = reordered.v(edge.startVertex).edges;
+      EXPECT_NE(find(outgoing.begin(), outgoing.end(), eid), outgoing.end());
+    }
+    // Every face keeps its geometry and normals, only at another index.
+    set<unsigned int> matched;
+    for (unsigned int fid = 0; fid < reordered.faceNum(); ++fid) {
+      Triangle3 t = reordered.triangle(fid);
+      Vector3 n = reordered.normal(TriangularMesh::MeshPoint(fid, Vector3(0.2, 0.3, 0.5)));
+      unsigned int found = HD_INVALID_ID;
+      for (unsigned int oldFid = 0; oldFid < mesh->faceNum(); ++oldFid) {
+        if (mesh->triangle(oldFid) == t) {
+          found = oldFid;
+          break;
+        }
+      }
+      ASSERT_NE(found, HD_INVALID_ID);
+      EXPECT_EQ(n, mesh->normal(TriangularMesh::MeshPoint(found, Vector3(0.2, 0.3, 0.5))));
+      matched.insert(found);
+    }
+    EXPECT_EQ(matched.size(), grid->faceNum());
+  }
+}
+
+TEST_F(TriangularMeshTest, TestBulkBuilder) {
+  // Same as tetra2.
+  vector<Vector3> positions = {
+    Vector3(0, 0, 0), Vector3(1, 0, 0), Vector3(0, 1, 0), Vector3(0, 0, 1)
+  };
+  vector<array<unsigned int, 3>> faces = {{1, 0, 2}, {1, 3, 0}, {0, 3, 2}, {1, 2, 3}};
+  auto bulk = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::PHONG)
+      .addVertices(positions.data(), 2)
+      .addVertices(positions.data() + 2, 2)
+      .addFaces(faces.data(), faces.size())
+      .build();
+
+  vector<TriangularMesh::Vertex> vertexList;
+  for (auto& p : positions) {
+    vertexList.push_back(TriangularMesh::Vertex(p));
+  }
+  vector<TriangularMesh::Face> faceList;
+  for (auto& f : faces) {
+    faceList.push_back(TriangularMesh::Face(f));
+  }
+  auto moved = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::PHONG)
+      .addVertex(Vector3(5, 5, 5))
+      .setVertices(std::move(vertexList))
+      .setFaces(std::move(faceList))
+      .build();
+
+  for (auto* mesh : {bulk.get(), moved.get()}) {
+    ASSERT_EQ(mesh->vertexNum(), tetra2->vertexNum());
+    ASSERT_EQ(mesh->edgeNum(), tetra2->edgeNum());
+    ASSERT_EQ(mesh->faceNum(), tetra2->faceNum());
+    for (unsigned int vid = 0; vid < mesh->vertexNum(); ++vid) {
+      EXPECT_EQ(mesh->v(vid).pos, tetra2->v(vid).pos);
+      EXPECT_EQ(mesh->v(vid).normal, tetra2->v(vid).normal);
+      EXPECT_EQ(mesh->v(vid).edges, tetra2->v(vid).edges);
+    }
+    for (unsigned int eid = 0; eid < mesh->edgeNum(); ++eid) {
+      EXPECT_EQ(mesh->e(eid).twinEdge, tetra2->e(eid).twinEdge);
+    }
+    EXPECT_EQ(mesh->boundingBox3(), tetra2->boundingBox3());
+  }
+
+  // User specified normals, same as plane2.
+  vector<Vector3> planePositions;
+  for (unsigned int vid = 0; vid < plane2->vertexNum(); ++vid) {
+    planePositions.push_back(plane2->v(vid).pos);
+  }
+  vector<Vector3> planeNormals(planePositions.size(), Vector3::zUnit());
+  vector<array<unsigned int, 3>> planeFaces;
+  for (unsigned int fid = 0; fid < plane2->faceNum(); ++fid) {
+    planeFaces.push_back(plane2->f(fid).vertices);
+  }
+  vector<Vector3> planeFaceNormals(planeFaces.size(), Vector3::zUnit());
+  auto plane = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::USER_SPECIFIED,
+          TriangularMesh::FaceNormalMode::USER_SPECIFIED)
+      .addVertices(planePositions.data(), planeNormals.data(), planePositions.size())
+      .addFaces(planeFaces.data(), planeFaceNormals.data(), planeFaces.size())
+      .build();
+  ASSERT_EQ(plane->faceNum(), plane2->faceNum());
+  for (unsigned int fid = 0; fid < plane->faceNum(); ++fid) {
+    EXPECT_EQ(plane->triangle(fid), plane2->triangle(fid));
+    EXPECT_EQ(plane->f(fid).normal, Vector3::zUnit());
+  }
+}
+
+TEST_F(TriangularMeshTest, TestCopyOnWrite) {
+  TriangularMesh copy = TriangularMesh(*tetra2);
+  EXPECT_TRUE(copy.sharesGeometryWith(*tetra2));
+  EXPECT_FALSE(tetra1->sharesGeometryWith(*tetra2));
+
+  // Modifying the copy leaves the original untouched.
+  copy.reorder(SpaceFillingCurve::MORTON);
+  EXPECT_FALSE(copy.sharesGeometryWith(*tetra2));
+  EXPECT_EQ(tetra2->f(0).vertices, (array<unsigned int, 3>{1, 0, 2}));
+  EXPECT_EQ(tetra2->v(1).pos, Vector3(1, 0, 0));
+
+  TriangularMesh compressed = TriangularMesh(*tetra2);
+  compressed.compress();
+  EXPECT_FALSE(compressed.sharesGeometryWith(*tetra2));
+  EXPECT_EQ(tetra2->edgeNum(), 12);
+  EXPECT_TRUE(TriangularMesh(compressed).sharesGeometryWith(compressed));
+}
+
+TEST_F(TriangularMeshTest, TestSurfaceSampling) {
+  // Two triangles with areas 0.5 and 2.
+  auto mesh = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::FLAT)
+      .addVertex(Vector3(0, 0, 0))
+      .addVertex(Vector3(1, 0, 0))
+      .addVertex(Vector3(0, 1, 0))
+      .addVertex(Vector3(5, 0, 0))
+      .addVertex(Vector3(7, 0, 0))
+      .addVertex(Vector3(5, 2, 0))
+      .addFace({0, 1, 2})
+      .addFace({3, 4, 5})
+      .build();
+  EXPECT_NEAR(mesh->surfaceArea(), 2.5, HD_EPSILON);
+  EXPECT_NEAR(tetra1->surfaceArea(), 1.5 + sqrt(3.0) / 2, HD_EPSILON);
+
+  const unsigned int n = 100;
+  vector<double> u;
+  unsigned int secondFace = 0;
+  Vector3 sumOfSecondFace = Vector3::zero();
+  for (unsigned int i = 0; i < n; ++i) {
+    for (unsigned int j = 0; j < n; ++j) {
+      // Decorrelated from u1 and u2 by a golden ratio sequence.
+      double uFace = fmod((i * n + j) * 0.6180339887498949, 1.0);
+      double u1 = (i + 0.5) / n;
+      double u2 = (j + 0.5) / n;
+      auto p = mesh->samplePoint(uFace, u1, u2);
+      Vector3 pos = mesh->pos(p);
+      EXPECT_NEAR(pos.z, 0.0, HD_EPSILON);
+      if (pos.x >= 5.0 - HD_EPSILON) {
+        ++secondFace;
+        sumOfSecondFace += pos;
+        EXPECT_LE(pos.x + pos.y, 7.0 + HD_EPSILON);
+      } else {
+        EXPECT_LE(pos.x + pos.y, 1.0 + HD_EPSILON);
+        EXPECT_GE(pos.x, -HD_EPSILON);
+        EXPECT_GE(pos.y, -HD_EPSILON);
+      }
+      u.push_back(uFace);
+      u.push_back(u1);
+      u.push_back(u2);
+    }
+  }
+  EXPECT_NEAR(static_cast<double>(secondFace) / (n * n), 0.8, 1e-3);
+  // Uniform sampling by area puts the mean at the centroid.
+  Vector3 mean = sumOfSecondFace / secondFace;
+  EXPECT_NEAR(mean.x, 17.0 / 3, 1e-2);
+  EXPECT_NEAR(mean.y, 2.0 / 3, 1e-2);
+
+  vector<TriangularMesh::MeshPoint> points;
+  mesh->samplePoints(u.data(), n * n, points);
+  ASSERT_EQ(points.size(), n * n);
+  for (unsigned int i = 0; i < points.size(); ++i) {
+    EXPECT_EQ(mesh->pos(points[i]), mesh->pos(mesh->samplePoint(u[3 * i], u[3 * i + 1],
+        u[3 * i + 2])));
+  }
+  // Appending one point at a time still grows the output geometrically.
+  points.clear();
+  points.shrink_to_fit();
+  unsigned int reallocationNum = 0;
+  for (unsigned int i = 0; i < n * n; ++i) {
+    size_t capacity = points.capacity();
+    mesh->samplePoints(&u[3 * i], 1, points);
+    reallocationNum += points.capacity() != capacity ? 1 : 0;
+  }
+  EXPECT_LT(reallocationNum, 32);
+
+  // The cached table follows geometry changes.
+  TriangularMesh copy = TriangularMesh(*mesh);
+  copy.reorder(SpaceFillingCurve::MORTON);
+  EXPECT_NEAR(copy.surfaceArea(), 2.5, HD_EPSILON);
+  copy.compress(CompressedMeshStorage::PositionPrecision::BITS_21);
+  EXPECT_NEAR(copy.surfaceArea(), 2.5, 1e-5);
+}
+
+TEST_F(TriangularMeshTest, TestBatchedEvaluation) {
+  // Spans several blocks, with a partial one at the end.
+  const unsigned int n = 150;
+  mt19937 rng(7);
+  uniform_real_distribution<double> uniform(0.0, 1.0);
+  vector<unsigned int> faceIds(n);
+  vector<double> a(n), b(n), c(n);
+  for (unsigned int i = 0; i < n; ++i) {
+    faceIds[i] = rng() % 4;
+    double u = uniform(rng);
+    double v = uniform(rng) * (1.0 - u);
+    a[i] = u;
+    b[i] = v;
+    c[i] = 1.0 - u - v;
+  }
+
+  TriangularMesh compressed = TriangularMesh(*tetra2);
+  compressed.compress();
+  vector<const TriangularMesh*> meshes = {tetra1.get(), tetra2.get(), &compressed};
+  vector<double> x(n), y(n), z(n);
+  for (auto mesh : meshes) {
+    mesh->pos(n, faceIds.data(), a.data(), b.data(), c.data(), x.data(), y.data(), z.data());
+    for (unsigned int i = 0; i < n; ++i) {
+      Vector3 expected = mesh->pos(TriangularMesh::MeshPoint(faceIds[i],
+          Vector3(a[i], b[i], c[i])));
+      EXPECT_NEAR(x[i], expected.x, HD_EPSILON);
+      EXPECT_NEAR(y[i], expected.y, HD_EPSILON);
+      EXPECT_NEAR(z[i], expected.z, HD_EPSILON);
+    }
+    mesh->normal(n, faceIds.data(), a.data(), b.data(), c.data(),
+        x.data(), y.data(), z.data());
+    for (unsigned int i = 0; i < n; ++i) {
+      Vector3 expected = mesh->normal(TriangularMesh::MeshPoint(faceIds[i],
+          Vector3(a[i], b[i], c[i])));
+      EXPECT_NEAR(x[i], expected.x, HD_EPSILON);
+      EXPECT_NEAR(y[i], expected.y, HD_EPSILON);
+      EXPECT_NEAR(z[i], expected.z, HD_EPSILON);
+    }
+  }
+
+  // User specified face normals are copied as is.
+  plane2->normal(2, faceIds.data(), a.data(), b.data(), c.data(), x.data(), y.data(), z.data());
+  EXPECT_EQ(Vector3(x[1], y[1], z[1]), Vector3::zUnit());
+}
+
+TEST_F(TriangularMeshTest, TestEditor) {
+  const unsigned int n = 8;
+  auto mesh = buildGridMesh(n,
+      [](unsigned int x, unsigned int y) { return sin(x * 0.5) * cos(y * 0.5); },
+      TriangularMesh::VertexNormalMode::AVERAGED,
+      TriangularMesh::FaceNormalMode::PHONG);
+  TriangularMesh original = TriangularMesh(*mesh);
+
+  // Lift an interior vertex, cut a hole and cover it with a fan around a new vertex, and pull
+  // in a corner so that the bounding box shrinks.
+  auto editor = mesh->edit();
+  editor.moveVertex(40, Vector3(4, 4, 3));
+  unsigned int center = editor.addVertex(Vector3(2.5, 2.5, -1));
+  EXPECT_EQ(center, (n + 1) * (n + 1));
+  unsigned int v0 = 2 * (n + 1) + 2;
+  editor.removeFace(2 * (2 * n + 2))
+      .removeFace(2 * (2 * n + 2) + 1)
+      .addFace({v0, v0 + 1, center})
+      .addFace({v0 + 1, v0 + n + 2, center})
+      .addFace({v0 + n + 2, v0 + n + 1, center})
+      .addFace({v0 + n + 1, v0, center})
+      .moveVertex(0, Vector3(0.5, 0.5, 0));
+  editor.commit();
+  EXPECT_EQ(mesh->faceNum(), 2 * n * n + 2);
+  EXPECT_EQ(mesh->edgeNum(), 3 * mesh->faceNum());
+  EXPECT_EQ(mesh->vertexNum(), (n + 1) * (n + 1) + 1);
+  // The original copy is left untouched.
+  EXPECT_EQ(original.faceNum(), 2 * n * n);
+  EXPECT_EQ(original.v(40).pos, Vector3(4, 4, sin(2.0) * cos(2.0)));
+
+  // Everything derived must match a mesh built from scratch from the edited geometry.
+  auto rebuilder = TriangularMesh::newBuilder(
+      TriangularMesh::VertexNormalMode::AVERAGED,
+      TriangularMesh::FaceNormalMode::PHONG);
+  for (unsigned int vid = 0; vid < mesh->vertexNum(); ++vid) {
+    rebuilder.addVertex(mesh->v(vid).pos);
+  }
+  for (unsigned int fid = 0; fid < mesh->faceNum(); ++fid) {
+    rebuilder.addFace(mesh->f(fid).vertices);
+  }
+  auto rebuilt = rebuilder.build();
+  EXPECT_EQ(mesh->boundingBox3(), rebuilt->boundingBox3());
+  EXPECT_EQ(mesh->boundingBox3().minCorner().x, 0.0);
+  for (unsigned int fid = 0; fid < mesh->faceNum(); ++fid) {
+    EXPECT_EQ(mesh->f(fid).normal, rebuilt->f(fid).normal);
+    EXPECT_EQ(mesh->f(fid).edges, rebuilt->f(fid).edges);
+  }
+  for (unsigned int eid = 0; eid < mesh->edgeNum(); ++eid) {
+    auto edge = mesh->e(eid);
+    auto expected = rebuilt->e(eid);
+    EXPECT_EQ(edge.startVertex, expected.startVertex);
+    EXPECT_EQ(edge.endVertex, expected.endVertex);
+    EXPECT_EQ(edge.face, expected.face);
+    EXPECT_EQ(edge.twinEdge, expected.twinEdge);
+    EXPECT_EQ(edge.nextEdge, expected.nextEdge);
+    EXPECT_EQ(edge.prevEdge, expected.prevEdge);
+  }
+  for (unsigned int vid = 0; vid < mesh->vertexNum(); ++vid) {
+    EXPECT_EQ(mesh->v(vid).normal, rebuilt->v(vid).normal);
+    auto edges = mesh->v(vid).edges;
+    auto expectedEdges = rebuilt->v(vid).edges;
+    EXPECT_EQ(set<unsigned int>(edges.begin(), edges.end()),
+        set<unsigned int>(expectedEdges.begin(), expectedEdges.end()));
+  }
+}
+
+TEST_F(TriangularMeshTest, TestArena) {
+  auto arena = make_shared<Arena>(4096);
+  auto mesh = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::PHONG)
+      .setArena(arena)
+      .addVertex(Vector3(0, 0, 0))
+      .addVertex(Vector3(1, 0, 0))
+      .addVertex(Vector3(0, 1, 0))
+      .addVertex(Vector3(0, 0, 1))
+      .addFace({1, 0, 2})
+      .addFace({1, 3, 0})
+      .addFace({0, 3, 2})
+      .addFace({1, 2, 3})
+      .build();
+  EXPECT_EQ(mesh->arena(), arena);
+  EXPECT_EQ(arena->bytesReserved(), 4096);
+  for (unsigned int vid = 0; vid < mesh->vertexNum(); ++vid) {
+    EXPECT_EQ(mesh->v(vid).edges, tetra2->v(vid).edges);
+    EXPECT_EQ(mesh->v(vid).normal, tetra2->v(vid).normal);
+  }
+
+  // Copies keep the arena alive.
+  TriangularMesh copy = TriangularMesh(*mesh);
+  mesh.reset();
+  arena.reset();
+  EXPECT_EQ(copy.v(0).edges, tetra2->v(0).edges);
+  copy.edit().moveVertex(0, Vector3(-1, -1, -1)).commit();
+  EXPECT_EQ(copy.v(0).edges, tetra2->v(0).edges);
+}
+
+TEST_F(TriangularMeshTest, TestEditingDoesNotGrowArena) {
+  auto arena = make_shared<Arena>(4096);
+  auto mesh = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::PHONG)
+      .setArena(arena)
+      .addVertex(Vector3(0, 0, 0))
+      .addVertex(Vector3(1, 0, 0))
+      .addVertex(Vector3(0, 1, 0))
+      .addVertex(Vector3(0, 0, 1))
+      .addFace({1, 0, 2})
+      .addFace({1, 3, 0})
+      .addFace({0, 3, 2})
+      .addFace({1, 2, 3})
+      .build();
+  ASSERT_EQ(arena->bytesReserved(), 4096);
+
+  // Grow the outgoing edge list of vertex 0 by a fan of faces, one commit per face.
+  unsigned int prev = 1;
+  for (unsigned int i = 0; i < 1000; ++i) {
+    auto editor = mesh->edit();
+    unsigned int vid = editor.addVertex(Vector3(cos(i * 0.01), sin(i * 0.01), -1));
+    editor.addFace({0, vid, prev}).commit();
+    prev = vid;
+  }
+  EXPECT_EQ(mesh->v(0).edges.size(), 1003);
+  for (unsigned int round = 0; round < 10; ++round) {
+    mesh->reorder(round % 2 == 0 ? SpaceFillingCurve::MORTON : SpaceFillingCurve::HILBERT);
+  }
+  EXPECT_EQ(arena->bytesReserved(), 4096);
+}
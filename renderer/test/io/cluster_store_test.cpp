@@ -0,0 +1,275 @@
+#include "io/cluster_store.h"
+#include "geometry/kd_tree.h"
+#include "geometry/mesh_cluster.h"
+#include "geometry/ray3.h"
+#include "geometry/triangular_mesh.h"
+#include "geometry/triangle3.h"
+#include "geometry/bounding_box3.h"
+#include "math/vector3.h"
+#include "const.h"
+#include "../geometry/grid_mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+class ClusterStoreTest : public ::testing::Test {
+  protected:
+    string path;
+    // A wavy 32x32 grid of 2048 faces with Phong interpolated normals.
+    unique_ptr<TriangularMesh> grid;
+    vector<MeshCluster> clusters;
+
+    virtual void SetUp() {
+      path = ::testing::TempDir() + "hd_cluster_store_test.hdc";
+      grid = buildGridMesh(32,
+          [](unsigned int x, unsigned int y) { return sin(x * 0.3) * cos(y * 0.2); },
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::PHONG);
+      clusters = MeshCluster::partition(*grid, 64, 64);
+      ASSERT_TRUE(ClusterStore::write(*grid, clusters, path));
+    }
+
+    virtual void TearDown() {
+      remove(path.c_str());
+    }
+};
+
+TEST_F(ClusterStoreTest, TestPagesMatchMesh) {
+  auto store = ClusterStore::open(path, 1 << 30);
+  ASSERT_NE(store, nullptr);
+  EXPECT_EQ(store->clusterNum(), clusters.size());
+  EXPECT_EQ(store->faceNum(), grid->faceNum());
+  EXPECT_EQ(store->boundingBox3(), grid->boundingBox3());
+  EXPECT_EQ(store->stats().pageIns, 0);
+
+  Vector3 params(0.2, 0.3, 0.5);
+  for (unsigned int cid = 0; cid < store->clusterNum(); ++cid) {
+    EXPECT_EQ(store->bounds(cid).boundingBox, clusters[cid].boundingBox);
+    EXPECT_EQ(store->bounds(cid).coneAxis, clusters[cid].coneAxis);
+    EXPECT_FALSE(store->isResident(cid));
+    auto page = store->page(cid);
+    ASSERT_NE(page, nullptr);
+    EXPECT_TRUE(store->isResident(cid));
+    ASSERT_EQ(page->faceNum(), clusters[cid].faces.size());
+    for (unsigned int i = 0; i < page->faceNum(); ++i) {
+      unsigned int fid = page->faceIds[i];
+      EXPECT_EQ(fid, clusters[cid].faces[i]);
+      EXPECT_EQ(page->triangle(i), grid->triangle(fid));
+      EXPECT_EQ(page->normal(i, params), grid->normal(TriangularMesh::MeshPoint(fid, params)));
+    }
+  }
+  auto stats = store->stats();
+  EXPECT_EQ(stats.pageIns, clusters.size());
+  EXPECT_EQ(stats.residentPages, clusters.size());
+  EXPECT_EQ(stats.evictions, 0);
+  EXPECT_EQ(stats.bytesResident, stats.bytesPagedIn);
+
+  store->page(0);
+  EXPECT_EQ(store->stats().hits, 1);
+  EXPECT_EQ(store->stats().pageIns, clusters.size());
+}
+
+TEST_F(ClusterStoreTest, TestLruEvictionWithinBudget) {
+  auto store = ClusterStore::open(path, 0);
+  ASSERT_NE(store, nullptr);
+  auto first = store->page(0);
+  std::size_t pageBytes = first->memoryBytes();
+  // A budget of zero keeps only the most recently used page resident.
+  store->page(1);
+  EXPECT_FALSE(store->isResident(0));
+  EXPECT_TRUE(store->isResident(1));
+  EXPECT_EQ(store->stats().evictions, 1);
+  // Evicted pages stay valid for their holders.
+  EXPECT_EQ(first->triangle(0), grid->triangle(first->faceIds[0]));
+
+  // Room for about three pages: the least recently used one goes first.
+  store->setMemoryBudget(pageBytes * 3 + pageBytes / 2);
+  store->page(2);
+  store->page(3);
+  store->page(1);
+  store->page(4);
+  EXPECT_TRUE(store->isResident(1));
+  EXPECT_FALSE(store->isResident(2));
+  EXPECT_TRUE(store->isResident(3));
+  EXPECT_TRUE(store->isResident(4));
+  auto stats = store->stats();
+  EXPECT_LE(stats.bytesResident, store->memoryBudget());
+  EXPECT_EQ(stats.pageIns, 5);
+  EXPECT_EQ(stats.hits, 1);
+
+  store->setMemoryBudget(0);
+  EXPECT_EQ(store->stats().residentPages, 1);
+}
+
+TEST_F(ClusterStoreTest, TestOnlyReachedClustersArePagedIn) {
+  auto store = ClusterStore::open(path, 1 << 30);
+  ASSERT_NE(store, nullptr);
+  // Visit clusters overlapping a small region near the origin only, culling by bounds.
+  Vector3 regionMin(0, 0, -2);
+  Vector3 regionMax(4, 4, 2);
+  unsigned int visited = 0;
+  for (unsigned int cid = 0; cid < store->clusterNum(); ++cid) {
+    BoundingBox3 box = store->bounds(cid).boundingBox;
+    bool overlaps = true;
+    for (int i = 0; i < 3; ++i) {
+      overlaps = overlaps && box.minCorner()[i] <= regionMax[i]
+          && box.maxCorner()[i] >= regionMin[i];
+    }
+    if (overlaps) {
+      ASSERT_NE(store->page(cid), nullptr);
+      ++visited;
+    }
+  }
+  EXPECT_GT(visited, 0);
+  EXPECT_LT(visited, store->clusterNum() / 4);
+  EXPECT_EQ(store->stats().pageIns, visited);
+}
+
+TEST_F(ClusterStoreTest, TestOutOfCoreMesh) {
+  // A budget of an eighth of the pages of the whole mesh.
+  size_t totalBytes = 0;
+  {
+    auto store = ClusterStore::open(path, 1 << 30);
+    ASSERT_NE(store, nullptr);
+    for (unsigned int cid = 0; cid < store->clusterNum(); ++cid) {
+      totalBytes += store->page(cid)->memoryBytes();
+    }
+  }
+  shared_ptr<ClusterStore> store(ClusterStore::open(path, totalBytes / 8));
+  ASSERT_NE(store, nullptr);
+  auto mesh = TriangularMesh::outOfCore(store);
+  EXPECT_TRUE(mesh->isOutOfCore());
+  EXPECT_TRUE(mesh->isPopulated());
+  EXPECT_EQ(mesh->faceNum(), grid->faceNum());
+  EXPECT_EQ(mesh->boundingBox3(), grid->boundingBox3());
+  EXPECT_EQ(mesh->faceNormalMode(), TriangularMesh::FaceNormalMode::PHONG);
+  auto tree = KdTree::build(*mesh);
+  auto inCoreTree = KdTree::build(*grid);
+  EXPECT_EQ(tree->entityNum(), grid->faceNum());
+  EXPECT_EQ(tree->memoryUsage().positions, 0);
+  EXPECT_EQ(store->stats().pageIns, 0);
+
+  // Faces of the store, numbered cluster by cluster, map back to those of the original mesh.
+  auto originalFace = [&](unsigned int fid) {
+    unsigned int cid, localFace;
+    store->locate(fid, cid, localFace);
+    return store->page(cid)->faceIds[localFace];
+  };
+  unsigned int hitNum = 0;
+  for (unsigned int y = 0; y < 24; ++y) {
+    for (unsigned int x = 0; x < 24; ++x) {
+      Ray3 ray(Vector3(x * 1.4 - 1.0, y * 1.3, 6.0), Vector3(0.3, 0.2, -1.0));
+      RayHit expected, actual;
+      bool isHit = inCoreTree->intersect(ray, 0.0, HD_INFINITY, expected);
+      ASSERT_EQ(tree->intersect(ray, 0.0, HD_INFINITY, actual), isHit);
+      EXPECT_EQ(tree->occluded(ray, 0.0, HD_INFINITY), isHit);
+      if (!isHit) {
+        continue;
+      }
+      ++hitNum;
+      EXPECT_EQ(actual.t, expected.t);
+      EXPECT_EQ(actual.u, expected.u);
+      EXPECT_EQ(actual.v, expected.v);
+      EXPECT_EQ(originalFace(actual.entityId), expected.entityId);
+      EXPECT_EQ(tree->entity(actual.entityId), grid->triangle(expected.entityId));
+      Vector3 params(1.0 - actual.u - actual.v, actual.u, actual.v);
+      EXPECT_EQ(mesh->normal(TriangularMesh::MeshPoint(actual.entityId, params)),
+          grid->normal(TriangularMesh::MeshPoint(expected.entityId, params)));
+      EXPECT_EQ(mesh->pos(TriangularMesh::MeshPoint(actual.entityId, params)),
+          grid->pos(TriangularMesh::MeshPoint(expected.entityId, params)));
+    }
+  }
+  EXPECT_GT(hitNum, 300);
+  // Rays reached the whole mesh, which never was resident at once.
+  auto stats = store->stats();
+  EXPECT_GT(stats.evictions, 0);
+  EXPECT_LT(stats.bytesResident, totalBytes / 4);
+
+  BoundingBox3 range(Vector3(3.0, 5.0, -2.0), Vector3(9.0, 8.0, 2.0));
+  vector<unsigned int> expectedIds, actualIds;
+  inCoreTree->query(range, expectedIds);
+  tree->query(range, actualIds);
+  for (auto& id : actualIds) {
+    id = originalFace(id);
+  }
+  sort(expectedIds.begin(), expectedIds.end());
+  sort(actualIds.begin(), actualIds.end());
+  EXPECT_EQ(actualIds, expectedIds);
+  EXPECT_FALSE(expectedIds.empty());
+}
+
+TEST_F(ClusterStoreTest, TestOutOfCoreTraversalPagesReachedClustersOnly) {
+  shared_ptr<ClusterStore> store(ClusterStore::open(path, 1 << 30));
+  ASSERT_NE(store, nullptr);
+  auto mesh = TriangularMesh::outOfCore(store);
+  auto tree = KdTree::build(*mesh);
+  // Rays straight down onto a small region near the origin.
+  for (unsigned int y = 0; y < 8; ++y) {
+    for (unsigned int x = 0; x < 8; ++x) {
+      RayHit hit;
+      EXPECT_TRUE(tree->intersect(Ray3(Vector3(x * 0.5 + 0.1, y * 0.5 + 0.1, 6.0),
+          Vector3(0.0, 0.0, -1.0)), 0.0, HD_INFINITY, hit));
+    }
+  }
+  EXPECT_GT(store->stats().pageIns, 0);
+  EXPECT_LT(store->stats().pageIns, store->clusterNum() / 4);
+}
+
+TEST_F(ClusterStoreTest, TestConcurrentAccess) {
+  auto store = ClusterStore::open(path, 0);
+  ASSERT_NE(store, nullptr);
+  vector<thread> threads;
+  for (unsigned int t = 0; t < 4; ++t) {
+    threads.push_back(thread([&]() {
+      for (unsigned int round = 0; round < 3; ++round) {
+        for (unsigned int cid = 0; cid < store->clusterNum(); ++cid) {
+          auto page = store->page(cid);
+          ASSERT_NE(page, nullptr);
+          EXPECT_EQ(page->faceIds[0], clusters[cid].faces[0]);
+        }
+      }
+    }));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(store->stats().residentPages, 1);
+
+  // With every page fitting in memory, each one is paged in once however the threads race, and
+  // all other accesses count as hits.
+  store = ClusterStore::open(path, 1 << 30);
+  ASSERT_NE(store, nullptr);
+  threads.clear();
+  for (unsigned int t = 0; t < 4; ++t) {
+    threads.push_back(thread([&]() {
+      for (unsigned int cid = 0; cid < store->clusterNum(); ++cid) {
+        ASSERT_NE(store->page(cid), nullptr);
+      }
+    }));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  auto stats = store->stats();
+  EXPECT_EQ(stats.pageIns, store->clusterNum());
+  EXPECT_EQ(stats.pageIns + stats.hits, 4 * store->clusterNum());
+}
+
+TEST_F(ClusterStoreTest, TestRejectsInvalidFiles) {
+  EXPECT_EQ(ClusterStore::open(path + ".missing", 0), nullptr);
+  {
+    fstream file(path, ios::in | ios::out | ios::binary);
+    file.seekp(0);
+    file.write("XXXX", 4);
+  }
+  EXPECT_EQ(ClusterStore::open(path, 0), nullptr);
+}
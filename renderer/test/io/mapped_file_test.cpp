@@ -0,0 +1,24 @@
+#include "io/mapped_file.h"
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <gtest/gtest.h>
+
+TEST(MappedFileTest, TestMapAndClose) {
+  std::string path = ::testing::TempDir() + "hd_mapped_file_test.bin";
+  {
+    std::ofstream out(path, std::ios::out | std::ios::binary);
+    out << "HyperDoom";
+  }
+  hd::MappedFile file;
+  EXPECT_FALSE(file.isOpen());
+  ASSERT_TRUE(file.open(path));
+  EXPECT_TRUE(file.isOpen());
+  EXPECT_EQ(file.size(), 9);
+  EXPECT_EQ(std::memcmp(file.data(), "HyperDoom", 9), 0);
+  file.close();
+  EXPECT_FALSE(file.isOpen());
+  EXPECT_EQ(file.size(), 0);
+  EXPECT_FALSE(file.open(path + ".missing"));
+  std::remove(path.c_str());
+}
@@ -0,0 +1,171 @@
+#include "io/mesh_serializer.h"
+#include "geometry/triangular_mesh.h"
+#include "geometry/bounding_box3.h"
+#include "math/vector3.h"
+#include "const.h"
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+class MeshSerializerTest : public ::testing::Test {
+  protected:
+    string path;
+    // A tetrahedron with averaged vertex normals and Phong interpolated face normals.
+    unique_ptr<TriangularMesh> tetra;
+    // A single-triangle plane with user specified vertex and face normals. All of its
+    // half-edges are on the boundary.
+    unique_ptr<TriangularMesh> plane;
+
+    virtual void SetUp() {
+      path = ::testing::TempDir() + "hd_mesh_serializer_test.hdm";
+      tetra = TriangularMesh::newBuilder(
+              TriangularMesh::VertexNormalMode::AVERAGED,
+              TriangularMesh::FaceNormalMode::PHONG)
+          .addVertex(Vector3(0, 0, 0))
+          .addVertex(Vector3(1, 0, 0))
+          .addVertex(Vector3(0, 1, 0))
+          .addVertex(Vector3(0, 0, 1))
+          .addFace({1, 0, 2})
+          .addFace({1, 3, 0})
+          .addFace({0, 3, 2})
+          .addFace({1, 2, 3})
+          .build();
+      plane = TriangularMesh::newBuilder(
+              TriangularMesh::VertexNormalMode::USER_SPECIFIED,
+              TriangularMesh::FaceNormalMode::USER_SPECIFIED)
+          .addVertex(Vector3(0, 0, 0), Vector3(0, 0, 1))
+          .addVertex(Vector3(1, 0, 0), Vector3(0, 0, 1))
+          .addVertex(Vector3(0, 1, 0), Vector3(0, 0, 1))
+          .addFace({0, 1, 2}, Vector3(0, 0, 1))
+          .build();
+    }
+
+    virtual void TearDown() {
+      remove(path.c_str());
+    }
+
+    // Verify that two meshes hold exactly the same populated data.
+    void expectSameMesh(const TriangularMesh& expected, const TriangularMesh& actual) {
+      EXPECT_TRUE(actual.isPopulated());
+      EXPECT_EQ(actual.vertexNormalMode(), expected.vertexNormalMode());
+      EXPECT_EQ(actual.faceNormalMode(), expected.faceNormalMode());
+      EXPECT_EQ(actual.boundingBox3(), expected.boundingBox3());
+      ASSERT_EQ(actual.vertexNum(), expected.vertexNum());
+      ASSERT_EQ(actual.edgeNum(), expected.edgeNum());
+      ASSERT_EQ(actual.faceNum(), expected.faceNum());
+      for (unsigned int vid = 0; vid < expected.vertexNum(); ++vid) {
+        EXPECT_EQ(actual.v(vid).pos, expected.v(vid).pos);
+        EXPECT_EQ(actual.v(vid).normal, expected.v(vid).normal);
+        EXPECT_EQ(actual.v(vid).edges, expected.v(vid).edges);
+      }
+      for (unsigned int eid = 0; eid < expected.edgeNum(); ++eid) {
+        EXPECT_EQ(actual.e(eid).startVertex, expected.e(eid).startVertex);
+        EXPECT_EQ(actual.e(eid).endVertex, expected.e(eid).endVertex);
+        EXPECT_EQ(actual.e(eid).face, expected.e(eid).face);
+        EXPECT_EQ(actual.e(eid).twinEdge, expected.e(eid).twinEdge);
+        EXPECT_EQ(actual.e(eid).nextEdge, expected.e(eid).nextEdge);
+        EXPECT_EQ(actual.e(eid).prevEdge, expected.e(eid).prevEdge);
+      }
+      for (unsigned int fid = 0; fid < expected.faceNum(); ++fid) {
+        EXPECT_EQ(actual.f(fid).vertices, expected.f(fid).vertices);
+        EXPECT_EQ(actual.f(fid).edges, expected.f(fid).edges);
+        EXPECT_EQ(actual.f(fid).normal, expected.f(fid).normal);
+      }
+    }
+};
+
+TEST_F(MeshSerializerTest, TestRoundTrip) {
+  ASSERT_TRUE(MeshSerializer::write(*tetra, path));
+  auto loaded = MeshSerializer::read(path);
+  ASSERT_NE(loaded, nullptr);
+  expectSameMesh(*tetra, *loaded);
+  TriangularMesh::MeshPoint p = TriangularMesh::MeshPoint(0, Vector3(0.6, 0.3, 0.1));
+  EXPECT_EQ(loaded->normal(p), tetra->normal(p));
+
+  ASSERT_TRUE(MeshSerializer::write(*plane, path, false /* withChecksum */));
+  loaded = MeshSerializer::read(path);
+  ASSERT_NE(loaded, nullptr);
+  expectSameMesh(*plane, *loaded);
+  EXPECT_EQ(loaded->e(0).twinEdge, HD_INVALID_ID);
+
+  // Compressed meshes have no half-edges to write.
+  tetra->compress();
+  EXPECT_FALSE(MeshSerializer::write(*tetra, path));
+}
+
+TEST_F(MeshSerializerTest, TestRejectCorruptedFiles) {
+  ASSERT_TRUE(MeshSerializer::write(*tetra, path));
+  // Flip a byte within the payload: the checksum must catch it.
+  {
+    fstream file(path, ios::in | ios::out | ios::binary);
+    file.seekp(-1, ios::end);
+    file.put('\x7f');
+  }
+  EXPECT_EQ(MeshSerializer::read(path), nullptr);
+  EXPECT_NE(MeshSerializer::read(path, false /* verifyChecksum */), nullptr);
+
+  // Swap the endianness tag, as if the file was written on a big-endian machine.
+  ASSERT_TRUE(MeshSerializer::write(*tetra, path));
+  {
+    fstream file(path, ios::in | ios::out | ios::binary);
+    file.seekp(12);
+    uint32_t swappedTag = 0x04030201;
+    file.write(reinterpret_cast<const char*>(&swappedTag), sizeof(swappedTag));
+  }
+  EXPECT_EQ(MeshSerializer::read(path), nullptr);
+
+  // Truncated file.
+  ASSERT_TRUE(MeshSerializer::write(*tetra, path));
+  {
+    ifstream in(path, ios::in | ios::binary);
+    string content((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    ofstream out(path, ios::out | ios::binary | ios::trunc);
+    out.write(content.data(), content.size() - 8);
+  }
+  EXPECT_EQ(MeshSerializer::read(path), nullptr);
+  EXPECT_EQ(MeshSerializer::read(path + ".missing"), nullptr);
+}
+
+TEST_F(MeshSerializerTest, TestRejectIndicesOutOfRange) {
+  // Overwrite a 32-bit value at the given offset from the end of the file, and read it back
+  // without checksum verification, as if the checksum matched the corrupted payload.
+  auto readCorrupted = [this](long offsetFromEnd, uint32_t value) {
+    EXPECT_TRUE(MeshSerializer::write(*tetra, path));
+    {
+      fstream file(path, ios::in | ios::out | ios::binary);
+      file.seekp(-offsetFromEnd, ios::end);
+      file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    return MeshSerializer::read(path, false /* verifyChecksum */);
+  };
+  // Faces are the last section, 48 bytes each, preceded by edges, 24 bytes each.
+  const long faceSectionSize = 4 * 48;
+  const long edgeSectionSize = 12 * 24;
+  EXPECT_NE(readCorrupted(faceSectionSize, 3), nullptr);
+  // First vertex of the first face.
+  EXPECT_EQ(readCorrupted(faceSectionSize, 4), nullptr);
+  // First edge of the first face.
+  EXPECT_EQ(readCorrupted(faceSectionSize - 12, 12), nullptr);
+  // Next edge of the first edge.
+  EXPECT_EQ(readCorrupted(faceSectionSize + edgeSectionSize - 16, 12), nullptr);
+  // Twin edge of the first edge: only HD_INVALID_ID may be out of range.
+  EXPECT_EQ(readCorrupted(faceSectionSize + edgeSectionSize - 12, 12), nullptr);
+  EXPECT_NE(readCorrupted(faceSectionSize + edgeSectionSize - 12, HD_INVALID_ID), nullptr);
+  // Last entry of the adjacency section, padded to 8 bytes.
+  EXPECT_EQ(readCorrupted(faceSectionSize + edgeSectionSize + 4, 12), nullptr);
+
+  // Element counts large enough for section sizes to overflow.
+  ASSERT_TRUE(MeshSerializer::write(*tetra, path));
+  {
+    fstream file(path, ios::in | ios::out | ios::binary);
+    file.seekp(32);
+    uint64_t vertexNum = 1ULL << 61;
+    file.write(reinterpret_cast<const char*>(&vertexNum), sizeof(vertexNum));
+  }
+  EXPECT_EQ(MeshSerializer::read(path, false /* verifyChecksum */), nullptr);
+}
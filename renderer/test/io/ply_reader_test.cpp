@@ -0,0 +1,189 @@
+#include "io/ply_reader.h"
+#include "geometry/triangular_mesh.h"
+#include "geometry/bounding_box3.h"
+#include "math/vector3.h"
+#include "const.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+class PlyReaderTest : public ::testing::Test {
+  protected:
+    string path;
+
+    virtual void SetUp() {
+      path = ::testing::TempDir() + "hd_ply_reader_test.ply";
+    }
+
+    virtual void TearDown() {
+      remove(path.c_str());
+    }
+
+  protected:
+    // Append the raw bytes of a value, in the byte order requested.
+    template <typename T>
+    static void put(string& body, T value, bool bigEndian = false) {
+      char bytes[sizeof(T)];
+      memcpy(bytes, &value, sizeof(T));
+      if (bigEndian) {
+        reverse(bytes, bytes + sizeof(T));
+      }
+      body.append(bytes, sizeof(T));
+    }
+
+    void writeFile(const string& header, const string& body) {
+      ofstream out(path, ios::out | ios::binary);
+      out << header;
+      out.write(body.data(), body.size());
+    }
+};
+
+TEST_F(PlyReaderTest, TestReadTetrahedronWithoutNormals) {
+  string header =
+      "ply\n"
+      "format binary_little_endian 1.0\n"
+      "comment tetrahedron with an extra color property\n"
+      "element vertex 4\n"
+      "property float x\n"
+      "property float y\n"
+      "property float z\n"
+      "property uchar red\n"
+      "element face 4\n"
+      "property list uchar int vertex_indices\n"
+      "end_header\n";
+  string body;
+  float vertices[4][3] = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+  for (auto& v : vertices) {
+    put<float>(body, v[0]);
+    put<float>(body, v[1]);
+    put<float>(body, v[2]);
+    put<uint8_t>(body, 255);
+  }
+  int faces[4][3] = {{1, 0, 2}, {1, 3, 0}, {0, 3, 2}, {1, 2, 3}};
+  for (auto& f : faces) {
+    put<uint8_t>(body, 3);
+    put<int32_t>(body, f[0]);
+    put<int32_t>(body, f[1]);
+    put<int32_t>(body, f[2]);
+  }
+  writeFile(header, body);
+
+  auto mesh = PlyReader::read(path, TriangularMesh::FaceNormalMode::FLAT);
+  ASSERT_NE(mesh, nullptr);
+  EXPECT_TRUE(mesh->isPopulated());
+  EXPECT_EQ(mesh->vertexNormalMode(), TriangularMesh::VertexNormalMode::AVERAGED);
+  EXPECT_EQ(mesh->vertexNum(), 4);
+  EXPECT_EQ(mesh->faceNum(), 4);
+  EXPECT_EQ(mesh->edgeNum(), 12);
+  EXPECT_EQ(mesh->v(3).pos, Vector3(0, 0, 1));
+  EXPECT_EQ(mesh->boundingBox3(), BoundingBox3(Vector3(0, 0, 0), Vector3(1, 1, 1)));
+  EXPECT_EQ(mesh->f(3).normal, Vector3::one().normalize());
+}
+
+TEST_F(PlyReaderTest, TestReadBigEndianQuadsWithNormals) {
+  // A unit square made of one quad, stored as doubles in big-endian order.
+  string header =
+      "ply\n"
+      "format binary_big_endian 1.0\n"
+      "element vertex 4\n"
+      "property double x\n"
+      "property double y\n"
+      "property double z\n"
+      "property float nx\n"
+      "property float ny\n"
+      "property float nz\n"
+      "element face 1\n"
+      "property list uchar uint vertex_indices\n"
+      "element material 1\n"
+      "property list ushort uchar name\n"
+      "end_header\n";
+  string body;
+  double vertices[4][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}};
+  for (auto& v : vertices) {
+    put<double>(body, v[0], true);
+    put<double>(body, v[1], true);
+    put<double>(body, v[2], true);
+    put<float>(body, 0.0f, true);
+    put<float>(body, 0.0f, true);
+    put<float>(body, 1.0f, true);
+  }
+  put<uint8_t>(body, 4);
+  for (uint32_t vid = 0; vid < 4; ++vid) {
+    put<uint32_t>(body, vid, true);
+  }
+  put<uint16_t>(body, 2, true);
+  body.append("ab");
+  writeFile(header, body);
+
+  auto mesh = PlyReader::read(path);
+  ASSERT_NE(mesh, nullptr);
+  EXPECT_EQ(mesh->vertexNormalMode(), TriangularMesh::VertexNormalMode::USER_SPECIFIED);
+  EXPECT_EQ(mesh->faceNormalMode(), TriangularMesh::FaceNormalMode::PHONG);
+  EXPECT_EQ(mesh->vertexNum(), 4);
+  // The quad is triangulated as a fan.
+  EXPECT_EQ(mesh->faceNum(), 2);
+  EXPECT_EQ(mesh->v(2).pos, Vector3(1, 1, 0));
+  EXPECT_EQ(mesh->v(2).normal, Vector3::zUnit());
+  EXPECT_EQ(mesh->triangle(1).v(2), Vector3(0, 1, 0));
+  EXPECT_EQ(mesh->normal(TriangularMesh::MeshPoint(1, Vector3::one() / 3.0)), Vector3::zUnit());
+}
+
+TEST_F(PlyReaderTest, TestRejectMalformedFiles) {
+  EXPECT_EQ(PlyReader::read(path + ".missing"), nullptr);
+
+  string asciiHeader =
+      "ply\n"
+      "format ascii 1.0\n"
+      "element vertex 0\n"
+      "property float x\n"
+      "end_header\n";
+  writeFile(asciiHeader, "");
+  EXPECT_EQ(PlyReader::read(path), nullptr);
+
+  // Face referring to a vertex that does not exist.
+  string header =
+      "ply\n"
+      "format binary_little_endian 1.0\n"
+      "element vertex 3\n"
+      "property float x\n"
+      "property float y\n"
+      "property float z\n"
+      "element face 1\n"
+      "property list uchar int vertex_indices\n"
+      "end_header\n";
+  string body;
+  for (int i = 0; i < 9; ++i) {
+    put<float>(body, static_cast<float>(i));
+  }
+  put<uint8_t>(body, 3);
+  put<int32_t>(body, 0);
+  put<int32_t>(body, 1);
+  put<int32_t>(body, 3);
+  writeFile(header, body);
+  EXPECT_EQ(PlyReader::read(path), nullptr);
+
+  // Truncated body.
+  writeFile(header, body.substr(0, 20));
+  EXPECT_EQ(PlyReader::read(path), nullptr);
+
+  // Element counts far beyond what the file holds.
+  string hugeHeader =
+      "ply\n"
+      "format binary_little_endian 1.0\n"
+      "element vertex 4000000000000000000\n"
+      "property float x\n"
+      "property float y\n"
+      "property float z\n"
+      "element face 4000000000000000000\n"
+      "property list uchar int vertex_indices\n"
+      "end_header\n";
+  writeFile(hugeHeader, body);
+  EXPECT_EQ(PlyReader::read(path), nullptr);
+}
@@ -0,0 +1,180 @@
+#include "io/socket.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+using namespace hd;
+
+namespace {
+  // Send a message from a client thread and echo it back from the server.
+  void testRoundTrip(const std::string& listenAddress) {
+    ServerSocket server;
+    ASSERT_TRUE(server.listen(listenAddress));
+    std::string address = server.address();
+    Message echoed;
+    bool isEchoed = false;
+    std::thread client([&]() {
+      Socket socket = Socket::connect(address);
+      Message message(7);
+      message.put<uint32_t>(42);
+      message.put(2.5);
+      message.putString("HyperDoom");
+      isEchoed = socket.isOpen() && socket.send(message) && socket.receive(echoed);
+    });
+    Socket socket = server.accept();
+    ASSERT_TRUE(socket.isOpen());
+    Message message;
+    ASSERT_TRUE(socket.receive(message));
+    EXPECT_TRUE(socket.send(message));
+    client.join();
+    ASSERT_TRUE(isEchoed);
+
+    EXPECT_EQ(echoed.type, 7);
+    uint32_t u;
+    double d;
+    std::string s;
+    ASSERT_TRUE(echoed.get(u));
+    ASSERT_TRUE(echoed.get(d));
+    ASSERT_TRUE(echoed.getString(s));
+    EXPECT_EQ(u, 42);
+    EXPECT_EQ(d, 2.5);
+    EXPECT_EQ(s, "HyperDoom");
+    EXPECT_TRUE(echoed.isFullyRead());
+    EXPECT_FALSE(echoed.get(u));
+  }
+}
+
+TEST(SocketTest, TestUnixRoundTrip) {
+  std::string path = ::testing::TempDir() + "hd_socket_test.sock";
+  testRoundTrip("unix:" + path);
+  // The socket file is removed with the server.
+  EXPECT_EQ(std::fopen(path.c_str(), "r"), nullptr);
+}
+
+TEST(SocketTest, TestUnixPathInUse) {
+  std::string path = ::testing::TempDir() + "hd_socket_test_in_use.sock";
+  std::remove(path.c_str());
+
+  // Regular files are never replaced.
+  {
+    std::ofstream file(path);
+    file << "precious";
+  }
+  ServerSocket server;
+  EXPECT_FALSE(server.listen("unix:" + path));
+  std::string content;
+  std::ifstream(path) >> content;
+  EXPECT_EQ(content, "precious");
+  std::remove(path.c_str());
+
+  // Neither is the socket of a running server.
+  ASSERT_TRUE(server.listen("unix:" + path));
+  ServerSocket other;
+  EXPECT_FALSE(other.listen("unix:" + path));
+  EXPECT_TRUE(Socket::connect(server.address()).isOpen());
+  server.close();
+
+  // A socket left behind by a process that is gone is reclaimed.
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_GE(fd, 0);
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  ASSERT_EQ(::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), 0);
+  ::close(fd);
+  EXPECT_TRUE(other.listen("unix:" + path));
+}
+
+TEST(SocketTest, TestTcpRoundTrip) {
+  testRoundTrip("tcp:127.0.0.1:0");
+}
+
+TEST(SocketTest, TestFailures) {
+  ServerSocket server;
+  EXPECT_FALSE(server.listen("nowhere"));
+  EXPECT_FALSE(server.listen("tcp:127.0.0.1:notaport"));
+  EXPECT_FALSE(Socket::connect("unix:" + ::testing::TempDir() + "hd_missing.sock").isOpen());
+  Socket socket;
+  EXPECT_FALSE(socket.send(Message(1)));
+
+  // Receiving fails once the peer is gone, and after the timeout while it is silent.
+  ASSERT_TRUE(server.listen("tcp:127.0.0.1:0"));
+  Socket client = Socket::connect(server.address());
+  ASSERT_TRUE(client.isOpen());
+  Socket peer = server.accept();
+  ASSERT_TRUE(peer.isOpen());
+  ASSERT_TRUE(client.setReceiveTimeout(0.05));
+  Message message;
+  EXPECT_FALSE(client.receive(message));
+  peer.close();
+  EXPECT_FALSE(client.receive(message));
+}
+
+TEST(SocketTest, TestTimeoutCoversWholeMessage) {
+  ServerSocket server;
+  ASSERT_TRUE(server.listen("tcp:127.0.0.1:0"));
+  Socket client = Socket::connect(server.address());
+  ASSERT_TRUE(client.isOpen());
+  Socket peer = server.accept();
+  ASSERT_TRUE(peer.isOpen());
+  ASSERT_TRUE(peer.setReceiveTimeout(0.2));
+
+  // A message header trickled one byte at a time, each well within the timeout.
+  std::thread sender([&]() {
+    char header[16] = {1};
+    for (std::size_t i = 0; i < sizeof(header); ++i) {
+      if (::send(client.fd(), header + i, 1, MSG_NOSIGNAL) != 1) {
+        return;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+  });
+  auto start = std::chrono::steady_clock::now();
+  Message message;
+  EXPECT_FALSE(peer.receive(message));
+  EXPECT_LT(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 0.5);
+  sender.join();
+}
+
+TEST(SocketTest, TestPayloadLimit) {
+  ServerSocket server;
+  ASSERT_TRUE(server.listen("tcp:127.0.0.1:0"));
+  std::string address = server.address();
+  // A message beyond the default limit, sent over two connections.
+  Message large(7);
+  large.payload.assign(100 << 10, 'x');
+  std::thread client([&]() {
+    for (int i = 0; i < 2; ++i) {
+      Socket socket = Socket::connect(address);
+      socket.send(large);
+      Message ack;
+      socket.receive(ack);
+    }
+  });
+  Message message;
+  {
+    Socket socket = server.accept();
+    ASSERT_TRUE(socket.isOpen());
+    EXPECT_FALSE(socket.receive(message));
+  }
+  {
+    Socket socket = server.accept();
+    ASSERT_TRUE(socket.isOpen());
+    // The limit is per message type.
+    EXPECT_TRUE(socket.receive(message, [](uint32_t type) {
+      return type == 7 ? 100 << 10 : 0;
+    }));
+    EXPECT_EQ(message.payload, large.payload);
+    EXPECT_TRUE(socket.send(Message(8)));
+  }
+  client.join();
+}
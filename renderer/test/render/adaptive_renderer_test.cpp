@@ -0,0 +1,287 @@
+#include "render/adaptive_renderer.h"
+#include "render/checkpoint.h"
+#include "geometry/kd_tree.h"
+#include "geometry/triangular_mesh.h"
+#include "render/camera.h"
+#include "render/integrator.h"
+#include "math/vector3.h"
+#include "const.h"
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <thread>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+namespace {
+  // Pixels on the left half of the image are flat gray. Those on the right half are noisy,
+  // more so further to the right, so that they need different numbers of samples.
+  class NoisyIntegrator : public Integrator {
+    public:
+      // Wall time each call to render() takes at least, to test time budgets.
+      chrono::milliseconds delay;
+
+    public:
+      NoisyIntegrator(const TriangularMesh& mesh, const KdTree& tree, const Camera& camera,
+          unsigned int seed) : Integrator(mesh, tree, camera, seed), delay(0) {}
+
+      void render(const SampleRequest* requests, size_t count,
+          Vector3* radiance) const override {
+        this_thread::sleep_for(delay);
+        unsigned int width = _camera.width();
+        for (size_t i = 0; i < count; ++i) {
+          double noise = 0.0;
+          if (requests[i].x >= width / 2) {
+            double amplitude = (requests[i].x - width / 2 + 1.0) / width;
+            noise = amplitude * (2.0 * _random(requests[i], 2) - 1.0);
+          }
+          radiance[i] = Vector3::identity(0.5 + noise);
+        }
+      }
+  };
+}
+
+class AdaptiveRendererTest : public ::testing::Test {
+  protected:
+    unique_ptr<TriangularMesh> mesh;
+    unique_ptr<KdTree> tree;
+    unique_ptr<Camera> camera;
+
+    virtual void SetUp() {
+      auto builder = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::FLAT);
+      builder.addVertex(Vector3(0.0, 0.0, 0.0));
+      builder.addVertex(Vector3(1.0, 0.0, 0.0));
+      builder.addVertex(Vector3(0.0, 1.0, 0.0));
+      builder.addFace({0, 1, 2});
+      mesh = builder.build();
+      tree = KdTree::build(*mesh);
+      camera.reset(new Camera(Vector3(0.0, 0.0, 5.0), Vector3::zero(), Vector3::yUnit(), 45.0,
+          24, 10));
+    }
+
+    virtual void TearDown() {}
+};
+
+TEST_F(AdaptiveRendererTest, TestConvergence) {
+  NoisyIntegrator integrator(*mesh, *tree, *camera, 1);
+  AdaptiveRenderer::Options options;
+  options.minSamplesPerPixel = 4;
+  options.samplesPerPass = 4;
+  options.maxSamplesPerPixel = 4096;
+  options.targetError = 0.01;
+  options.tileSize = 4;
+  options.threadNum = 2;
+  AdaptiveRenderer renderer(integrator, options);
+
+  // The first pass takes the minimum number of samples everywhere.
+  EXPECT_TRUE(renderer.renderPass());
+  EXPECT_EQ(renderer.stats().passNum, 1);
+  EXPECT_EQ(renderer.sampleCount(0, 0), 4);
+  EXPECT_EQ(renderer.sampleCount(23, 9), 4);
+  EXPECT_EQ(renderer.stats().sampleNum, 24 * 10 * 4);
+
+  auto image = renderer.render();
+  EXPECT_TRUE(renderer.isDone());
+  EXPECT_FALSE(renderer.stats().outOfTime);
+  EXPECT_FALSE(renderer.renderPass());
+  EXPECT_EQ(renderer.stats().convergedPixelNum, 240);
+  // Flat pixels stop at the minimum. Noisy ones take more samples the noisier they are, which
+  // is compared over whole columns since a single pixel may stop early by chance.
+  unsigned int columnSampleNum[24] = {};
+  for (unsigned int y = 0; y < 10; ++y) {
+    EXPECT_EQ(renderer.sampleCount(0, y), 4);
+    EXPECT_EQ(renderer.sampleCount(11, y), 4);
+    for (unsigned int x = 0; x < 24; ++x) {
+      columnSampleNum[x] += renderer.sampleCount(x, y);
+    }
+    for (unsigned int x = 0; x < 24; ++x) {
+      EXPECT_LE(renderer.relativeError(x, y), options.targetError);
+      // The error estimate that stops a pixel is itself noisy, and a pixel whose first samples
+      // happen to agree stops early. So the result is checked against the true standard error
+      // of the samples taken, i.e. amplitude / sqrt(3 n) for noise uniform in [-amplitude,
+      // amplitude], within 5 standard errors.
+      double amplitude = x >= 12 ? (x - 12 + 1.0) / 24 : 0.0;
+      double standardError = amplitude / sqrt(3.0 * renderer.sampleCount(x, y));
+      EXPECT_NEAR(image->at(x, y).x, 0.5, 5.0 * standardError + HD_EPSILON_TINY);
+    }
+  }
+  EXPECT_GT(columnSampleNum[12], 10 * 4);
+  EXPECT_GT(columnSampleNum[23], 4 * columnSampleNum[13]);
+  unsigned int threadTileNum = 0;
+  for (auto& thread : renderer.stats().scheduling.threads) {
+    threadTileNum += thread.tileNum;
+  }
+  EXPECT_EQ(threadTileNum, renderer.stats().passNum * 18);
+}
+
+TEST_F(AdaptiveRendererTest, TestDeterminism) {
+  NoisyIntegrator integrator(*mesh, *tree, *camera, 2);
+  AdaptiveRenderer::Options options;
+  options.targetError = 0.05;
+  options.threadNum = 1;
+  options.tileSize = 16;
+  AdaptiveRenderer first(integrator, options);
+  auto firstImage = first.render();
+  options.threadNum = 3;
+  options.tileSize = 3;
+  AdaptiveRenderer second(integrator, options);
+  auto secondImage = second.render();
+
+  EXPECT_EQ(first.stats().passNum, second.stats().passNum);
+  EXPECT_EQ(first.stats().sampleNum, second.stats().sampleNum);
+  for (unsigned int y = 0; y < 10; ++y) {
+    for (unsigned int x = 0; x < 24; ++x) {
+      EXPECT_EQ(first.sampleCount(x, y), second.sampleCount(x, y));
+      EXPECT_EQ(firstImage->at(x, y).x, secondImage->at(x, y).x);
+    }
+  }
+
+  // Another seed gives other samples.
+  NoisyIntegrator reseeded(*mesh, *tree, *camera, 3);
+  AdaptiveRenderer third(reseeded, options);
+  auto thirdImage = third.render();
+  EXPECT_NE(firstImage->at(23, 0).x, thirdImage->at(23, 0).x);
+}
+
+TEST_F(AdaptiveRendererTest, TestTimeBudget) {
+  NoisyIntegrator integrator(*mesh, *tree, *camera, 1);
+  integrator.delay = chrono::milliseconds(5);
+  AdaptiveRenderer::Options options;
+  // Never reached.
+  options.targetError = 0.0;
+  options.maxSamplesPerPixel = 1 << 20;
+  options.tileSize = 8;
+  options.threadNum = 2;
+  options.timeBudgetSeconds = 0.1;
+  AdaptiveRenderer renderer(integrator, options);
+  auto image = renderer.render();
+  EXPECT_TRUE(renderer.stats().outOfTime);
+  EXPECT_FALSE(renderer.isDone());
+  EXPECT_GE(renderer.stats().passNum, 1);
+  EXPECT_LT(renderer.stats().wallSeconds, 0.5);
+  EXPECT_NEAR(image->at(0, 0).x, 0.5, 1e-12);
+
+  // The budget covers the passes run before the render was resumed, so that resuming a render
+  // that used it up renders nothing more.
+  auto spent = renderer.checkpoint();
+  spent->wallSeconds = options.timeBudgetSeconds;
+  AdaptiveRenderer resumed(integrator, options);
+  ASSERT_TRUE(resumed.resume(*spent));
+  resumed.render();
+  EXPECT_TRUE(resumed.stats().outOfTime);
+  EXPECT_EQ(resumed.stats().passNum, renderer.stats().passNum);
+  options.timeBudgetSeconds = renderer.stats().wallSeconds + 0.1;
+  AdaptiveRenderer extended(integrator, options);
+  ASSERT_TRUE(extended.resume(*renderer.checkpoint()));
+  extended.render();
+  EXPECT_GT(extended.stats().passNum, renderer.stats().passNum);
+  EXPECT_LT(extended.stats().wallSeconds, options.timeBudgetSeconds + 0.4);
+}
+
+TEST_F(AdaptiveRendererTest, TestResume) {
+  NoisyIntegrator integrator(*mesh, *tree, *camera, 4);
+  AdaptiveRenderer::Options options;
+  options.minSamplesPerPixel = 4;
+  options.samplesPerPass = 4;
+  options.targetError = 0.02;
+  options.threadNum = 2;
+  options.tileSize = 5;
+  AdaptiveRenderer uninterrupted(integrator, options);
+  auto expected = uninterrupted.render();
+
+  // A render stopped after two passes, whose checkpoint is resumed by another renderer.
+  AdaptiveRenderer stopped(integrator, options);
+  stopped.renderPass();
+  stopped.renderPass();
+  string path = ::testing::TempDir() + "hd_adaptive_renderer_test.ckpt";
+  ASSERT_TRUE(stopped.checkpoint()->write(path));
+  auto checkpoint = Checkpoint::read(path);
+  ASSERT_NE(checkpoint, nullptr);
+  EXPECT_EQ(checkpoint->passNum, 2);
+
+  options.threadNum = 3;
+  AdaptiveRenderer resumed(integrator, options);
+  ASSERT_TRUE(resumed.resume(*checkpoint));
+  EXPECT_EQ(resumed.stats().passNum, 2);
+  EXPECT_EQ(resumed.stats().sampleNum, stopped.stats().sampleNum);
+  EXPECT_EQ(resumed.stats().convergedPixelNum, stopped.stats().convergedPixelNum);
+  auto image = resumed.render();
+  EXPECT_EQ(resumed.stats().passNum, uninterrupted.stats().passNum);
+  EXPECT_EQ(resumed.stats().sampleNum, uninterrupted.stats().sampleNum);
+  for (unsigned int y = 0; y < 10; ++y) {
+    for (unsigned int x = 0; x < 24; ++x) {
+      EXPECT_EQ(resumed.sampleCount(x, y), uninterrupted.sampleCount(x, y));
+      EXPECT_EQ(image->at(x, y), expected->at(x, y));
+    }
+  }
+
+  // Checkpoints of renders that would continue differently are refused.
+  options.samplesPerPass = 8;
+  AdaptiveRenderer otherOptions(integrator, options);
+  EXPECT_FALSE(otherOptions.resume(*checkpoint));
+  EXPECT_EQ(otherOptions.stats().passNum, 0);
+  NoisyIntegrator otherSeed(*mesh, *tree, *camera, 5);
+  options.samplesPerPass = 4;
+  AdaptiveRenderer otherSampler(otherSeed, options);
+  EXPECT_FALSE(otherSampler.resume(*checkpoint));
+  options.samplerName = "sobol";
+  EXPECT_FALSE(AdaptiveRenderer(integrator, options).resume(*checkpoint));
+  options.samplerName = "";
+  options.integratorName = "headlight";
+  EXPECT_FALSE(AdaptiveRenderer(integrator, options).resume(*checkpoint));
+  options.integratorName = "";
+  options.filter.radius = 1.0;
+  EXPECT_FALSE(AdaptiveRenderer(integrator, options).resume(*checkpoint));
+  options.filter.radius = 0.5;
+  EXPECT_TRUE(AdaptiveRenderer(integrator, options).resume(*checkpoint));
+
+  // So are those of another camera or mesh.
+  Camera movedCamera(Vector3(0.0, 0.0, 6.0), Vector3::zero(), Vector3::yUnit(), 45.0, 24, 10);
+  NoisyIntegrator otherCamera(*mesh, *tree, movedCamera, 4);
+  EXPECT_FALSE(AdaptiveRenderer(otherCamera, options).resume(*checkpoint));
+  auto builder = TriangularMesh::newBuilder(
+      TriangularMesh::VertexNormalMode::AVERAGED,
+      TriangularMesh::FaceNormalMode::FLAT);
+  builder.addVertex(Vector3(0.0, 0.0, 0.0));
+  builder.addVertex(Vector3(1.0, 0.0, 0.0));
+  builder.addVertex(Vector3(0.0, 2.0, 0.0));
+  builder.addFace({0, 1, 2});
+  auto otherMesh = builder.build();
+  auto otherTree = KdTree::build(*otherMesh);
+  NoisyIntegrator otherScene(*otherMesh, *otherTree, *camera, 4);
+  EXPECT_FALSE(AdaptiveRenderer(otherScene, options).resume(*checkpoint));
+}
+
+TEST_F(AdaptiveRendererTest, TestCheckpointing) {
+  NoisyIntegrator integrator(*mesh, *tree, *camera, 4);
+  AdaptiveRenderer::Options options;
+  options.minSamplesPerPixel = 4;
+  options.samplesPerPass = 4;
+  options.targetError = 0.02;
+  options.checkpointPath = ::testing::TempDir() + "hd_adaptive_renderer_test_periodic.ckpt";
+  options.checkpointIntervalSeconds = 0.0;
+  AdaptiveRenderer renderer(integrator, options);
+  renderer.render();
+  EXPECT_GE(renderer.stats().checkpointNum, 1);
+  EXPECT_EQ(renderer.stats().checkpointFailureNum, 0);
+
+  // The last checkpoint holds the finished render.
+  auto checkpoint = Checkpoint::read(options.checkpointPath);
+  ASSERT_NE(checkpoint, nullptr);
+  EXPECT_EQ(checkpoint->passNum, renderer.stats().passNum);
+  AdaptiveRenderer resumed(integrator, options);
+  ASSERT_TRUE(resumed.resume(*checkpoint));
+  EXPECT_TRUE(resumed.isDone());
+  EXPECT_FALSE(resumed.renderPass());
+  for (unsigned int y = 0; y < 10; ++y) {
+    for (unsigned int x = 0; x < 24; ++x) {
+      EXPECT_EQ(resumed.sampleCount(x, y), renderer.sampleCount(x, y));
+      EXPECT_EQ(resumed.relativeError(x, y), renderer.relativeError(x, y));
+    }
+  }
+}
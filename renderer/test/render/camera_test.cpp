@@ -0,0 +1,46 @@
+#include "render/camera.h"
+#include "geometry/bounding_box3.h"
+#include "math/vector3.h"
+#include "const.h"
+#include <cmath>
+#include <gtest/gtest.h>
+
+using namespace hd;
+
+TEST(CameraTest, TestGenerateRay) {
+  // Looking down the negative z axis with a 90 degree vertical field of view.
+  Camera camera(Vector3(0.0, 0.0, 5.0), Vector3::zero(), Vector3::yUnit(), 90.0, 200, 100);
+  EXPECT_EQ(camera.width(), 200);
+  EXPECT_EQ(camera.height(), 100);
+  EXPECT_EQ(camera.forward(), Vector3(0.0, 0.0, -1.0));
+
+  Ray3 center = camera.generateRay(100.0, 50.0);
+  EXPECT_EQ(center.origin, Vector3(0.0, 0.0, 5.0));
+  EXPECT_EQ(center.direction, Vector3(0.0, 0.0, -1.0));
+
+  // Top-left corner: up by tan(45) = 1 and left by the aspect ratio 2, at unit distance.
+  Ray3 corner = camera.generateRay(0.0, 0.0);
+  EXPECT_EQ(corner.direction, Vector3(-2.0, 1.0, -1.0).normalize());
+  Ray3 bottomRight = camera.generateRay(200.0, 100.0);
+  EXPECT_EQ(bottomRight.direction, Vector3(2.0, -1.0, -1.0).normalize());
+}
+
+TEST(CameraTest, TestFrame) {
+  BoundingBox3 box(-1.0, 3.0, -2.0, 2.0, 0.0, 4.0);
+  Camera camera = Camera::frame(box, Vector3(0.0, 0.0, -1.0), Vector3::yUnit(), 60.0, 64, 64);
+  EXPECT_EQ(camera.forward(), Vector3(0.0, 0.0, -1.0));
+  // The center of the image looks at the center of the box.
+  Ray3 ray = camera.generateRay(32.0, 32.0);
+  Vector3 toCenter = Vector3(1.0, 0.0, 2.0) - ray.origin;
+  EXPECT_NEAR((toCenter ^ ray.direction).len(), 0.0, HD_EPSILON);
+  // All corners of the box are in view.
+  double halfFov = std::tan(30.0 * HD_PI / 180.0);
+  for (int i = 0; i < 8; ++i) {
+    Vector3 corner((i & 1) ? 3.0 : -1.0, (i & 2) ? 2.0 : -2.0, (i & 4) ? 4.0 : 0.0);
+    Vector3 d = corner - camera.position();
+    double depth = d * camera.forward();
+    EXPECT_GT(depth, 0.0);
+    EXPECT_LE(std::fabs(d.x) / depth, halfFov);
+    EXPECT_LE(std::fabs(d.y) / depth, halfFov);
+  }
+}
@@ -0,0 +1,144 @@
+#include "render/checkpoint.h"
+#include "geometry/triangular_mesh.h"
+#include "math/vector3.h"
+#include "render/film.h"
+#include <array>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+namespace {
+  Checkpoint makeCheckpoint() {
+    Checkpoint checkpoint;
+    checkpoint.width = 3;
+    checkpoint.height = 2;
+    checkpoint.samplerSeed = 42;
+    checkpoint.minSamplesPerPixel = 4;
+    checkpoint.maxSamplesPerPixel = 64;
+    checkpoint.samplesPerPass = 8;
+    checkpoint.targetError = 0.03;
+    checkpoint.integrator = "wavefront";
+    checkpoint.sampler = "sobol";
+    checkpoint.filter = Film::Filter(Film::Filter::Type::TENT, 1.5);
+    checkpoint.cameraPosition = Vector3(1.0, 2.0, 3.0);
+    checkpoint.cameraForward = Vector3(0.0, 0.0, -1.0);
+    checkpoint.cameraRight = Vector3(0.6, 0.0, 0.0);
+    checkpoint.cameraUp = Vector3(0.0, 0.4, 0.0);
+    checkpoint.meshVertexNum = 7;
+    checkpoint.meshFaceNum = 9;
+    checkpoint.meshChecksum = 0x0123456789abcdefULL;
+    checkpoint.passNum = 5;
+    checkpoint.wallSeconds = 12.5;
+    for (unsigned int i = 0; i < 6; ++i) {
+      checkpoint.sums.push_back(Vector3(i, 0.1 * i, 1.0 / (i + 3)));
+      checkpoint.luminanceSquareSums.push_back(i * i + 0.25);
+      checkpoint.sampleCounts.push_back(4 + 8 * i);
+    }
+    return checkpoint;
+  }
+
+  unique_ptr<TriangularMesh> makeMesh(const vector<Vector3>& vertices,
+      const vector<array<unsigned int, 3>>& faces) {
+    auto builder = TriangularMesh::newBuilder(
+        TriangularMesh::VertexNormalMode::AVERAGED, TriangularMesh::FaceNormalMode::FLAT);
+    for (const Vector3& v : vertices) {
+      builder.addVertex(v);
+    }
+    for (const auto& face : faces) {
+      builder.addFace(face);
+    }
+    return builder.build();
+  }
+}
+
+TEST(CheckpointTest, TestRoundTrip) {
+  Checkpoint checkpoint = makeCheckpoint();
+  string path = ::testing::TempDir() + "hd_checkpoint_test.ckpt";
+  ASSERT_TRUE(checkpoint.write(path));
+  // The temporary file was renamed.
+  EXPECT_FALSE(ifstream(path + ".tmp").good());
+
+  auto read = Checkpoint::read(path);
+  ASSERT_NE(read, nullptr);
+  EXPECT_EQ(read->width, 3);
+  EXPECT_EQ(read->height, 2);
+  EXPECT_EQ(read->samplerSeed, 42);
+  EXPECT_EQ(read->minSamplesPerPixel, 4);
+  EXPECT_EQ(read->maxSamplesPerPixel, 64);
+  EXPECT_EQ(read->samplesPerPass, 8);
+  EXPECT_EQ(read->targetError, 0.03);
+  EXPECT_EQ(read->integrator, "wavefront");
+  EXPECT_EQ(read->sampler, "sobol");
+  EXPECT_EQ(read->filter.type, Film::Filter::Type::TENT);
+  EXPECT_EQ(read->filter.radius, 1.5);
+  EXPECT_EQ(read->cameraPosition, checkpoint.cameraPosition);
+  EXPECT_EQ(read->cameraForward, checkpoint.cameraForward);
+  EXPECT_EQ(read->cameraRight, checkpoint.cameraRight);
+  EXPECT_EQ(read->cameraUp, checkpoint.cameraUp);
+  EXPECT_EQ(read->meshVertexNum, 7);
+  EXPECT_EQ(read->meshFaceNum, 9);
+  EXPECT_EQ(read->meshChecksum, 0x0123456789abcdefULL);
+  EXPECT_EQ(read->passNum, 5);
+  EXPECT_EQ(read->wallSeconds, 12.5);
+  EXPECT_EQ(read->sums, checkpoint.sums);
+  EXPECT_EQ(read->luminanceSquareSums, checkpoint.luminanceSquareSums);
+  EXPECT_EQ(read->sampleCounts, checkpoint.sampleCounts);
+
+  // Overwriting replaces the previous checkpoint.
+  checkpoint.passNum = 6;
+  ASSERT_TRUE(checkpoint.write(path));
+  EXPECT_EQ(Checkpoint::read(path)->passNum, 6);
+}
+
+TEST(CheckpointTest, TestMeshChecksum) {
+  vector<Vector3> vertices = {Vector3(0.0, 0.0, 0.0), Vector3(1.0, 0.0, 0.0),
+      Vector3(0.0, 1.0, 0.0), Vector3(0.0, 0.0, 1.0)};
+  vector<array<unsigned int, 3>> faces = {{{0, 1, 2}}, {{0, 3, 1}}};
+  auto mesh = makeMesh(vertices, faces);
+  uint64_t checksum = Checkpoint::checksum(*mesh);
+  EXPECT_EQ(Checkpoint::checksum(*makeMesh(vertices, faces)), checksum);
+  EXPECT_EQ(Checkpoint::checksum(TriangularMesh(*mesh)), checksum);
+
+  // Moving a vertex changes the checksum, as does reordering faces.
+  vertices[3].z = 1.5;
+  EXPECT_NE(Checkpoint::checksum(*makeMesh(vertices, faces)), checksum);
+  vertices[3].z = 1.0;
+  swap(faces[0], faces[1]);
+  EXPECT_NE(Checkpoint::checksum(*makeMesh(vertices, faces)), checksum);
+}
+
+TEST(CheckpointTest, TestInvalidFiles) {
+  string path = ::testing::TempDir() + "hd_checkpoint_test_invalid.ckpt";
+  EXPECT_EQ(Checkpoint::read(path + ".missing"), nullptr);
+  EXPECT_FALSE(makeCheckpoint().write(::testing::TempDir() + "no_such_directory/a.ckpt"));
+  Checkpoint longName = makeCheckpoint();
+  longName.integrator = string(Checkpoint::MAX_NAME_LENGTH + 1, 'x');
+  EXPECT_FALSE(longName.write(path));
+  longName.integrator.pop_back();
+  ASSERT_TRUE(longName.write(path));
+  EXPECT_EQ(Checkpoint::read(path)->integrator, longName.integrator);
+
+  ASSERT_TRUE(makeCheckpoint().write(path));
+  string content;
+  {
+    ifstream in(path, ios::binary);
+    content.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+  }
+  // A flipped payload bit fails the checksum.
+  string corrupted = content;
+  corrupted[corrupted.size() - 20] ^= 1;
+  ofstream(path, ios::binary | ios::trunc) << corrupted;
+  EXPECT_EQ(Checkpoint::read(path), nullptr);
+  // So does a truncated file.
+  ofstream(path, ios::binary | ios::trunc) << content.substr(0, content.size() - 8);
+  EXPECT_EQ(Checkpoint::read(path), nullptr);
+  ofstream(path, ios::binary | ios::trunc) << content;
+  EXPECT_NE(Checkpoint::read(path), nullptr);
+}
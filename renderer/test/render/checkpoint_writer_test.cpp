@@ -0,0 +1,54 @@
+#include "render/checkpoint_writer.h"
+#include "render/checkpoint.h"
+#include "math/vector3.h"
+#include <memory>
+#include <string>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+namespace {
+  unique_ptr<Checkpoint> makeCheckpoint(unsigned int passNum) {
+    unique_ptr<Checkpoint> checkpoint(new Checkpoint());
+    checkpoint->width = 64;
+    checkpoint->height = 64;
+    checkpoint->passNum = passNum;
+    checkpoint->sums.assign(64 * 64, Vector3(passNum, 0.0, 0.0));
+    checkpoint->luminanceSquareSums.assign(64 * 64, 1.0);
+    checkpoint->sampleCounts.assign(64 * 64, passNum);
+    return checkpoint;
+  }
+}
+
+TEST(CheckpointWriterTest, TestSubmit) {
+  string path = ::testing::TempDir() + "hd_checkpoint_writer_test.ckpt";
+  {
+    CheckpointWriter writer(path);
+    EXPECT_EQ(writer.path(), path);
+    for (unsigned int pass = 1; pass <= 10; ++pass) {
+      writer.submit(makeCheckpoint(pass));
+    }
+    EXPECT_TRUE(writer.flush());
+    // Checkpoints still waiting when a newer one came were skipped.
+    EXPECT_GE(writer.writeNum(), 1);
+    EXPECT_LE(writer.writeNum(), 10);
+    EXPECT_EQ(writer.failureNum(), 0);
+    auto checkpoint = Checkpoint::read(path);
+    ASSERT_NE(checkpoint, nullptr);
+    EXPECT_EQ(checkpoint->passNum, 10);
+    EXPECT_EQ(checkpoint->sampleCounts[100], 10);
+
+    // Destruction writes what is still waiting.
+    writer.submit(makeCheckpoint(11));
+  }
+  EXPECT_EQ(Checkpoint::read(path)->passNum, 11);
+}
+
+TEST(CheckpointWriterTest, TestFailure) {
+  CheckpointWriter writer(::testing::TempDir() + "no_such_directory/a.ckpt");
+  writer.submit(makeCheckpoint(1));
+  EXPECT_FALSE(writer.flush());
+  EXPECT_EQ(writer.writeNum(), 0);
+  EXPECT_EQ(writer.failureNum(), 1);
+}
@@ -0,0 +1,137 @@
+#include "render/film.h"
+#include "math/vector3.h"
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(FilmTest, TestBoxFilter) {
+  Film film(4, 3);
+  EXPECT_EQ(film.filter().margin(), 0);
+  EXPECT_EQ(film.pixel(3, 2), Vector3::zero());
+  // Samples count only in the pixel they are taken in, wherever in it.
+  film.addSample(1.0, 2.0, Vector3(1.0, 2.0, 3.0));
+  film.addSample(1.99, 2.5, Vector3(3.0, 2.0, 1.0));
+  EXPECT_EQ(film.pixel(1, 2), Vector3(2.0, 2.0, 2.0));
+  EXPECT_EQ(film.pixel(0, 2), Vector3::zero());
+  EXPECT_EQ(film.pixel(2, 2), Vector3::zero());
+  EXPECT_EQ(film.pixel(1, 1), Vector3::zero());
+
+  // Splats are summed and scaled, on top of samples.
+  film.splat(1.5, 2.5, Vector3(4.0, 0.0, 0.0));
+  film.splat(3.5, 0.5, Vector3(1.0, 1.0, 1.0));
+  film.splat(-0.5, 0.5, Vector3(1.0, 1.0, 1.0));
+  EXPECT_EQ(film.pixel(1, 2, 0.5), Vector3(4.0, 2.0, 2.0));
+  auto image = film.image(0.25);
+  EXPECT_EQ(image->at(3, 0), Vector3(0.25, 0.25, 0.25));
+  EXPECT_EQ(image->at(0, 0), Vector3::zero());
+
+  film.clear();
+  EXPECT_EQ(film.pixel(1, 2), Vector3::zero());
+  EXPECT_EQ(film.pixel(3, 0), Vector3::zero());
+}
+
+TEST(FilmTest, TestTentFilter) {
+  Film::Filter filter(Film::Filter::Type::TENT, 1.5);
+  EXPECT_EQ(filter.margin(), 1);
+  EXPECT_DOUBLE_EQ(filter.weight(0.0), 1.0);
+  EXPECT_DOUBLE_EQ(filter.weight(-0.75), 0.5);
+  EXPECT_EQ(filter.weight(1.6), 0.0);
+
+  Film film(5, 5, filter);
+  // A sample at the center of pixel (2, 2) reaches its 8 neighbours, with a third of the weight
+  // on each axis.
+  film.addSample(2.5, 2.5, Vector3(1.0, 1.0, 1.0));
+  film.addSample(1.5, 2.5, Vector3(4.0, 4.0, 4.0));
+  EXPECT_EQ(film.pixel(3, 2), Vector3(1.0, 1.0, 1.0));
+  EXPECT_EQ(film.pixel(0, 2), Vector3(4.0, 4.0, 4.0));
+  EXPECT_EQ(film.pixel(3, 3), Vector3(1.0, 1.0, 1.0));
+  EXPECT_EQ(film.pixel(0, 1), Vector3(4.0, 4.0, 4.0));
+  EXPECT_EQ(film.pixel(4, 2), Vector3::zero());
+  EXPECT_EQ(film.pixel(2, 4), Vector3::zero());
+  // Pixel (2, 2) takes the first sample with weight 1, the second with weight 1/3.
+  EXPECT_NEAR(film.pixel(2, 2).x, 7.0 / 4.0, 1e-12);
+  EXPECT_NEAR(film.pixel(1, 2).x, 13.0 / 4.0, 1e-12);
+
+  // A constant image stays constant, including across borders.
+  film.clear();
+  for (unsigned int y = 0; y < 5; ++y) {
+    for (unsigned int x = 0; x < 5; ++x) {
+      film.addSample(x + 0.3, y + 0.8, Vector3(0.5, 0.5, 0.5));
+    }
+  }
+  for (unsigned int y = 0; y < 5; ++y) {
+    for (unsigned int x = 0; x < 5; ++x) {
+      EXPECT_NEAR(film.pixel(x, y).y, 0.5, 1e-12);
+    }
+  }
+}
+
+TEST(FilmTest, TestTileBuffers) {
+  // Tiles of 4x4 pixels whose footprints overlap their neighbours, merged concurrently.
+  const unsigned int size = 16;
+  Film::Filter filter(Film::Filter::Type::TENT, 2.0);
+  Film film(size, size, filter);
+  Film reference(size, size, filter);
+  auto value = [](unsigned int x, unsigned int y, unsigned int s) {
+    return Vector3(x + s, y, 1.0);
+  };
+  for (unsigned int y = 0; y < size; ++y) {
+    for (unsigned int x = 0; x < size; ++x) {
+      for (unsigned int s = 0; s < 2; ++s) {
+        reference.addSample(x + 0.25 + 0.5 * s, y + 0.5, value(x, y, s));
+      }
+    }
+  }
+  vector<thread> threads;
+  for (unsigned int t = 0; t < 4; ++t) {
+    threads.push_back(thread([&, t]() {
+      for (unsigned int tile = t; tile < 16; tile += 4) {
+        unsigned int x0 = tile % 4 * 4;
+        unsigned int y0 = tile / 4 * 4;
+        Film::TileBuffer buffer = film.tileBuffer(x0, y0, x0 + 4, y0 + 4);
+        for (unsigned int y = y0; y < y0 + 4; ++y) {
+          for (unsigned int x = x0; x < x0 + 4; ++x) {
+            for (unsigned int s = 0; s < 2; ++s) {
+              buffer.addSample(x + 0.25 + 0.5 * s, y + 0.5, value(x, y, s));
+            }
+          }
+        }
+        film.merge(buffer);
+      }
+    }));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (unsigned int y = 0; y < size; ++y) {
+    for (unsigned int x = 0; x < size; ++x) {
+      for (int c = 0; c < 3; ++c) {
+        EXPECT_NEAR(film.pixel(x, y)[c], reference.pixel(x, y)[c], 1e-12);
+      }
+    }
+  }
+}
+
+TEST(FilmTest, TestConcurrentSplats) {
+  Film film(2, 2);
+  const unsigned int threadNum = 4;
+  const unsigned int splatNum = 10000;
+  vector<thread> threads;
+  for (unsigned int t = 0; t < threadNum; ++t) {
+    threads.push_back(thread([&]() {
+      for (unsigned int i = 0; i < splatNum; ++i) {
+        film.splat(0.5 + i % 2, 0.5, Vector3(1.0, 2.0, 0.0));
+      }
+    }));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  // Integer sums are exact, so no addition was lost.
+  EXPECT_EQ(film.pixel(0, 0), Vector3(threadNum * splatNum / 2, threadNum * splatNum, 0.0));
+  EXPECT_EQ(film.pixel(1, 0), Vector3(threadNum * splatNum / 2, threadNum * splatNum, 0.0));
+  EXPECT_EQ(film.pixel(0, 1), Vector3::zero());
+}
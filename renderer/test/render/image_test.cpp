@@ -0,0 +1,48 @@
+#include "render/image.h"
+#include "math/vector3.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(ImageTest, TestPfmRoundTrip) {
+  Image image(5, 3);
+  EXPECT_EQ(image.at(4, 2), Vector3::zero());
+  for (unsigned int y = 0; y < 3; ++y) {
+    for (unsigned int x = 0; x < 5; ++x) {
+      image.at(x, y) = Vector3(x, y, 0.25 * (x + y) + 1000.0);
+    }
+  }
+  string path = ::testing::TempDir() + "hd_image_test.pfm";
+  ASSERT_TRUE(image.writePfm(path));
+
+  // Header, then float rows from the bottom up.
+  ifstream in(path, ios::binary);
+  string header;
+  getline(in, header);
+  EXPECT_EQ(header, "PF");
+  getline(in, header);
+  EXPECT_EQ(header, "5 3");
+  getline(in, header);
+  EXPECT_EQ(header, "-1.0");
+  float first[3];
+  in.read(reinterpret_cast<char*>(first), sizeof(first));
+  EXPECT_EQ(first[1], 2.0f);
+  in.close();
+
+  auto loaded = Image::readPfm(path);
+  ASSERT_NE(loaded, nullptr);
+  EXPECT_EQ(loaded->width(), 5);
+  EXPECT_EQ(loaded->height(), 3);
+  for (unsigned int y = 0; y < 3; ++y) {
+    for (unsigned int x = 0; x < 5; ++x) {
+      EXPECT_EQ(loaded->at(x, y), image.at(x, y));
+    }
+  }
+  remove(path.c_str());
+
+  EXPECT_EQ(Image::readPfm(path), nullptr);
+}
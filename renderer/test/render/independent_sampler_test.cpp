@@ -0,0 +1,47 @@
+#include "render/independent_sampler.h"
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(IndependentSamplerTest, TestGet) {
+  IndependentSampler sampler(7);
+  EXPECT_EQ(sampler.seed(), 7);
+  double sum = 0.0;
+  const unsigned int n = 10000;
+  for (unsigned int i = 0; i < n; ++i) {
+    double u = sampler.get(i % 13, i % 7, i, i % 5);
+    EXPECT_GE(u, 0.0);
+    EXPECT_LT(u, 1.0);
+    sum += u;
+  }
+  EXPECT_NEAR(sum / n, 0.5, 0.01);
+
+  // A pure function of its arguments, which all change the result.
+  EXPECT_EQ(sampler.get(1, 2, 3, 4), IndependentSampler(7).get(1, 2, 3, 4));
+  EXPECT_NE(sampler.get(1, 2, 3, 4), sampler.get(2, 2, 3, 4));
+  EXPECT_NE(sampler.get(1, 2, 3, 4), sampler.get(1, 3, 3, 4));
+  EXPECT_NE(sampler.get(1, 2, 3, 4), sampler.get(1, 2, 4, 4));
+  EXPECT_NE(sampler.get(1, 2, 3, 4), sampler.get(1, 2, 3, 5));
+  EXPECT_NE(sampler.get(1, 2, 3, 4), IndependentSampler(8).get(1, 2, 3, 4));
+}
+
+TEST(IndependentSamplerTest, TestFill) {
+  IndependentSampler sampler(3);
+  // More samples than a batch, and dimensions starting and ending in the middle of pairs.
+  const size_t n = 300;
+  vector<unsigned int> xs(n), ys(n), sampleIndices(n);
+  for (size_t i = 0; i < n; ++i) {
+    xs[i] = static_cast<unsigned int>(i % 17);
+    ys[i] = static_cast<unsigned int>(i / 17);
+    sampleIndices[i] = static_cast<unsigned int>(i * 5);
+  }
+  vector<double> values(5 * n);
+  sampler.fill(n, xs.data(), ys.data(), sampleIndices.data(), 3, 5, values.data());
+  for (unsigned int d = 0; d < 5; ++d) {
+    for (size_t i = 0; i < n; ++i) {
+      EXPECT_EQ(values[d * n + i], sampler.get(xs[i], ys[i], sampleIndices[i], 3 + d));
+    }
+  }
+}
@@ -0,0 +1,69 @@
+#include "render/lattice_sampler.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(LatticeSamplerTest, TestStratification) {
+  LatticeSampler sampler(5);
+  // The first 2^m samples of a pixel are a shifted lattice, one per stratum of each dimension.
+  for (unsigned int m = 2; m <= 10; m += 4) {
+    unsigned int n = 1 << m;
+    for (unsigned int d = 0; d < LatticeSampler::LATTICE_DIMENSION_NUM; ++d) {
+      vector<unsigned int> counts(n, 0);
+      for (unsigned int i = 0; i < n; ++i) {
+        double u = sampler.get(7, 9, i, d);
+        ASSERT_GE(u, 0.0);
+        ASSERT_LT(u, 1.0);
+        ++counts[static_cast<unsigned int>(u * n)];
+      }
+      EXPECT_EQ(*max_element(counts.begin(), counts.end()), 1);
+    }
+  }
+  // Dimensions past the lattice still give numbers in [0, 1).
+  double u = sampler.get(7, 9, 3, LatticeSampler::LATTICE_DIMENSION_NUM + 4);
+  EXPECT_GE(u, 0.0);
+  EXPECT_LT(u, 1.0);
+}
+
+TEST(LatticeSamplerTest, TestBlueNoise) {
+  LatticeSampler sampler;
+  const unsigned int size = LatticeSampler::BLUE_NOISE_SIZE;
+  // Every value appears once.
+  vector<double> values;
+  for (unsigned int y = 0; y < size; ++y) {
+    for (unsigned int x = 0; x < size; ++x) {
+      values.push_back(sampler.blueNoise(x, y));
+    }
+  }
+  sort(values.begin(), values.end());
+  for (unsigned int i = 0; i < values.size(); ++i) {
+    EXPECT_DOUBLE_EQ(values[i], (i + 0.5) / values.size());
+  }
+  EXPECT_EQ(sampler.blueNoise(3, 4), sampler.blueNoise(3 + size, 4 + 2 * size));
+
+  // Little low frequency content: averages over 3x3 windows vary much less than they would
+  // for white noise, whose variance 1/12 would drop to 1/108. The same holds for the shifts of
+  // pixels in every dimension.
+  for (int d = -1; d < 4; ++d) {
+    auto value = [&](unsigned int x, unsigned int y) {
+      return d < 0 ? sampler.blueNoise(x, y) : sampler.get(x, y, 0, d);
+    };
+    double squareSum = 0.0;
+    for (unsigned int y = 0; y < size; ++y) {
+      for (unsigned int x = 0; x < size; ++x) {
+        double mean = 0.0;
+        for (unsigned int dy = 0; dy < 3; ++dy) {
+          for (unsigned int dx = 0; dx < 3; ++dx) {
+            mean += value(x + dx, y + dy) / 9.0;
+          }
+        }
+        squareSum += (mean - 0.5) * (mean - 0.5);
+      }
+    }
+    EXPECT_LT(squareSum / (size * size), 1.0 / 108.0 / 3.0);
+  }
+}
@@ -0,0 +1,105 @@
+#include "render/megakernel_integrator.h"
+#include "geometry/kd_tree.h"
+#include "geometry/triangular_mesh.h"
+#include "render/camera.h"
+#include "render/renderer.h"
+#include "math/vector3.h"
+#include "const.h"
+#include <cmath>
+#include <memory>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+class MegakernelIntegratorTest : public ::testing::Test {
+  protected:
+    // A 20x20 ground plane at y = 0, alone or with a 2x2 square floating above it at y = 1.
+    unique_ptr<TriangularMesh> ground;
+    unique_ptr<TriangularMesh> groundAndOccluder;
+
+    virtual void SetUp() {
+      ground = buildMesh(false);
+      groundAndOccluder = buildMesh(true);
+    }
+
+    virtual void TearDown() {}
+
+    unique_ptr<TriangularMesh> buildMesh(bool withOccluder) {
+      auto builder = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::FLAT);
+      addSquare(builder, 0.0, 10.0, 0);
+      if (withOccluder) {
+        addSquare(builder, 1.0, 1.0, 4);
+      }
+      return builder.build();
+    }
+
+    // A horizontal square at height y, centered on the y axis, facing up.
+    void addSquare(TriangularMesh::Builder& builder, double y, double halfSize,
+        unsigned int firstVertex) {
+      builder.addVertex(Vector3(-halfSize, y, -halfSize));
+      builder.addVertex(Vector3(-halfSize, y, halfSize));
+      builder.addVertex(Vector3(halfSize, y, halfSize));
+      builder.addVertex(Vector3(halfSize, y, -halfSize));
+      builder.addFace({firstVertex, firstVertex + 1, firstVertex + 2});
+      builder.addFace({firstVertex, firstVertex + 2, firstVertex + 3});
+    }
+
+    // Looking straight down at the origin, with the ground filling the image.
+    Camera camera() const {
+      return Camera(Vector3(0.0, 10.0, 0.0), Vector3::zero(), Vector3::zUnit(), 45.0, 32, 32);
+    }
+};
+
+TEST_F(MegakernelIntegratorTest, TestDirectAndSkyLight) {
+  auto tree = KdTree::build(*ground);
+  PathIntegrator::Options options;
+  options.maxDepth = 2;
+  MegakernelIntegrator integrator(*ground, *tree, camera(), options);
+  EXPECT_NEAR(integrator.options().sunDirection.len(), 1.0, HD_EPSILON);
+  Renderer::Options renderOptions;
+  renderOptions.threadNum = 2;
+  auto image = Renderer(integrator).render(renderOptions);
+
+  // Sun light reflected by the ground, plus sky light seen after one bounce, as every bounce
+  // off the ground escapes to the sky.
+  double cosTheta = integrator.options().sunDirection.y;
+  Vector3 expected = options.sunIrradiance * (options.albedo / HD_PI * cosTheta)
+      + options.skyRadiance * options.albedo;
+  for (unsigned int y = 0; y < 32; ++y) {
+    for (unsigned int x = 0; x < 32; ++x) {
+      for (int c = 0; c < 3; ++c) {
+        EXPECT_NEAR(image->at(x, y)[c], expected[c], 1e-9);
+      }
+    }
+  }
+}
+
+TEST_F(MegakernelIntegratorTest, TestShadow) {
+  auto tree = KdTree::build(*groundAndOccluder);
+  PathIntegrator::Options options;
+  options.maxDepth = 1;
+  MegakernelIntegrator integrator(*groundAndOccluder, *tree, camera(), options);
+  auto image = Renderer(integrator).render(Renderer::Options());
+
+  // Surfaces are either lit by the sun, both facing up, or in the shadow of the occluder.
+  double lit = options.sunIrradiance.x * options.albedo / HD_PI
+      * integrator.options().sunDirection.y;
+  unsigned int litNum = 0;
+  unsigned int shadowNum = 0;
+  for (unsigned int y = 0; y < 32; ++y) {
+    for (unsigned int x = 0; x < 32; ++x) {
+      double value = image->at(x, y).x;
+      if (fabs(value - lit) < 1e-9) {
+        ++litNum;
+      } else {
+        EXPECT_EQ(value, 0.0);
+        ++shadowNum;
+      }
+    }
+  }
+  EXPECT_GT(litNum, 0);
+  EXPECT_GT(shadowNum, 0);
+}
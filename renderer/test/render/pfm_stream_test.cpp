@@ -0,0 +1,69 @@
+#include "render/pfm_stream.h"
+#include "render/film.h"
+#include "render/image.h"
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+namespace {
+  string readFile(const string& path) {
+    ifstream in(path, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+  }
+}
+
+TEST(PfmStreamTest, TestWriteRegions) {
+  Film film(7, 5);
+  for (unsigned int y = 0; y < 5; ++y) {
+    for (unsigned int x = 0; x < 7; ++x) {
+      film.addSample(x + 0.5, y + 0.5, Vector3(x, y, 0.5 * x * y + 100.0));
+    }
+  }
+  string path = ::testing::TempDir() + "hd_pfm_stream_test.pfm";
+  PfmStream stream;
+  EXPECT_FALSE(stream.isOpen());
+  ASSERT_TRUE(stream.open(path, film));
+  EXPECT_TRUE(stream.isOpen());
+  // Regions in any order, with the bottom right one left out.
+  stream.write(4, 3, 7, 5);
+  stream.write(0, 0, 4, 3);
+  stream.write(4, 0, 7, 3);
+  EXPECT_TRUE(stream.close());
+  EXPECT_FALSE(stream.isOpen());
+  EXPECT_EQ(stream.regionNum(), 3);
+
+  auto image = Image::readPfm(path);
+  ASSERT_NE(image, nullptr);
+  ASSERT_EQ(image->width(), 7);
+  ASSERT_EQ(image->height(), 5);
+  for (unsigned int y = 0; y < 5; ++y) {
+    for (unsigned int x = 0; x < 7; ++x) {
+      Vector3 expected = x < 4 && y >= 3 ? Vector3::zero() : film.pixel(x, y);
+      for (int c = 0; c < 3; ++c) {
+        EXPECT_FLOAT_EQ(image->at(x, y)[c], expected[c]);
+      }
+    }
+  }
+
+  // Once all pixels are written, the file is the one Image::writePfm() writes.
+  ASSERT_TRUE(stream.open(path, film));
+  for (unsigned int y = 0; y < 5; ++y) {
+    stream.write(0, y, 7, y + 1);
+  }
+  EXPECT_TRUE(stream.close());
+  string reference = ::testing::TempDir() + "hd_pfm_stream_test_reference.pfm";
+  ASSERT_TRUE(film.image()->writePfm(reference));
+  EXPECT_EQ(readFile(path), readFile(reference));
+}
+
+TEST(PfmStreamTest, TestOpenFailure) {
+  Film film(2, 2);
+  PfmStream stream;
+  EXPECT_FALSE(stream.open(::testing::TempDir() + "no_such_directory/image.pfm", film));
+  EXPECT_FALSE(stream.isOpen());
+  EXPECT_FALSE(stream.close());
+}
@@ -0,0 +1,227 @@
+#include "render/render_coordinator.h"
+#include "geometry/kd_tree.h"
+#include "geometry/triangular_mesh.h"
+#include "io/mesh_serializer.h"
+#include "render/render_protocol.h"
+#include "render/render_worker.h"
+#include "render/renderer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+class RenderCoordinatorTest : public ::testing::Test {
+  protected:
+    // A unit square on the xOy plane, centered at the origin, seen at an angle.
+    unique_ptr<TriangularMesh> square;
+    unique_ptr<KdTree> tree;
+    RenderJob job;
+
+    virtual void SetUp() {
+      auto builder = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::FLAT);
+      builder.addVertex(Vector3(-0.5, -0.5, 0.0));
+      builder.addVertex(Vector3(0.5, -0.5, 0.0));
+      builder.addVertex(Vector3(0.5, 0.5, 0.0));
+      builder.addVertex(Vector3(-0.5, 0.5, 0.0));
+      builder.addFace({0, 1, 2});
+      builder.addFace({0, 2, 3});
+      square = builder.build();
+      tree = KdTree::build(*square);
+      job.meshPath = ::testing::TempDir() + "hd_render_coordinator_test.hdmesh";
+      ASSERT_TRUE(MeshSerializer::write(*square, job.meshPath));
+      job.width = 24;
+      job.height = 20;
+      job.viewDirection = Vector3(-0.3, -0.2, -1.0);
+      job.sampler = "independent";
+      job.samplerSeed = 3;
+      job.samplesPerPixel = 2;
+    }
+
+    virtual void TearDown() {
+      std::remove(job.meshPath.c_str());
+    }
+
+    // Image rendered in this process.
+    unique_ptr<Image> renderLocally() {
+      auto integrator = job.createIntegrator(*square, *tree);
+      Renderer::Options options;
+      options.samplesPerPixel = job.samplesPerPixel;
+      options.filter = job.filter;
+      return Renderer(*integrator).render(options);
+    }
+
+    void expectSameImage(const Image& image, const Image& expected) {
+      ASSERT_EQ(image.width(), expected.width());
+      ASSERT_EQ(image.height(), expected.height());
+      for (unsigned int y = 0; y < image.height(); ++y) {
+        for (unsigned int x = 0; x < image.width(); ++x) {
+          EXPECT_EQ(image.at(x, y), expected.at(x, y)) << x << ", " << y;
+        }
+      }
+    }
+};
+
+TEST_F(RenderCoordinatorTest, TestRender) {
+  for (auto type : {Film::Filter::Type::BOX, Film::Filter::Type::TENT}) {
+    job.filter = type == Film::Filter::Type::BOX ? Film::Filter()
+        : Film::Filter(Film::Filter::Type::TENT, 1.5);
+    RenderCoordinator::Options options;
+    options.tileSize = 8;
+    RenderCoordinator coordinator(job, options);
+    ASSERT_TRUE(coordinator.listen("unix:" + ::testing::TempDir() + "hd_coordinator.sock"));
+    vector<thread> workers;
+    vector<unique_ptr<RenderWorker>> renderWorkers;
+    atomic<unsigned int> successNum(0);
+    for (unsigned int i = 0; i < 2; ++i) {
+      RenderWorker::Options workerOptions;
+      workerOptions.threadNum = i + 1;
+      renderWorkers.emplace_back(new RenderWorker(workerOptions));
+      RenderWorker* worker = renderWorkers.back().get();
+      string address = coordinator.address();
+      workers.push_back(thread([worker, address, &successNum]() {
+        if (worker->run(address)) {
+          ++successNum;
+        }
+      }));
+    }
+    auto image = coordinator.run();
+    for (thread& worker : workers) {
+      worker.join();
+    }
+    ASSERT_NE(image, nullptr);
+    EXPECT_EQ(successNum, 2);
+    EXPECT_EQ(coordinator.stats().workerNum, 2);
+    EXPECT_EQ(coordinator.stats().lostWorkerNum, 0);
+    EXPECT_EQ(renderWorkers[0]->stats().tileNum + renderWorkers[1]->stats().tileNum, 9);
+    // Same as rendering in a single process, to the bit.
+    expectSameImage(*image, *renderLocally());
+  }
+}
+
+TEST_F(RenderCoordinatorTest, TestLostWorker) {
+  RenderCoordinator::Options options;
+  options.tileSize = 8;
+  options.tileTimeoutSeconds = 0.5;
+  RenderCoordinator coordinator(job, options);
+  ASSERT_TRUE(coordinator.listen("tcp:127.0.0.1:0"));
+  string address = coordinator.address();
+  // Workers that take tiles and then die, or hang, before returning any.
+  atomic<unsigned int> faultyNum(0);
+  auto faulty = [&](bool dies) {
+    Socket socket = Socket::connect(address);
+    Message hello(RenderProtocol::HELLO);
+    hello.put<uint32_t>(RenderProtocol::VERSION);
+    hello.put<uint32_t>(RenderProtocol::ENDIANNESS_TAG);
+    hello.put<uint32_t>(1);
+    Message job, tile;
+    if (socket.send(hello) && socket.receive(job) && socket.receive(tile)
+        && tile.type == RenderProtocol::TILE) {
+      ++faultyNum;
+    }
+    if (!dies) {
+      // Hang until the coordinator gives up on this worker.
+      while (socket.receive(tile)) {}
+    }
+  };
+  thread dying(faulty, true);
+  thread hanging(faulty, false);
+  RenderWorker worker;
+  bool isDone = false;
+  thread healthy([&]() {
+    // Start once the faulty workers have their tiles.
+    while (faultyNum < 2) {
+      this_thread::yield();
+    }
+    isDone = worker.run(address);
+  });
+  auto image = coordinator.run();
+  dying.join();
+  hanging.join();
+  healthy.join();
+  ASSERT_NE(image, nullptr);
+  EXPECT_TRUE(isDone);
+  EXPECT_EQ(coordinator.stats().workerNum, 3);
+  EXPECT_EQ(coordinator.stats().lostWorkerNum, 2);
+  // Each faulty worker was handed 2 tiles, twice its threads.
+  EXPECT_EQ(coordinator.stats().reassignedTileNum, 4);
+  EXPECT_EQ(worker.stats().tileNum, 9);
+  expectSameImage(*image, *renderLocally());
+}
+
+TEST_F(RenderCoordinatorTest, TestSlowWorker) {
+  RenderCoordinator::Options options;
+  options.tileSize = 12;
+  options.tileTimeoutSeconds = 0.5;
+  RenderCoordinator coordinator(job, options);
+  ASSERT_TRUE(coordinator.listen("tcp:127.0.0.1:0"));
+  string address = coordinator.address();
+  // A worker that takes less than the timeout per tile, but longer for the 2 tiles it holds at a
+  // time, which is not hung.
+  unsigned int resultNum = 0;
+  thread slow([&]() {
+    Socket socket = Socket::connect(address);
+    Message hello(RenderProtocol::HELLO);
+    hello.put<uint32_t>(RenderProtocol::VERSION);
+    hello.put<uint32_t>(RenderProtocol::ENDIANNESS_TAG);
+    hello.put<uint32_t>(1);
+    Message message;
+    if (!socket.send(hello) || !socket.receive(message)) {
+      return;
+    }
+    while (socket.receive(message) && message.type == RenderProtocol::TILE) {
+      uint32_t index, x0, y0, x1, y1;
+      message.get(index);
+      message.get(x0);
+      message.get(y0);
+      message.get(x1);
+      message.get(y1);
+      this_thread::sleep_for(chrono::milliseconds(300));
+      Film::TileBuffer buffer(job.filter, job.width, job.height, x0, y0, x1, y1);
+      Message result(RenderProtocol::RESULT);
+      result.put<uint32_t>(index);
+      result.put<uint32_t>(buffer.x0());
+      result.put<uint32_t>(buffer.y0());
+      result.put<uint32_t>(buffer.x1());
+      result.put<uint32_t>(buffer.y1());
+      result.payload.resize(result.payload.size()
+          + (buffer.x1() - buffer.x0()) * (buffer.y1() - buffer.y0()) * 4 * sizeof(double));
+      if (socket.send(result)) {
+        ++resultNum;
+      }
+    }
+  });
+  auto image = coordinator.run();
+  slow.join();
+  ASSERT_NE(image, nullptr);
+  EXPECT_EQ(coordinator.stats().lostWorkerNum, 0);
+  EXPECT_EQ(coordinator.stats().reassignedTileNum, 0);
+  EXPECT_EQ(resultNum, 4);
+}
+
+TEST_F(RenderCoordinatorTest, TestIdleTimeout) {
+  RenderCoordinator::Options options;
+  options.idleTimeoutSeconds = 0.1;
+  RenderCoordinator coordinator(job, options);
+  EXPECT_EQ(coordinator.run(), nullptr);
+  ASSERT_TRUE(coordinator.listen("tcp:127.0.0.1:0"));
+  EXPECT_EQ(coordinator.run(), nullptr);
+  EXPECT_EQ(coordinator.stats().workerNum, 0);
+}
+
+TEST_F(RenderCoordinatorTest, TestNoWorkerExpected) {
+  RenderCoordinator::Options options;
+  unsigned int checkNum = 0;
+  options.isWorkerExpected = [&checkNum]() { return ++checkNum < 3; };
+  RenderCoordinator coordinator(job, options);
+  ASSERT_TRUE(coordinator.listen("tcp:127.0.0.1:0"));
+  EXPECT_EQ(coordinator.run(), nullptr);
+  EXPECT_EQ(checkNum, 3);
+}
@@ -0,0 +1,104 @@
+#include "render/render_daemon.h"
+#include "geometry/kd_tree.h"
+#include "geometry/triangular_mesh.h"
+#include "io/mesh_serializer.h"
+#include "render/render_protocol.h"
+#include "render/renderer.h"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(RenderDaemonTest, TestServe) {
+  auto builder = TriangularMesh::newBuilder(
+      TriangularMesh::VertexNormalMode::AVERAGED,
+      TriangularMesh::FaceNormalMode::FLAT);
+  builder.addVertex(Vector3(-0.5, -0.5, 0.0));
+  builder.addVertex(Vector3(0.5, -0.5, 0.0));
+  builder.addVertex(Vector3(0.0, 0.5, 0.0));
+  builder.addFace({0, 1, 2});
+  auto mesh = builder.build();
+  auto tree = KdTree::build(*mesh);
+  string meshPath = ::testing::TempDir() + "hd_render_daemon_test.hdmesh";
+  ASSERT_TRUE(MeshSerializer::write(*mesh, meshPath));
+  RenderJob job;
+  job.meshPath = meshPath;
+  job.width = 20;
+  job.height = 16;
+  job.samplesPerPixel = 2;
+
+  RenderDaemon::Options options;
+  options.threadNum = 2;
+  options.maxPixelNum = 20 * 16;
+  RenderDaemon daemon(options);
+  ASSERT_TRUE(daemon.listen("unix:" + ::testing::TempDir() + "hd_render_daemon.sock"));
+  string address = daemon.address();
+  bool isServed = false;
+  thread server([&]() { isServed = daemon.run(); });
+
+  // The first job loads the scene, later ones find it cached.
+  RenderDaemon::JobStats stats;
+  string error;
+  auto image = RenderDaemon::render(address, job, &stats, &error);
+  EXPECT_TRUE(error.empty());
+  ASSERT_NE(image, nullptr);
+  EXPECT_FALSE(stats.isSceneCached);
+  job.viewDirection = Vector3(0.2, -0.1, -1.0);
+  job.integrator = "headlight";
+  auto moved = RenderDaemon::render(address, job, &stats);
+  ASSERT_NE(moved, nullptr);
+  EXPECT_TRUE(stats.isSceneCached);
+
+  // Images are the same as rendered in a single process.
+  auto integrator = job.createIntegrator(*mesh, *tree);
+  Renderer::Options renderOptions;
+  renderOptions.samplesPerPixel = job.samplesPerPixel;
+  auto expected = Renderer(*integrator).render(renderOptions);
+  ASSERT_EQ(moved->width(), 20);
+  ASSERT_EQ(moved->height(), 16);
+  for (unsigned int y = 0; y < 16; ++y) {
+    for (unsigned int x = 0; x < 20; ++x) {
+      EXPECT_EQ(moved->at(x, y), expected->at(x, y));
+    }
+  }
+
+  // Failures are reported, and the daemon carries on.
+  job.integrator = "raytracer";
+  EXPECT_EQ(RenderDaemon::render(address, job, nullptr, &error), nullptr);
+  EXPECT_NE(error.find("raytracer"), string::npos);
+  job.integrator = "headlight";
+  job.meshPath = meshPath + ".missing";
+  EXPECT_EQ(RenderDaemon::render(address, job, nullptr, &error), nullptr);
+  EXPECT_NE(error.find("cannot read scene"), string::npos);
+  job.meshPath = meshPath;
+  job.width = 21;
+  EXPECT_EQ(RenderDaemon::render(address, job, nullptr, &error), nullptr);
+  EXPECT_NE(error.find("larger than"), string::npos);
+  // Sizes whose pixel count overflows 32 bits are rejected as malformed.
+  job.width = 65536;
+  job.height = 65536;
+  EXPECT_EQ(RenderDaemon::render(address, job, nullptr, &error), nullptr);
+  EXPECT_EQ(error, "malformed request");
+  {
+    Socket socket = Socket::connect(address);
+    Message response;
+    ASSERT_TRUE(socket.send(Message(RenderProtocol::TILE)));
+    ASSERT_TRUE(socket.receive(response));
+    EXPECT_EQ(response.type, RenderProtocol::FAILED);
+  }
+
+  EXPECT_TRUE(RenderDaemon::shutdown(address));
+  server.join();
+  EXPECT_TRUE(isServed);
+  EXPECT_EQ(daemon.stats().jobNum, 5);
+  EXPECT_EQ(daemon.stats().failedJobNum, 3);
+  EXPECT_EQ(daemon.stats().badRequestNum, 2);
+  EXPECT_EQ(daemon.cache().stats().loads, 1);
+  EXPECT_FALSE(RenderDaemon::shutdown(address));
+  EXPECT_EQ(RenderDaemon::render(address, job, nullptr, &error), nullptr);
+  std::remove(meshPath.c_str());
+}
@@ -0,0 +1,87 @@
+#include "render/render_job.h"
+#include "geometry/kd_tree.h"
+#include "geometry/triangular_mesh.h"
+#include "render/sobol_sampler.h"
+#include <memory>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(RenderJobTest, TestSerialization) {
+  RenderJob job;
+  job.meshPath = "/tmp/scene.hdmesh";
+  job.width = 320;
+  job.height = 200;
+  job.viewDirection = Vector3(0.0, 0.0, -1.0);
+  job.fovY = 30.0;
+  job.isInside = true;
+  job.integrator = "headlight";
+  job.sampler = "lattice";
+  job.samplerSeed = 17;
+  job.samplesPerPixel = 8;
+  job.filter = Film::Filter(Film::Filter::Type::TENT, 1.5);
+  job.isSortingRays = false;
+  Message message;
+  job.write(message);
+
+  RenderJob read;
+  ASSERT_TRUE(read.read(message));
+  EXPECT_TRUE(message.isFullyRead());
+  EXPECT_EQ(read.meshPath, job.meshPath);
+  EXPECT_EQ(read.width, 320);
+  EXPECT_EQ(read.height, 200);
+  EXPECT_EQ(read.viewDirection, job.viewDirection);
+  EXPECT_EQ(read.up, Vector3::yUnit());
+  EXPECT_EQ(read.fovY, 30.0);
+  EXPECT_TRUE(read.isInside);
+  EXPECT_EQ(read.integrator, "headlight");
+  EXPECT_EQ(read.sampler, "lattice");
+  EXPECT_EQ(read.samplerSeed, 17);
+  EXPECT_EQ(read.samplesPerPixel, 8);
+  EXPECT_EQ(read.filter.type, Film::Filter::Type::TENT);
+  EXPECT_EQ(read.filter.radius, 1.5);
+  EXPECT_FALSE(read.isSortingRays);
+
+  // Truncated messages are rejected.
+  Message truncated;
+  job.write(truncated);
+  truncated.payload.resize(truncated.payload.size() - 1);
+  EXPECT_FALSE(read.read(truncated));
+
+  // So are images too large to allocate.
+  job.width = 1 << 16;
+  job.height = 1 << 16;
+  Message huge;
+  job.write(huge);
+  EXPECT_FALSE(read.read(huge));
+}
+
+TEST(RenderJobTest, TestCreateIntegrator) {
+  auto builder = TriangularMesh::newBuilder(
+      TriangularMesh::VertexNormalMode::AVERAGED,
+      TriangularMesh::FaceNormalMode::FLAT);
+  builder.addVertex(Vector3(-0.5, -0.5, 0.0));
+  builder.addVertex(Vector3(0.5, -0.5, 0.0));
+  builder.addVertex(Vector3(0.0, 0.5, 0.0));
+  builder.addFace({0, 1, 2});
+  auto mesh = builder.build();
+  auto tree = KdTree::build(*mesh);
+
+  RenderJob job;
+  job.width = 32;
+  job.height = 24;
+  job.samplerSeed = 5;
+  auto integrator = job.createIntegrator(*mesh, *tree);
+  ASSERT_NE(integrator, nullptr);
+  EXPECT_EQ(integrator->camera().width(), 32);
+  EXPECT_EQ(integrator->camera().height(), 24);
+  EXPECT_NE(dynamic_cast<const SobolSampler*>(&integrator->sampler()), nullptr);
+  EXPECT_EQ(integrator->sampler().seed(), 5);
+
+  job.integrator = "raytracer";
+  EXPECT_EQ(job.createIntegrator(*mesh, *tree), nullptr);
+  job.integrator = "megakernel";
+  job.sampler = "stratified";
+  EXPECT_EQ(job.createIntegrator(*mesh, *tree), nullptr);
+}
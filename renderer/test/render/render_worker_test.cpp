@@ -0,0 +1,118 @@
+#include "render/render_worker.h"
+#include "geometry/kd_tree.h"
+#include "geometry/triangular_mesh.h"
+#include "io/mesh_serializer.h"
+#include "io/socket.h"
+#include "render/render_job.h"
+#include "render/render_protocol.h"
+#include "render/renderer.h"
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(RenderWorkerTest, TestRenderTile) {
+  auto builder = TriangularMesh::newBuilder(
+      TriangularMesh::VertexNormalMode::AVERAGED,
+      TriangularMesh::FaceNormalMode::FLAT);
+  builder.addVertex(Vector3(-0.5, -0.5, 0.0));
+  builder.addVertex(Vector3(0.5, -0.5, 0.0));
+  builder.addVertex(Vector3(0.0, 0.5, 0.0));
+  builder.addFace({0, 1, 2});
+  auto mesh = builder.build();
+  auto tree = KdTree::build(*mesh);
+  RenderJob job;
+  job.meshPath = ::testing::TempDir() + "hd_render_worker_test.hdmesh";
+  ASSERT_TRUE(MeshSerializer::write(*mesh, job.meshPath));
+  job.width = 16;
+  job.height = 16;
+  job.samplesPerPixel = 3;
+  job.filter = Film::Filter(Film::Filter::Type::TENT, 1.5);
+
+  // A coordinator handing out a single tile.
+  ServerSocket server;
+  ASSERT_TRUE(server.listen("tcp:127.0.0.1:0"));
+  RenderWorker::Options options;
+  options.threadNum = 2;
+  RenderWorker worker(options);
+  bool isDone = false;
+  thread workerThread([&]() { isDone = worker.run(server.address()); });
+  Socket socket = server.accept();
+  Message message;
+  ASSERT_TRUE(socket.receive(message));
+  EXPECT_EQ(message.type, RenderProtocol::HELLO);
+  uint32_t version, endiannessTag, threadNum;
+  ASSERT_TRUE(message.get(version) && message.get(endiannessTag) && message.get(threadNum));
+  EXPECT_EQ(version, RenderProtocol::VERSION);
+  EXPECT_EQ(endiannessTag, RenderProtocol::ENDIANNESS_TAG);
+  EXPECT_EQ(threadNum, 2);
+  Message jobMessage(RenderProtocol::JOB);
+  job.write(jobMessage);
+  ASSERT_TRUE(socket.send(jobMessage));
+  Message tile(RenderProtocol::TILE);
+  for (uint32_t value : {5u, 8u, 0u, 16u, 8u}) {
+    tile.put(value);
+  }
+  ASSERT_TRUE(socket.send(tile));
+  ASSERT_TRUE(socket.receive(message));
+  ASSERT_TRUE(socket.send(Message(RenderProtocol::DONE)));
+  workerThread.join();
+  EXPECT_TRUE(isDone);
+  EXPECT_EQ(worker.stats().tileNum, 1);
+
+  // The result holds the buffer of the tile, margin included, as rendered locally.
+  auto integrator = job.createIntegrator(*mesh, *tree);
+  Film::TileBuffer expected(job.filter, 16, 16, 8, 0, 16, 8);
+  TileScheduler::Tile expectedTile;
+  expectedTile.x0 = 8;
+  expectedTile.y0 = 0;
+  expectedTile.x1 = 16;
+  expectedTile.y1 = 8;
+  expectedTile.index = 5;
+  Renderer(*integrator).renderTile(expectedTile, 3, expected);
+  EXPECT_EQ(message.type, RenderProtocol::RESULT);
+  uint32_t index, x0, y0, x1, y1;
+  ASSERT_TRUE(message.get(index) && message.get(x0) && message.get(y0) && message.get(x1)
+      && message.get(y1));
+  EXPECT_EQ(index, 5);
+  EXPECT_EQ(x0, 7);
+  EXPECT_EQ(y0, 0);
+  EXPECT_EQ(x1, 16);
+  EXPECT_EQ(y1, 9);
+  for (unsigned int y = y0; y < y1; ++y) {
+    for (unsigned int x = x0; x < x1; ++x) {
+      double values[4];
+      ASSERT_TRUE(message.getBytes(values, sizeof(values)));
+      EXPECT_EQ(Vector3(values[0], values[1], values[2]), expected.sum(x, y));
+      EXPECT_EQ(values[3], expected.weight(x, y));
+    }
+  }
+  EXPECT_TRUE(message.isFullyRead());
+  std::remove(job.meshPath.c_str());
+}
+
+TEST(RenderWorkerTest, TestFailures) {
+  RenderWorker::Options options;
+  options.connectTimeoutSeconds = 0.1;
+  RenderWorker worker(options);
+  EXPECT_FALSE(worker.run("unix:" + ::testing::TempDir() + "hd_missing_coordinator.sock"));
+
+  // A job whose scene cannot be loaded.
+  ServerSocket server;
+  ASSERT_TRUE(server.listen("tcp:127.0.0.1:0"));
+  bool isDone = true;
+  thread workerThread([&]() { isDone = worker.run(server.address()); });
+  Socket socket = server.accept();
+  Message message;
+  ASSERT_TRUE(socket.receive(message));
+  RenderJob job;
+  job.meshPath = ::testing::TempDir() + "hd_missing.hdmesh";
+  Message jobMessage(RenderProtocol::JOB);
+  job.write(jobMessage);
+  ASSERT_TRUE(socket.send(jobMessage));
+  workerThread.join();
+  EXPECT_FALSE(isDone);
+}
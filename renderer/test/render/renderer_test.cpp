@@ -0,0 +1,120 @@
+#include "render/renderer.h"
+#include "geometry/kd_tree.h"
+#include "geometry/triangular_mesh.h"
+#include "render/camera.h"
+#include "render/headlight_integrator.h"
+#include "math/vector3.h"
+#include "const.h"
+#include <cmath>
+#include <memory>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+class RendererTest : public ::testing::Test {
+  protected:
+    // A unit square on the xOy plane, centered at the origin.
+    unique_ptr<TriangularMesh> square;
+    unique_ptr<KdTree> tree;
+
+    virtual void SetUp() {
+      auto builder = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::FLAT);
+      builder.addVertex(Vector3(-0.5, -0.5, 0.0));
+      builder.addVertex(Vector3(0.5, -0.5, 0.0));
+      builder.addVertex(Vector3(0.5, 0.5, 0.0));
+      builder.addVertex(Vector3(-0.5, 0.5, 0.0));
+      builder.addFace({0, 1, 2});
+      builder.addFace({0, 2, 3});
+      square = builder.build();
+      tree = KdTree::build(*square);
+    }
+
+    virtual void TearDown() {}
+};
+
+TEST_F(RendererTest, TestRender) {
+  // The square fills the middle half of the image, seen from 2 units away.
+  double fovY = 2.0 * atan(0.5) * 180.0 / HD_PI;
+  Camera camera(Vector3(0.0, 0.0, 2.0), Vector3::zero(), Vector3::yUnit(), fovY, 40, 40);
+  HeadlightIntegrator integrator(*square, *tree, camera);
+  Integrator::SampleRequest requests[] = {
+    Integrator::SampleRequest(20, 20, 0), Integrator::SampleRequest(1, 1, 0)
+  };
+  Vector3 radiance[2];
+  integrator.render(requests, 2, radiance);
+  EXPECT_NEAR(radiance[0].x, 1.0, 0.01);
+  EXPECT_EQ(radiance[1], Vector3::zero());
+  Renderer renderer(integrator);
+
+  Renderer::Options options;
+  options.samplesPerPixel = 4;
+  options.tileSize = 8;
+  options.threadNum = 3;
+  TileScheduler::Stats stats;
+  auto image = renderer.render(options, &stats);
+  ASSERT_EQ(image->width(), 40);
+  ASSERT_EQ(image->height(), 40);
+  EXPECT_EQ(stats.threads.size(), 3);
+  for (unsigned int y = 0; y < 40; ++y) {
+    for (unsigned int x = 0; x < 40; ++x) {
+      bool inside = x > 10 && x < 29 && y > 10 && y < 29;
+      bool outside = x < 9 || x > 30 || y < 9 || y > 30;
+      if (inside) {
+        // Lit at nearly normal incidence.
+        EXPECT_GT(image->at(x, y).x, 0.9);
+      } else if (outside) {
+        EXPECT_EQ(image->at(x, y), Vector3::zero());
+      }
+    }
+  }
+
+  // The result does not depend on how tiles are scheduled.
+  options.threadNum = 1;
+  options.tileSize = 5;
+  auto single = renderer.render(options);
+  for (unsigned int y = 0; y < 40; ++y) {
+    for (unsigned int x = 0; x < 40; ++x) {
+      EXPECT_EQ(single->at(x, y).x, image->at(x, y).x);
+    }
+  }
+}
+
+TEST_F(RendererTest, TestStreamOutput) {
+  Camera camera(Vector3(0.0, 0.0, 2.0), Vector3::zero(), Vector3::yUnit(), 40.0, 23, 17);
+  HeadlightIntegrator integrator(*square, *tree, camera);
+  Renderer renderer(integrator);
+  Renderer::Options options;
+  options.samplesPerPixel = 2;
+  options.tileSize = 4;
+  options.threadNum = 3;
+  // Footprints reach the neighbouring tiles, so tiles are final only once those are done.
+  options.filter = Film::Filter(Film::Filter::Type::TENT, 1.5);
+  options.outputPath = ::testing::TempDir() + "hd_renderer_test.pfm";
+  auto image = renderer.render(options);
+  ASSERT_NE(image, nullptr);
+  auto written = Image::readPfm(options.outputPath);
+  ASSERT_NE(written, nullptr);
+  ASSERT_EQ(written->width(), 23);
+  ASSERT_EQ(written->height(), 17);
+  for (unsigned int y = 0; y < 17; ++y) {
+    for (unsigned int x = 0; x < 23; ++x) {
+      EXPECT_FLOAT_EQ(written->at(x, y).x, image->at(x, y).x);
+    }
+  }
+
+  // Pixels add samples of neighbouring tiles in any order, which only changes rounding.
+  options.threadNum = 1;
+  options.outputPath = "";
+  auto single = renderer.render(options);
+  for (unsigned int y = 0; y < 17; ++y) {
+    for (unsigned int x = 0; x < 23; ++x) {
+      EXPECT_NEAR(single->at(x, y).x, image->at(x, y).x, 1e-12);
+    }
+  }
+
+  options.outputPath = ::testing::TempDir() + "no_such_directory/image.pfm";
+  EXPECT_EQ(renderer.render(options), nullptr);
+}
@@ -0,0 +1,106 @@
+#include "render/sampler.h"
+#include "render/independent_sampler.h"
+#include "render/lattice_sampler.h"
+#include "render/sobol_sampler.h"
+#include "const.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+namespace {
+  // L2 star discrepancy of the first n samples of a pixel in dimensions d and d + 1, by
+  // Warnock's formula.
+  double l2StarDiscrepancy(const Sampler& sampler, unsigned int n, unsigned int d) {
+    vector<double> u(n);
+    vector<double> v(n);
+    for (unsigned int i = 0; i < n; ++i) {
+      u[i] = sampler.get(3, 5, i, d);
+      v[i] = sampler.get(3, 5, i, d + 1);
+    }
+    double single = 0.0;
+    double pairs = 0.0;
+    for (unsigned int i = 0; i < n; ++i) {
+      single += (1.0 - u[i] * u[i]) * (1.0 - v[i] * v[i]) / 4.0;
+      for (unsigned int j = 0; j < n; ++j) {
+        pairs += (1.0 - max(u[i], u[j])) * (1.0 - max(v[i], v[j]));
+      }
+    }
+    return sqrt(1.0 / 9.0 - 2.0 / n * single + pairs / (static_cast<double>(n) * n));
+  }
+
+  // RMS error over many pixels of the estimate with n samples of the integral of a smooth
+  // function over dimensions d and d + 1.
+  double rmsError(const Sampler& sampler, unsigned int n, unsigned int d) {
+    const unsigned int pixelNum = 16;
+    double exact = 4.0 / (HD_PI * HD_PI);
+    double squareSum = 0.0;
+    for (unsigned int y = 0; y < pixelNum; ++y) {
+      for (unsigned int x = 0; x < pixelNum; ++x) {
+        double sum = 0.0;
+        for (unsigned int i = 0; i < n; ++i) {
+          sum += sin(HD_PI * sampler.get(x, y, i, d)) * sin(HD_PI * sampler.get(x, y, i, d + 1));
+        }
+        double error = sum / n - exact;
+        squareSum += error * error;
+      }
+    }
+    return sqrt(squareSum / (pixelNum * pixelNum));
+  }
+
+  // Exponent of the decrease of the RMS error with the sample count, from 16 to 256 samples.
+  double convergenceRate(const Sampler& sampler, unsigned int d) {
+    return log(rmsError(sampler, 256, d) / rmsError(sampler, 16, d)) / log(16.0);
+  }
+}
+
+// Reports figures of merit of all samplers, and checks that low discrepancy samplers beat plain
+// Monte Carlo by a wide margin, both on the first dimensions and on later ones.
+TEST(SamplerTest, TestDiscrepancyAndConvergence) {
+  IndependentSampler independent(1);
+  SobolSampler sobol(1);
+  LatticeSampler lattice(1);
+  const Sampler* samplers[] = {&independent, &sobol, &lattice};
+  const char* names[] = {"independent", "sobol", "lattice"};
+  double discrepancy[3][2];
+  double rate[3][2];
+  for (int s = 0; s < 3; ++s) {
+    // Pixel position, and the direction of the second bounce of a path.
+    const unsigned int dims[] = {0, 4};
+    for (int k = 0; k < 2; ++k) {
+      discrepancy[s][k] = l2StarDiscrepancy(*samplers[s], 256, dims[k]);
+      rate[s][k] = convergenceRate(*samplers[s], dims[k]);
+      printf("[ figures  ] %-11s dims %u-%u: L2* discrepancy (256 samples) %.5f,"
+          " RMS error ~ N^%.2f\n", names[s], dims[k], dims[k] + 1, discrepancy[s][k],
+          rate[s][k]);
+    }
+  }
+  for (int k = 0; k < 2; ++k) {
+    // Plain Monte Carlo converges as N^-1/2.
+    EXPECT_NEAR(rate[0][k], -0.5, 0.15);
+    // Owen-scrambled Sobol converges as N^-3/2 on smooth integrands, lattices with random
+    // shifts at least as N^-1.
+    EXPECT_LT(rate[1][k], -1.2);
+    EXPECT_LT(rate[2][k], -0.9);
+    EXPECT_LT(discrepancy[1][k], discrepancy[0][k] / 3.0);
+    EXPECT_LT(discrepancy[2][k], discrepancy[0][k] / 3.0);
+  }
+}
+
+TEST(SamplerTest, TestFill) {
+  SobolSampler sobol(2);
+  const unsigned int xs[] = {0, 5, 5, 63};
+  const unsigned int ys[] = {0, 1, 1, 40};
+  const unsigned int sampleIndices[] = {0, 0, 9, 1000};
+  double values[3 * 4];
+  sobol.fill(4, xs, ys, sampleIndices, 1, 3, values);
+  for (unsigned int d = 0; d < 3; ++d) {
+    for (unsigned int i = 0; i < 4; ++i) {
+      EXPECT_EQ(values[d * 4 + i], sobol.get(xs[i], ys[i], sampleIndices[i], 1 + d));
+    }
+  }
+}
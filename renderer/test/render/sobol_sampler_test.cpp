@@ -0,0 +1,87 @@
+#include "render/sobol_sampler.h"
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+namespace {
+  // Whether each of the 2^m intervals [i / 2^m, (i + 1) / 2^m) holds exactly one point.
+  bool isStratified(const vector<double>& u, unsigned int m) {
+    vector<unsigned int> counts(1u << m, 0);
+    for (double x : u) {
+      if (++counts[static_cast<unsigned int>(x * (1u << m))] > 1) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Whether every box [i / 2^a, (i + 1) / 2^a) x [j / 2^b, (j + 1) / 2^b) with a + b = m holds
+  // exactly one of the 2^m points, i.e. whether the points are a (0, m, 2)-net in base 2.
+  bool isNet(const vector<double>& u, const vector<double>& v, unsigned int m) {
+    for (unsigned int a = 0; a <= m; ++a) {
+      unsigned int b = m - a;
+      vector<unsigned int> counts(1u << m, 0);
+      for (size_t i = 0; i < u.size(); ++i) {
+        unsigned int cell = (static_cast<unsigned int>(u[i] * (1u << a)) << b)
+            | static_cast<unsigned int>(v[i] * (1u << b));
+        if (++counts[cell] > 1) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+}
+
+TEST(SobolSamplerTest, TestSobol) {
+  SobolSampler sampler;
+  const double scale = 1.0 / 4294967296.0;
+  // Van der Corput, then the first points of the next dimensions.
+  double expected[4][4] = {
+    {0.0, 0.5, 0.25, 0.75},
+    {0.0, 0.5, 0.75, 0.25},
+    {0.0, 0.5, 0.75, 0.25},
+    {0.0, 0.5, 0.75, 0.25},
+  };
+  for (unsigned int d = 0; d < SobolSampler::GROUP_DIMENSION_NUM; ++d) {
+    for (unsigned int i = 0; i < 4; ++i) {
+      EXPECT_EQ(sampler.sobol(i, d) * scale, expected[d][i]);
+    }
+  }
+  EXPECT_EQ(sampler.sobol(4, 1) * scale, 0.625);
+  EXPECT_EQ(sampler.sobol(4, 2) * scale, 0.375);
+  EXPECT_EQ(sampler.sobol(4, 3) * scale, 0.125);
+}
+
+TEST(SobolSamplerTest, TestStratification) {
+  SobolSampler sampler(3);
+  const unsigned int m = 8;
+  const unsigned int n = 1 << m;
+  for (unsigned int group = 0; group < 3; ++group) {
+    unsigned int d = group * SobolSampler::GROUP_DIMENSION_NUM;
+    vector<vector<double>> points(SobolSampler::GROUP_DIMENSION_NUM, vector<double>(n));
+    for (unsigned int i = 0; i < n; ++i) {
+      for (unsigned int k = 0; k < SobolSampler::GROUP_DIMENSION_NUM; ++k) {
+        points[k][i] = sampler.get(10, 20, i, d + k);
+        EXPECT_GE(points[k][i], 0.0);
+        EXPECT_LT(points[k][i], 1.0);
+      }
+    }
+    // Scrambled points keep the stratification of the sequence: each dimension alone, and
+    // the first two dimensions of a group jointly. The first 2^k samples are stratified too.
+    for (unsigned int k = 0; k < SobolSampler::GROUP_DIMENSION_NUM; ++k) {
+      EXPECT_TRUE(isStratified(points[k], m));
+    }
+    EXPECT_TRUE(isNet(points[0], points[1], m));
+    vector<double> u(points[0].begin(), points[0].begin() + n / 4);
+    vector<double> v(points[1].begin(), points[1].begin() + n / 4);
+    EXPECT_TRUE(isNet(u, v, m - 2));
+  }
+
+  // Pixels and seeds are scrambled differently.
+  EXPECT_NE(sampler.get(10, 20, 0, 0), sampler.get(11, 20, 0, 0));
+  EXPECT_NE(sampler.get(10, 20, 0, 0), SobolSampler(4).get(10, 20, 0, 0));
+  EXPECT_EQ(sampler.get(10, 20, 5, 6), SobolSampler(3).get(10, 20, 5, 6));
+}
@@ -0,0 +1,73 @@
+#include "render/tile_scheduler.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(TileSchedulerTest, TestTiles) {
+  TileScheduler scheduler(100, 40, 16, 3);
+  EXPECT_EQ(scheduler.threadNum(), 3);
+  // 7 columns and 3 rows of tiles, cut at the right and bottom borders.
+  EXPECT_EQ(scheduler.tileNum(), 21);
+  EXPECT_EQ(scheduler.tile(6).x0, 96);
+  EXPECT_EQ(scheduler.tile(6).x1, 100);
+  EXPECT_EQ(scheduler.tile(20).y1, 40);
+  EXPECT_EQ(scheduler.tile(20).pixelNum(), 4 * 8);
+  EXPECT_GT(TileScheduler(10, 10).threadNum(), 0);
+}
+
+TEST(TileSchedulerTest, TestRunCoversEveryPixelOnce) {
+  const unsigned int width = 123;
+  const unsigned int height = 77;
+  TileScheduler scheduler(width, height, 8, 4);
+  vector<atomic<unsigned int>> counts(width * height);
+  for (auto& count : counts) {
+    count = 0;
+  }
+  auto stats = scheduler.run([&](const TileScheduler::Tile& tile, unsigned int threadId) {
+    EXPECT_LT(threadId, 4);
+    for (unsigned int y = tile.y0; y < tile.y1; ++y) {
+      for (unsigned int x = tile.x0; x < tile.x1; ++x) {
+        ++counts[y * width + x];
+      }
+    }
+  });
+  for (auto& count : counts) {
+    EXPECT_EQ(count, 1);
+  }
+  ASSERT_EQ(stats.threads.size(), 4);
+  unsigned int tileNum = 0;
+  for (auto& thread : stats.threads) {
+    tileNum += thread.tileNum;
+  }
+  EXPECT_EQ(tileNum, scheduler.tileNum());
+}
+
+TEST(TileSchedulerTest, TestStealing) {
+  // All the cost is in the first quarter of the tiles, i.e. the tiles dealt to thread 0, which
+  // the other threads have to steal to share the work.
+  TileScheduler scheduler(64, 64, 8, 4);
+  auto stats = scheduler.run([&](const TileScheduler::Tile& tile, unsigned int) {
+    if (tile.index < scheduler.tileNum() / 4) {
+      this_thread::sleep_for(chrono::milliseconds(5));
+    }
+  });
+  EXPECT_EQ(stats.threads[0].stealNum, 0);
+  unsigned int stealNum = 0;
+  for (unsigned int t = 1; t < 4; ++t) {
+    stealNum += stats.threads[t].stealNum;
+  }
+  EXPECT_GT(stealNum, 0);
+  // Thread 0 did well below the 16 expensive tiles it was dealt.
+  EXPECT_LT(stats.threads[0].tileNum, 16);
+  for (unsigned int t = 0; t < 4; ++t) {
+    EXPECT_GE(stats.utilisation(t), 0.0);
+    EXPECT_LE(stats.utilisation(t), 1.0);
+  }
+  EXPECT_GT(stats.utilisation(), 0.5);
+  EXPECT_NE(stats.toString().find("thread 3:"), string::npos);
+}
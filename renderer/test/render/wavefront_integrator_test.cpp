@@ -0,0 +1,148 @@
+#include "render/wavefront_integrator.h"
+#include "geometry/kd_tree.h"
+#include "geometry/triangular_mesh.h"
+#include "render/camera.h"
+#include "render/megakernel_integrator.h"
+#include "math/vector3.h"
+#include "scene/room_generator.h"
+#include "../geometry/grid_mesh.h"
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+namespace {
+  // A wavy grid, folded enough for paths to bounce off it several times and to shadow itself.
+  // Heights are along z, so the sun of PathIntegrator::Options must be turned to match.
+  unique_ptr<TriangularMesh> buildWavyGrid() {
+    return buildGridMesh(24,
+        [](unsigned int x, unsigned int y) { return 3.0 * sin(x * 0.7) * cos(y * 0.5); },
+        TriangularMesh::VertexNormalMode::AVERAGED,
+        TriangularMesh::FaceNormalMode::PHONG, true);
+  }
+}
+
+TEST(WavefrontIntegratorTest, TestMatchesMegakernel) {
+  auto mesh = buildWavyGrid();
+  auto tree = KdTree::build(*mesh);
+  Camera camera(Vector3(-2.0, -2.0, 8.0), Vector3(12.0, 12.0, 0.0), Vector3::zUnit(), 50.0,
+      24, 16);
+  PathIntegrator::Options options;
+  options.maxDepth = 6;
+  options.sunDirection = Vector3(0.3, 0.5, 1.0);
+  MegakernelIntegrator megakernel(*mesh, *tree, camera, options, 7);
+  // A wave size that does not divide the batch, so that the last wave is partial.
+  WavefrontIntegrator wavefront(*mesh, *tree, camera, options, 7, 100);
+  EXPECT_EQ(wavefront.waveSize(), 100);
+
+  vector<Integrator::SampleRequest> requests;
+  for (unsigned int y = 0; y < 16; ++y) {
+    for (unsigned int x = 0; x < 24; ++x) {
+      for (unsigned int s = 0; s < 3; ++s) {
+        requests.push_back(Integrator::SampleRequest(x, y, s));
+      }
+    }
+  }
+  vector<Vector3> expected(requests.size());
+  vector<Vector3> actual(requests.size());
+  megakernel.render(requests.data(), requests.size(), expected.data());
+  wavefront.render(requests.data(), requests.size(), actual.data());
+  unsigned int surfaceNum = 0;
+  for (size_t i = 0; i < requests.size(); ++i) {
+    for (int c = 0; c < 3; ++c) {
+      EXPECT_NEAR(actual[i][c], expected[i][c], 1e-9);
+    }
+    surfaceNum += expected[i] == options.skyRadiance ? 0 : 1;
+  }
+  // Most samples see the surface rather than the sky.
+  EXPECT_GT(surfaceNum, requests.size() / 2);
+
+  // Samples do not depend on the batch they are rendered in.
+  vector<Vector3> single(1);
+  wavefront.render(&requests[101], 1, single.data());
+  EXPECT_EQ(single[0], actual[101]);
+}
+
+TEST(WavefrontIntegratorTest, TestSortingRays) {
+  auto mesh = buildWavyGrid();
+  auto tree = KdTree::build(*mesh);
+  Camera camera(Vector3(-2.0, -2.0, 8.0), Vector3(12.0, 12.0, 0.0), Vector3::zUnit(), 50.0,
+      24, 16);
+  PathIntegrator::Options options;
+  options.maxDepth = 6;
+  options.sunDirection = Vector3(0.3, 0.5, 1.0);
+  WavefrontIntegrator sorted(*mesh, *tree, camera, options, 7, 128);
+  WavefrontIntegrator unsorted(*mesh, *tree, camera, options, 7, 128);
+  EXPECT_TRUE(sorted.isSortingRays());
+  unsorted.setSortingRays(false);
+  EXPECT_FALSE(unsorted.isSortingRays());
+  EXPECT_EQ(sorted.rayNum(), 0u);
+
+  vector<Integrator::SampleRequest> requests;
+  for (unsigned int y = 0; y < 16; ++y) {
+    for (unsigned int x = 0; x < 24; ++x) {
+      requests.push_back(Integrator::SampleRequest(x, y, 0));
+    }
+  }
+  vector<Vector3> expected(requests.size());
+  vector<Vector3> actual(requests.size());
+  unsorted.render(requests.data(), requests.size(), expected.data());
+  sorted.render(requests.data(), requests.size(), actual.data());
+  // Sorting only changes the order rays are traced in, so results are identical, bit for bit.
+  for (size_t i = 0; i < requests.size(); ++i) {
+    EXPECT_EQ(actual[i], expected[i]);
+  }
+  EXPECT_GT(sorted.rayNum(), requests.size());
+  EXPECT_EQ(sorted.rayNum(), unsorted.rayNum());
+}
+
+TEST(WavefrontIntegratorTest, TestCountingTraversals) {
+  // A small interior scene, rendered from the clearing in its center.
+  RoomGenerator::Options roomOptions;
+  roomOptions.wallResolution = 16;
+  roomOptions.boxNum = 40;
+  roomOptions.boxResolution = 2;
+  auto mesh = RoomGenerator::generate(roomOptions);
+  auto tree = KdTree::build(*mesh);
+  Camera camera(Vector3(0.0, 0.0, 0.0), Vector3(0.0, 0.0, 1.0), Vector3::yUnit(), 90.0, 32, 32);
+  PathIntegrator::Options options;
+  options.maxDepth = 4;
+  WavefrontIntegrator counted(*mesh, *tree, camera, options, 7, 1024);
+  WavefrontIntegrator uncounted(*mesh, *tree, camera, options, 7, 1024);
+  EXPECT_FALSE(counted.isCountingTraversals());
+  counted.setCountingTraversals(true);
+  EXPECT_TRUE(counted.isCountingTraversals());
+
+  vector<Integrator::SampleRequest> requests;
+  for (unsigned int y = 0; y < 32; ++y) {
+    for (unsigned int x = 0; x < 32; ++x) {
+      requests.push_back(Integrator::SampleRequest(x, y, 0));
+    }
+  }
+  vector<Vector3> expected(requests.size());
+  vector<Vector3> actual(requests.size());
+  uncounted.render(requests.data(), requests.size(), expected.data());
+  counted.render(requests.data(), requests.size(), actual.data());
+  for (size_t i = 0; i < requests.size(); ++i) {
+    EXPECT_EQ(actual[i], expected[i]);
+  }
+  EXPECT_EQ(uncounted.traversalStats().traversalNum, 0u);
+  KdTree::TraversalStats sortedStats = counted.traversalStats();
+  // A traversal per ray traced.
+  EXPECT_EQ(sortedStats.traversalNum, counted.rayNum());
+  EXPECT_GT(sortedStats.nodeNum, sortedStats.traversalNum);
+
+  // Sorting only changes the order nodes are visited in, so that fewer of them miss the cache.
+  WavefrontIntegrator unsorted(*mesh, *tree, camera, options, 7, 1024);
+  unsorted.setSortingRays(false);
+  unsorted.setCountingTraversals(true);
+  unsorted.render(requests.data(), requests.size(), actual.data());
+  KdTree::TraversalStats unsortedStats = unsorted.traversalStats();
+  EXPECT_EQ(unsortedStats.traversalNum, sortedStats.traversalNum);
+  EXPECT_EQ(unsortedStats.nodeNum, sortedStats.nodeNum);
+  EXPECT_EQ(unsortedStats.entityNum, sortedStats.entityNum);
+  EXPECT_LT(sortedStats.cacheMissNum, unsortedStats.cacheMissNum);
+}
@@ -0,0 +1,63 @@
+#include "scene/room_generator.h"
+#include "const.h"
+#include "geometry/kd_tree.h"
+#include "geometry/ray3.h"
+#include "geometry/triangular_mesh.h"
+#include "math/vector3.h"
+#include <cmath>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(RoomGeneratorTest, TestGenerate) {
+  RoomGenerator::Options options;
+  options.wallResolution = 4;
+  options.boxNum = 10;
+  options.boxResolution = 2;
+  auto room = RoomGenerator::generate(options);
+  EXPECT_EQ(room->faceNum(), 12 * 4 * 4 + 12 * 10 * 2 * 2);
+  BoundingBox3 box = room->boundingBox3();
+  EXPECT_EQ(box.minCorner(), Vector3::zero());
+  EXPECT_EQ(box.maxCorner(), Vector3(10.0, 4.0, 10.0));
+  // Walls face inwards, boxes outwards.
+  EXPECT_EQ(room->triangle(0).normal(), Vector3(1.0, 0.0, 0.0));
+  EXPECT_GT(room->triangle(12 * 4 * 4).normal() * Vector3(-1.0, 0.0, 0.0), 0.99);
+
+  // The same options give the same room, and another seed another one.
+  auto again = RoomGenerator::generate(options);
+  ASSERT_EQ(again->faceNum(), room->faceNum());
+  for (unsigned int i = 0; i < room->faceNum(); ++i) {
+    for (unsigned int v = 0; v < 3; ++v) {
+      ASSERT_EQ(again->triangle(i).v(v).x, room->triangle(i).v(v).x);
+      ASSERT_EQ(again->triangle(i).v(v).y, room->triangle(i).v(v).y);
+      ASSERT_EQ(again->triangle(i).v(v).z, room->triangle(i).v(v).z);
+    }
+  }
+  options.seed = 1;
+  auto reseeded = RoomGenerator::generate(options);
+  EXPECT_FALSE(reseeded->triangle(room->faceNum() - 1).v(0)
+      == room->triangle(room->faceNum() - 1).v(0));
+}
+
+TEST(RoomGeneratorTest, TestClosedAroundClearing) {
+  RoomGenerator::Options options;
+  options.wallResolution = 8;
+  options.boxResolution = 1;
+  auto room = RoomGenerator::generate(options);
+  auto tree = KdTree::build(*room);
+  // Every ray from the center of the room hits it, and horizontal ones only beyond the
+  // clearing.
+  Vector3 center(5.0, 2.0, 5.0);
+  for (unsigned int i = 0; i < 64; ++i) {
+    double phi = 2.0 * HD_PI * i / 64;
+    for (double y : {-0.9, 0.0, 0.9}) {
+      Vector3 direction(cos(phi), y, sin(phi));
+      RayHit hit;
+      ASSERT_TRUE(tree->intersect(Ray3(center, direction), 0.0, HD_INFINITY, hit));
+      if (y == 0.0) {
+        EXPECT_GE(hit.t, 1.0);
+      }
+    }
+  }
+}
@@ -0,0 +1,121 @@
+#include "scene/scene_cache.h"
+#include "geometry/kd_tree.h"
+#include "geometry/triangular_mesh.h"
+#include "io/mesh_serializer.h"
+#include "math/vector3.h"
+#include "../geometry/grid_mesh.h"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+class SceneCacheTest : public ::testing::Test {
+  protected:
+    // Write an n x n grid to a native mesh file at the given path.
+    void writeGrid(unsigned int n, const string& path) {
+      auto grid = buildGridMesh(n, nullptr,
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::FLAT);
+      ASSERT_TRUE(MeshSerializer::write(*grid, path));
+    }
+
+    string path(const string& name) {
+      return ::testing::TempDir() + "hd_scene_cache_test_" + name;
+    }
+};
+
+TEST_F(SceneCacheTest, TestGet) {
+  string gridPath = path("grid.hdmesh");
+  writeGrid(8, gridPath);
+  string plyPath = path("triangle.ply");
+  {
+    ofstream out(plyPath, ios::out | ios::binary);
+    out << "ply\nformat binary_little_endian 1.0\nelement vertex 3\nproperty float x\n"
+        << "property float y\nproperty float z\nelement face 1\n"
+        << "property list uchar int vertex_indices\nend_header\n";
+    float vertices[9] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    out.write(reinterpret_cast<const char*>(vertices), sizeof(vertices));
+    uint8_t count = 3;
+    int32_t face[3] = {0, 1, 2};
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(face), sizeof(face));
+  }
+  SceneCache cache(1 << 30);
+  auto grid = cache.get(gridPath);
+  ASSERT_NE(grid, nullptr);
+  EXPECT_EQ(grid->meshNum(), 1);
+  EXPECT_EQ(grid->kdTreeNum(), 1);
+  EXPECT_EQ(grid->mesh(0)->faceNum(), 128);
+  EXPECT_EQ(grid->kdTree(0)->entityNum(), 128);
+  auto triangle = cache.get(plyPath);
+  ASSERT_NE(triangle, nullptr);
+  EXPECT_EQ(triangle->mesh(0)->faceNum(), 1);
+  EXPECT_EQ(cache.get(path("missing.ply")), nullptr);
+
+  // Cached scenes are served as they are.
+  EXPECT_EQ(cache.get(gridPath), grid);
+  SceneCache::Stats stats = cache.stats();
+  EXPECT_EQ(stats.loads, 2);
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.residentScenes, 2);
+  EXPECT_EQ(stats.bytesResident,
+      grid->memoryUsage().total() + triangle->memoryUsage().total());
+
+  // Modified files are loaded again.
+  writeGrid(4, gridPath);
+  auto modified = cache.get(gridPath);
+  ASSERT_NE(modified, nullptr);
+  EXPECT_NE(modified, grid);
+  EXPECT_EQ(modified->mesh(0)->faceNum(), 32);
+  EXPECT_EQ(cache.stats().loads, 3);
+  EXPECT_EQ(cache.stats().residentScenes, 2);
+
+  cache.clear();
+  EXPECT_FALSE(cache.contains(gridPath));
+  EXPECT_EQ(cache.stats().residentScenes, 0);
+  EXPECT_EQ(cache.stats().bytesResident, 0);
+  std::remove(gridPath.c_str());
+  std::remove(plyPath.c_str());
+}
+
+TEST_F(SceneCacheTest, TestEviction) {
+  string paths[3] = {path("a.hdmesh"), path("b.hdmesh"), path("c.hdmesh")};
+  for (const string& p : paths) {
+    writeGrid(16, p);
+  }
+  // Room for two scenes only.
+  std::size_t sceneBytes;
+  {
+    SceneCache probe(1 << 30);
+    sceneBytes = probe.get(paths[0])->memoryUsage().total();
+  }
+  SceneCache cache(2 * sceneBytes + sceneBytes / 2);
+  auto a = cache.get(paths[0]);
+  cache.get(paths[1]);
+  EXPECT_EQ(cache.get(paths[0]), a);
+  cache.get(paths[2]);
+  // The least recently used scene is evicted.
+  EXPECT_TRUE(cache.contains(paths[0]));
+  EXPECT_FALSE(cache.contains(paths[1]));
+  EXPECT_TRUE(cache.contains(paths[2]));
+  EXPECT_EQ(cache.stats().evictions, 1);
+  EXPECT_EQ(cache.stats().residentScenes, 2);
+
+  // Scenes still held survive eviction.
+  cache.get(paths[1]);
+  EXPECT_FALSE(cache.contains(paths[0]));
+  EXPECT_EQ(a->mesh(0)->faceNum(), 512);
+
+  // The most recently used scene is kept even over budget.
+  SceneCache tiny(1);
+  EXPECT_NE(tiny.get(paths[0]), nullptr);
+  EXPECT_TRUE(tiny.contains(paths[0]));
+  for (const string& p : paths) {
+    std::remove(p.c_str());
+  }
+}
@@ -0,0 +1,111 @@
+#include "scene/scene.h"
+#include "geometry/kd_tree.h"
+#include "geometry/triangular_mesh.h"
+#include "math/vector3.h"
+#include "util/arena.h"
+#include "util/memory_usage.h"
+#include "../geometry/grid_mesh.h"
+#include <cmath>
+#include <memory>
+#include <gtest/gtest.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace hd;
+using namespace std;
+
+class SceneTest : public ::testing::Test {
+  protected:
+    // Build a wavy n x n grid, optionally allocating from the given arena.
+    unique_ptr<TriangularMesh> buildGrid(unsigned int n,
+        const shared_ptr<Arena>& arena = shared_ptr<Arena>()) {
+      auto builder = TriangularMesh::newBuilder(
+          TriangularMesh::VertexNormalMode::AVERAGED,
+          TriangularMesh::FaceNormalMode::PHONG);
+      if (arena) {
+        builder.setArena(arena);
+      }
+      addGridMesh(builder, n,
+          [](unsigned int x, unsigned int y) { return sin(x * 0.1) * cos(y * 0.1); });
+      return builder.build();
+    }
+};
+
+TEST_F(SceneTest, TestMemoryUsageBreakdown) {
+  const unsigned int n = 32;
+  auto mesh = buildGrid(n);
+  MemoryUsage usage = mesh->memoryUsage();
+  unsigned int vertexNum = (n + 1) * (n + 1);
+  EXPECT_EQ(usage.positions, vertexNum * sizeof(Vector3));
+  EXPECT_EQ(usage.normals, (vertexNum + 2 * n * n) * sizeof(Vector3));
+  EXPECT_EQ(usage.topology,
+      2 * n * n * (3 * sizeof(TriangularMesh::Edge) + 6 * sizeof(unsigned int)));
+  EXPECT_GE(usage.adjacency, 6 * n * n * sizeof(unsigned int));
+  EXPECT_EQ(usage.nodes, 0);
+  EXPECT_EQ(usage.caches, 0);
+  EXPECT_GT(usage.slack, 0);
+  EXPECT_EQ(usage.total(), usage.positions + usage.normals + usage.topology + usage.adjacency
+      + usage.slack);
+
+  mesh->surfaceArea();
+  EXPECT_GT(mesh->memoryUsage().caches, 0);
+
+  auto tree = KdTree::build(*mesh);
+  MemoryUsage treeUsage = tree->memoryUsage();
+  EXPECT_EQ(treeUsage.primitiveReferences, 2 * n * n * sizeof(unsigned int));
+  EXPECT_GT(treeUsage.nodes, 0);
+  EXPECT_EQ(treeUsage.nodes % tree->nodeNum(), 0);
+  EXPECT_EQ(treeUsage.total(), tree->arena()->bytesReserved());
+  EXPECT_NE(treeUsage.toString().find("nodes="), string::npos);
+}
+
+TEST_F(SceneTest, TestMemoryUsageCountsSharedDataOnce) {
+  Scene scene;
+  shared_ptr<TriangularMesh> mesh = buildGrid(32, scene.arena());
+  scene.addMesh(mesh);
+  scene.addMesh(make_shared<TriangularMesh>(*mesh));
+  scene.addKdTree(shared_ptr<KdTree>(KdTree::build(*mesh, KdTree::Options(), scene.arena())));
+  EXPECT_EQ(scene.meshNum(), 2);
+  EXPECT_EQ(scene.kdTreeNum(), 1);
+
+  // Copies share geometry, and the arena is counted once as a whole.
+  MemoryUsage usage = scene.memoryUsage();
+  MemoryUsage meshUsage = mesh->memoryUsage();
+  MemoryUsage treeUsage = scene.kdTree(0)->memoryUsage();
+  EXPECT_EQ(usage.positions, meshUsage.positions + treeUsage.positions);
+  EXPECT_EQ(usage.adjacency, meshUsage.adjacency);
+  EXPECT_EQ(usage.nodes, treeUsage.nodes);
+  EXPECT_GE(usage.total(), scene.arena()->bytesReserved());
+
+  // Editing a copy detaches its geometry.
+  auto copy = make_shared<TriangularMesh>(*mesh);
+  copy->edit().moveVertex(0, Vector3(-1, -1, 0)).commit();
+  scene.addMesh(copy);
+  EXPECT_GT(scene.memoryUsage().positions, usage.positions);
+}
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+namespace {
+  // Bytes currently allocated from the heap, including separately mapped blocks.
+  size_t heapBytesInUse() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+  }
+}
+
+TEST_F(SceneTest, TestMemoryUsageMatchesAllocator) {
+  // Keep large blocks mapped separately, as assumed by heapBlockBytes().
+  mallopt(M_MMAP_THRESHOLD, 128 * 1024);
+
+  size_t before = heapBytesInUse();
+  auto mesh = buildGrid(64);
+  double meshBytes = heapBytesInUse() - before;
+  EXPECT_NEAR(mesh->memoryUsage().total() / meshBytes, 1.0, 0.02);
+
+  before = heapBytesInUse();
+  auto tree = KdTree::build(*mesh);
+  double treeBytes = heapBytesInUse() - before;
+  EXPECT_NEAR(tree->memoryUsage().total() / treeBytes, 1.0, 0.02);
+}
+#endif
@@ -0,0 +1,44 @@
+#include "util/alias_table.h"
+#include "const.h"
+#include <cmath>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(AliasTableTest, TestSampledFrequenciesMatchWeights) {
+  vector<double> weights = {1.0, 0.0, 3.0, 0.5, 2.5, 1.0};
+  AliasTable table(weights);
+  EXPECT_EQ(table.size(), weights.size());
+  EXPECT_NEAR(table.totalWeight(), 8.0, HD_EPSILON);
+  for (unsigned int i = 0; i < weights.size(); ++i) {
+    EXPECT_NEAR(table.pmf(i), weights[i] / 8.0, HD_EPSILON);
+  }
+  // Sweeping u over a fine regular grid reproduces the distribution up to the grid step.
+  const unsigned int n = 600000;
+  vector<unsigned int> counts(weights.size(), 0);
+  for (unsigned int i = 0; i < n; ++i) {
+    ++counts[table.sample((i + 0.5) / n)];
+  }
+  for (unsigned int i = 0; i < weights.size(); ++i) {
+    EXPECT_NEAR(static_cast<double>(counts[i]) / n, table.pmf(i), 1e-4);
+  }
+  EXPECT_EQ(counts[1], 0);
+}
+
+TEST(AliasTableTest, TestDegenerateDistributions) {
+  AliasTable single({2.0});
+  EXPECT_EQ(single.sample(0.0), 0);
+  EXPECT_EQ(single.sample(0.999999), 0);
+
+  AliasTable onlyLast({0.0, 0.0, 0.0, 5.0});
+  for (double u = 0.0; u < 1.0; u += 0.01) {
+    EXPECT_EQ(onlyLast.sample(u), 3);
+  }
+
+  AliasTable uniform(vector<double>(10, 1.0));
+  for (unsigned int i = 0; i < 10; ++i) {
+    EXPECT_EQ(uniform.sample((i + 0.5) / 10), i);
+  }
+}
@@ -0,0 +1,79 @@
+#include "util/arena.h"
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(ArenaTest, TestAllocate) {
+  Arena arena(1024);
+  EXPECT_EQ(arena.bytesReserved(), 0);
+  set<uintptr_t> addresses;
+  for (int i = 0; i < 100; ++i) {
+    void* p = arena.allocate(24, 16);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % 16, 0);
+    addresses.insert(reinterpret_cast<uintptr_t>(p));
+  }
+  EXPECT_EQ(addresses.size(), 100);
+  // 100 blocks of 32 bytes fit in 4 chunks.
+  EXPECT_LE(arena.bytesReserved(), 4 * 1024);
+
+  // Large allocations get chunks of their own.
+  double* large = arena.allocateArray<double>(1000);
+  large[999] = 1.0;
+  EXPECT_GE(arena.bytesReserved(), 1000 * sizeof(double));
+
+  arena.release();
+  EXPECT_EQ(arena.bytesReserved(), 0);
+  int* value = arena.create<int>(42);
+  EXPECT_EQ(*value, 42);
+}
+
+TEST(ArenaTest, TestConcurrentAllocate) {
+  Arena arena(4096);
+  const unsigned int threadNum = 4;
+  const unsigned int allocationNum = 10000;
+  vector<vector<uint64_t*>> blocks(threadNum);
+  vector<thread> threads;
+  for (unsigned int t = 0; t < threadNum; ++t) {
+    threads.push_back(thread([&, t]() {
+      for (unsigned int i = 0; i < allocationNum; ++i) {
+        uint64_t* p = arena.create<uint64_t>(t * allocationNum + i);
+        blocks[t].push_back(p);
+      }
+    }));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  // No block was handed out twice.
+  for (unsigned int t = 0; t < threadNum; ++t) {
+    for (unsigned int i = 0; i < allocationNum; ++i) {
+      EXPECT_EQ(*blocks[t][i], t * allocationNum + i);
+    }
+  }
+}
+
+TEST(ArenaTest, TestArenaAllocator) {
+  Arena arena;
+  vector<int, ArenaAllocator<int>> values((ArenaAllocator<int>(&arena)));
+  for (int i = 0; i < 1000; ++i) {
+    values.push_back(i);
+  }
+  EXPECT_EQ(values.get_allocator().arena(), &arena);
+  EXPECT_GT(arena.bytesReserved(), 0);
+
+  // Copies are made on the heap.
+  vector<int, ArenaAllocator<int>> copy = values;
+  EXPECT_EQ(copy.get_allocator().arena(), nullptr);
+  EXPECT_EQ(copy, values);
+
+  // Without an arena, the heap is used.
+  vector<int, ArenaAllocator<int>> heap;
+  heap.assign(100, 7);
+  EXPECT_EQ(heap.size(), 100);
+  EXPECT_EQ(heap[99], 7);
+}
@@ -0,0 +1,23 @@
+#include "util/bits.h"
+#include <cstdint>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(BitsTest, TestReverseBits) {
+  EXPECT_EQ(reverseBits(0u), 0u);
+  EXPECT_EQ(reverseBits(1u), 0x80000000u);
+  EXPECT_EQ(reverseBits(0x80000000u), 1u);
+  EXPECT_EQ(reverseBits(0xffffffffu), 0xffffffffu);
+  EXPECT_EQ(reverseBits(0x12345678u), 0x1e6a2c48u);
+  // Bit by bit, and an involution.
+  for (uint32_t x = 0; x < 1000; ++x) {
+    uint32_t expected = 0;
+    for (int i = 0; i < 32; ++i) {
+      expected |= ((x >> i) & 1u) << (31 - i);
+    }
+    EXPECT_EQ(reverseBits(x), expected);
+    EXPECT_EQ(reverseBits(reverseBits(x * 2654435761u)), x * 2654435761u);
+  }
+}
@@ -0,0 +1,72 @@
+#include "util/cow_vector.h"
+#include <thread>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(CowVectorTest, TestCopySharesBuffer) {
+  CowVector<int> a(vector<int>{1, 2, 3});
+  EXPECT_FALSE(a.isShared());
+  CowVector<int> b = a;
+  EXPECT_TRUE(a.isShared());
+  EXPECT_TRUE(b.isShared());
+  EXPECT_EQ(a.buffer(), b.buffer());
+  EXPECT_EQ(b.size(), 3);
+  EXPECT_EQ(b[2], 3);
+
+  // Mutating one copy detaches it from the other.
+  b.mutate().push_back(4);
+  EXPECT_NE(a.buffer(), b.buffer());
+  EXPECT_FALSE(a.isShared());
+  EXPECT_EQ(a.get(), vector<int>({1, 2, 3}));
+  EXPECT_EQ(b.get(), vector<int>({1, 2, 3, 4}));
+
+  // Mutating an unshared copy does not clone.
+  const void* buffer = b.buffer();
+  b.mutate()[0] = 5;
+  EXPECT_EQ(b.buffer(), buffer);
+  EXPECT_EQ(b[0], 5);
+}
+
+TEST(CowVectorTest, TestAssignAndClear) {
+  CowVector<int> a;
+  EXPECT_TRUE(a.empty());
+  CowVector<int> b = a;
+  vector<int> data = {7, 8};
+  a.assign(std::move(data));
+  EXPECT_EQ(a.size(), 2);
+  EXPECT_TRUE(b.empty());
+  b = a;
+  a.clear();
+  EXPECT_TRUE(a.empty());
+  EXPECT_FALSE(b.isShared());
+  int sum = 0;
+  for (int v : b) {
+    sum += v;
+  }
+  EXPECT_EQ(sum, 15);
+}
+
+TEST(CowVectorTest, TestConcurrentMutationOfCopies) {
+  CowVector<int> original(vector<int>(1000, 1));
+  vector<CowVector<int>> copies(8, original);
+  vector<thread> threads;
+  for (unsigned int i = 0; i < copies.size(); ++i) {
+    threads.push_back(thread([&copies, i]() {
+      auto& data = copies[i].mutate();
+      for (auto& v : data) {
+        v += i;
+      }
+    }));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (unsigned int i = 0; i < copies.size(); ++i) {
+    EXPECT_EQ(copies[i][999], 1 + i);
+  }
+  EXPECT_EQ(original[0], 1);
+}
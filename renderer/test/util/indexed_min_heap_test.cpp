@@ -0,0 +1,40 @@
+#include "util/indexed_min_heap.h"
+#include <vector>
+#include <gtest/gtest.h>
+
+TEST(IndexedMinHeapTest, TestPushAndPopInOrder) {
+  hd::IndexedMinHeap heap(8);
+  EXPECT_TRUE(heap.empty());
+  double priorities[8] = {5.0, 3.0, 7.0, 1.0, 4.0, 6.0, 2.0, 0.5};
+  for (unsigned int key = 0; key < 8; ++key) {
+    heap.push(key, priorities[key]);
+  }
+  EXPECT_EQ(heap.size(), 8);
+  std::vector<unsigned int> order;
+  while (!heap.empty()) {
+    order.push_back(heap.pop());
+  }
+  EXPECT_EQ(order, std::vector<unsigned int>({7, 3, 6, 1, 4, 0, 5, 2}));
+}
+
+TEST(IndexedMinHeapTest, TestUpdateAndRemove) {
+  hd::IndexedMinHeap heap(5);
+  for (unsigned int key = 0; key < 5; ++key) {
+    heap.push(key, key);
+  }
+  // Decrease, increase and remove keys in the middle of the heap.
+  heap.push(3, -1.0);
+  heap.push(0, 10.0);
+  heap.remove(1);
+  heap.remove(1);
+  EXPECT_FALSE(heap.contains(1));
+  EXPECT_TRUE(heap.contains(0));
+  EXPECT_EQ(heap.priority(0), 10.0);
+  EXPECT_EQ(heap.top(), 3);
+  EXPECT_EQ(heap.topPriority(), -1.0);
+  EXPECT_EQ(heap.pop(), 3);
+  EXPECT_EQ(heap.pop(), 2);
+  EXPECT_EQ(heap.pop(), 4);
+  EXPECT_EQ(heap.pop(), 0);
+  EXPECT_TRUE(heap.empty());
+}
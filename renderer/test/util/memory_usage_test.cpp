@@ -0,0 +1,50 @@
+#include "util/memory_usage.h"
+#include "util/arena.h"
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(MemoryUsageTest, TestTotal) {
+  MemoryUsage usage;
+  usage.positions = 1024;
+  usage.slack = 10;
+  MemoryUsage other;
+  other.nodes = 2 * 1024 * 1024;
+  usage += other;
+  EXPECT_EQ(usage.total(), 1024 + 10 + 2 * 1024 * 1024);
+  string summary = usage.toString();
+  EXPECT_NE(summary.find("total=2.0MiB"), string::npos);
+  EXPECT_NE(summary.find("positions=1.0KiB"), string::npos);
+  EXPECT_NE(summary.find("slack=10B"), string::npos);
+}
+
+TEST(MemoryUsageTest, TestHeapBlockBytes) {
+  EXPECT_EQ(heapBlockBytes(0), 0);
+  EXPECT_EQ(heapBlockBytes(1), 32);
+  EXPECT_EQ(heapBlockBytes(24), 32);
+  EXPECT_EQ(heapBlockBytes(25), 48);
+  EXPECT_EQ(heapBlockBytes(1 << 20), (1 << 20) + 4096);
+
+  vector<double> v;
+  v.reserve(10);
+  v.push_back(1.0);
+  EXPECT_EQ(heapSlack(v), heapBlockBytes(80) - 8);
+}
+
+TEST(MemoryUsageTest, TestCounter) {
+  MemoryCounter counter;
+  int a = 0;
+  int b = 0;
+  EXPECT_TRUE(counter.add(&a));
+  EXPECT_FALSE(counter.add(&a));
+  EXPECT_TRUE(counter.add(&b));
+
+  Arena arena(4096);
+  arena.allocate(100);
+  counter.addArenaBytes(&arena, 100);
+  counter.addArenaBytes(&arena, 200);
+  EXPECT_EQ(counter.arenaSlack(), 4096 - 300);
+}
@@ -0,0 +1,33 @@
+#include "util/parallel.h"
+#include <atomic>
+#include <vector>
+#include <gtest/gtest.h>
+
+TEST(ParallelTest, TestEveryIndexVisitedOnce) {
+  std::vector<std::atomic<int>> visits(100003);
+  for (auto& v : visits) {
+    v = 0;
+  }
+  hd::parallelFor(3, visits.size(), [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      ++visits[i];
+    }
+  }, 1000);
+  for (std::size_t i = 0; i < visits.size(); ++i) {
+    EXPECT_EQ(visits[i], i < 3 ? 0 : 1);
+  }
+}
+
+TEST(ParallelTest, TestEmptyAndSmallRanges) {
+  int calls = 0;
+  hd::parallelFor(5, 5, [&](std::size_t, std::size_t) { ++calls; });
+  EXPECT_EQ(calls, 0);
+  // Small ranges run on the calling thread as a single chunk.
+  hd::parallelFor(0, 10, [&](std::size_t begin, std::size_t end) {
+    ++calls;
+    EXPECT_EQ(begin, 0);
+    EXPECT_EQ(end, 10);
+  });
+  EXPECT_EQ(calls, 1);
+  EXPECT_GE(hd::parallelThreadNum(), 1);
+}
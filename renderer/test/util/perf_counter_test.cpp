@@ -0,0 +1,26 @@
+#include "util/perf_counter.h"
+#include <cstdint>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+
+TEST(PerfCounterTest, TestCount) {
+  PerfCounter counter(PerfCounter::Event::INSTRUCTIONS);
+  counter.start();
+  std::vector<uint64_t> values(1 << 16);
+  for (std::size_t i = 1; i < values.size(); ++i) {
+    values[i] = values[i - 1] * 31 + i;
+  }
+  counter.stop();
+  uint64_t count = counter.value();
+  if (!counter.isAvailable()) {
+    // Hardware counters are not exposed, e.g. in virtual machines.
+    EXPECT_EQ(count, 0);
+    return;
+  }
+  EXPECT_GT(count, values.size());
+  // Stopped counters do not count.
+  EXPECT_EQ(counter.value(), count);
+  EXPECT_NE(values.back(), 0);
+}
@@ -0,0 +1,59 @@
+#include "util/philox.h"
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace hd;
+using namespace std;
+
+TEST(PhiloxTest, TestKnownAnswers) {
+  // Known answer tests of the Random123 distribution.
+  Philox4x32::Counter zero = Philox4x32::generate({{0, 0, 0, 0}}, {{0, 0}});
+  EXPECT_EQ(zero[0], 0x6627e8d5u);
+  EXPECT_EQ(zero[1], 0xe169c58du);
+  EXPECT_EQ(zero[2], 0xbc57ac4cu);
+  EXPECT_EQ(zero[3], 0x9b00dbd8u);
+
+  Philox4x32::Counter ones = Philox4x32::generate(
+      {{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}}, {{0xffffffff, 0xffffffff}});
+  EXPECT_EQ(ones[0], 0x408f276du);
+  EXPECT_EQ(ones[1], 0x41c83b0eu);
+  EXPECT_EQ(ones[2], 0xa20bc7c6u);
+  EXPECT_EQ(ones[3], 0x6d5451fdu);
+
+  Philox4x32::Counter pi = Philox4x32::generate(
+      {{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}}, {{0xa4093822, 0x299f31d0}});
+  EXPECT_EQ(pi[0], 0xd16cfe09u);
+  EXPECT_EQ(pi[1], 0x94fdccebu);
+  EXPECT_EQ(pi[2], 0x5001e420u);
+  EXPECT_EQ(pi[3], 0x24126ea1u);
+}
+
+TEST(PhiloxTest, TestBatch) {
+  // More counters than a group of lanes, and not a multiple of it.
+  const size_t n = 1000;
+  Philox4x32::Key key = {{7, 11}};
+  vector<uint32_t> counter[4];
+  vector<uint32_t> result[4];
+  for (unsigned int j = 0; j < 4; ++j) {
+    counter[j].resize(n);
+    result[j].resize(n);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    counter[0][i] = static_cast<uint32_t>(i % 37);
+    counter[1][i] = static_cast<uint32_t>(i / 37);
+    counter[2][i] = static_cast<uint32_t>(i * 7);
+    counter[3][i] = 3;
+  }
+  const uint32_t* counters[4] = {counter[0].data(), counter[1].data(), counter[2].data(),
+      counter[3].data()};
+  uint32_t* results[4] = {result[0].data(), result[1].data(), result[2].data(),
+      result[3].data()};
+  Philox4x32::generate(n, counters, key, results);
+  for (size_t i = 0; i < n; ++i) {
+    Philox4x32::Counter expected = Philox4x32::generate(
+        {{counter[0][i], counter[1][i], counter[2][i], counter[3][i]}}, key);
+    for (unsigned int j = 0; j < 4; ++j) {
+      EXPECT_EQ(result[j][i], expected[j]);
+    }
+  }
+}